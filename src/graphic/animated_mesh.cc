@@ -1,12 +1,11 @@
 
-#include <d3d9.h>
 #include <vector>
 #include <util/logger.h>
 #include "uber_shader.h"
 #include "uber_draw_call.h"
 #include "animated_model.h"
 #include "renderer.h"
-#include "scheduler.h"
+#include "draw_call_bucket.h"
 #include "animated_mesh.h"
 
 namespace graphic
@@ -73,23 +72,20 @@ void BasicAnimatedMesh<V>::check()
 }
 
 template<class V>
-void BasicAnimatedMesh<V>::draw(Joint *joint_ptr, CameraPtr const &camera,
-	math::matrix<4,4> const &world_matrix)
+void BasicAnimatedMesh<V>::draw(Model const &model, Joint const *joint_ptr, CameraPtr const &camera,
+	math::matrix<4,4> const &world_matrix, DrawCallBucket &bucket)
 {
-	math::matrix<4,4> transform = world_matrix * joint_ptr->matrix;
+	math::matrix<4,4> transform = world_matrix * model.get_joint_matrix(joint_ptr->index);
 
-    std::vector<math::matrix<4,4> > joint_matrix_array;
-    joint_matrix_array.reserve(this->joint_index_transform.size());
+	// matrices are shared by calls of all triangle lists and live in arena of bucket until it is cleared
+	size_t const joints_count = this->joint_index_transform.size();
+	math::matrix<4,4> *joint_matrices = bucket.allocate_matrices(joints_count);
 
-    for (typename BasicStaticMesh<V>::joint_index_transform_type::const_iterator it = this->joint_index_transform.begin();
-         it != this->joint_index_transform.end(); it++)
-    {
-		math::matrix<4,4> t = this->bind_shape_matrix *
-			this->inverted_bind_matrices[*it] *
-			get_model()->joints[*it]->matrix;
-
-        joint_matrix_array.push_back(t);
-    }
+	for (size_t i = 0; i < joints_count; ++i)
+	{
+		size_t const index = this->joint_index_transform[i];
+		joint_matrices[i] = this->bind_shape_matrix * this->inverted_bind_matrices[index] * model.get_joint_matrix(index);
+	}
 
 	math::obb<3> bounds(this->bounds_);
 	bounds.transform(transform);
@@ -97,7 +93,7 @@ void BasicAnimatedMesh<V>::draw(Joint *joint_ptr, CameraPtr const &camera,
 	for (typename Mesh::triangles_list_type::const_iterator it = this->triangles_list.begin();
 		 it != this->triangles_list.end(); it++)
 	{
-		UberDrawCallPtr draw_call = get_model()->get_renderer()->create_uber_draw_call();
+		UberDrawCall *draw_call = bucket.create_uber_draw_call();
 
 		draw_call->set_obb(bounds);
 		draw_call->set_vertex_buffer(this->vertex_array_->get_vertex_buffer());
@@ -109,11 +105,11 @@ void BasicAnimatedMesh<V>::draw(Joint *joint_ptr, CameraPtr const &camera,
 		draw_call->set_triangles_count(it->triangles_count);
 		draw_call->set_world_matrix(transform);
 		draw_call->set_camera(camera);
-		draw_call->set_joint_matrix_array(joint_matrix_array);
+		draw_call->set_joint_matrices(joint_matrices, joints_count);
 		draw_call->set_always_visible(this->always_visible_);
 		draw_call->commit();
 
-		get_model()->get_scheduler()->add(draw_call);
+		bucket.add(draw_call);
 	}
 }
 
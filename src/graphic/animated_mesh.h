@@ -20,7 +20,8 @@ public:
 
 	virtual void check();
 
-    virtual void draw(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
+    virtual void draw(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix,
+		DrawCallBucket &bucket);
 };
 
 typedef BasicAnimatedMesh<VERTEX_PNJWT> AnimatedMeshPNJWT;
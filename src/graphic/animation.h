@@ -10,14 +10,36 @@ namespace graphic
 
 struct Animation {
 	typedef std::vector<Sampler> samplers_type;
+	// keys found by samplers last time, every playback of animation has its own cursor
+	typedef std::vector<size_t> cursor_type;
 
 	std::string name;
 	samplers_type samplers;
 
-	void set_time(math::scalar t) {
+	// pose of whole skeleton in one pass, transforms are indexed by skeleton slots and samplers without
+	// resolved targets are skipped
+	void sample(math::scalar t, math::matrix<4,4> *transforms, cursor_type &cursor) const {
+		cursor.resize(samplers.size());
+
+		for (size_t i = 0; i < samplers.size(); ++i) {
+			Sampler const &sampler = samplers[i];
+			if (sampler.get_slot() != Sampler::NO_SLOT) transforms[sampler.get_slot()] = sampler.get(t, cursor[i]);
+		}
+	}
+
+	void compress(math::scalar rotation_tolerance, math::scalar translation_tolerance, bool quantize) {
 		for (samplers_type::iterator it = samplers.begin(); it != samplers.end(); it++) {
-			it->set_target_matrix(t);
+			it->compress(rotation_tolerance, translation_tolerance, quantize);
+		}
+	}
+
+	// bytes allocated for keys of samplers
+	size_t get_memory_size() const {
+		size_t size = 0;
+		for (samplers_type::const_iterator it = samplers.begin(); it != samplers.end(); it++) {
+			size += it->get_memory_size();
 		}
+		return size;
 	}
 };
 
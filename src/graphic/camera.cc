@@ -1,5 +1,4 @@
 
-#include <d3dx9.h>
 #include <stdexcept>
 #include <luabind/luabind.hpp>
 #include "camera.h"
@@ -1901,6 +1901,7 @@ public:
 			visual_scenes_->build_hierarchy();
 			if (controllers_.get()) controllers_->build_joint_influences();
 			if (animations_.get()) animations_->build_animations();
+			model_ptr->build_skeleton();
 		}
 		catch(...)
 		{
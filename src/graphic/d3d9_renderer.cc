@@ -12,6 +12,7 @@
 #include "d3d9_shader.h"
 #include "d3d9_draw_call.h"
 #include "d3d9_uber_draw_call.h"
+#include "frame_arena.h"
 #include "d3d9_renderer.h"
 
 namespace graphic
@@ -22,7 +23,8 @@ D3D9Renderer::D3D9Renderer(int width, int height, bool fullscreen, HWND window_h
 	window_handle_(window_handle ? window_handle : get_sdl_window_handle()),
 	screen_width_(width),
 	screen_height_(height),
-	fullscreen_(fullscreen)
+	fullscreen_(fullscreen),
+	instancing_supported_(false)
 {
 	init();
 }
@@ -111,6 +113,18 @@ void D3D9Renderer::init() {
 		device_.reset(device_ptr);
 		device_ptr->Release();
 	}
+
+	{
+		// stream frequencies need shader model 3
+		D3DCAPS9 caps;
+		hr = device_->GetDeviceCaps(&caps);
+		if (FAILED(hr)) throw directx_error(hr);
+
+		instancing_supported_ = caps.VertexShaderVersion >= D3DVS_VERSION(3, 0)
+			&& caps.PixelShaderVersion >= D3DPS_VERSION(3, 0);
+
+		LOG_INFO("instancing supported = " << instancing_supported_);
+	}
 }
 
 int D3D9Renderer::get_screen_width() const
@@ -156,6 +170,13 @@ void D3D9Renderer::postconstruct()
 
 	vertex_declarations_.reset(new D3D9VertexDeclarations(this));
 
+	if (instancing_supported_)
+	{
+		instance_buffer_.reset(new D3D9VertexBuffer(shared_from_this(),
+			DrawCall::MAX_INSTANCES_COUNT * sizeof(math::matrix<4,4>), true, true, 0, 0));
+		register_resource(instance_buffer_);
+	}
+
 	reset_state();
 }
 
@@ -293,11 +314,26 @@ UberDrawCallPtr D3D9Renderer::create_uber_draw_call()
 	return UberDrawCallPtr(new D3D9UberDrawCall(shared_from_this()));
 }
 
+UberDrawCall *D3D9Renderer::create_frame_uber_draw_call(FrameArena &arena)
+{
+	return new (arena.allocate(sizeof(D3D9UberDrawCall))) D3D9UberDrawCall(shared_from_this());
+}
+
 UberShaderPtr D3D9Renderer::get_uber_shader() const
 {
 	return uber_shader_;
 }
 
+bool D3D9Renderer::is_instancing_supported() const
+{
+	return instancing_supported_;
+}
+
+IDirect3DVertexBuffer9 *D3D9Renderer::get_instance_buffer() const
+{
+	return instance_buffer_->get();
+}
+
 HWND D3D9Renderer::get_sdl_window_handle() {
 	SDL_SysWMinfo si;
 	SDL_VERSION(&si.version);
@@ -12,6 +12,8 @@
 namespace graphic
 {
 
+class D3D9VertexBuffer;
+
 class D3D9Renderer: public Renderer {
 public:
 	D3D9RendererPtr shared_from_this()
@@ -52,9 +54,15 @@ public:
 
 	virtual DrawCallPtr create_draw_call();
 	virtual UberDrawCallPtr create_uber_draw_call();
+	virtual UberDrawCall *create_frame_uber_draw_call(FrameArena &arena);
 
 	virtual UberShaderPtr get_uber_shader() const;
 
+	virtual bool is_instancing_supported() const;
+
+	// dynamic buffer for world matrices of instanced draws, DrawCall::MAX_INSTANCES_COUNT fit in
+	IDirect3DVertexBuffer9 *get_instance_buffer() const;
+
 	template<class T>
 	void register_resource(boost::shared_ptr<T> const &resource)
 	{
@@ -81,6 +89,9 @@ private:
 	UberShaderPtr uber_shader_;
 	boost::scoped_ptr<D3D9VertexDeclarations> vertex_declarations_;
 
+	bool instancing_supported_;
+	boost::shared_ptr<D3D9VertexBuffer> instance_buffer_;
+
 	static HWND get_sdl_window_handle();
 	void handle_resize();
 };
@@ -47,7 +47,12 @@ public:
 
 	virtual void set(std::vector<math::matrix<4,4> > const &value)
 	{
-		HRESULT hr = shader_->get()->SetMatrixArray(handle_, (D3DXMATRIX const *) &value[0], value.size());
+		set(value.empty() ? 0 : &value[0], value.size());
+	}
+
+	virtual void set(math::matrix<4,4> const *matrices, size_t count)
+	{
+		HRESULT hr = shader_->get()->SetMatrixArray(handle_, (D3DXMATRIX const *) matrices, count);
 		if (FAILED(hr)) throw directx_error(hr);
 	}
 
@@ -30,7 +30,7 @@ void D3D9Texture::create_texture() {
 
 	IDirect3DTexture9 *texture_ptr;
 	HRESULT hr = renderer_->get_device()->CreateTexture(width_, height_, 0, usage_,
-		pixel_format.direct3d_format, pool_, &texture_ptr, 0);
+		(D3DFORMAT) pixel_format.direct3d_format, pool_, &texture_ptr, 0);
 	if (FAILED(hr)) throw directx_error(hr);
 	texture_.reset(texture_ptr);
 	texture_ptr->Release();
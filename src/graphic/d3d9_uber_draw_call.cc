@@ -1,4 +1,6 @@
 
+#include <cstring>
+#include <stdexcept>
 #include "directx_error.h"
 #include "vertex_array.h"
 #include "index_array.h"
@@ -44,29 +46,83 @@ void D3D9UberDrawCall::execute()
     hr = device_ptr->SetIndices(index_buffer->get());
 	if (FAILED(hr)) throw directx_error(hr);
 
-	if (material_)
+	set_material_parameters(*shader_instance);
+
+	shader_instance->world_matrix->set(world_matrix_);
+	shader_instance->world_view_projection_matrix->set(world_view_projection_matrix_);
+
+	if (shader_instance->joint_matrix_array && joint_matrices_count_)
+		shader_instance->joint_matrix_array->set(joint_matrices_, joint_matrices_count_);
+
+	draw_passes(shader);
+}
+
+void D3D9UberDrawCall::execute_instanced(math::matrix<4,4> const *world_matrices, size_t count)
+{
+	if (count > MAX_INSTANCES_COUNT) throw std::logic_error("too many instances");
+
+	HRESULT hr;
+
+	IDirect3DDevice9 *device_ptr = renderer_->get_device();
+	D3D9VertexBuffer *vertex_buffer = static_cast<D3D9VertexBuffer *>(vertex_buffer_.get());
+	D3D9IndexBuffer *index_buffer = static_cast<D3D9IndexBuffer *>(index_buffer_.get());
+	IDirect3DVertexBuffer9 *instance_buffer = renderer_->get_instance_buffer();
+	VertexTraits const *vertex_traits = vertex_buffer->get_vertex_traits();
+	UberShader::InstancePtr shader_instance = shader_->get_instance(vertex_traits->get_format(), material_, true);
+	D3D9Shader *shader = static_cast<D3D9Shader *>(shader_instance->get_shader().get());
+
 	{
-		material_->select();
+		void *ptr = 0;
 
-		for (size_t i = 0; i < UberShader::DIFFUSE_TEXTURES_COUNT && i < material_->get_diffuse_textures_count(); ++i)
-		{
-			shader_instance->diffuse_textures[i]->set(material_->get_diffuse_texture(i));
-		}
+		hr = instance_buffer->Lock(0, UINT(sizeof(*world_matrices) * count), &ptr, D3DLOCK_DISCARD);
+		if (FAILED(hr)) throw directx_error(hr);
 
-		if (material_->get_texture_blending_weights_texture())
-		{
-			shader_instance->texture_blending_weights_texture->set(material_->get_texture_blending_weights_texture());
-		}
+		memcpy(ptr, world_matrices, sizeof(*world_matrices) * count);
+
+		hr = instance_buffer->Unlock();
+		if (FAILED(hr)) throw directx_error(hr);
 	}
 
-	if (shader_instance->normal_map_texture)
-		shader_instance->normal_map_texture->set(material_ ? material_->get_normal_map_texture() : TexturePtr());
+	hr = device_ptr->SetVertexDeclaration(renderer_->get_vertex_declarations()->get(vertex_traits, true));
+	if (FAILED(hr)) throw directx_error(hr);
 
-	shader_instance->world_matrix->set(world_matrix_);
-	shader_instance->world_view_projection_matrix->set(world_view_projection_matrix_);
+	// geometry is repeated count times, instance stream advances once per instance
+	hr = device_ptr->SetStreamSource(0, vertex_buffer->get(), 0, vertex_traits->get_size());
+	if (FAILED(hr)) throw directx_error(hr);
+
+	hr = device_ptr->SetStreamSourceFreq(0, D3DSTREAMSOURCE_INDEXEDDATA | UINT(count));
+	if (FAILED(hr)) throw directx_error(hr);
+
+	hr = device_ptr->SetStreamSource(1, instance_buffer, 0, sizeof(*world_matrices));
+	if (FAILED(hr)) throw directx_error(hr);
+
+	hr = device_ptr->SetStreamSourceFreq(1, D3DSTREAMSOURCE_INSTANCEDATA | 1u);
+	if (FAILED(hr)) throw directx_error(hr);
+
+	hr = device_ptr->SetIndices(index_buffer->get());
+	if (FAILED(hr)) throw directx_error(hr);
+
+	set_material_parameters(*shader_instance);
+
+	shader_instance->view_projection_matrix->set(view_projection_matrix_);
+
+	draw_passes(shader);
 
-	if (shader_instance->joint_matrix_array && joint_matrix_array_.size())
-		shader_instance->joint_matrix_array->set(joint_matrix_array_);
+	hr = device_ptr->SetStreamSourceFreq(0, 1);
+	if (FAILED(hr)) throw directx_error(hr);
+
+	hr = device_ptr->SetStreamSourceFreq(1, 1);
+	if (FAILED(hr)) throw directx_error(hr);
+
+	hr = device_ptr->SetStreamSource(1, 0, 0, 0);
+	if (FAILED(hr)) throw directx_error(hr);
+}
+
+void D3D9UberDrawCall::draw_passes(D3D9Shader *shader)
+{
+	HRESULT hr;
+
+	IDirect3DDevice9 *device_ptr = renderer_->get_device();
 
 	UINT passes_count;
 	hr = shader->get()->Begin(&passes_count, D3DXFX_DONOTSAVESTATE);
@@ -5,15 +5,20 @@
 namespace graphic
 {
 
+class D3D9Shader;
+
 class D3D9UberDrawCall: public UberDrawCall {
 public:
 	D3D9UberDrawCall(D3D9RendererPtr const &renderer);
 	virtual ~D3D9UberDrawCall();
 
 	virtual void execute();
+	virtual void execute_instanced(math::matrix<4,4> const *world_matrices, size_t count);
 
 private:
 	D3D9RendererPtr const renderer_;
+
+	void draw_passes(D3D9Shader *shader);
 };
 
 }
@@ -1,4 +1,8 @@
 
+#include <stddef.h>
+#include <vector>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
 #include "directx_error.h"
 #include "d3d9_renderer.h"
 #include "d3d9_vertex_declarations.h"
@@ -6,6 +10,390 @@
 namespace graphic
 {
 
+namespace
+{
+
+template<class V> D3DVERTEXELEMENT9 const *get_vertex_descr();
+
+template<> D3DVERTEXELEMENT9 const *
+get_vertex_descr<VERTEX_PT>()
+{
+	static D3DVERTEXELEMENT9 descr[] = {
+		{
+			0,
+			offsetof(VERTEX_PT, position),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_POSITION,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PT, texcoords),
+			D3DDECLTYPE_FLOAT2,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			0
+		},
+
+		D3DDECL_END()
+	};
+
+	return descr;
+}
+
+template<> D3DVERTEXELEMENT9 const *
+get_vertex_descr<VERTEX_PNT>()
+{
+	static D3DVERTEXELEMENT9 descr[] = {
+		{
+			0,
+			offsetof(VERTEX_PNT, position),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_POSITION,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNT, normal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_NORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNT, texcoords),
+			D3DDECLTYPE_FLOAT2,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			0
+		},
+
+		D3DDECL_END()
+	};
+
+	return descr;
+}
+
+template<> D3DVERTEXELEMENT9 const *
+get_vertex_descr<VERTEX_PNTB>()
+{
+	static D3DVERTEXELEMENT9 descr[] = {
+		{
+			0,
+			offsetof(VERTEX_PNTB, position),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_POSITION,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNTB, normal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_NORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNTB, texcoords),
+			D3DDECLTYPE_FLOAT2,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNTB, texutre_blend_weights),
+			D3DDECLTYPE_FLOAT4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			1
+		},
+
+		D3DDECL_END()
+	};
+
+	return descr;
+}
+
+template<> D3DVERTEXELEMENT9 const *
+get_vertex_descr<VERTEX_PTBNT>()
+{
+	static D3DVERTEXELEMENT9 descr[] = {
+		{
+			0,
+			offsetof(VERTEX_PTBNT, position),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_POSITION,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNT, tangent),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TANGENT,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNT, binormal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BINORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNT, normal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_NORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNT, texcoords),
+			D3DDECLTYPE_FLOAT2,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			0
+		},
+
+		D3DDECL_END()
+	};
+
+	return descr;
+}
+
+template<> D3DVERTEXELEMENT9 const *
+get_vertex_descr<VERTEX_PNJWT>()
+{
+	static D3DVERTEXELEMENT9 descr[] = {
+		{
+			0,
+			offsetof(VERTEX_PNJWT, position),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_POSITION,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNJWT, normal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_NORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNJWT, joints),
+			D3DDECLTYPE_UBYTE4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDINDICES,
+			0
+		},
+
+        {
+			0,
+			offsetof(VERTEX_PNJWT, joints) + 4,
+			D3DDECLTYPE_UBYTE4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDINDICES,
+			1
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNJWT, weights),
+			D3DDECLTYPE_FLOAT4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDWEIGHT,
+			0
+		},
+
+        {
+			0,
+			offsetof(VERTEX_PNJWT, weights) + 16,
+			D3DDECLTYPE_FLOAT4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDWEIGHT,
+			1
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PNJWT, texcoords),
+			D3DDECLTYPE_FLOAT2,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			0
+		},
+
+		D3DDECL_END()
+	};
+
+	return descr;
+}
+
+template<> D3DVERTEXELEMENT9 const *
+get_vertex_descr<VERTEX_PTBNJWT>()
+{
+	static D3DVERTEXELEMENT9 descr[] = {
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, position),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_POSITION,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, tangent),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TANGENT,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, binormal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BINORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, normal),
+			D3DDECLTYPE_FLOAT3,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_NORMAL,
+			0
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, joints),
+			D3DDECLTYPE_UBYTE4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDINDICES,
+			0
+		},
+
+        {
+			0,
+			offsetof(VERTEX_PTBNJWT, joints) + 4,
+			D3DDECLTYPE_UBYTE4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDINDICES,
+			1
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, weights),
+			D3DDECLTYPE_FLOAT4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDWEIGHT,
+			0
+		},
+
+        {
+			0,
+			offsetof(VERTEX_PTBNJWT, weights) + 16,
+			D3DDECLTYPE_FLOAT4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_BLENDWEIGHT,
+			1
+		},
+
+		{
+			0,
+			offsetof(VERTEX_PTBNJWT, texcoords),
+			D3DDECLTYPE_FLOAT2,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			0
+		},
+
+		D3DDECL_END()
+	};
+
+	return descr;
+}
+
+D3DVERTEXELEMENT9 const *get_vertex_descr(GenericVertex::format_type format)
+{
+	switch (format)
+	{
+	case VERTEX_PT::FORMAT: return get_vertex_descr<VERTEX_PT>();
+	case VERTEX_PNT::FORMAT: return get_vertex_descr<VERTEX_PNT>();
+	case VERTEX_PNTB::FORMAT: return get_vertex_descr<VERTEX_PNTB>();
+	case VERTEX_PTBNT::FORMAT: return get_vertex_descr<VERTEX_PTBNT>();
+	case VERTEX_PNJWT::FORMAT: return get_vertex_descr<VERTEX_PNJWT>();
+	case VERTEX_PTBNJWT::FORMAT: return get_vertex_descr<VERTEX_PTBNJWT>();
+
+	default:
+		throw std::logic_error("vertex format " + boost::lexical_cast<std::string>(format)
+			+ " has no direct3d declaration");
+	}
+}
+
+// elements of vertex followed by world matrix rows at TEXCOORD4-7 of stream 1, as uber_shader.fx expects
+std::vector<D3DVERTEXELEMENT9> get_instanced_vertex_descr(GenericVertex::format_type format)
+{
+	D3DVERTEXELEMENT9 const end = D3DDECL_END();
+	std::vector<D3DVERTEXELEMENT9> descr;
+
+	for (D3DVERTEXELEMENT9 const *element = get_vertex_descr(format); element->Stream != end.Stream; ++element)
+	{
+		descr.push_back(*element);
+	}
+
+	for (BYTE row = 0; row < 4; ++row)
+	{
+		D3DVERTEXELEMENT9 const element = {
+			1,
+			WORD(row * sizeof(math::vec<4>)),
+			D3DDECLTYPE_FLOAT4,
+			D3DDECLMETHOD_DEFAULT,
+			D3DDECLUSAGE_TEXCOORD,
+			BYTE(4 + row)
+		};
+
+		descr.push_back(element);
+	}
+
+	descr.push_back(end);
+
+	return descr;
+}
+
+}
+
 D3D9VertexDeclarations::D3D9VertexDeclarations(D3D9Renderer * const renderer_ptr):
 	renderer_(renderer_ptr)
 {
@@ -15,18 +403,28 @@ D3D9VertexDeclarations::~D3D9VertexDeclarations()
 {
 }
 
-IDirect3DVertexDeclaration9 *D3D9VertexDeclarations::get(VertexTraits const *vertex_traits)
+IDirect3DVertexDeclaration9 *D3D9VertexDeclarations::get(VertexTraits const *vertex_traits, bool instanced)
 {
-	traits_to_declarations_t::const_iterator it = traits_to_declarations_.find(vertex_traits);
+	traits_to_declarations_t::const_iterator it = traits_to_declarations_.find(std::make_pair(vertex_traits, instanced));
 
 	if (it == traits_to_declarations_.end())
 	{
 		IDirect3DVertexDeclaration9 *decl_ptr;
+		HRESULT hr;
+
+		if (instanced)
+		{
+			std::vector<D3DVERTEXELEMENT9> const descr = get_instanced_vertex_descr(vertex_traits->get_format());
+			hr = renderer_->get_device()->CreateVertexDeclaration(&descr[0], &decl_ptr);
+		}
+		else
+		{
+			hr = renderer_->get_device()->CreateVertexDeclaration(get_vertex_descr(vertex_traits->get_format()), &decl_ptr);
+		}
 
-		HRESULT hr = renderer_->get_device()->CreateVertexDeclaration(vertex_traits->get_descr(), &decl_ptr);
 		if (FAILED(hr)) throw directx_error(hr);
 
-		traits_to_declarations_.insert(std::make_pair(vertex_traits, VertexDeclarationPtr(decl_ptr)));
+		traits_to_declarations_.insert(std::make_pair(std::make_pair(vertex_traits, instanced), VertexDeclarationPtr(decl_ptr)));
 
 		decl_ptr->Release();
 
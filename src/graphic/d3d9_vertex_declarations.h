@@ -23,13 +23,14 @@ public:
 		return get(VertexTraits::get<V>());
 	}
 
-	IDirect3DVertexDeclaration9 *get(VertexTraits const *vertex_traits);
+	// instanced declaration takes rows of world matrix from stream 1
+	IDirect3DVertexDeclaration9 *get(VertexTraits const *vertex_traits, bool instanced = false);
 
 private:
 	D3D9Renderer * const renderer_;
 
 	typedef boost::intrusive_ptr<IDirect3DVertexDeclaration9> VertexDeclarationPtr;
-	typedef std::map<VertexTraits const *,  VertexDeclarationPtr> traits_to_declarations_t;
+	typedef std::map<std::pair<VertexTraits const *, bool>, VertexDeclarationPtr> traits_to_declarations_t;
 
 	traits_to_declarations_t traits_to_declarations_;
 };
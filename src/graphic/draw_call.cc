@@ -1,8 +1,13 @@
 
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/static_assert.hpp>
 #include <luabind/luabind.hpp>
 #include <math/frustum.h>
-#include "directx_error.h"
 #include "vertex_traits.h"
+#include "vertex_buffer.h"
 #include "camera.h"
 #include "uber_shader.h"
 #include "texture.h"
@@ -20,8 +25,10 @@ DrawCall::DrawCall(RendererPtr const &renderer):
 	minimal_vertex_index_(0),
 	vertices_count_(0),
 	first_index_offset_(0),
-	triangles_count_(0)
+	triangles_count_(0),
+	sort_key_(0)
 {
+	bounds_ = math::aabb<3>(math::vec<3>(0, 0, 0));
 	world_matrix_.identity();
 }
 
@@ -31,7 +38,7 @@ DrawCall::~DrawCall()
 
 void DrawCall::set_priority(int priority)
 {
-	priority_ = priority_;
+	priority_ = priority;
 }
 
 void DrawCall::set_always_visible(bool always_visible)
@@ -99,14 +106,13 @@ void DrawCall::commit()
 	world_view_projection_matrix_ = world_matrix_ * view_projection_matrix_;
 
 	frustum_.load(view_projection_matrix_);
+
+	sort_key_ = make_sort_key();
 }
 
 bool DrawCall::operator <(DrawCall const &rhs) const
 {
-	if (priority_ < rhs.priority_) return true;
-	if (priority_ > rhs.priority_) return false;
-
-	return material_ < rhs.material_;
+	return sort_key_ < rhs.sort_key_;
 }
 
 bool DrawCall::is_visible() const
@@ -114,10 +120,66 @@ bool DrawCall::is_visible() const
 	return always_visible_ || frustum_.test_intersection(bounds_);
 }
 
+bool DrawCall::is_instance_of(DrawCall const &rhs) const
+{
+	return vertex_buffer_ == rhs.vertex_buffer_
+		&& index_buffer_ == rhs.index_buffer_
+		&& material_ == rhs.material_
+		&& minimal_vertex_index_ == rhs.minimal_vertex_index_
+		&& vertices_count_ == rhs.vertices_count_
+		&& first_index_offset_ == rhs.first_index_offset_
+		&& triangles_count_ == rhs.triangles_count_
+		&& std::memcmp(&view_projection_matrix_, &rhs.view_projection_matrix_, sizeof(view_projection_matrix_)) == 0
+		&& is_instanceable() && rhs.is_instanceable();
+}
+
 void DrawCall::execute()
 {
 }
 
+bool DrawCall::is_instanceable() const
+{
+	return false;
+}
+
+void DrawCall::execute_instanced(math::matrix<4,4> const *world_matrices, size_t count)
+{
+	throw std::logic_error("draw call could not be instanced");
+}
+
+unsigned DrawCall::get_shader_sort_id() const
+{
+	return 0;
+}
+
+boost::uint64_t DrawCall::make_sort_key() const
+{
+	BOOST_STATIC_ASSERT(SORT_KEY_PRIORITY_SHIFT + SORT_KEY_PRIORITY_BITS == 64);
+
+	unsigned const max_depth = (1u << SORT_KEY_DEPTH_BITS) - 1;
+
+	// distance of bounds centre along view direction, buckets are logarithmic so near objects
+	// are ordered more precisely
+	math::vec<3> const centre = bounds_.origin + (bounds_.tangent + bounds_.normal + bounds_.binormal) * 0.5f;
+	math::scalar const distance = (centre - camera_->get_eye_point()) & camera_->get_view_dir();
+
+	unsigned depth = 0;
+	if (distance > 0) depth = unsigned(std::min(std::log(1 + distance) / std::log(2.0f) * 256, math::scalar(max_depth)));
+	if (material_->is_alpha_blend_enabled()) depth = max_depth - depth;
+
+	TexturePtr const texture = material_->get_diffuse_textures_count() ? material_->get_diffuse_texture() : TexturePtr();
+
+	boost::uint64_t key = std::min(std::max(priority_ + 128, 0), 255);
+	key = (key << SORT_KEY_SHADER_BITS) | (get_shader_sort_id() & ((1u << SORT_KEY_SHADER_BITS) - 1));
+	key = (key << SORT_KEY_TEXTURE_BITS) | ((texture ? texture->get_sort_id() : 0) & ((1u << SORT_KEY_TEXTURE_BITS) - 1));
+	key = (key << SORT_KEY_MATERIAL_BITS) | (material_->get_sort_id() & ((1u << SORT_KEY_MATERIAL_BITS) - 1));
+	key = (key << SORT_KEY_MESH_BITS) | (vertex_buffer_ && !material_->is_alpha_blend_enabled() ?
+		vertex_buffer_->get_sort_id() & ((1u << SORT_KEY_MESH_BITS) - 1) : 0);
+	key = (key << SORT_KEY_DEPTH_BITS) | depth;
+
+	return key;
+}
+
 void DrawCall::bind(lua_State *L)
 {
 	using namespace luabind;
@@ -2,6 +2,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 #include <math/obb.h>
 #include <math/frustum.h>
 #include "forward.h"
@@ -11,6 +12,36 @@ namespace graphic
 
 class DrawCall: public boost::noncopyable {
 public:
+	// sort key is made at commit(), from highest bits: priority, shader, diffuse texture, material,
+	// vertex buffer and distance from camera, front to back for opaque and back to front for alpha
+	// blended materials. Vertex buffer bits are zero for alpha blended materials, so their order
+	// is kept, for opaque ones calls drawing same mesh go together and could be instanced.
+	static unsigned const SORT_KEY_DEPTH_BITS = 12;
+	static unsigned const SORT_KEY_MESH_BITS = 10;
+	static unsigned const SORT_KEY_MATERIAL_BITS = 13;
+	static unsigned const SORT_KEY_TEXTURE_BITS = 11;
+	static unsigned const SORT_KEY_SHADER_BITS = 10;
+	static unsigned const SORT_KEY_PRIORITY_BITS = 8;
+
+	static unsigned const SORT_KEY_MESH_SHIFT = SORT_KEY_DEPTH_BITS;
+	static unsigned const SORT_KEY_MATERIAL_SHIFT = SORT_KEY_MESH_SHIFT + SORT_KEY_MESH_BITS;
+	static unsigned const SORT_KEY_TEXTURE_SHIFT = SORT_KEY_MATERIAL_SHIFT + SORT_KEY_MATERIAL_BITS;
+	static unsigned const SORT_KEY_SHADER_SHIFT = SORT_KEY_TEXTURE_SHIFT + SORT_KEY_TEXTURE_BITS;
+	static unsigned const SORT_KEY_PRIORITY_SHIFT = SORT_KEY_SHADER_SHIFT + SORT_KEY_SHADER_BITS;
+
+	// instanced execution draws at most this many instances at once
+	static size_t const MAX_INSTANCES_COUNT = 1024;
+
+	static unsigned get_sort_key_shader(boost::uint64_t key)
+	{
+		return unsigned(key >> SORT_KEY_SHADER_SHIFT) & ((1u << SORT_KEY_SHADER_BITS) - 1);
+	}
+
+	static unsigned get_sort_key_material(boost::uint64_t key)
+	{
+		return unsigned(key >> SORT_KEY_MATERIAL_SHIFT) & ((1u << SORT_KEY_MATERIAL_BITS) - 1);
+	}
+
 	DrawCall(RendererPtr const &renderer);
 	virtual ~DrawCall();
 
@@ -31,11 +62,25 @@ public:
 	bool operator <(DrawCall const &rhs) const;
 
 	boost::shared_ptr<Material> get_material() const { return material_; }
+	bool is_always_visible() const { return always_visible_; }
+	math::obb<3> const &get_obb() const { return bounds_; }
+	math::matrix<4,4> const &get_view_projection_matrix() const { return view_projection_matrix_; }
+	math::frustum<> const &get_frustum() const { return frustum_; }
+	math::matrix<4,4> const &get_world_matrix() const { return world_matrix_; }
+	boost::uint64_t get_sort_key() const { return sort_key_; }
 
 	bool is_visible() const;
 
+	// true when rhs draws same range of same buffers with same material and camera, so both calls could be
+	// drawn by one instanced call, which differs only by world matrix
+	bool is_instance_of(DrawCall const &rhs) const;
+
 	virtual void execute();
 
+	// draws geometry of this call once for each world matrix, available when is_instanceable()
+	virtual bool is_instanceable() const;
+	virtual void execute_instanced(math::matrix<4,4> const *world_matrices, size_t count);
+
 	static void bind(lua_State *L);
 
 protected:
@@ -51,6 +96,13 @@ protected:
 	CameraPtr camera_;
 	math::matrix<4,4> view_projection_matrix_, world_view_projection_matrix_;
 	math::frustum<> frustum_;
+	boost::uint64_t sort_key_;
+
+	// id of shader draw call will use, zero for fixed function pipeline
+	virtual unsigned get_shader_sort_id() const;
+
+private:
+	boost::uint64_t make_sort_key() const;
 };
 
 }
@@ -0,0 +1,58 @@
+
+#include "renderer.h"
+#include "uber_draw_call.h"
+#include "draw_call_bucket.h"
+
+namespace graphic
+{
+
+DrawCallBucket::DrawCallBucket(RendererPtr const &renderer):
+	renderer_(renderer)
+{
+	draw_calls_.reserve(1024);
+	created_draw_calls_.reserve(1024);
+}
+
+DrawCallBucket::~DrawCallBucket()
+{
+	clear();
+}
+
+UberDrawCall *DrawCallBucket::create_uber_draw_call()
+{
+	UberDrawCall *draw_call = renderer_->create_frame_uber_draw_call(arena_);
+	created_draw_calls_.push_back(draw_call);
+	return draw_call;
+}
+
+math::matrix<4,4> *DrawCallBucket::allocate_matrices(size_t count)
+{
+	return static_cast<math::matrix<4,4> *>(arena_.allocate(count * sizeof(math::matrix<4,4>)));
+}
+
+void DrawCallBucket::add(DrawCall *draw_call)
+{
+	draw_calls_.push_back(draw_call);
+}
+
+void DrawCallBucket::add(DrawCallPtr const &draw_call)
+{
+	shared_draw_calls_.push_back(draw_call);
+	draw_calls_.push_back(draw_call.get());
+}
+
+void DrawCallBucket::clear()
+{
+	for (std::vector<DrawCall *>::iterator it = created_draw_calls_.begin(); it != created_draw_calls_.end(); ++it)
+	{
+		(*it)->~DrawCall();
+	}
+
+	created_draw_calls_.clear();
+	shared_draw_calls_.clear();
+	draw_calls_.clear();
+
+	arena_.reset();
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <math/matrix.h>
+#include "forward.h"
+#include "frame_arena.h"
+
+namespace graphic
+{
+
+// Draw calls recorded by one thread for scheduler. Threads could fill different buckets concurrently,
+// one bucket is used by one thread at a time. Buckets are merged and cleared by Scheduler::flush().
+class DrawCallBucket: public boost::noncopyable {
+public:
+	DrawCallBucket(RendererPtr const &renderer);
+	~DrawCallBucket();
+
+	// call is placed into frame arena of bucket and lives until bucket is cleared
+	UberDrawCall *create_uber_draw_call();
+
+	// matrices live in frame arena until bucket is cleared, they are not initialized
+	math::matrix<4,4> *allocate_matrices(size_t count);
+
+	// call created by this bucket
+	void add(DrawCall *draw_call);
+
+	// shared call is kept alive until bucket is cleared
+	void add(DrawCallPtr const &draw_call);
+
+	std::vector<DrawCall *> const &get_draw_calls() const { return draw_calls_; }
+	FrameArena const &get_arena() const { return arena_; }
+
+	// destroys created calls and releases shared ones, arena memory is kept for next frame
+	void clear();
+
+private:
+	RendererPtr const renderer_;
+	FrameArena arena_;
+
+	std::vector<DrawCall *> draw_calls_, created_draw_calls_;
+	std::vector<DrawCallPtr> shared_draw_calls_;
+};
+
+}
@@ -9,7 +9,9 @@ namespace graphic
 class Camera;
 class D3D9Renderer;
 class DrawCall;
+class DrawCallBucket;
 class Font;
+class FrameArena;
 class IndexBuffer;
 class Joint;
 class Material;
@@ -17,6 +19,7 @@ class Mesh;
 class MeshShader;
 class MeshShader;
 class Model;
+class RecordingRenderer;
 class Renderer;
 class Scheduler;
 class Shader;
@@ -37,6 +40,7 @@ typedef boost::shared_ptr<Material> MaterialPtr;
 typedef boost::shared_ptr<Mesh> MeshPtr;
 typedef boost::shared_ptr<MeshShader> MeshShaderPtr;
 typedef boost::shared_ptr<Model> ModelPtr;
+typedef boost::shared_ptr<RecordingRenderer> RecordingRendererPtr;
 typedef boost::shared_ptr<Renderer> RendererPtr;
 typedef boost::shared_ptr<Scheduler> SchedulerPtr;
 typedef boost::shared_ptr<Shader> ShaderPtr;
@@ -47,6 +51,7 @@ typedef boost::shared_ptr<VertexBuffer> VertexBufferPtr;
 typedef boost::weak_ptr<D3D9Renderer> D3D9RendererWeakPtr;
 typedef boost::weak_ptr<Joint> JointWeakPtr;
 typedef boost::weak_ptr<Mesh> MeshWeakPtr;
+typedef boost::weak_ptr<RecordingRenderer> RecordingRendererWeakPtr;
 typedef boost::weak_ptr<Renderer> RendererWeakPtr;
 
 }
@@ -0,0 +1,57 @@
+
+#include "frame_arena.h"
+
+namespace graphic
+{
+
+FrameArena::FrameArena():
+	block_(0),
+	offset_(0),
+	allocated_size_(0),
+	reserved_size_(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+	for (std::vector<Block>::iterator it = blocks_.begin(); it != blocks_.end(); ++it)
+	{
+		delete[] it->data;
+	}
+}
+
+void *FrameArena::allocate(size_t size)
+{
+	size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+	// rest of current block is skipped when object doesn't fit, blocks bigger than default are
+	// made for big objects
+	while (block_ < blocks_.size() && offset_ + size > blocks_[block_].size)
+	{
+		++block_;
+		offset_ = 0;
+	}
+
+	if (block_ == blocks_.size())
+	{
+		Block block = { 0, size > BLOCK_SIZE ? size : BLOCK_SIZE };
+		block.data = new char[block.size];
+		blocks_.push_back(block);
+
+		reserved_size_ += block.size;
+	}
+
+	void *ptr = blocks_[block_].data + offset_;
+	offset_ += size;
+	allocated_size_ += size;
+
+	return ptr;
+}
+
+void FrameArena::reset()
+{
+	block_ = offset_ = 0;
+	allocated_size_ = 0;
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace graphic
+{
+
+// Linear allocator for objects living one frame. Memory is taken from big blocks and is not freed
+// separately, reset() makes all blocks available again without returning them to heap. Objects with
+// destructors have to be destroyed by owner before reset.
+class FrameArena: public boost::noncopyable {
+public:
+	static size_t const BLOCK_SIZE = 64 * 1024;
+	static size_t const ALIGNMENT = 16;
+
+	FrameArena();
+	~FrameArena();
+
+	void *allocate(size_t size);
+	void reset();
+
+	// bytes allocated since last reset and bytes taken from heap
+	size_t get_allocated_size() const { return allocated_size_; }
+	size_t get_reserved_size() const { return reserved_size_; }
+
+private:
+	struct Block
+	{
+		char *data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks_;
+	size_t block_, offset_;
+	size_t allocated_size_, reserved_size_;
+};
+
+}
@@ -1,12 +1,12 @@
 #pragma once
 
-#include <d3d9.h>
 #include <boost/cstdint.hpp>
 
 namespace graphic
 {
 
-static D3DFORMAT const INDEX_FORMAT_U16 = D3DFMT_INDEX16;
+// same value as D3DFMT_INDEX16
+static unsigned const INDEX_FORMAT_U16 = 101;
 typedef boost::uint16_t INDEX_U16;
 
 }
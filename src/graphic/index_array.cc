@@ -1,6 +1,5 @@
 
 #include <luabind/luabind.hpp>
-#include "directx_error.h"
 #include "renderer.h"
 #include "index_array.h"
 
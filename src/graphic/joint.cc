@@ -12,7 +12,7 @@ void Joint::bind(lua_State *L)
 	module_(L, "graphic")
 	[
 		class_<Joint, JointPtr>("Joint")
-		.def_readwrite("matrix", &Joint::matrix)
+		.def_readonly("index", &Joint::index)
 	];
 }
 
@@ -29,8 +29,9 @@ public:
 	std::string id, name;
 	JointWeakPtr parent;
 	childs_type childs;
+	// local transforms as loaded, animated ones are kept in pose of model by skeleton slots; joints are shared
+	// by instances of model, so local-to-model matrices are kept by every instance, see Model::get_joint_matrix()
 	std::vector<transform> transforms;
-	mutable math::matrix<4,4> matrix;
 	boost::weak_ptr<Mesh> mesh_ptr;
 
 	Joint(size_t i):
@@ -44,24 +45,6 @@ public:
 		throw std::logic_error("transform sid = " + sid + " not found");
 	}
 
-	void build_frame_transforms()
-	{
-		matrix.identity();
-
-		for (std::vector<transform>::reverse_iterator it = transforms.rbegin();
-			it != transforms.rend(); it++)
-		{
-			matrix *= it->matrix;
-		}
-
-		if (JointPtr p = parent.lock()) matrix *= p->matrix;
-
-		for (childs_type::iterator it = childs.begin(); it != childs.end(); it++)
-		{
-			if (JointPtr child = it->lock()) child->build_frame_transforms();
-		}
-	}
-
 	static void bind(lua_State *L);
 };
 
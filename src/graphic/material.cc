@@ -1,19 +1,21 @@
 
 #include <luabind/luabind.hpp>
-#include "directx_error.h"
 #include <util/logger.h>
 #include "material.h"
 
 namespace graphic
 {
 
+unsigned Material::next_sort_id_ = 1;
+
 Material::Material(RendererPtr const &renderer_ptr):
 	renderer_(renderer_ptr),
 	cull_mode_(CULL_NONE),
 	zwrite_enabled_(true),
 	alpha_blend_enabled_(false),
 	src_blend_mode_(BLEND_ONE),
-	dest_blend_mode_(BLEND_ZERO)
+	dest_blend_mode_(BLEND_ZERO),
+	sort_id_(next_sort_id_++)
 {
 }
 
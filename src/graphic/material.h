@@ -39,6 +39,10 @@ public:
 	TexturePtr get_diffuse_texture(size_t index = 0) const { return diffuse_textures_.at(index); }
 	TexturePtr get_texture_blending_weights_texture() const { return texture_blending_weights_texture_; }
 	TexturePtr get_normal_map_texture() const {	return normal_map_texture_; }
+	bool is_alpha_blend_enabled() const { return alpha_blend_enabled_; }
+
+	// small number given to material on creation, draw calls are sorted by it
+	unsigned get_sort_id() const { return sort_id_; }
 
 	void set_name(std::string const &name) { name_ = name; }
 	void set_cull_mode(cull_mode_type cull_mode) { cull_mode_ = cull_mode; }
@@ -69,6 +73,11 @@ protected:
 	std::vector<TexturePtr> diffuse_textures_;
 	TexturePtr texture_blending_weights_texture_;
 	TexturePtr normal_map_texture_;
+
+private:
+	unsigned const sort_id_;
+
+	static unsigned next_sort_id_;
 };
 
 }
@@ -61,6 +61,8 @@ void MemoryMesh::set_vertices(GenericVertex *vertices, GenericVertex::format_typ
 		}
 	}
 
+	skin_.build(weights_.empty() ? 0 : &weights_[0], weights_.size());
+
 	initialized_vertex_components_ |= format;
 }
 
@@ -79,7 +81,7 @@ void MemoryMesh::set_always_visible(bool /*flag*/)
 	// frustum culling is not supported for memory mesh
 }
 
-void MemoryMesh::transform_vertices(Joint const *joint_ptr, std::vector<vertex_type> &result) const
+void MemoryMesh::transform_vertices(Model const &model, std::vector<vertex_type> &result) const
 {
     std::vector<math::matrix<4,4> > joint_matrix_array;
     joint_matrix_array.reserve(joint_index_transform.size());
@@ -89,42 +91,30 @@ void MemoryMesh::transform_vertices(Joint const *joint_ptr, std::vector<vertex_t
     {
 		math::matrix<4,4> t = bind_shape_matrix *
 			inverted_bind_matrices[*it] *
-			get_model()->joints[*it]->matrix;
+			model.get_joint_matrix(*it);
 
         joint_matrix_array.push_back(t);
     }
 
-	result = vertices_;
-
-	for (size_t i = 0; i < vertices_.size(); i++)
-	{
-		math::vec<3> pos(0, 0, 0);
+	// vertices could be replaced through bindings
+	if (skin_.get_vertices_count() != vertices_.size()) throw std::logic_error("vertices do not match weights");
 
-		math::vec<8, unsigned> const &indices = weights_[i].joints;
-		math::vec<8> const &weights = weights_[i].weights;
+	result.resize(vertices_.size());
+	if (vertices_.empty()) return;
 
-		for (size_t j = 0; j < 8; j++)
-		{
-			if (weights.i[j] > math::EPSILON)
-			{
-				pos += (vertices_[i].position * joint_matrix_array.at(indices.i[j])) * weights.i[j];
-			}
-		}
-
-		result[i].position = pos;
-	}
+	skin_.transform(&vertices_[0], joint_matrix_array.empty() ? 0 : &joint_matrix_array[0], joint_matrix_array.size(), &result[0]);
 }
 
 // Results of rendering via MemoryMesh and AnimatedMesh may differ if model have joint weights
 // and no animation: AnimatedMesh always computes positions of vertices using weights but MemoryMesh
 // uses weights only if model have animation. You can easily check if this is the cause just replacing
 // AnimatedMesh with StaticMesh and checking that rendering result is matching the one of MemoryMesh.
-void MemoryMesh::draw_static(Joint *joint_ptr, CameraPtr const &camera,
+void MemoryMesh::draw_static(Model const &model, Joint const *joint_ptr, CameraPtr const &camera,
 	math::matrix<4,4> const &world_matrix) const
 {
 	// TODO
 /*
-	RendererPtr const renderer_ptr = get_model()->get_renderer();
+	RendererPtr const renderer_ptr = model.get_renderer();
     ShadersLibrary *shaders_library_ptr = renderer_ptr->get_shaders_library();
 	IDirect3DDevice9 *device_ptr = renderer_ptr->get_device();
 
@@ -135,7 +125,7 @@ void MemoryMesh::draw_static(Joint *joint_ptr, CameraPtr const &camera,
 	{
 		it->material_ptr->select();
 
-		device_ptr->SetTransform(D3DTS_WORLD, (D3DMATRIX const *) joint_ptr->matrix.ij);
+		device_ptr->SetTransform(D3DTS_WORLD, (D3DMATRIX const *) model.get_joint_matrix(joint_ptr->index).ij);
 
 		device_ptr->DrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, it->minimal_vertex_index, it->vertices_count,
 			it->triangles_count, &indices_[it->first_index_offset], INDEX_FORMAT_U16, &vertices_[0], sizeof(vertex_type));
@@ -143,17 +133,17 @@ void MemoryMesh::draw_static(Joint *joint_ptr, CameraPtr const &camera,
 */
 }
 
-void MemoryMesh::draw_animated(Joint *joint_ptr, CameraPtr const &camera,
+void MemoryMesh::draw_animated(Model const &model, Joint const *joint_ptr, CameraPtr const &camera,
 	math::matrix<4,4> const &world_matrix) const
 {
 	// TODO
 /*
-	RendererPtr const renderer_ptr = get_model()->get_renderer();
+	RendererPtr const renderer_ptr = model.get_renderer();
     ShadersLibrary *shaders_library_ptr = renderer_ptr->get_shaders_library();
 	IDirect3DDevice9 *device_ptr = renderer_ptr->get_device();
 
 	std::vector<vertex_type> transformed_vertices;
-	transform_vertices(joint_ptr, transformed_vertices);
+	transform_vertices(model, transformed_vertices);
 
 	device_ptr->SetVertexDeclaration(renderer_ptr->get_vertex_declarations()->get<vertex_type>());
 
@@ -162,7 +152,7 @@ void MemoryMesh::draw_animated(Joint *joint_ptr, CameraPtr const &camera,
 	{
 		it->material_ptr->select();
 
-		device_ptr->SetTransform(D3DTS_WORLD, (D3DMATRIX const *) joint_ptr->matrix.ij);
+		device_ptr->SetTransform(D3DTS_WORLD, (D3DMATRIX const *) model.get_joint_matrix(joint_ptr->index).ij);
 
 		device_ptr->DrawIndexedPrimitiveUP(D3DPT_TRIANGLELIST, it->minimal_vertex_index, it->vertices_count,
 			it->triangles_count, &indices_[it->first_index_offset], INDEX_FORMAT_U16, &transformed_vertices[0], sizeof(vertex_type));
@@ -5,6 +5,7 @@
 #include "index.h"
 #include "mesh.h"
 #include "model.h"
+#include "skin.h"
 
 namespace graphic
 {
@@ -19,13 +20,7 @@ public:
     typedef VERTEX_PTBNT vertex_type;
 	typedef INDEX_U16 index_type;
 
-	#pragma pack(push, 1)
-	struct JointWeights
-	{
-		math::vec<8, unsigned> joints;
-		math::vec<8> weights;
-	};
-	#pragma pack(pop)
+	typedef Skin::JointWeights JointWeights;
 
 	MemoryMesh(MemoryModel *m);
 	virtual ~MemoryMesh();
@@ -36,15 +31,17 @@ public:
 	std::vector<vertex_type> const &get_vertex_buffer() const { return vertices_; }
 	std::vector<index_type> const &get_index_buffer() const { return indices_; }
 	std::vector<JointWeights> const &get_vertex_weights() const { return weights_; }
+	Skin const &get_skin() const { return skin_; }
 
 	virtual void set_vertices(GenericVertex *vertices, GenericVertex::format_type format, size_t count);
 	virtual void set_indices(unsigned *indices, size_t count);
 	virtual void set_always_visible(bool flag);
 
-	void transform_vertices(Joint const *joint_ptr, std::vector<vertex_type> &result) const;
+	// vertices skinned by joint matrices of given instance of model
+	void transform_vertices(Model const &model, std::vector<vertex_type> &result) const;
 
-	void draw_static(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix) const;
-	void draw_animated(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix) const;
+	void draw_static(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix) const;
+	void draw_animated(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix) const;
 
 	static void bind(lua_State *L);
 
@@ -53,6 +50,7 @@ private:
 	std::vector<vertex_type> vertices_;
 	std::vector<index_type> indices_;
 	std::vector<JointWeights> weights_;
+	Skin skin_;
 };
 
 }
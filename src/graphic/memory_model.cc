@@ -20,7 +20,7 @@ MeshPtr MemoryModel::add_mesh()
 	return meshes.back();
 }
 
-void MemoryModel::draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix)
+void MemoryModel::draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix, DrawCallBucket *bucket)
 {
 	if (animations.size()) draw_animated(camera, world_matrix);
 	else draw_static(camera, world_matrix);
@@ -34,7 +34,7 @@ void MemoryModel::draw_static(CameraPtr const &camera, math::matrix<4,4> const &
 	{
 		if (MemoryMeshPtr mesh_ptr = boost::static_pointer_cast<MemoryMesh>((*it)->mesh_ptr.lock()))
 		{
-			mesh_ptr->draw_static(it->get(), camera, world_matrix);
+			mesh_ptr->draw_static(*this, it->get(), camera, world_matrix);
 		}
 	}
 }
@@ -45,7 +45,7 @@ void MemoryModel::draw_animated(CameraPtr const &camera, math::matrix<4,4> const
 	{
 		if (MemoryMeshPtr mesh_ptr = boost::static_pointer_cast<MemoryMesh>((*it)->mesh_ptr.lock()))
 		{
-			mesh_ptr->draw_animated(it->get(), camera, world_matrix);
+			mesh_ptr->draw_animated(*this, it->get(), camera, world_matrix);
 		}
 	}
 }
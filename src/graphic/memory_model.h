@@ -22,7 +22,7 @@ public:
 
 	virtual MeshPtr add_mesh();
 
-	virtual void draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
+	virtual void draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix, DrawCallBucket *bucket = 0);
 	void draw_static(CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
 	void draw_animated(CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
 
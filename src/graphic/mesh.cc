@@ -33,7 +33,8 @@ void Mesh::check()
 	LOG_INFO("checking mesh id = " << id << ", name = " << name << "...");
 }
 
-void Mesh::draw(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix)
+void Mesh::draw(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix,
+	DrawCallBucket &bucket)
 {
 }
 
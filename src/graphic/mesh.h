@@ -50,12 +50,14 @@ public:
 
 	virtual void check();
 
-	virtual void draw(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
+	// mesh is shared by instances of its model, instance which draws mesh gives matrices of joints
+	virtual void draw(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix,
+		DrawCallBucket &bucket);
 
 	static void bind(lua_State *L);
 
 protected:
-	Model *model_;
+	Model *model_; // model which created mesh
 	UberShaderPtr shader_;
 };
 
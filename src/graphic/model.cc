@@ -1,83 +1,31 @@
 
-#include <boost/unordered_map.hpp>
+#include <cassert>
 #include <luabind/luabind.hpp>
 #include "collada_loader.h"
+#include "scheduler.h"
 #include "model.h"
 
 namespace graphic {
 
 Model::Model(RendererPtr const &renderer_ptr, SchedulerPtr const &scheduler_ptr):
 	renderer_(renderer_ptr),
-	scheduler_(scheduler_ptr)
+	scheduler_(scheduler_ptr),
+	skeleton_(new Skeleton())
 {
 }
 
+// instance costs its containers of shared pointers and pose, samplers and vertices are not copied
 Model::Model(Model const &model):
+	joints(model.joints),
+	meshes(model.meshes),
+	animations(model.animations),
 	materials(model.materials),
 	renderer_(model.renderer_),
-	scheduler_(model.scheduler_)
+	scheduler_(model.scheduler_),
+	skeleton_(model.skeleton_),
+	pose_(model.pose_),
+	joint_matrices_(model.joint_matrices_)
 {
-	boost::unordered_map<JointPtr, JointPtr> joints_tt;
-	boost::unordered_map<MeshPtr, MeshPtr> meshes_tt;
-
-	joints.reserve(model.joints.size());
-	animations.reserve(model.animations.size());
-	meshes.reserve(model.meshes.size());
-
-	for (size_t i = 0; i < model.joints.size(); i++)
-	{
-		JointPtr source = model.joints[i];
-		JointPtr joint(new Joint(*source));
-
-		joints.push_back(joint);
-		joints_tt.insert(std::make_pair(source, joint));
-	}
-
-	for (animations_type::const_iterator it = model.animations.begin(); it != model.animations.end(); it++)
-	{
-		animations.push_back(AnimationPtr(new Animation(**it)));
-	}
-
-	for (meshes_type::const_iterator it = model.meshes.begin(); it != model.meshes.end(); it++)
-	{
-		MeshPtr source = *it;
-
-		MeshPtr mesh = source->shallow_copy();
-		mesh->set_model(this);
-
-		meshes.push_back(mesh);
-
-		meshes_tt.insert(std::make_pair(source, mesh));
-	}
-
-	for (joints_type::iterator it = joints.begin(); it != joints.end(); it++)
-	{
-		if (JointPtr parent = (*it)->parent.lock())
-		{
-			(*it)->parent = joints_tt.find(parent)->second;
-		}
-
-		for (Joint::childs_type::iterator jt = (*it)->childs.begin(); jt != (*it)->childs.end(); jt++)
-		{
-			*jt = joints_tt.find(jt->lock())->second;
-		}
-
-		if (MeshPtr mesh_ptr = (*it)->mesh_ptr.lock())
-		{
-			(*it)->mesh_ptr = meshes_tt.find(mesh_ptr)->second;
-		}
-	}
-
-	for (animations_type::iterator it = animations.begin(); it != animations.end(); it++)
-	{
-		for (Animation::samplers_type::iterator jt = (*it)->samplers.begin(); jt != (*it)->samplers.end(); jt++)
-		{
-			if (JointPtr joint = jt->get_joint())
-			{
-				jt->set_joint(joints_tt.find(joint)->second);
-			}
-		}
-	}
 }
 
 Model::~Model()
@@ -118,6 +66,35 @@ void Model::check()
 	}
 }
 
+// skeleton is replaced, not rebuilt, so instances keep the one they share
+void Model::build_skeleton()
+{
+	boost::shared_ptr<Skeleton> skeleton(new Skeleton());
+	skeleton->build(joints);
+	skeleton_ = skeleton;
+
+	pose_ = skeleton_->get_bind_transforms();
+	joint_matrices_.resize(joints.size());
+	if (!joints.empty()) skeleton_->build_model_matrices(pose_.empty() ? 0 : &pose_[0], &joint_matrices_[0]);
+
+	for (animations_type::iterator it = animations.begin(); it != animations.end(); it++)
+	{
+		for (Animation::samplers_type::iterator jt = (*it)->samplers.begin(); jt != (*it)->samplers.end(); jt++)
+		{
+			JointPtr joint = jt->get_joint();
+			jt->set_slot(joint ? skeleton_->get_transform_slot(joint->index, jt->get_sid()) : Sampler::NO_SLOT);
+		}
+	}
+}
+
+void Model::compress_animations(math::scalar rotation_tolerance, math::scalar translation_tolerance, bool quantize)
+{
+	for (animations_type::iterator it = animations.begin(); it != animations.end(); it++)
+	{
+		(*it)->compress(rotation_tolerance, translation_tolerance, quantize);
+	}
+}
+
 JointPtr Model::get_joint_by_id(std::string const &id)
 {
 	for (joints_type::iterator it = joints.begin(); it != joints.end(); it++) {
@@ -163,18 +140,36 @@ MaterialPtr Model::get_material_by_name(std::string const &name)
 	throw std::runtime_error("material with name = " + name + " not found");
 }
 
+// layers keep their cursors while they match animations, so playback finds keys in constant time
 void Model::set_animation_time(math::scalar t)
 {
-	for (animations_type::iterator it = animations.begin(); it != animations.end(); it++)
+	bool matching = blender_.get_layers_count() == animations.size();
+	for (size_t i = 0; i < animations.size() && matching; ++i)
 	{
-		(*it)->set_time(t);
+		matching = blender_.get_animation(i) == animations[i];
 	}
 
-	for (joints_type::iterator it = joints.begin(); it != joints.end(); it++) {
-		if (!(*it)->parent.lock()) {
-			(*it)->build_frame_transforms();
-		}
+	if (!matching)
+	{
+		blender_.clear();
+		for (size_t i = 0; i < animations.size(); ++i) blender_.add_layer(animations[i]);
 	}
+
+	for (size_t i = 0; i < blender_.get_layers_count(); ++i)
+	{
+		blender_.set_time(i, t);
+	}
+
+	update_pose();
+}
+
+void Model::update_pose()
+{
+	assert(skeleton_->get_joints_count() == joints.size() && "skeleton is not built");
+	if (joints.empty()) return;
+
+	blender_.evaluate(*skeleton_, pose_.empty() ? 0 : &pose_[0]);
+	skeleton_->build_model_matrices(pose_.empty() ? 0 : &pose_[0], &joint_matrices_[0]);
 }
 
 void Model::set_always_visible(bool flag)
@@ -185,17 +180,32 @@ void Model::set_always_visible(bool flag)
 	}
 }
 
-void Model::draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix)
+void Model::draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix, DrawCallBucket *bucket)
 {
+	if (!bucket) bucket = &scheduler_->get_bucket(0);
+
+	// skeleton is built by loader, building it here would change samplers shared with models drawn concurrently
+	assert(skeleton_->get_joints_count() == joints.size() && "skeleton is not built");
+
 	for (joints_type::iterator it = joints.begin(); it != joints.end(); it++)
 	{
 		if (MeshPtr mesh_ptr = (*it)->mesh_ptr.lock())
 		{
-			mesh_ptr->draw(it->get(), camera, world_matrix);
+			mesh_ptr->draw(*this, it->get(), camera, world_matrix, *bucket);
 		}
 	}
 }
 
+namespace
+{
+
+void draw(Model &model, CameraPtr const &camera, math::matrix<4,4> const &world_matrix)
+{
+	model.draw(camera, world_matrix);
+}
+
+}
+
 void Model::bind(lua_State *L)
 {
     using namespace luabind;
@@ -207,9 +217,11 @@ void Model::bind(lua_State *L)
 		.def("load_from_collada", &Model::load_from_collada)
 		.def("get_joint_by_id", &Model::get_joint_by_id)
 		.def("get_joint_by_name", &Model::get_joint_by_name)
+		.def("get_joint_matrix", &Model::get_joint_matrix)
 		.def("set_animation_time", &Model::set_animation_time)
+		.def("compress_animations", &Model::compress_animations)
 		.def("set_always_visible", &Model::set_always_visible)
-		.def("draw", &Model::draw)
+		.def("draw", &draw)
 		.scope
 		[
 			class_<materials_type>("materials_type")
@@ -6,6 +6,8 @@
 #include "joint.h"
 #include "animation.h"
 #include "mesh.h"
+#include "skeleton.h"
+#include "pose_blender.h"
 #include "material.h"
 
 namespace graphic
@@ -28,7 +30,10 @@ public:
 	materials_type materials;
 
 	Model(RendererPtr const &renderer_ptr, SchedulerPtr const &scheduler_ptr);
-	Model(Model const &model); // makes shallow copy of meshes and materials, and full copy of joints and animations
+	// makes instance of model which shares joints, meshes, animations, materials and skeleton with it and
+	// has its own pose and joint matrices; shared data should not be changed while instances exist, layers
+	// of pose blender are not copied
+	Model(Model const &model);
 	virtual ~Model();
 
 	RendererPtr const &get_renderer() const { return renderer_; }
@@ -50,20 +55,43 @@ public:
 	// checks that model have been loaded correctly
 	virtual void check();
 
-	// animations blending could be easily implemented adding another function that will clear
-	// all Joint::matrix variables to null matrix (all elements == zero) and specifying animation
-	// and blend factor in this function
+	// compiles joints to skeleton and resolves targets of animation samplers to its slots, has to be
+	// called after joints or animations are changed and before model is drawn; loader calls it when
+	// model is built
+	void build_skeleton();
+	Skeleton const &get_skeleton() const { return *skeleton_; }
+
+	// local-to-model matrix of joint with given index in current pose of this instance
+	math::matrix<4,4> const &get_joint_matrix(size_t index) const { return joint_matrices_[index]; }
+
+	// see Sampler::compress(), animations are shared by all instances of model
+	void compress_animations(math::scalar rotation_tolerance, math::scalar translation_tolerance, bool quantize);
+
+	// layers of animations blended to pose, weights and masks of layers are kept by set_animation_time()
+	PoseBlender &get_pose_blender() { return blender_; }
+
+	// sets time of all layers, every animation of model gets its own layer when layers do not match them
     virtual void set_animation_time(math::scalar t);
 
+	// blends layers to pose and builds joint matrices from it
+	void update_pose();
+
 	virtual void set_always_visible(bool flag);
 
-    virtual void draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
+	// calls are recorded to given bucket, to first bucket of scheduler when it is not specified; different
+	// models could be drawn concurrently to different buckets
+    virtual void draw(CameraPtr const &camera, math::matrix<4,4> const &world_matrix, DrawCallBucket *bucket = 0);
 
     static void bind(lua_State *L);
 
 protected:
 	RendererPtr const renderer_;
 	SchedulerPtr const scheduler_;
+
+	boost::shared_ptr<Skeleton const> skeleton_;
+	std::vector<math::matrix<4,4> > pose_; // local transforms by skeleton slots
+	std::vector<math::matrix<4,4> > joint_matrices_; // local-to-model matrices by joint indices
+	PoseBlender blender_;
 };
 
 }
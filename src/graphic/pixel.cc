@@ -8,13 +8,13 @@ namespace graphic
 
 static PixelFormat pixel_format_X8R8G8B8 = {
 	math::vec<4, unsigned>(0x0000FF0000u, 0x0000FF00u, 0x000000FFu, 0xFF000000u),
-	D3DFMT_X8R8G8B8,
+	22, // D3DFMT_X8R8G8B8
 	32
 };
 
 static PixelFormat pixel_format_A8R8G8B8 = {
 	math::vec<4, unsigned>(0x0000FF0000u, 0x0000FF00u, 0x000000FFu, 0xFF000000u),
-	D3DFMT_A8R8G8B8,
+	21, // D3DFMT_A8R8G8B8
 	32
 };
 
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <d3d9.h>
 #include <math/vec.h>
 
 namespace graphic
@@ -15,7 +14,8 @@ struct PixelFormat {
 
 
 	const math::vec<4, unsigned> masks;
-	const D3DFORMAT direct3d_format;
+	// D3DFORMAT value, kept as integer so header does not depend on direct3d
+	const unsigned direct3d_format;
 	const int bits;
 
 	static PixelFormat const &get(unsigned pixel_format);
@@ -0,0 +1,151 @@
+
+#include <stdexcept>
+#include <algorithm>
+#include "skeleton.h"
+#include "pose_blender.h"
+
+namespace graphic {
+
+namespace
+{
+
+// matrix of result rotates by first, then by second
+math::quaternion<> rotate(math::quaternion<> const &first, math::quaternion<> const &second)
+{
+	math::quaternion<> const &p = second, &q = first;
+	return math::quaternion<>(
+		p.w * q.x + p.x * q.w + p.y * q.z - p.z * q.y,
+		p.w * q.y - p.x * q.z + p.y * q.w + p.z * q.x,
+		p.w * q.z + p.x * q.y - p.y * q.x + p.z * q.w,
+		p.w * q.w - p.x * q.x - p.y * q.y - p.z * q.z);
+}
+
+math::quaternion<> inverse(math::quaternion<> const &q)
+{
+	return math::quaternion<>(-q.x, -q.y, -q.z, q.w);
+}
+
+// shortest arc is interpolated linearly, weights of layers do not need constant angular speed
+math::quaternion<> nlerp(math::quaternion<> const &p, math::quaternion<> q, math::scalar k)
+{
+	if (math::dot_product(p, q) < 0) q = -q;
+	return (p * (1 - k) + q * k).normalized();
+}
+
+void blend(Sampler::value &pose, Sampler::value const &sample, math::scalar weight)
+{
+	pose.rotation = nlerp(pose.rotation, sample.rotation, weight);
+	pose.translation = pose.translation * (1 - weight) + sample.translation * weight;
+	pose.scale = pose.scale * (1 - weight) + sample.scale * weight;
+}
+
+void add(Sampler::value &pose, Sampler::value const &sample, Sampler::value const &reference, math::scalar weight)
+{
+	math::quaternion<> delta = rotate(inverse(reference.rotation), sample.rotation);
+	if (weight < 1)
+	{
+		math::quaternion<> identity;
+		identity.identity();
+		delta = nlerp(identity, delta, weight);
+	}
+
+	pose.rotation = rotate(pose.rotation, delta);
+	pose.translation += (sample.translation - reference.translation) * weight;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		if (reference.scale.i[i] != 0) pose.scale.i[i] *= 1 + weight * (sample.scale.i[i] / reference.scale.i[i] - 1);
+	}
+}
+
+}
+
+size_t PoseBlender::add_layer(AnimationPtr const &animation, math::scalar weight, bool additive)
+{
+	if (!animation) throw std::logic_error("layer has no animation");
+
+	Layer layer;
+	layer.animation = animation;
+	layer.time = 0;
+	layer.weight = weight;
+	layer.additive = additive;
+
+	layers_.push_back(layer);
+	return layers_.size() - 1;
+}
+
+void PoseBlender::clear()
+{
+	layers_.clear();
+}
+
+// bind transform of slot is decomposed only when it is blended with sample
+void PoseBlender::evaluate(Skeleton const &skeleton, math::matrix<4,4> *transforms)
+{
+	size_t const count = skeleton.get_transforms_count();
+	std::vector<math::matrix<4,4> > const &bind = skeleton.get_bind_transforms();
+
+	pose_.resize(count);
+	animated_.assign(count, 0);
+
+	Sampler::value sample, reference;
+
+	for (std::vector<Layer>::iterator layer = layers_.begin(); layer != layers_.end(); ++layer)
+	{
+		Animation::samplers_type const &samplers = layer->animation->samplers;
+		layer->cursor.resize(samplers.size());
+
+		if (layer->weight <= 0) continue;
+
+		for (size_t i = 0; i < samplers.size(); ++i)
+		{
+			Sampler const &sampler = samplers[i];
+
+			size_t const slot = sampler.get_slot();
+			if (slot == Sampler::NO_SLOT) continue;
+			if (slot >= count) throw std::logic_error("sampler " + sampler.get_sid() + " is not resolved to skeleton");
+
+			math::scalar weight = layer->weight;
+			if (!layer->mask.empty())
+			{
+				size_t const joint = skeleton.get_slot_joint(slot);
+				weight *= joint < layer->mask.size() ? layer->mask[joint] : 0;
+			}
+
+			if (weight <= 0) continue;
+			weight = std::min(weight, math::scalar(1));
+
+			sampler.get(layer->time, layer->cursor[i], sample);
+
+			if (!animated_[slot])
+			{
+				animated_[slot] = 1;
+
+				if (!layer->additive && weight == 1)
+				{
+					pose_[slot] = sample;
+					continue;
+				}
+
+				pose_[slot].assign(bind[slot]);
+			}
+
+			if (layer->additive)
+			{
+				sampler.get_first(reference);
+				add(pose_[slot], sample, reference, weight);
+			}
+			else
+			{
+				blend(pose_[slot], sample, weight);
+			}
+		}
+	}
+
+	for (size_t slot = 0; slot < count; ++slot)
+	{
+		transforms[slot] = animated_[slot] ? pose_[slot].to_matrix() : bind[slot];
+	}
+}
+
+}
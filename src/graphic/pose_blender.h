@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <math/matrix.h>
+#include "forward.h"
+#include "animation.h"
+
+namespace graphic
+{
+
+class Skeleton;
+
+// Layers of animations blended to local pose of skeleton in one pass. Samplers of all layers give
+// decomposed transforms which are accumulated by skeleton slots, matrices are built once per slot after
+// all layers are applied. Layers go in order: normal one moves pose towards its sample by its weight,
+// additive one adds difference of its sample from first key of its track scaled by weight. Weight of layer
+// could be scaled for every joint by mask.
+class PoseBlender {
+public:
+	// returns index of layer
+	size_t add_layer(AnimationPtr const &animation, math::scalar weight = 1, bool additive = false);
+	void clear();
+
+	size_t get_layers_count() const { return layers_.size(); }
+	AnimationPtr const &get_animation(size_t layer) const { return layers_.at(layer).animation; }
+
+	void set_time(size_t layer, math::scalar t) { layers_.at(layer).time = t; }
+	void set_weight(size_t layer, math::scalar weight) { layers_.at(layer).weight = weight; }
+	// weights by joint indices, joints out of mask get zero weight; empty mask applies layer to all joints
+	void set_mask(size_t layer, std::vector<math::scalar> const &joint_weights) { layers_.at(layer).mask = joint_weights; }
+
+	// local transforms by skeleton slots, slots animated by no layer get bind transforms; samplers have to
+	// be resolved to slots of same skeleton
+	void evaluate(Skeleton const &skeleton, math::matrix<4,4> *transforms);
+
+private:
+	struct Layer {
+		AnimationPtr animation;
+		math::scalar time, weight;
+		bool additive;
+		std::vector<math::scalar> mask;
+		Animation::cursor_type cursor;
+	};
+
+	std::vector<Layer> layers_;
+	std::vector<Sampler::value> pose_; // by slots
+	std::vector<unsigned char> animated_; // by slots
+};
+
+}
@@ -0,0 +1,33 @@
+
+#include "material.h"
+#include "recording_renderer.h"
+#include "recording_draw_call.h"
+
+namespace graphic
+{
+
+RecordingDrawCall::RecordingDrawCall(RecordingRendererPtr const &renderer):
+	DrawCall(renderer),
+	renderer_(renderer)
+{
+}
+
+RecordingDrawCall::~RecordingDrawCall()
+{
+}
+
+void RecordingDrawCall::execute()
+{
+	if (!triangles_count_) return;
+
+	// fixed function pipeline
+	renderer_->set_shader(0);
+	renderer_->set_vertex_buffer(vertex_buffer_.get());
+	if (index_buffer_) renderer_->set_index_buffer(index_buffer_.get());
+
+	if (material_) material_->select();
+
+	renderer_->draw(first_index_offset_, triangles_count_);
+}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "draw_call.h"
+
+namespace graphic
+{
+
+class RecordingDrawCall: public DrawCall {
+public:
+	RecordingDrawCall(RecordingRendererPtr const &renderer);
+	virtual ~RecordingDrawCall();
+
+	virtual void execute();
+
+private:
+	RecordingRendererPtr renderer_;
+};
+
+}
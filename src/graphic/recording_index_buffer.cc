@@ -0,0 +1,38 @@
+
+#include "recording_renderer.h"
+#include "recording_index_buffer.h"
+
+namespace graphic
+{
+
+RecordingIndexBuffer::RecordingIndexBuffer(RecordingRendererPtr const &renderer, unsigned format, size_t size):
+	renderer_(renderer),
+	format_(format),
+	data_(size)
+{
+}
+
+RecordingIndexBuffer::~RecordingIndexBuffer()
+{
+}
+
+const void *RecordingIndexBuffer::lock() const
+{
+	return &data_[0];
+}
+
+void RecordingIndexBuffer::unlock() const
+{
+}
+
+void *RecordingIndexBuffer::lock(bool discard)
+{
+	return &data_[0];
+}
+
+void RecordingIndexBuffer::unlock()
+{
+	renderer_->record_upload(data_.size());
+}
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "forward.h"
+#include "index_buffer.h"
+
+namespace graphic
+{
+
+class RecordingIndexBuffer: public IndexBuffer
+{
+	friend class RecordingRenderer;
+
+public:
+	virtual ~RecordingIndexBuffer();
+
+	const void *lock() const;
+	void unlock() const;
+	void *lock(bool discard);
+	void unlock();
+
+	void *begin() { return &data_[0]; }
+	void const *begin() const { return &data_[0]; }
+
+	size_t get_size() const { return data_.size(); }
+	unsigned get_format() const { return format_; }
+
+protected:
+	RecordingRendererPtr renderer_;
+
+	RecordingIndexBuffer(RecordingRendererPtr const &renderer, unsigned format, size_t size);
+
+private:
+	unsigned format_;
+	std::vector<char> data_;
+};
+
+}
@@ -0,0 +1,23 @@
+
+#include "recording_renderer.h"
+#include "recording_material.h"
+
+namespace graphic
+{
+
+RecordingMaterial::RecordingMaterial(RecordingRendererPtr const &renderer_ptr):
+	Material(renderer_ptr),
+	renderer_(renderer_ptr)
+{
+}
+
+RecordingMaterial::~RecordingMaterial()
+{
+}
+
+void RecordingMaterial::select()
+{
+	renderer_->set_material(this);
+}
+
+}
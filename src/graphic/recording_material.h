@@ -0,0 +1,22 @@
+#pragma once
+
+#include "material.h"
+
+namespace graphic
+{
+
+class RecordingMaterial: public Material {
+	friend class RecordingRenderer;
+
+public:
+	virtual ~RecordingMaterial();
+
+	virtual void select();
+
+private:
+	RecordingRendererPtr renderer_;
+
+	RecordingMaterial(RecordingRendererPtr const &renderer_ptr);
+};
+
+}
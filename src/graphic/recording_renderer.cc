@@ -0,0 +1,226 @@
+
+#include <util/logger.h>
+#include "uber_shader.h"
+#include "recording_vertex_buffer.h"
+#include "recording_index_buffer.h"
+#include "recording_texture.h"
+#include "recording_material.h"
+#include "recording_shader.h"
+#include "recording_draw_call.h"
+#include "recording_uber_draw_call.h"
+#include "frame_arena.h"
+#include "recording_renderer.h"
+
+namespace graphic
+{
+
+RecordingRenderer::RecordingRenderer(int width, int height):
+	Renderer(),
+	screen_width_(width),
+	screen_height_(height),
+	commands_recorded_(true),
+	instancing_supported_(true)
+{
+	reset_log();
+}
+
+RecordingRenderer::~RecordingRenderer()
+{
+}
+
+int RecordingRenderer::get_screen_width() const
+{
+	return screen_width_;
+}
+
+int RecordingRenderer::get_screen_height() const
+{
+	return screen_height_;
+}
+
+void RecordingRenderer::resize(int width, int height)
+{
+	if (!width || !height) return;
+
+	screen_width_ = width;
+	screen_height_ = height;
+
+	LOG_INFO("recording renderer resized to " << screen_width_ << 'x' << screen_height_);
+}
+
+void *RecordingRenderer::get_window_handle() const
+{
+	return 0;
+}
+
+void RecordingRenderer::postconstruct()
+{
+	uber_shader_.reset(new UberShader(shared_from_this()));
+}
+
+void RecordingRenderer::begin_frame()
+{
+}
+
+void RecordingRenderer::finish_frame()
+{
+	++log_.frames;
+}
+
+VertexBufferPtr RecordingRenderer::create_vertex_buffer(VertexTraits const *traits, size_t size, bool dynamic, bool writeonly)
+{
+	return VertexBufferPtr(new RecordingVertexBuffer(shared_from_this(), size, traits));
+}
+
+IndexBufferPtr RecordingRenderer::create_index_buffer(unsigned format, size_t size, bool dynamic, bool writeonly)
+{
+	return IndexBufferPtr(new RecordingIndexBuffer(shared_from_this(), format, size));
+}
+
+TexturePtr RecordingRenderer::create_texture(int width, int height, unsigned pixel_format,
+		bool dynamic, bool writeonly)
+{
+	return TexturePtr(new RecordingTexture(shared_from_this(), width, height, pixel_format, dynamic, writeonly));
+}
+
+MaterialPtr RecordingRenderer::create_material()
+{
+	return MaterialPtr(new RecordingMaterial(shared_from_this()));
+}
+
+ShaderPtr RecordingRenderer::create_shader()
+{
+	return ShaderPtr(new RecordingShader(shared_from_this()));
+}
+
+DrawCallPtr RecordingRenderer::create_draw_call()
+{
+	return DrawCallPtr(new RecordingDrawCall(shared_from_this()));
+}
+
+UberDrawCallPtr RecordingRenderer::create_uber_draw_call()
+{
+	return UberDrawCallPtr(new RecordingUberDrawCall(shared_from_this()));
+}
+
+UberDrawCall *RecordingRenderer::create_frame_uber_draw_call(FrameArena &arena)
+{
+	return new (arena.allocate(sizeof(RecordingUberDrawCall))) RecordingUberDrawCall(shared_from_this());
+}
+
+UberShaderPtr RecordingRenderer::get_uber_shader() const
+{
+	return uber_shader_;
+}
+
+bool RecordingRenderer::is_instancing_supported() const
+{
+	return instancing_supported_;
+}
+
+void RecordingRenderer::reset_log()
+{
+	log_.frames = 0;
+	log_.draw_calls = 0;
+	log_.instanced_draw_calls = 0;
+	log_.instances = 0;
+	log_.triangles = 0;
+	log_.vertex_buffer_changes = 0;
+	log_.index_buffer_changes = 0;
+	log_.material_changes = 0;
+	log_.texture_changes = 0;
+	log_.shader_changes = 0;
+	log_.shader_parameter_sets = 0;
+	log_.bytes_uploaded = 0;
+
+	commands_.clear();
+
+	// next draw sets all state again, as after device reset
+	vertex_buffer_ = 0;
+	index_buffer_ = 0;
+	material_ = 0;
+	shader_ = 0;
+}
+
+void RecordingRenderer::set_vertex_buffer(VertexBuffer const *vertex_buffer)
+{
+	if (vertex_buffer == vertex_buffer_) return;
+
+	vertex_buffer_ = vertex_buffer;
+	++log_.vertex_buffer_changes;
+}
+
+void RecordingRenderer::set_index_buffer(IndexBuffer const *index_buffer)
+{
+	if (index_buffer == index_buffer_) return;
+
+	index_buffer_ = index_buffer;
+	++log_.index_buffer_changes;
+}
+
+void RecordingRenderer::set_material(Material const *material)
+{
+	if (material == material_) return;
+
+	material_ = material;
+	++log_.material_changes;
+}
+
+void RecordingRenderer::set_shader(Shader const *shader)
+{
+	if (shader == shader_) return;
+
+	shader_ = shader;
+	++log_.shader_changes;
+}
+
+void RecordingRenderer::record_texture_change()
+{
+	++log_.texture_changes;
+}
+
+void RecordingRenderer::record_shader_parameter_set()
+{
+	++log_.shader_parameter_sets;
+}
+
+void RecordingRenderer::record_upload(size_t bytes)
+{
+	log_.bytes_uploaded += bytes;
+}
+
+void RecordingRenderer::draw(size_t first_index_offset, size_t triangles_count)
+{
+	++log_.draw_calls;
+	log_.triangles += triangles_count;
+
+	record_command(first_index_offset, triangles_count, 1);
+}
+
+void RecordingRenderer::draw_instanced(size_t first_index_offset, size_t triangles_count, size_t instances_count)
+{
+	++log_.draw_calls;
+	++log_.instanced_draw_calls;
+	log_.instances += instances_count;
+	log_.triangles += triangles_count * instances_count;
+
+	record_command(first_index_offset, triangles_count, instances_count);
+}
+
+void RecordingRenderer::record_command(size_t first_index_offset, size_t triangles_count, size_t instances_count)
+{
+	if (commands_recorded_)
+	{
+		Command command;
+		command.vertex_buffer = vertex_buffer_;
+		command.index_buffer = index_buffer_;
+		command.material = material_;
+		command.shader = shader_;
+		command.first_index_offset = first_index_offset;
+		command.triangles_count = triangles_count;
+		command.instances_count = instances_count;
+		commands_.push_back(command);
+	}
+}
+
+}
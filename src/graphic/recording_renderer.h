@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include "renderer.h"
+
+namespace graphic
+{
+
+// Renderer without device, resources live in memory and draw calls are recorded to command log
+// instead of being sent to GPU. Used to run graphic code and tests without window and to measure
+// CPU side cost of frame and amount of state changes it makes.
+class RecordingRenderer: public Renderer {
+public:
+	struct CommandLog
+	{
+		size_t frames;
+		size_t draw_calls;
+		// instanced draws are counted in draw calls too
+		size_t instanced_draw_calls;
+		size_t instances;
+		size_t triangles;
+		size_t vertex_buffer_changes;
+		size_t index_buffer_changes;
+		size_t material_changes;
+		size_t texture_changes;
+		size_t shader_changes;
+		size_t shader_parameter_sets;
+		size_t bytes_uploaded;
+	};
+
+	// state draw was made with, pointers only identify resources and could be dangling
+	struct Command
+	{
+		VertexBuffer const *vertex_buffer;
+		IndexBuffer const *index_buffer;
+		Material const *material;
+		Shader const *shader;
+		size_t first_index_offset;
+		size_t triangles_count;
+		size_t instances_count;
+	};
+
+	typedef std::vector<Command> commands_type;
+
+	RecordingRendererPtr shared_from_this()
+	{
+		return boost::static_pointer_cast<RecordingRenderer>(Renderer::shared_from_this());
+	}
+
+	RecordingRenderer(int width = 800, int height = 600);
+	virtual ~RecordingRenderer();
+
+	virtual int get_screen_width() const;
+	virtual int get_screen_height() const;
+	virtual void resize(int width, int height);
+	virtual void *get_window_handle() const;
+
+	virtual void postconstruct();
+
+	virtual void begin_frame();
+	virtual void finish_frame();
+
+	virtual VertexBufferPtr create_vertex_buffer(VertexTraits const *vertex_traits,
+		size_t size, bool dynamic = false, bool writeonly = false);
+	virtual IndexBufferPtr create_index_buffer(unsigned index_format, size_t size,
+		bool dynamic = false, bool writeonly = false);
+
+	virtual TexturePtr create_texture(int width, int height, unsigned pixel_format,
+		bool dynamic = false, bool writeonly = false);
+	virtual MaterialPtr create_material();
+	virtual ShaderPtr create_shader();
+
+	virtual DrawCallPtr create_draw_call();
+	virtual UberDrawCallPtr create_uber_draw_call();
+	virtual UberDrawCall *create_frame_uber_draw_call(FrameArena &arena);
+
+	virtual UberShaderPtr get_uber_shader() const;
+
+	virtual bool is_instancing_supported() const;
+
+	// instancing is supported by default, turning it off makes scheduler to fall back to separate draws
+	void set_instancing_supported(bool flag) { instancing_supported_ = flag; }
+
+	CommandLog const &get_log() const { return log_; }
+	commands_type const &get_commands() const { return commands_; }
+	void reset_log();
+
+	// commands are recorded by default, counters are always updated
+	void set_commands_recorded(bool flag) { commands_recorded_ = flag; }
+
+	// state changes made by recording resources and draw calls, changes to bound value are not counted
+	void set_vertex_buffer(VertexBuffer const *vertex_buffer);
+	void set_index_buffer(IndexBuffer const *index_buffer);
+	void set_material(Material const *material);
+	void set_shader(Shader const *shader);
+	void record_texture_change();
+	void record_shader_parameter_set();
+	void record_upload(size_t bytes);
+	void draw(size_t first_index_offset, size_t triangles_count);
+	void draw_instanced(size_t first_index_offset, size_t triangles_count, size_t instances_count);
+
+private:
+	int screen_width_, screen_height_;
+
+	UberShaderPtr uber_shader_;
+
+	CommandLog log_;
+	commands_type commands_;
+	bool commands_recorded_;
+	bool instancing_supported_;
+
+	VertexBuffer const *vertex_buffer_;
+	IndexBuffer const *index_buffer_;
+	Material const *material_;
+	Shader const *shader_;
+
+	void record_command(size_t first_index_offset, size_t triangles_count, size_t instances_count);
+};
+
+}
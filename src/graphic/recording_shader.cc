@@ -0,0 +1,81 @@
+
+#include "texture.h"
+#include "recording_renderer.h"
+#include "recording_shader.h"
+
+namespace graphic
+{
+
+class RecordingShader::RecordingParameter: public Parameter {
+public:
+	RecordingParameter(boost::shared_ptr<RecordingShader> const &shader, std::string const &name):
+		shader_(shader),
+		name_(name),
+		texture_(0)
+	{
+	}
+
+	virtual ~RecordingParameter()
+	{
+	}
+
+	virtual void set(math::vec<2> const &v) { record_set(); }
+	virtual void set(math::vec<3> const &v) { record_set(); }
+	virtual void set(math::vec<4> const &v) { record_set(); }
+	virtual void set(math::matrix<4,4> const &value) { record_set(); }
+	virtual void set(std::vector<math::matrix<4,4> > const &value) { record_set(); }
+	virtual void set(math::matrix<4,4> const *matrices, size_t count) { record_set(); }
+	virtual void set(void const *ptr, size_t size) { record_set(); }
+
+	virtual void set(TexturePtr const &texture)
+	{
+		record_set();
+
+		if (texture.get() != texture_)
+		{
+			texture_ = texture.get();
+			RecordingRendererPtr(shader_->renderer_)->record_texture_change();
+		}
+	}
+
+private:
+	boost::shared_ptr<RecordingShader> const shader_;
+	std::string const name_;
+	Texture const *texture_;
+
+	void record_set()
+	{
+		RecordingRendererPtr(shader_->renderer_)->record_shader_parameter_set();
+	}
+};
+
+RecordingShader::~RecordingShader()
+{
+}
+
+void RecordingShader::add_preprocessor_macro(std::string const &key, std::string const &value)
+{
+	macros_.push_back(std::make_pair(key, value));
+}
+
+void RecordingShader::load_from_file(std::string const &filename)
+{
+	filename_ = filename;
+}
+
+void RecordingShader::load_from_buffer(char const *buffer, size_t len)
+{
+	filename_.clear();
+}
+
+Shader::ParameterPtr RecordingShader::get_parameter(std::string const &name)
+{
+	return Shader::ParameterPtr(new RecordingParameter(shared_from_this(), name));
+}
+
+RecordingShader::RecordingShader(RecordingRendererPtr const &renderer_ptr):
+	renderer_(renderer_ptr)
+{
+}
+
+}
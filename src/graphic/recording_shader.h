@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include "forward.h"
+#include "shader.h"
+
+namespace graphic
+{
+
+// accepts any source and any parameter name, only counts parameter changes
+class RecordingShader: public Shader, public boost::enable_shared_from_this<RecordingShader> {
+	friend class RecordingRenderer;
+
+public:
+	virtual ~RecordingShader();
+
+	virtual void add_preprocessor_macro(std::string const &key, std::string const &value = std::string());
+
+    virtual void load_from_file(std::string const &filename);
+    virtual void load_from_buffer(char const *buffer, size_t len);
+
+	virtual ParameterPtr get_parameter(std::string const &name);
+
+	std::string const &get_filename() const { return filename_; }
+	std::vector<std::pair<std::string, std::string> > const &get_macros() const { return macros_; }
+
+protected:
+	class RecordingParameter;
+
+    RecordingShader(RecordingRendererPtr const &renderer_ptr);
+
+	RecordingRendererWeakPtr const renderer_;
+	std::string filename_;
+	std::vector<std::pair<std::string, std::string> > macros_;
+};
+
+}
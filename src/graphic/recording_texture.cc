@@ -0,0 +1,35 @@
+
+#include "recording_renderer.h"
+#include "recording_texture.h"
+
+namespace graphic
+{
+
+RecordingTexture::RecordingTexture(RecordingRendererPtr const &renderer_ptr, int width, int height,
+	unsigned pixel_format, bool dynamic, bool writeonly):
+	Texture(width, height, pixel_format, dynamic, writeonly),
+	renderer_(renderer_ptr),
+	data_(width * height * PixelFormat::get(pixel_format).bits / 8)
+{
+}
+
+RecordingTexture::~RecordingTexture()
+{
+}
+
+const void *RecordingTexture::lock() const {
+	return &data_[0];
+}
+
+void RecordingTexture::unlock() const {
+}
+
+void *RecordingTexture::lock(bool discard) {
+	return &data_[0];
+}
+
+void RecordingTexture::unlock() {
+	renderer_->record_upload(data_.size());
+}
+
+}
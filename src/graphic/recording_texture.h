@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "forward.h"
+#include "texture.h"
+
+namespace graphic
+{
+
+class RecordingTexture: public Texture {
+	friend class RecordingRenderer;
+
+public:
+	RecordingTexture(RecordingRendererPtr const &renderer_ptr, int width, int height,
+		unsigned pixel_format, bool dynamic = false, bool writeonly = false);
+	virtual ~RecordingTexture();
+
+	virtual const void *lock() const;
+	virtual void unlock() const;
+	virtual void *lock(bool discard);
+	virtual void unlock();
+
+private:
+	RecordingRendererPtr renderer_;
+	std::vector<char> data_;
+};
+
+}
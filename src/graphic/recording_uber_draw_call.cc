@@ -0,0 +1,66 @@
+
+#include <stdexcept>
+#include "material.h"
+#include "uber_shader.h"
+#include "recording_vertex_buffer.h"
+#include "recording_renderer.h"
+#include "recording_uber_draw_call.h"
+
+namespace graphic
+{
+
+RecordingUberDrawCall::RecordingUberDrawCall(RecordingRendererPtr const &renderer):
+	UberDrawCall(renderer),
+	renderer_(renderer)
+{
+}
+
+RecordingUberDrawCall::~RecordingUberDrawCall()
+{
+}
+
+// same state is set as in D3D9UberDrawCall::execute, one pass is drawn
+void RecordingUberDrawCall::execute()
+{
+	RecordingVertexBuffer *vertex_buffer = static_cast<RecordingVertexBuffer *>(vertex_buffer_.get());
+	VertexTraits const *vertex_traits = vertex_buffer->get_vertex_traits();
+	UberShader::InstancePtr shader_instance = shader_->get_instance(vertex_traits->get_format(), material_);
+
+	renderer_->set_vertex_buffer(vertex_buffer);
+	renderer_->set_index_buffer(index_buffer_.get());
+
+	set_material_parameters(*shader_instance);
+
+	shader_instance->world_matrix->set(world_matrix_);
+	shader_instance->world_view_projection_matrix->set(world_view_projection_matrix_);
+
+	if (shader_instance->joint_matrix_array && joint_matrices_count_)
+		shader_instance->joint_matrix_array->set(joint_matrices_, joint_matrices_count_);
+
+	renderer_->set_shader(shader_instance->get_shader().get());
+	renderer_->draw(first_index_offset_, triangles_count_);
+}
+
+// same state is set as in D3D9UberDrawCall::execute_instanced, world matrices are uploaded to instance stream
+void RecordingUberDrawCall::execute_instanced(math::matrix<4,4> const *world_matrices, size_t count)
+{
+	if (count > MAX_INSTANCES_COUNT) throw std::logic_error("too many instances");
+
+	RecordingVertexBuffer *vertex_buffer = static_cast<RecordingVertexBuffer *>(vertex_buffer_.get());
+	VertexTraits const *vertex_traits = vertex_buffer->get_vertex_traits();
+	UberShader::InstancePtr shader_instance = shader_->get_instance(vertex_traits->get_format(), material_, true);
+
+	renderer_->record_upload(sizeof(*world_matrices) * count);
+
+	renderer_->set_vertex_buffer(vertex_buffer);
+	renderer_->set_index_buffer(index_buffer_.get());
+
+	set_material_parameters(*shader_instance);
+
+	shader_instance->view_projection_matrix->set(view_projection_matrix_);
+
+	renderer_->set_shader(shader_instance->get_shader().get());
+	renderer_->draw_instanced(first_index_offset_, triangles_count_, count);
+}
+
+}
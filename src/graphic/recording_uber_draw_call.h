@@ -0,0 +1,20 @@
+#pragma once
+
+#include "uber_draw_call.h"
+
+namespace graphic
+{
+
+class RecordingUberDrawCall: public UberDrawCall {
+public:
+	RecordingUberDrawCall(RecordingRendererPtr const &renderer);
+	virtual ~RecordingUberDrawCall();
+
+	virtual void execute();
+	virtual void execute_instanced(math::matrix<4,4> const *world_matrices, size_t count);
+
+private:
+	RecordingRendererPtr const renderer_;
+};
+
+}
@@ -0,0 +1,39 @@
+
+#include "recording_renderer.h"
+#include "recording_vertex_buffer.h"
+
+namespace graphic
+{
+
+RecordingVertexBuffer::RecordingVertexBuffer(RecordingRendererPtr const &renderer, size_t size, VertexTraits const *traits):
+	renderer_(renderer),
+	data_(size),
+	traits_(traits)
+{
+}
+
+RecordingVertexBuffer::~RecordingVertexBuffer()
+{
+}
+
+const void *RecordingVertexBuffer::lock() const
+{
+	return &data_[0];
+}
+
+void RecordingVertexBuffer::unlock() const
+{
+}
+
+void *RecordingVertexBuffer::lock(bool discard)
+{
+	return &data_[0];
+}
+
+void RecordingVertexBuffer::unlock()
+{
+	// device buffer would be refilled from whole copy, as D3D9VertexBuffer does
+	renderer_->record_upload(data_.size());
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "forward.h"
+#include "vertex_buffer.h"
+#include "vertex_traits.h"
+
+namespace graphic
+{
+
+class RecordingVertexBuffer: public VertexBuffer
+{
+	friend class RecordingRenderer;
+
+public:
+	virtual ~RecordingVertexBuffer();
+
+	virtual const void *lock() const;
+	virtual void unlock() const;
+	virtual void *lock(bool discard);
+	virtual void unlock();
+
+	size_t get_size() const { return data_.size(); }
+
+	void *begin() { return &data_[0]; }
+	void const *begin() const { return &data_[0]; }
+	void *end() { return &data_[0] + get_size(); }
+	void const *end() const { return &data_[0] + get_size(); }
+
+	VertexTraits const *get_vertex_traits() const { return traits_; }
+
+protected:
+	RecordingRendererPtr renderer_;
+	std::vector<char> data_;
+	VertexTraits const *traits_;
+
+	RecordingVertexBuffer(RecordingRendererPtr const &renderer, size_t size, VertexTraits const *traits);
+};
+
+}
@@ -57,9 +57,15 @@ public:
 
 	virtual UberShaderPtr get_uber_shader() const = 0;
 
+	// whether draw calls could be executed instanced
+	virtual bool is_instancing_supported() const = 0;
+
 	virtual DrawCallPtr create_draw_call() = 0;
 	virtual UberDrawCallPtr create_uber_draw_call() = 0;
 
+	// call is constructed in arena memory, owner has to destroy it before arena is reset
+	virtual UberDrawCall *create_frame_uber_draw_call(FrameArena &arena) = 0;
+
     static void bind(lua_State *L);
 };
 
@@ -6,7 +6,10 @@
 #include "renderer.h"
 #include "draw_call.h"
 #include "uber_draw_call.h"
+#include "recording_renderer.h"
+#if defined(_WIN32)
 #include "d3d9_renderer.h"
+#endif
 
 namespace graphic
 {
@@ -31,11 +34,22 @@ void Renderer::bind(lua_State *L)
 		.def("create_vertex_array_pnjwt", &Renderer::create_vertex_array<VERTEX_PNJWT>)
 		.def("create_index_array_16", &Renderer::create_index_array<INDEX_U16>)
 		.def("create_draw_call", &Renderer::create_draw_call)
-		.def("create_uber_draw_call", &Renderer::create_uber_draw_call),
+		.def("create_uber_draw_call", &Renderer::create_uber_draw_call)
+		.def("is_instancing_supported", &Renderer::is_instancing_supported),
 
+		class_<RecordingRenderer, Renderer, RendererPtr>("RecordingRenderer")
+		.def(constructor<int, int>())
+		.def("reset_log", &RecordingRenderer::reset_log)
+		.def("set_instancing_supported", &RecordingRenderer::set_instancing_supported)
+    ];
+
+#if defined(_WIN32)
+    module_(L, "graphic")
+    [
 		class_<D3D9Renderer, Renderer, RendererPtr>("D3D9Renderer")
 		.def(constructor<int, int, bool>())
     ];
+#endif
 }
 
 }
\ No newline at end of file
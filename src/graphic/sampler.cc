@@ -1,40 +1,308 @@
 
+#include <cmath>
+#include <stdexcept>
 #include <algorithm>
-#include <boost/lambda/lambda.hpp>
 #include <graphic/sampler.h>
 
 namespace graphic {
 
-void Sampler::add_sample(math::scalar time, math::matrix<4,4> const &m)
+namespace
 {
-	sample s;
-	s.time = time;
-	s.transform = m;
-	s.translation.set(m.ij[3][0], m.ij[3][1], m.ij[3][2]);
-	s.rotation.set_unit(m);
 
-	if (samples_.size()) {
-		samples_.back().rotation_interpolator.setup(samples_.back().rotation, s.rotation);
-	}
+math::scalar const ROTATION_RANGE = 32767;
+math::scalar const TRANSLATION_RANGE = 65535;
+
+// keys are kept in same hemisphere, so shortest arc is interpolated; close rotations are interpolated linearly
+math::quaternion<> interpolate(math::quaternion<> const &p, math::quaternion<> const &q, math::scalar k)
+{
+	math::scalar const dot = math::dot_product(p, q);
+	if (dot > 0.9995f) return (p * (1 - k) + q * k).normalized();
 
-	samples_.push_back(s);
+	math::scalar const omega = std::acos(dot);
+	math::scalar const inv_sin_omega = 1 / std::sin(omega);
+	return p * (std::sin((1 - k) * omega) * inv_sin_omega) + q * (std::sin(k * omega) * inv_sin_omega);
+}
+
+// distance between unit quaternions keeps precision for small angles unlike acos of their dot product
+math::scalar angle(math::quaternion<> const &p, math::quaternion<> const &q)
+{
+	math::quaternion<> const d = math::dot_product(p, q) < 0 ? p + q : p - q;
+	return 4 * std::asin(std::min(d.norm() / 2, math::scalar(1)));
 }
 
-math::matrix<4,4> Sampler::get(math::scalar time) const {
-	if (time <= samples_.front().time) return samples_.front().transform;
-	if (time >= samples_.back().time) return samples_.back().transform;
+template<class T>
+void shrink(std::vector<T> &v)
+{
+	std::vector<T>(v).swap(v);
+}
+
+}
+
+void Sampler::value::assign(math::matrix<4,4> const &m)
+{
+	math::matrix<4,4> r = m;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		scale.i[i] = std::sqrt(r.ij[i][0] * r.ij[i][0] + r.ij[i][1] * r.ij[i][1] + r.ij[i][2] * r.ij[i][2]);
+		if (scale.i[i] > 0)
+		{
+			for (int j = 0; j < 3; ++j) r.ij[i][j] /= scale.i[i];
+		}
+	}
 
-	using namespace boost::lambda;
-	samples_type::const_iterator it = std::lower_bound(samples_.begin(), samples_.end(), sample(time), &_1 ->* &sample::time < &_2 ->* &sample::time);
+	// reflection could not be kept by rotation, it is moved to scale of first row
+	math::scalar const det =
+		r.ij[0][0] * (r.ij[1][1] * r.ij[2][2] - r.ij[1][2] * r.ij[2][1]) -
+		r.ij[0][1] * (r.ij[1][0] * r.ij[2][2] - r.ij[1][2] * r.ij[2][0]) +
+		r.ij[0][2] * (r.ij[1][0] * r.ij[2][1] - r.ij[1][1] * r.ij[2][0]);
 
-	math::scalar k = (time - (it - 1)->time) / (it->time - (it - 1)->time);
-	math::scalar inv_k = 1.0f - k;
+	if (det < 0)
+	{
+		scale.x = -scale.x;
+		for (int j = 0; j < 3; ++j) r.ij[0][j] = -r.ij[0][j];
+	}
 
+	rotation.set_unit(r);
+	rotation.normalize();
+	translation.set(m.ij[3][0], m.ij[3][1], m.ij[3][2]);
+}
+
+math::matrix<4,4> Sampler::value::to_matrix() const
+{
 	math::matrix<4,4> m;
-	m.rotation((it - 1)->rotation_interpolator.interpolate(k));
-	m.translate((it - 1)->translation * inv_k + it->translation * k);
+	m.rotation(rotation);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j) m.ij[i][j] *= scale.i[i];
+	}
+
+	m.ij[3][0] = translation.x;
+	m.ij[3][1] = translation.y;
+	m.ij[3][2] = translation.z;
 	return m;
 }
 
+Sampler::Sampler():
+	slot_(NO_SLOT),
+	translation_min_(0, 0, 0),
+	translation_step_(0, 0, 0)
+{
 }
 
+void Sampler::add_sample(math::scalar time, math::matrix<4,4> const &m)
+{
+	if (is_quantized()) throw std::logic_error("samples could not be added to compressed sampler");
+
+	value v;
+	v.assign(m);
+	if (!rotations_.empty() && math::dot_product(rotations_.back(), v.rotation) < 0) v.rotation = -v.rotation;
+
+	bool const rigid = std::abs(v.scale.x - 1) < 1e-4f && std::abs(v.scale.y - 1) < 1e-4f && std::abs(v.scale.z - 1) < 1e-4f;
+	if (!rigid && scales_.empty()) scales_.resize(times_.size(), math::vec<3>(1, 1, 1));
+	if (!rigid || !scales_.empty()) scales_.push_back(v.scale);
+
+	times_.push_back(time);
+	rotations_.push_back(v.rotation);
+	translations_.push_back(v.translation);
+}
+
+// key is removed when interpolation from last kept key to next one reproduces all keys between them
+void Sampler::compress(math::scalar rotation_tolerance, math::scalar translation_tolerance, bool quantize)
+{
+	if (is_quantized()) throw std::logic_error("sampler is compressed already");
+
+	size_t const count = times_.size();
+
+	if (count > 2)
+	{
+		std::vector<bool> kept(count, false);
+		kept.front() = kept.back() = true;
+
+		size_t first = 0;
+		for (size_t i = 1; i + 1 < count; ++i)
+		{
+			size_t const last = i + 1;
+			bool reproduced = times_[last] > times_[first];
+
+			for (size_t j = first + 1; j <= i && reproduced; ++j)
+			{
+				math::scalar const k = (times_[j] - times_[first]) / (times_[last] - times_[first]);
+
+				reproduced = angle(interpolate(rotations_[first], rotations_[last], k), rotations_[j]) <= rotation_tolerance &&
+					(translations_[first] * (1 - k) + translations_[last] * k - translations_[j]).length() <= translation_tolerance &&
+					(scales_.empty() || (scales_[first] * (1 - k) + scales_[last] * k - scales_[j]).length() <= translation_tolerance);
+			}
+
+			if (!reproduced)
+			{
+				kept[i] = true;
+				first = i;
+			}
+		}
+
+		remove_keys(kept);
+	}
+
+	if (quantize && !times_.empty()) this->quantize();
+}
+
+void Sampler::remove_keys(std::vector<bool> const &kept)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < times_.size(); ++i)
+	{
+		if (!kept[i]) continue;
+
+		times_[n] = times_[i];
+		rotations_[n] = rotations_[i];
+		translations_[n] = translations_[i];
+		if (!scales_.empty()) scales_[n] = scales_[i];
+		++n;
+	}
+
+	times_.resize(n);
+	rotations_.resize(n);
+	translations_.resize(n);
+	if (!scales_.empty()) scales_.resize(n);
+
+	shrink(times_);
+	shrink(rotations_);
+	shrink(translations_);
+	shrink(scales_);
+}
+
+void Sampler::quantize()
+{
+	size_t const count = times_.size();
+
+	math::vec<3> max = translations_.front();
+	translation_min_ = translations_.front();
+
+	for (size_t i = 1; i < count; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			translation_min_.i[j] = std::min(translation_min_.i[j], translations_[i].i[j]);
+			max.i[j] = std::max(max.i[j], translations_[i].i[j]);
+		}
+	}
+
+	for (int j = 0; j < 3; ++j) translation_step_.i[j] = (max.i[j] - translation_min_.i[j]) / TRANSLATION_RANGE;
+
+	quantized_rotations_.resize(count * 4);
+	quantized_translations_.resize(count * 3);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		math::quaternion<> const &q = rotations_[i];
+		quantized_rotations_[i * 4 + 0] = boost::int16_t(std::floor(q.x * ROTATION_RANGE + 0.5f));
+		quantized_rotations_[i * 4 + 1] = boost::int16_t(std::floor(q.y * ROTATION_RANGE + 0.5f));
+		quantized_rotations_[i * 4 + 2] = boost::int16_t(std::floor(q.z * ROTATION_RANGE + 0.5f));
+		quantized_rotations_[i * 4 + 3] = boost::int16_t(std::floor(q.w * ROTATION_RANGE + 0.5f));
+
+		for (int j = 0; j < 3; ++j)
+		{
+			math::scalar const step = translation_step_.i[j];
+			quantized_translations_[i * 3 + j] = step > 0 ?
+				boost::uint16_t(std::floor((translations_[i].i[j] - translation_min_.i[j]) / step + 0.5f)) : 0;
+		}
+	}
+
+	std::vector<math::quaternion<> >().swap(rotations_);
+	std::vector<math::vec<3> >().swap(translations_);
+}
+
+math::quaternion<> Sampler::get_rotation(size_t key) const
+{
+	if (!is_quantized()) return rotations_[key];
+
+	boost::int16_t const *q = &quantized_rotations_[key * 4];
+	return math::quaternion<>(q[0] / ROTATION_RANGE, q[1] / ROTATION_RANGE, q[2] / ROTATION_RANGE, q[3] / ROTATION_RANGE).normalized();
+}
+
+math::vec<3> Sampler::get_translation(size_t key) const
+{
+	if (!is_quantized()) return translations_[key];
+
+	boost::uint16_t const *t = &quantized_translations_[key * 3];
+	return math::vec<3>(translation_min_.x + t[0] * translation_step_.x,
+		translation_min_.y + t[1] * translation_step_.y,
+		translation_min_.z + t[2] * translation_step_.z);
+}
+
+math::vec<3> Sampler::get_scale(size_t key) const
+{
+	return scales_.empty() ? math::vec<3>(1, 1, 1) : scales_[key];
+}
+
+size_t Sampler::get_memory_size() const
+{
+	return times_.capacity() * sizeof(math::scalar) +
+		rotations_.capacity() * sizeof(math::quaternion<>) +
+		translations_.capacity() * sizeof(math::vec<3>) +
+		scales_.capacity() * sizeof(math::vec<3>) +
+		quantized_rotations_.capacity() * sizeof(boost::int16_t) +
+		quantized_translations_.capacity() * sizeof(boost::uint16_t);
+}
+
+// time is strictly between first and last keys, so found key has next one
+size_t Sampler::find_key(math::scalar time, size_t &cursor) const
+{
+	size_t const last = times_.size() - 2;
+
+	if (cursor <= last && times_[cursor] <= time)
+	{
+		if (time < times_[cursor + 1]) return cursor;
+		if (cursor < last && time < times_[cursor + 2]) return ++cursor;
+	}
+
+	cursor = std::upper_bound(times_.begin(), times_.end(), time) - times_.begin() - 1;
+	return cursor;
+}
+
+void Sampler::get_key(size_t key, value &result) const
+{
+	result.rotation = get_rotation(key);
+	result.translation = get_translation(key);
+	result.scale = get_scale(key);
+}
+
+void Sampler::get(math::scalar time, size_t &cursor, value &result) const
+{
+	if (times_.empty()) throw std::logic_error("sampler " + sid_ + " has no samples");
+
+	if (time <= times_.front()) return get_key(0, result);
+	if (time >= times_.back()) return get_key(times_.size() - 1, result);
+
+	size_t const key = find_key(time, cursor);
+
+	math::scalar const k = (time - times_[key]) / (times_[key + 1] - times_[key]);
+	math::scalar const inv_k = 1 - k;
+
+	result.rotation = interpolate(get_rotation(key), get_rotation(key + 1), k);
+	result.translation = get_translation(key) * inv_k + get_translation(key + 1) * k;
+	result.scale = get_scale(key) * inv_k + get_scale(key + 1) * k;
+}
+
+math::matrix<4,4> Sampler::get(math::scalar time, size_t &cursor) const
+{
+	value result;
+	get(time, cursor, result);
+	return result.to_matrix();
+}
+
+math::matrix<4,4> Sampler::get(math::scalar time) const
+{
+	size_t cursor = 0;
+	return get(time, cursor);
+}
+
+void Sampler::get_first(value &result) const
+{
+	if (times_.empty()) throw std::logic_error("sampler " + sid_ + " has no samples");
+	get_key(0, result);
+}
+
+}
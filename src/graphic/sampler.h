@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <boost/cstdint.hpp>
 #include <math/vec.h>
 #include <math/quaternion.h>
 #include <math/matrix.h>
@@ -11,37 +12,77 @@
 namespace graphic
 {
 
+// Animation track of one joint transform. Samples are decomposed to rotation, translation and scale which
+// are kept in separate arrays of keys, scales only when some sample is not rigid. Keys could be compressed:
+// keys reproduced by interpolation of their neighbours are removed and rotations and translations are
+// quantized to 16 bits per component. Search of keys starts from cursor of caller, so forward playback
+// finds them in constant time.
 struct Sampler {
-private:
-	struct sample {
-		math::scalar time;
-		math::matrix<4,4> transform;
+public:
+	// transform decomposed to parts, matrix scales, then rotates, then translates
+	struct value {
 		math::quaternion<> rotation;
-		math::quaternion_slerper<> rotation_interpolator;
 		math::vec<3> translation;
+		math::vec<3> scale;
 
-		sample(math::scalar t = 0):
-		time(t)
-		{
-		}
+		// rows of 3x3 part are scaled rows of rotation
+		void assign(math::matrix<4,4> const &m);
+		math::matrix<4,4> to_matrix() const;
 	};
 
-	typedef std::vector<sample> samples_type;
-
+private:
 	std::string sid_;
 	JointWeakPtr joint_;
-	samples_type samples_;
+	size_t slot_;
+
+	std::vector<math::scalar> times_;
+	std::vector<math::quaternion<> > rotations_;
+	std::vector<math::vec<3> > translations_;
+	std::vector<math::vec<3> > scales_;
+
+	// quantized keys replace rotations_ and translations_, translations are relative to bounds of track
+	std::vector<boost::int16_t> quantized_rotations_;
+	std::vector<boost::uint16_t> quantized_translations_;
+	math::vec<3> translation_min_, translation_step_;
+
+	math::quaternion<> get_rotation(size_t key) const;
+	math::vec<3> get_translation(size_t key) const;
+	math::vec<3> get_scale(size_t key) const;
+	void get_key(size_t key, value &result) const;
+	size_t find_key(math::scalar time, size_t &cursor) const;
+	void remove_keys(std::vector<bool> const &kept);
+	void quantize();
 
 public:
-	void set_target(JointPtr joint_ptr, std::string const &sid) { joint_ = joint_ptr; sid_ = sid; }
+	static size_t const NO_SLOT = size_t(-1);
 
+	Sampler();
+
+	void set_target(JointPtr joint_ptr, std::string const &sid) { joint_ = joint_ptr; sid_ = sid; slot_ = NO_SLOT; }
+	std::string const &get_sid() const { return sid_; }
+
+	// slot of target transform in skeleton of model, it is resolved by Model::build_skeleton()
+	size_t get_slot() const { return slot_; }
+	void set_slot(size_t slot) { slot_ = slot; }
+
+	// samples are added in order of time, compressed sampler could not get more of them
 	void add_sample(math::scalar time, math::matrix<4,4> const &m);
-	math::matrix<4,4> get(math::scalar time) const;
 
-	void set_target_matrix(math::scalar t) const {
-		if (JointPtr joint_ptr = joint_.lock())
-			joint_ptr->get_transform_by_sid(sid_) = get(t);
-	}
+	// removes keys which differ from interpolation of kept neighbours less than tolerances, rotation one is
+	// angle in radians; keys are quantized when quantize flag is set
+	void compress(math::scalar rotation_tolerance, math::scalar translation_tolerance, bool quantize);
+
+	size_t get_keys_count() const { return times_.size(); }
+	bool is_quantized() const { return !quantized_rotations_.empty(); }
+	// bytes allocated for keys
+	size_t get_memory_size() const;
+
+	// cursor is key found by previous call for same playback, it is updated; zero is valid for first call
+	void get(math::scalar time, size_t &cursor, value &result) const;
+	math::matrix<4,4> get(math::scalar time, size_t &cursor) const;
+	math::matrix<4,4> get(math::scalar time) const;
+	// value of first key, additive animations are relative to it
+	void get_first(value &result) const;
 
 	// stores joint as weak ptr
 	JointPtr get_joint() const { return joint_.lock(); }
@@ -1,17 +1,95 @@
 
 #include <algorithm>
-#include <boost/lambda/lambda.hpp>
+#include <cstring>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <math/parallel.h>
 #include "draw_call.h"
+#include "draw_call_bucket.h"
 #include "renderer.h"
 #include "scheduler.h"
 
 namespace graphic
 {
 
+namespace
+{
+
+// below this count comparison sort is faster than going through histograms
+size_t const RADIX_SORT_MIN = 64;
+
+double seconds_since(boost::posix_time::ptime const &start)
+{
+	return (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+}
+
+template<class Entry>
+inline bool key_less(Entry const &lhs, Entry const &rhs)
+{
+	return lhs.key < rhs.key;
+}
+
+// stable least significant digit radix sort by 8 bit digits, digits which are same in all keys are
+// skipped, so only bits which differ cost a pass; result is in entries
+template<class Entry>
+void radix_sort(std::vector<Entry> &entries, std::vector<Entry> &buffer)
+{
+	size_t const count = entries.size();
+	size_t histograms[8][256] = {};
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		boost::uint64_t const key = entries[i].key;
+		for (int digit = 0; digit < 8; ++digit) ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+	}
+
+	buffer.resize(count);
+	Entry *from = &entries[0], *to = &buffer[0];
+
+	for (int digit = 0; digit < 8; ++digit)
+	{
+		size_t *histogram = histograms[digit];
+		if (histogram[(from[0].key >> (digit * 8)) & 0xFF] == count) continue;
+
+		size_t offset = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			size_t const n = histogram[i];
+			histogram[i] = offset;
+			offset += n;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			to[histogram[(from[i].key >> (digit * 8)) & 0xFF]++] = from[i];
+		}
+
+		std::swap(from, to);
+	}
+
+	if (from != &entries[0]) entries.swap(buffer);
+}
+
+}
+
 Scheduler::Scheduler(RendererPtr const &renderer):
+	visible_calls_count_(0),
+	invisible_calls_count_(0),
+	shader_changes_count_(0),
+	material_changes_count_(0),
+	instanced_calls_count_(0),
+	instances_count_(0),
+	instancing_enabled_(true),
+	cull_time_(0),
+	sort_time_(0),
+	execute_time_(0),
 	renderer_(renderer)
 {
 	draw_calls_.reserve(4096);
+	sort_entries_.reserve(4096);
+
+	set_buckets_count(1);
 }
 
 Scheduler::~Scheduler()
@@ -20,29 +98,234 @@ Scheduler::~Scheduler()
 
 void Scheduler::add(DrawCallPtr const &draw_call)
 {
-	draw_calls_.push_back(draw_call);
+	buckets_.front()->add(draw_call);
+}
+
+void Scheduler::set_buckets_count(size_t count)
+{
+	if (!count) throw std::logic_error("scheduler needs at least one bucket");
+
+	for (size_t i = count; i < buckets_.size(); ++i)
+	{
+		if (!buckets_[i]->get_draw_calls().empty()) throw std::logic_error("removed bucket has draw calls");
+	}
+
+	buckets_.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!buckets_[i]) buckets_[i].reset(new DrawCallBucket(renderer_));
+	}
 }
 
 void Scheduler::flush()
 {
-	visible_calls_count_ = invisible_calls_count_ = 0;
+	draw_calls_.clear();
+	for (size_t i = 0; i < buckets_.size(); ++i)
+	{
+		std::vector<DrawCall *> const &draw_calls = buckets_[i]->get_draw_calls();
+		draw_calls_.insert(draw_calls_.end(), draw_calls.begin(), draw_calls.end());
+	}
+
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+	cull();
+	cull_time_ = seconds_since(start);
 
-	std::sort(draw_calls_.begin(), draw_calls_.end(), *boost::lambda::_1 < *boost::lambda::_2);
+	start = boost::posix_time::microsec_clock::universal_time();
+	sort();
+	sort_time_ = seconds_since(start);
 
-	for(draw_calls_type::const_iterator it = draw_calls_.begin(); it != draw_calls_.end(); ++it)
+	start = boost::posix_time::microsec_clock::universal_time();
+	execute();
+	execute_time_ = seconds_since(start);
+
+	draw_calls_.clear();
+	for (size_t i = 0; i < buckets_.size(); ++i) buckets_[i]->clear();
+}
+
+// fills sort entries with visible calls, in order they were added
+void Scheduler::cull()
+{
+	size_t const count = draw_calls_.size();
+
+	cull_groups_.clear();
+	cull_slots_.resize(count);
+
+	// group of each call is stored to its slot at first
+	size_t last_group = 0;
+	for (size_t i = 0; i < count; ++i)
 	{
-		if ((*it)->is_visible())
+		DrawCall const &draw_call = *draw_calls_[i];
+
+		if (draw_call.is_always_visible())
 		{
-			++visible_calls_count_;
-			(*it)->execute();
+			cull_slots_[i] = NO_CULL_SLOT;
+			continue;
 		}
-		else
+
+		math::matrix<4,4> const &view_projection = draw_call.get_view_projection_matrix();
+
+		if (cull_groups_.empty() || std::memcmp(&view_projection, &cull_groups_[last_group].draw_call->get_view_projection_matrix(),
+			sizeof(view_projection)) != 0)
 		{
-			++invisible_calls_count_;
+			for (last_group = 0; last_group < cull_groups_.size(); ++last_group)
+			{
+				if (!std::memcmp(&view_projection, &cull_groups_[last_group].draw_call->get_view_projection_matrix(),
+					sizeof(view_projection))) break;
+			}
+
+			if (last_group == cull_groups_.size())
+			{
+				CullGroup group = { &draw_call, 0, 0 };
+				cull_groups_.push_back(group);
+			}
 		}
+
+		++cull_groups_[last_group].count;
+		cull_slots_[i] = last_group;
 	}
 
-	draw_calls_.clear();
+	size_t nslots = 0;
+	cull_chunks_.clear();
+
+	for (std::vector<CullGroup>::iterator it = cull_groups_.begin(); it != cull_groups_.end(); ++it)
+	{
+		it->first = nslots;
+		nslots += (it->count + 31) & ~size_t(31);
+
+		for (size_t first = 0; first < it->count; first += CULL_CHUNK_SIZE)
+		{
+			size_t const chunk_count = it->count - first < CULL_CHUNK_SIZE ? it->count - first : CULL_CHUNK_SIZE;
+			CullChunk chunk = { &it->draw_call->get_frustum(), it->first + first, chunk_count };
+			cull_chunks_.push_back(chunk);
+		}
+
+		it->count = 0;
+	}
+
+	for (int k = 0; k < 12; ++k) cull_bounds_[k].resize(nslots);
+	visible_bits_.resize(nslots / 32);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (cull_slots_[i] == NO_CULL_SLOT) continue;
+
+		CullGroup &group = cull_groups_[cull_slots_[i]];
+		size_t const slot = group.first + group.count++;
+		cull_slots_[i] = slot;
+
+		math::obb<3> const &bounds = draw_calls_[i]->get_obb();
+		math::vec<3> const tangent = bounds.tangent * 0.5f, normal = bounds.normal * 0.5f, binormal = bounds.binormal * 0.5f;
+		math::vec<3> const centre = bounds.origin + tangent + normal + binormal;
+
+		cull_bounds_[0][slot] = centre.x;
+		cull_bounds_[1][slot] = centre.y;
+		cull_bounds_[2][slot] = centre.z;
+		cull_bounds_[3][slot] = tangent.x;
+		cull_bounds_[4][slot] = tangent.y;
+		cull_bounds_[5][slot] = tangent.z;
+		cull_bounds_[6][slot] = normal.x;
+		cull_bounds_[7][slot] = normal.y;
+		cull_bounds_[8][slot] = normal.z;
+		cull_bounds_[9][slot] = binormal.x;
+		cull_bounds_[10][slot] = binormal.y;
+		cull_bounds_[11][slot] = binormal.z;
+	}
+
+	// threads of math/parallel.h pool test ranges of chunks
+	math::parallel_for(cull_chunks_.size(), PARALLEL_CULL_MIN / CULL_CHUNK_SIZE, 1,
+		boost::bind(&Scheduler::cull_chunks, this, _1, _2));
+
+	sort_entries_.clear();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t const slot = cull_slots_[i];
+
+		if (slot == NO_CULL_SLOT || (visible_bits_[slot / 32] & (1u << (slot % 32))))
+		{
+			SortEntry entry = { draw_calls_[i]->get_sort_key(), boost::uint32_t(i) };
+			sort_entries_.push_back(entry);
+		}
+	}
+
+	visible_calls_count_ = sort_entries_.size();
+	invisible_calls_count_ = count - visible_calls_count_;
+}
+
+void Scheduler::cull_chunks(size_t first, size_t count)
+{
+	for (size_t i = first; i < first + count; ++i)
+	{
+		CullChunk const &chunk = cull_chunks_[i];
+
+		math::frustum<>::obb_arrays bounds = {
+			&cull_bounds_[0][chunk.first], &cull_bounds_[1][chunk.first], &cull_bounds_[2][chunk.first],
+			&cull_bounds_[3][chunk.first], &cull_bounds_[4][chunk.first], &cull_bounds_[5][chunk.first],
+			&cull_bounds_[6][chunk.first], &cull_bounds_[7][chunk.first], &cull_bounds_[8][chunk.first],
+			&cull_bounds_[9][chunk.first], &cull_bounds_[10][chunk.first], &cull_bounds_[11][chunk.first]
+		};
+
+		chunk.frustum->test_intersection(bounds, chunk.count, &visible_bits_[chunk.first / 32]);
+	}
+}
+
+void Scheduler::sort()
+{
+	if (sort_entries_.size() < RADIX_SORT_MIN)
+	{
+		std::stable_sort(sort_entries_.begin(), sort_entries_.end(), key_less<SortEntry>);
+	}
+	else
+	{
+		radix_sort(sort_entries_, sort_buffer_);
+	}
+}
+
+void Scheduler::execute()
+{
+	shader_changes_count_ = material_changes_count_ = 0;
+	instanced_calls_count_ = instances_count_ = 0;
+
+	bool const instancing = instancing_enabled_ && renderer_->is_instancing_supported();
+	boost::uint64_t previous_key = 0;
+
+	for (sort_entries_type::const_iterator it = sort_entries_.begin(); it != sort_entries_.end(); )
+	{
+		if (it == sort_entries_.begin() || DrawCall::get_sort_key_shader(it->key) != DrawCall::get_sort_key_shader(previous_key))
+			++shader_changes_count_;
+
+		if (it == sort_entries_.begin() || DrawCall::get_sort_key_material(it->key) != DrawCall::get_sort_key_material(previous_key))
+			++material_changes_count_;
+
+		DrawCall &draw_call = *draw_calls_[it->index];
+
+		// instances have same material and shader, so they don't change state between each other
+		sort_entries_type::const_iterator end = it + 1;
+		if (instancing && draw_call.is_instanceable())
+		{
+			while (end != sort_entries_.end() && size_t(end - it) < DrawCall::MAX_INSTANCES_COUNT
+				&& draw_calls_[end->index]->is_instance_of(draw_call)) ++end;
+		}
+
+		previous_key = (end - 1)->key;
+
+		if (end - it > 1)
+		{
+			instance_matrices_.clear();
+			for (; it != end; ++it) instance_matrices_.push_back(draw_calls_[it->index]->get_world_matrix());
+
+			draw_call.execute_instanced(&instance_matrices_[0], instance_matrices_.size());
+
+			++instanced_calls_count_;
+			instances_count_ += instance_matrices_.size();
+		}
+		else
+		{
+			draw_call.execute();
+			++it;
+		}
+	}
 }
 
 }
@@ -3,7 +3,11 @@
 #include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 #include <luabind/lua_include.hpp>
+#include <math/scalar.h>
+#include <math/matrix.h>
+#include <math/frustum.h>
 #include "forward.h"
 
 namespace graphic
@@ -11,24 +15,100 @@ namespace graphic
 
 class Scheduler: public boost::noncopyable {
 public:
+	// visibility is tested in parallel when at least this many calls have to be culled
+	static size_t const PARALLEL_CULL_MIN = 8192;
+
 	Scheduler(RendererPtr const &renderer);
 	~Scheduler();
 
+	// adds call to first bucket
 	void add(DrawCallPtr const &draw_call);
+
+	// buckets let threads record draw calls concurrently, each thread has to use its own bucket; calls
+	// are merged in order of buckets at flush, count must not be changed while buckets have calls
+	void set_buckets_count(size_t count);
+	size_t get_buckets_count() const { return buckets_.size(); }
+	DrawCallBucket &get_bucket(size_t index) { return *buckets_.at(index); }
+
+	// culls calls, then executes visible ones in order of their sort keys, calls with equal keys are
+	// executed in order they were added
 	void flush();
 
 	size_t get_visible_calls_count() const { return visible_calls_count_; }
 	size_t get_invisible_calls_count() const { return invisible_calls_count_; }
 
+	// switches between executed calls in last flush, first call is counted as switch
+	size_t get_shader_changes_count() const { return shader_changes_count_; }
+	size_t get_material_changes_count() const { return material_changes_count_; }
+
+	// runs of sorted calls which are instances of same geometry are merged into one instanced call when
+	// renderer supports it, otherwise calls are executed one by one
+	void set_instancing_enabled(bool flag) { instancing_enabled_ = flag; }
+	bool is_instancing_enabled() const { return instancing_enabled_; }
+
+	// instanced calls made by last flush and visible calls merged into them
+	size_t get_instanced_calls_count() const { return instanced_calls_count_; }
+	size_t get_instances_count() const { return instances_count_; }
+
+	// duration of phases of last flush in seconds
+	double get_cull_time() const { return cull_time_; }
+	double get_sort_time() const { return sort_time_; }
+	double get_execute_time() const { return execute_time_; }
+
 	static void bind(lua_State *L);
 
 private:
-	typedef std::vector<DrawCallPtr> draw_calls_type;
+	typedef std::vector<DrawCall *> draw_calls_type;
+
+	struct SortEntry
+	{
+		boost::uint64_t key;
+		boost::uint32_t index;
+	};
+
+	typedef std::vector<SortEntry> sort_entries_type;
+
+	// calls with same view projection matrix are culled against same frustum, slots of group start at
+	// multiple of 32 so each word of visibility bits belongs to one group
+	struct CullGroup
+	{
+		DrawCall const *draw_call;
+		size_t first, count;
+	};
+
+	struct CullChunk
+	{
+		math::frustum<> const *frustum;
+		size_t first, count;
+	};
+
+	static size_t const CULL_CHUNK_SIZE = 1024;
+	static size_t const NO_CULL_SLOT = size_t(-1);
 
 	size_t visible_calls_count_, invisible_calls_count_;
+	size_t shader_changes_count_, material_changes_count_;
+	size_t instanced_calls_count_, instances_count_;
+	bool instancing_enabled_;
+	double cull_time_, sort_time_, execute_time_;
 
-	RendererPtr const &renderer_;
+	RendererPtr const renderer_;
+	std::vector<boost::shared_ptr<DrawCallBucket> > buckets_;
 	draw_calls_type draw_calls_;
+	sort_entries_type sort_entries_, sort_buffer_;
+
+	std::vector<CullGroup> cull_groups_;
+	std::vector<CullChunk> cull_chunks_;
+	std::vector<size_t> cull_slots_;
+	// centres and halves of sides of oriented boxes, see math::frustum<>::obb_arrays
+	std::vector<math::scalar> cull_bounds_[12];
+	std::vector<boost::uint32_t> visible_bits_;
+
+	std::vector<math::matrix<4,4> > instance_matrices_;
+
+	void cull();
+	void cull_chunks(size_t first, size_t count);
+	void sort();
+	void execute();
 };
 
 }
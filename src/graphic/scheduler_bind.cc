@@ -15,8 +15,19 @@ void Scheduler::bind(lua_State *L)
 		.def(constructor<RendererPtr const &>())
 		.def("add", &Scheduler::add)
 		.def("flush", &Scheduler::flush)
+		.def("set_buckets_count", &Scheduler::set_buckets_count)
+		.def("get_buckets_count", &Scheduler::get_buckets_count)
 		.def("get_visible_calls_count", &Scheduler::get_visible_calls_count)
 		.def("get_invisible_calls_count", &Scheduler::get_invisible_calls_count)
+		.def("get_shader_changes_count", &Scheduler::get_shader_changes_count)
+		.def("get_material_changes_count", &Scheduler::get_material_changes_count)
+		.def("set_instancing_enabled", &Scheduler::set_instancing_enabled)
+		.def("is_instancing_enabled", &Scheduler::is_instancing_enabled)
+		.def("get_instanced_calls_count", &Scheduler::get_instanced_calls_count)
+		.def("get_instances_count", &Scheduler::get_instances_count)
+		.def("get_cull_time", &Scheduler::get_cull_time)
+		.def("get_sort_time", &Scheduler::get_sort_time)
+		.def("get_execute_time", &Scheduler::get_execute_time)
 	];
 }
 
@@ -1,6 +1,5 @@
 
 #include <util/logger.h>
-#include "directx_error.h"
 #include "shader.h"
 
 namespace graphic
@@ -19,6 +19,7 @@ public:
 		virtual void set(math::vec<4> const &v) = 0;
 		virtual void set(math::matrix<4, 4> const &m) = 0;
 		virtual void set(std::vector<math::matrix<4,4> > const &value) = 0;
+		virtual void set(math::matrix<4,4> const *matrices, size_t count) = 0;
 		virtual void set(TexturePtr const &t) = 0;
 		virtual void set(void const *ptr, size_t size) = 0;
 	};
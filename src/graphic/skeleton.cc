@@ -0,0 +1,137 @@
+
+#include <stdexcept>
+#include <algorithm>
+#include <math/simd_matrix.h>
+#include "joint.h"
+#include "skeleton.h"
+
+namespace graphic
+{
+
+namespace
+{
+
+struct depth_less
+{
+	std::vector<size_t> const *depths;
+
+	bool operator ()(size_t a, size_t b) const
+	{
+		return (*depths)[a] < (*depths)[b];
+	}
+};
+
+}
+
+Skeleton::Skeleton()
+{
+	first_slots_.push_back(0);
+}
+
+// joints are stable sorted by depth, so siblings keep order of model
+void Skeleton::build(std::vector<JointPtr> const &joints)
+{
+	size_t const count = joints.size();
+
+	std::vector<size_t> parents(count, NO_PARENT);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (joints[i]->index != i) throw std::logic_error("joint index does not match its position in model");
+
+		if (JointPtr parent = joints[i]->parent.lock())
+		{
+			if (parent->index >= count || joints[parent->index] != parent) throw std::logic_error("parent of joint " + joints[i]->id + " is not in model");
+			parents[i] = parent->index;
+		}
+	}
+
+	std::vector<size_t> depths(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t depth = 0;
+		for (size_t j = parents[i]; j != NO_PARENT; j = parents[j])
+		{
+			if (++depth > count) throw std::logic_error("hierarchy of joint " + joints[i]->id + " has a cycle");
+		}
+		depths[i] = depth;
+	}
+
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; ++i) order[i] = i;
+
+	depth_less const less = { &depths };
+	std::stable_sort(order.begin(), order.end(), less);
+
+	order_.swap(order);
+	parents_.resize(count);
+	positions_.resize(count);
+	first_slots_.resize(1);
+	sids_.clear();
+	slot_joints_.clear();
+	bind_transforms_.clear();
+
+	for (size_t k = 0; k < count; ++k)
+	{
+		Joint const &joint = *joints[order_[k]];
+
+		parents_[k] = parents[order_[k]];
+		positions_[order_[k]] = k;
+
+		for (std::vector<Joint::transform>::const_iterator it = joint.transforms.begin(); it != joint.transforms.end(); ++it)
+		{
+			sids_.push_back(it->sid);
+			slot_joints_.push_back(order_[k]);
+			bind_transforms_.push_back(it->matrix);
+		}
+
+		first_slots_.push_back(bind_transforms_.size());
+	}
+}
+
+size_t Skeleton::get_transform_slot(size_t joint, std::string const &sid) const
+{
+	if (joint >= positions_.size()) throw std::logic_error("joint is not in skeleton");
+
+	size_t const position = positions_[joint];
+	for (size_t slot = first_slots_[position]; slot < first_slots_[position + 1]; ++slot)
+	{
+		if (sids_[slot] == sid) return slot;
+	}
+
+	throw std::logic_error("transform sid = " + sid + " not found");
+}
+
+void Skeleton::build_model_matrices(math::matrix<4,4> const *transforms, math::matrix<4,4> *result) const
+{
+	math::simd_matrix m, t;
+
+	for (size_t k = 0; k < order_.size(); ++k)
+	{
+		size_t slot = first_slots_[k + 1];
+
+		if (slot == first_slots_[k])
+		{
+			m.identity();
+		}
+		else
+		{
+			m.assign(transforms[--slot]);
+
+			while (slot-- > first_slots_[k])
+			{
+				t.assign(transforms[slot]);
+				m *= t;
+			}
+		}
+
+		if (parents_[k] != NO_PARENT)
+		{
+			t.assign(result[parents_[k]]);
+			m *= t;
+		}
+
+		m.store(result[order_[k]]);
+	}
+}
+
+}
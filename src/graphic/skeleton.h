@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <math/matrix.h>
+#include "forward.h"
+
+namespace graphic
+{
+
+// Joint hierarchy compiled to flat arrays. Joints are kept in topological order, parent of every joint
+// goes before it, so local-to-model matrices are computed in one linear pass. Local transforms of all
+// joints are numbered by slots which are contiguous for every joint and follow order of joints, animation
+// samplers resolve their targets to slots once when model is loaded.
+class Skeleton {
+public:
+	static size_t const NO_PARENT = size_t(-1);
+
+	Skeleton();
+
+	// joints[i]->index has to be i, throws std::logic_error when parent of joint is not in array or
+	// hierarchy has a cycle
+	void build(std::vector<JointPtr> const &joints);
+
+	size_t get_joints_count() const { return order_.size(); }
+	size_t get_transforms_count() const { return bind_transforms_.size(); }
+
+	// index of joint at given position of topological order and index of its parent or NO_PARENT
+	size_t get_joint(size_t position) const { return order_[position]; }
+	size_t get_parent(size_t position) const { return parents_[position]; }
+
+	// throws std::logic_error when joint has no transform with given sid
+	size_t get_transform_slot(size_t joint, std::string const &sid) const;
+	// index of joint which transform is kept in given slot
+	size_t get_slot_joint(size_t slot) const { return slot_joints_[slot]; }
+
+	// local transforms of joints as they were loaded, by slots
+	std::vector<math::matrix<4,4> > const &get_bind_transforms() const { return bind_transforms_; }
+
+	// local transforms by slots to local-to-model matrices by joint indices, same as product of joint
+	// transforms in reverse order multiplied by matrix of parent
+	void build_model_matrices(math::matrix<4,4> const *transforms, math::matrix<4,4> *result) const;
+
+private:
+	std::vector<size_t> order_;
+	std::vector<size_t> parents_;
+	std::vector<size_t> first_slots_; // slots of joint at position i are [first_slots_[i], first_slots_[i + 1])
+	std::vector<size_t> positions_; // by joint index
+	std::vector<std::string> sids_; // by slots
+	std::vector<size_t> slot_joints_;
+	std::vector<math::matrix<4,4> > bind_transforms_;
+};
+
+}
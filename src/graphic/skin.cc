@@ -0,0 +1,305 @@
+
+#include <stdexcept>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <math/simd.h>
+#include <math/parallel.h>
+#include <math/transform.h>
+#include "skin.h"
+
+namespace graphic
+{
+
+namespace
+{
+
+// zero vectors are kept
+inline math::vec<3> normalize(math::vec<3> v)
+{
+	math::scalar const length_sq = v.x * v.x + v.y * v.y + v.z * v.z;
+	if (length_sq > 0) v /= std::sqrt(length_sq);
+	return v;
+}
+
+#ifdef MATH_SSE
+
+// rows of blended matrix, sum of joint matrices multiplied by weights
+template<size_t N>
+inline void blend(math::matrix<4,4> const *joint_matrices, boost::uint32_t const *joints, math::scalar const *weights,
+	__m128 &r0, __m128 &r1, __m128 &r2, __m128 &r3)
+{
+	math::matrix<4,4> const &m = joint_matrices[joints[0]];
+	__m128 const w = _mm_set1_ps(weights[0]);
+
+	r0 = _mm_mul_ps(_mm_loadu_ps(m.ij[0]), w);
+	r1 = _mm_mul_ps(_mm_loadu_ps(m.ij[1]), w);
+	r2 = _mm_mul_ps(_mm_loadu_ps(m.ij[2]), w);
+	r3 = _mm_mul_ps(_mm_loadu_ps(m.ij[3]), w);
+
+	for (size_t i = 1; i < N; ++i)
+	{
+		math::matrix<4,4> const &m = joint_matrices[joints[i]];
+		__m128 const w = _mm_set1_ps(weights[i]);
+
+		r0 = _mm_add_ps(r0, _mm_mul_ps(_mm_loadu_ps(m.ij[0]), w));
+		r1 = _mm_add_ps(r1, _mm_mul_ps(_mm_loadu_ps(m.ij[1]), w));
+		r2 = _mm_add_ps(r2, _mm_mul_ps(_mm_loadu_ps(m.ij[2]), w));
+		r3 = _mm_add_ps(r3, _mm_mul_ps(_mm_loadu_ps(m.ij[3]), w));
+	}
+}
+
+inline __m128 transform_vector(math::vec<3> const &v, __m128 r0, __m128 r1, __m128 r2)
+{
+	__m128 r = _mm_mul_ps(_mm_set1_ps(v.x), r0);
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.y), r1));
+	return _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.z), r2));
+}
+
+// zero vectors are kept
+inline __m128 normalize(__m128 v)
+{
+	__m128 const sq = _mm_mul_ps(v, v);
+	__m128 const length_sq = _mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, 1)), _mm_shuffle_ps(sq, sq, 2));
+
+	if (_mm_cvtss_f32(length_sq) <= 0) return v;
+
+	__m128 const length = _mm_sqrt_ss(length_sq);
+	return _mm_div_ps(v, _mm_shuffle_ps(length, length, 0));
+}
+
+// three components are stored, so next field of vertex is not overwritten
+inline void store(math::vec<3> &r, __m128 v)
+{
+	_mm_storel_pi(reinterpret_cast<__m64 *>(&r.x), v);
+	_mm_store_ss(&r.z, _mm_movehl_ps(v, v));
+}
+
+template<size_t N>
+void skin_vertex(Skin::vertex_type const &source, math::matrix<4,4> const *joint_matrices,
+	boost::uint32_t const *joints, math::scalar const *weights, Skin::vertex_type &result)
+{
+	__m128 r0, r1, r2, r3;
+	blend<N>(joint_matrices, joints, weights, r0, r1, r2, r3);
+
+	store(result.position, _mm_add_ps(transform_vector(source.position, r0, r1, r2), r3));
+	store(result.tangent, normalize(transform_vector(source.tangent, r0, r1, r2)));
+	store(result.binormal, normalize(transform_vector(source.binormal, r0, r1, r2)));
+	store(result.normal, normalize(transform_vector(source.normal, r0, r1, r2)));
+	result.texcoords = source.texcoords;
+}
+
+#else
+
+template<size_t N>
+void blend(math::matrix<4,4> const *joint_matrices, boost::uint32_t const *joints, math::scalar const *weights,
+	math::matrix<4,4> &r)
+{
+	for (size_t i = 0; i < 4; ++i)
+		for (size_t j = 0; j < 4; ++j)
+			r.ij[i][j] = joint_matrices[joints[0]].ij[i][j] * weights[0];
+
+	for (size_t k = 1; k < N; ++k)
+		for (size_t i = 0; i < 4; ++i)
+			for (size_t j = 0; j < 4; ++j)
+				r.ij[i][j] += joint_matrices[joints[k]].ij[i][j] * weights[k];
+}
+
+inline math::vec<3> transform_vector(math::vec<3> const &v, math::matrix<4,4> const &m)
+{
+	return math::vec<3>(v.x * m._11 + v.y * m._21 + v.z * m._31,
+		v.x * m._12 + v.y * m._22 + v.z * m._32,
+		v.x * m._13 + v.y * m._23 + v.z * m._33);
+}
+
+template<size_t N>
+void skin_vertex(Skin::vertex_type const &source, math::matrix<4,4> const *joint_matrices,
+	boost::uint32_t const *joints, math::scalar const *weights, Skin::vertex_type &result)
+{
+	math::matrix<4,4> m;
+	blend<N>(joint_matrices, joints, weights, m);
+
+	result.position = transform_vector(source.position, m) + math::vec<3>(m._41, m._42, m._43);
+	result.tangent = normalize(transform_vector(source.tangent, m));
+	result.binormal = normalize(transform_vector(source.binormal, m));
+	result.normal = normalize(transform_vector(source.normal, m));
+	result.texcoords = source.texcoords;
+}
+
+#endif
+
+}
+
+struct Skin::Kernel
+{
+	Skin const *skin;
+	vertex_type const *source;
+	math::matrix<4,4> const *joint_matrices;
+	vertex_type *result;
+
+	template<size_t N>
+	void run_group(Group const &group, size_t first, size_t end) const
+	{
+		boost::uint32_t const *joints = &skin->joints_[0] + group.first_influence + (first - group.first) * N;
+		math::scalar const *weights = &skin->weights_[0] + group.first_influence + (first - group.first) * N;
+
+		for (size_t i = first; i < end; ++i, joints += N, weights += N)
+		{
+			boost::uint32_t const v = skin->vertices_[i];
+			skin_vertex<N>(source[v], joint_matrices, joints, weights, result[v]);
+		}
+	}
+
+	// range of vertices_, it could span several groups
+	void run(size_t first, size_t count) const
+	{
+		size_t const end = first + count;
+
+		for (size_t n = 0; n <= MAX_INFLUENCES; ++n)
+		{
+			Group const &group = skin->groups_[n];
+
+			size_t const group_first = std::max(first, group.first);
+			size_t const group_end = std::min(end, group.first + group.count);
+			if (group_first >= group_end) continue;
+
+			switch (n)
+			{
+			case 0:
+				for (size_t i = group_first; i < group_end; ++i)
+				{
+					boost::uint32_t const v = skin->vertices_[i];
+					result[v] = source[v];
+					result[v].position = math::vec<3>(0, 0, 0);
+				}
+				break;
+			case 1: run_group<1>(group, group_first, group_end); break;
+			case 2: run_group<2>(group, group_first, group_end); break;
+			case 3: run_group<3>(group, group_first, group_end); break;
+			case 4: run_group<4>(group, group_first, group_end); break;
+			case 5: run_group<5>(group, group_first, group_end); break;
+			case 6: run_group<6>(group, group_first, group_end); break;
+			case 7: run_group<7>(group, group_first, group_end); break;
+			case 8: run_group<8>(group, group_first, group_end); break;
+			}
+		}
+	}
+};
+
+Skin::Skin():
+	joints_limit_(0),
+	rigid_joint_(NOT_RIGID)
+{
+	clear();
+}
+
+void Skin::clear()
+{
+	std::fill(groups_, groups_ + MAX_INFLUENCES + 1, Group());
+	vertices_.clear();
+	joints_.clear();
+	weights_.clear();
+	joints_limit_ = 0;
+	rigid_joint_ = NOT_RIGID;
+}
+
+void Skin::build(JointWeights const *weights, size_t count)
+{
+	clear();
+
+	std::vector<unsigned char> influences(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (size_t j = 0; j < MAX_INFLUENCES; ++j)
+		{
+			if (weights[i].weights.i[j] > math::EPSILON) ++influences[i];
+		}
+		++groups_[influences[i]].count;
+	}
+
+	size_t first = 0, first_influence = 0;
+	for (size_t n = 0; n <= MAX_INFLUENCES; ++n)
+	{
+		groups_[n].first = first;
+		groups_[n].first_influence = first_influence;
+		first += groups_[n].count;
+		first_influence += groups_[n].count * n;
+	}
+
+	vertices_.resize(count);
+	joints_.resize(first_influence);
+	weights_.resize(first_influence);
+
+	size_t filled[MAX_INFLUENCES + 1] = {};
+	for (size_t i = 0; i < count; ++i)
+	{
+		Group const &group = groups_[influences[i]];
+		size_t const k = filled[influences[i]]++;
+
+		vertices_[group.first + k] = boost::uint32_t(i);
+
+		size_t influence = group.first_influence + k * influences[i];
+		for (size_t j = 0; j < MAX_INFLUENCES; ++j)
+		{
+			if (weights[i].weights.i[j] > math::EPSILON)
+			{
+				joints_[influence] = weights[i].joints.i[j];
+				weights_[influence] = weights[i].weights.i[j];
+				joints_limit_ = std::max<size_t>(joints_limit_, joints_[influence] + 1);
+				++influence;
+			}
+		}
+	}
+
+	if (count == 0 || groups_[1].count != count) return;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (joints_[i] != joints_[0] || math::abs(weights_[i] - 1) > math::EPSILON) return;
+	}
+
+	rigid_joint_ = joints_[0];
+}
+
+size_t Skin::get_group_size(size_t influences) const
+{
+	return influences <= MAX_INFLUENCES ? groups_[influences].count : 0;
+}
+
+// vertices are split to equal ranges between threads of math/parallel.h pool
+void Skin::transform(vertex_type const *source, math::matrix<4,4> const *joint_matrices, size_t joints_count,
+	vertex_type *result) const
+{
+	if (joints_limit_ > joints_count) throw std::out_of_range("joint index is out of range");
+
+	if (rigid_joint_ != NOT_RIGID)
+	{
+		transform_rigid(source, joint_matrices[rigid_joint_], result);
+		return;
+	}
+
+	Kernel const kernel = { this, source, joint_matrices, result };
+	size_t const count = vertices_.size();
+
+	math::parallel_for(count, PARALLEL_MIN, 1, boost::bind(&Kernel::run, &kernel, _1, _2));
+}
+
+void Skin::transform_rigid(vertex_type const *source, math::matrix<4,4> const &m, vertex_type *result) const
+{
+	size_t const count = vertices_.size(), stride = sizeof(vertex_type);
+
+	math::transform_points(m, &source->position, stride, &result->position, stride, count);
+	math::transform_vectors(m, &source->tangent, stride, &result->tangent, stride, count);
+	math::transform_vectors(m, &source->binormal, stride, &result->binormal, stride, count);
+	math::transform_vectors(m, &source->normal, stride, &result->normal, stride, count);
+
+	// weight is one, so only scale of joint matrix could change length of vectors
+	for (size_t i = 0; i < count; ++i)
+	{
+		result[i].tangent = normalize(result[i].tangent);
+		result[i].binormal = normalize(result[i].binormal);
+		result[i].normal = normalize(result[i].normal);
+		result[i].texcoords = source[i].texcoords;
+	}
+}
+
+}
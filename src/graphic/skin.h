@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <math/matrix.h>
+#include "vertex.h"
+
+namespace graphic
+{
+
+// Joint influences of mesh vertices prepared for skinning on cpu. Influences with weight not greater
+// than math::EPSILON are dropped and vertices are grouped by count of remaining ones, so every group
+// is skinned by loop of fixed length. Joint matrices of vertex are blended before it is transformed,
+// positions, tangents, binormals and normals are skinned in sse registers and meshes with more than
+// PARALLEL_MIN vertices are split between threads. Rigid mesh, which has all vertices bound to one
+// joint with weight one, is transformed by math/transform.h array kernels without blending.
+class Skin {
+public:
+	typedef VERTEX_PTBNT vertex_type;
+
+	static size_t const MAX_INFLUENCES = 8;
+	static size_t const PARALLEL_MIN = 1 << 13;
+
+	#pragma pack(push, 1)
+	struct JointWeights
+	{
+		math::vec<8, unsigned> joints;
+		math::vec<8> weights;
+	};
+	#pragma pack(pop)
+
+	Skin();
+
+	void build(JointWeights const *weights, size_t count);
+	void clear();
+
+	size_t get_vertices_count() const { return vertices_.size(); }
+	size_t get_influences_count() const { return joints_.size(); }
+	// vertices with given count of influences
+	size_t get_group_size(size_t influences) const;
+	bool is_rigid() const { return rigid_joint_ != NOT_RIGID; }
+
+	// source and result have get_vertices_count() elements and should not overlap, texture coordinates are
+	// copied, vertices without influences get zero position like in sum of weighted positions
+	void transform(vertex_type const *source, math::matrix<4,4> const *joint_matrices, size_t joints_count,
+		vertex_type *result) const;
+
+private:
+	struct Group
+	{
+		size_t first; // in vertices_
+		size_t count;
+		size_t first_influence; // in joints_ and weights_
+	};
+
+	struct Kernel;
+
+	static size_t const NOT_RIGID = size_t(-1);
+
+	Group groups_[MAX_INFLUENCES + 1];
+	std::vector<boost::uint32_t> vertices_; // vertex indices in order of groups
+	std::vector<boost::uint32_t> joints_;
+	std::vector<math::scalar> weights_;
+	size_t joints_limit_; // greatest joint index plus one
+	size_t rigid_joint_; // joint of rigid mesh, NOT_RIGID for others
+
+	void transform_rigid(vertex_type const *source, math::matrix<4,4> const &m, vertex_type *result) const;
+};
+
+}
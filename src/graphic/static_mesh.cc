@@ -1,11 +1,10 @@
 
-#include "directx_error.h"
 #include <util/logger.h>
 #include "uber_shader.h"
 #include "uber_draw_call.h"
 #include "static_model.h"
 #include "renderer.h"
-#include "scheduler.h"
+#include "draw_call_bucket.h"
 #include "static_mesh.h"
 
 namespace graphic
@@ -55,13 +54,14 @@ void BasicStaticMesh<T>::check()
 }
 
 template<class T>
-void BasicStaticMesh<T>::draw(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix)
+void BasicStaticMesh<T>::draw(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix,
+	DrawCallBucket &bucket)
 {
-	math::matrix<4,4> transform = joint_ptr->matrix * world_matrix;
+	math::matrix<4,4> transform = model.get_joint_matrix(joint_ptr->index) * world_matrix;
 
 	for (triangles_list_type::const_iterator it = triangles_list.begin(); it != triangles_list.end(); it++)
 	{
-		UberDrawCallPtr draw_call = get_model()->get_renderer()->create_uber_draw_call();
+		UberDrawCall *draw_call = bucket.create_uber_draw_call();
 
 		{
 			math::obb<3> bounds(bounds_);
@@ -81,7 +81,7 @@ void BasicStaticMesh<T>::draw(Joint *joint_ptr, CameraPtr const &camera, math::m
 		draw_call->set_always_visible(always_visible_);
 		draw_call->commit();
 
-		get_model()->get_scheduler()->add(draw_call);
+		bucket.add(draw_call);
 	}
 }
 
@@ -1,7 +1,5 @@
 #pragma once
 
-#include <d3d9.h>
-#include <util/boost_com_intrusive_ptr.h>
 #include <math/aabb.h>
 #include "vertex.h"
 #include "vertex_array.h"
@@ -30,7 +28,8 @@ public:
 
 	virtual void check();
 
-	virtual void draw(Joint *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix);
+	virtual void draw(Model const &model, Joint const *joint_ptr, CameraPtr const &camera, math::matrix<4,4> const &world_matrix,
+		DrawCallBucket &bucket);
 
 	virtual void set_vertices(GenericVertex *vertices, GenericVertex::format_type format, size_t count);
 	virtual void set_indices(unsigned *indices, size_t count);
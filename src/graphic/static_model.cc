@@ -1,6 +1,5 @@
 
 #include <luabind/luabind.hpp>
-#include "directx_error.h"
 #include "static_model.h"
 
 namespace graphic
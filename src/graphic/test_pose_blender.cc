@@ -0,0 +1,213 @@
+
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include "joint.h"
+#include "skeleton.h"
+#include "pose_blender.h"
+
+namespace
+{
+
+bool equal(math::matrix<4,4> const &a, math::matrix<4,4> const &b)
+{
+	for (size_t i = 0; i < 4; ++i)
+		for (size_t j = 0; j < 4; ++j)
+			if (abs(a.ij[i][j] - b.ij[i][j]) > 1e-3f) return false;
+
+	return true;
+}
+
+math::matrix<4,4> transform(math::vec<3> const &axis, math::scalar angle, math::scalar x)
+{
+	math::matrix<4,4> m;
+	m.rotation(axis, angle);
+	m.ij[3][0] = x;
+	return m;
+}
+
+// reflection across plane of y and z axes, as of mirrored joint
+math::matrix<4,4> mirror(math::matrix<4,4> m)
+{
+	for (int j = 0; j < 3; ++j) m.ij[0][j] = -m.ij[0][j];
+	return m;
+}
+
+// chain of joints with one transform each, animations rotate all of them
+struct Fixture
+{
+	std::vector<graphic::JointPtr> joints;
+	graphic::Skeleton skeleton;
+
+	Fixture()
+	{
+		for (size_t i = 0; i < 4; ++i)
+		{
+			graphic::JointPtr joint(new graphic::Joint(i));
+			joint->id = "joint";
+			joint->transforms.push_back(graphic::Joint::transform("transform", transform(math::vec<3>(1, 0, 0), 0.1f * i, 1)));
+			if (i > 0) joint->parent = joints.back();
+
+			joints.push_back(joint);
+		}
+
+		skeleton.build(joints);
+	}
+
+	// rotation about axis changes from angle at zero time to double angle at one second
+	graphic::AnimationPtr create_animation(math::vec<3> const &axis, math::scalar angle, math::scalar x)
+	{
+		graphic::AnimationPtr animation(new graphic::Animation);
+		animation->samplers.resize(joints.size());
+
+		for (size_t i = 0; i < joints.size(); ++i)
+		{
+			graphic::Sampler &sampler = animation->samplers[i];
+			sampler.set_target(joints[i], "transform");
+			sampler.set_slot(skeleton.get_transform_slot(i, "transform"));
+			sampler.add_sample(0, transform(axis, angle, x));
+			sampler.add_sample(1, transform(axis, 2 * angle, x));
+		}
+
+		return animation;
+	}
+
+	std::vector<math::matrix<4,4> > evaluate(graphic::PoseBlender &blender)
+	{
+		std::vector<math::matrix<4,4> > pose(skeleton.get_transforms_count());
+		blender.evaluate(skeleton, &pose[0]);
+		return pose;
+	}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(pose_blender)
+
+BOOST_FIXTURE_TEST_CASE(crossfade, Fixture)
+{
+	math::vec<3> const y(0, 1, 0);
+	graphic::PoseBlender blender;
+
+	BOOST_REQUIRE (equal(evaluate(blender)[2], skeleton.get_bind_transforms()[2]));
+
+	blender.add_layer(create_animation(y, 0.2f, 1));
+	size_t const layer = blender.add_layer(create_animation(y, 0.6f, 3), 0);
+
+	BOOST_REQUIRE (equal(evaluate(blender)[1], transform(y, 0.2f, 1)));
+
+	blender.set_weight(layer, 0.5f);
+	BOOST_REQUIRE (equal(evaluate(blender)[1], transform(y, 0.4f, 2)));
+
+	blender.set_time(0, 1);
+	blender.set_time(layer, 1);
+	BOOST_REQUIRE (equal(evaluate(blender)[1], transform(y, 0.8f, 2)));
+
+	blender.set_weight(layer, 1);
+	BOOST_REQUIRE (equal(evaluate(blender)[1], transform(y, 1.2f, 3)));
+}
+
+BOOST_FIXTURE_TEST_CASE(mask, Fixture)
+{
+	math::vec<3> const y(0, 1, 0);
+	graphic::PoseBlender blender;
+
+	size_t const layer = blender.add_layer(create_animation(y, 0.2f, 1), 0.5f);
+
+	std::vector<math::scalar> mask(2, 0);
+	mask[1] = 2;
+	blender.set_mask(layer, mask);
+
+	// joint out of mask gets bind transform, weight is clamped
+	std::vector<math::matrix<4,4> > const pose = evaluate(blender);
+	BOOST_REQUIRE (equal(pose[0], skeleton.get_bind_transforms()[0]));
+	BOOST_REQUIRE (equal(pose[1], transform(y, 0.2f, 1)));
+	BOOST_REQUIRE (equal(pose[3], skeleton.get_bind_transforms()[3]));
+}
+
+BOOST_FIXTURE_TEST_CASE(additive, Fixture)
+{
+	math::vec<3> const y(0, 1, 0), z(0, 0, 1);
+	graphic::PoseBlender blender;
+
+	blender.add_layer(create_animation(y, 0.4f, 1));
+	size_t const layer = blender.add_layer(create_animation(z, 0.3f, 0), 1, true);
+
+	// difference from first key is applied after base rotation
+	blender.set_time(layer, 1);
+
+	BOOST_REQUIRE (equal(evaluate(blender)[2], transform(y, 0.4f, 0) * transform(z, 0.3f, 1)));
+
+	blender.set_weight(layer, 0.5f);
+	BOOST_REQUIRE (equal(evaluate(blender)[2], transform(y, 0.4f, 0) * transform(z, 0.15f, 1)));
+
+	blender.set_weight(layer, 0);
+	BOOST_REQUIRE (equal(evaluate(blender)[2], transform(y, 0.4f, 1)));
+}
+
+// bind transforms decomposed for blending keep reflection of mirrored joints
+BOOST_FIXTURE_TEST_CASE(mirrored_bind, Fixture)
+{
+	math::vec<3> const x(1, 0, 0), y(0, 1, 0);
+
+	for (size_t i = 0; i < joints.size(); ++i)
+	{
+		joints[i]->transforms[0].matrix = mirror(joints[i]->transforms[0].matrix);
+	}
+	skeleton.build(joints);
+
+	// additive layer at its first key leaves bind pose
+	graphic::PoseBlender blender;
+	blender.add_layer(create_animation(y, 0.2f, 0), 1, true);
+
+	std::vector<math::matrix<4,4> > pose = evaluate(blender);
+	for (size_t slot = 0; slot < pose.size(); ++slot)
+	{
+		BOOST_REQUIRE (equal(pose[slot], skeleton.get_bind_transforms()[slot]));
+	}
+
+	// mirrored samples blended with mirrored bind pose stay mirrored
+	graphic::AnimationPtr animation(new graphic::Animation);
+	animation->samplers.resize(1);
+	animation->samplers[0].set_target(joints[2], "transform");
+	animation->samplers[0].set_slot(skeleton.get_transform_slot(2, "transform"));
+	animation->samplers[0].add_sample(0, mirror(transform(x, 0.6f, 3)));
+
+	blender.clear();
+	blender.add_layer(animation, 0.5f);
+
+	BOOST_REQUIRE (equal(evaluate(blender)[2], mirror(transform(x, 0.4f, 2))));
+}
+
+BOOST_FIXTURE_TEST_CASE(benchmark, Fixture)
+{
+	math::vec<3> const y(0, 1, 0);
+	graphic::AnimationPtr walk = create_animation(y, 0.2f, 1), run = create_animation(y, 0.6f, 3);
+
+	std::vector<math::matrix<4,4> > pose(skeleton.get_transforms_count());
+	size_t const frames = 10000;
+
+	graphic::Animation::cursor_type cursor;
+	std::clock_t start = std::clock();
+	for (size_t i = 0; i < frames; ++i) walk->sample(math::scalar(i) / frames, &pose[0], cursor);
+	double const sample_time = double(std::clock() - start) / CLOCKS_PER_SEC / frames;
+
+	graphic::PoseBlender blender;
+	blender.add_layer(walk, 1);
+	blender.add_layer(run, 0.5f);
+
+	start = std::clock();
+	for (size_t i = 0; i < frames; ++i)
+	{
+		blender.set_time(0, math::scalar(i) / frames);
+		blender.set_time(1, math::scalar(i) / frames);
+		blender.evaluate(skeleton, &pose[0]);
+	}
+	double const blend_time = double(std::clock() - start) / CLOCKS_PER_SEC / frames;
+
+	BOOST_REQUIRE (equal(pose[0], transform(y, 0.8f, 2)));
+
+	BOOST_TEST_MESSAGE("pose of " << pose.size() << " slots: " << sample_time * 1e6 << "us by one animation, "
+		<< blend_time * 1e6 << "us by crossfade of two");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,186 @@
+
+#include <ctime>
+#include <xercesc/util/PlatformUtils.hpp>
+#include <boost/test/unit_test.hpp>
+#include <util/get_sources_path.h>
+#include "material.h"
+#include "scheduler.h"
+#include "static_model.h"
+#include "uber_draw_call.h"
+#include "recording_renderer.h"
+
+namespace
+{
+
+struct Fixture
+{
+	graphic::RecordingRendererPtr renderer;
+	graphic::CameraPtr camera;
+
+	Fixture():
+		renderer(new graphic::RecordingRenderer()),
+		camera(new graphic::Camera())
+	{
+		renderer->postconstruct();
+
+		camera->set_perspective_projection(math::PI / 2, 4.0f / 3.0f, 1, 1000);
+		camera->set_eye_lookat_up(math::vec<3>(10, 1, 10), math::vec<3>(0, 0, 0), math::vec<3>(0, 1, 0));
+	}
+
+	graphic::MaterialPtr create_material()
+	{
+		graphic::MaterialPtr material = renderer->create_material();
+		material->set_diffuse_texture(renderer->create_texture(4, 4, graphic::PixelFormat::DEFAULT_FORMAT));
+		return material;
+	}
+
+	graphic::UberDrawCallPtr create_draw_call(graphic::VertexArrayPNT &vertex_array, graphic::IndexArray16 &index_array,
+		graphic::MaterialPtr const &material, size_t triangles_count)
+	{
+		graphic::UberDrawCallPtr draw_call = renderer->create_uber_draw_call();
+		draw_call->set_always_visible(true);
+		draw_call->set_vertex_buffer(vertex_array.get_vertex_buffer());
+		draw_call->set_index_buffer(index_array.get_index_buffer());
+		draw_call->set_material(material);
+		draw_call->set_vertices_count(vertex_array.get_count());
+		draw_call->set_triangles_count(triangles_count);
+		draw_call->set_camera(camera);
+		draw_call->commit();
+		return draw_call;
+	}
+};
+
+struct ColladaFixture: Fixture
+{
+	ColladaFixture()
+	{
+		xercesc::XMLPlatformUtils::Initialize();
+	}
+
+	~ColladaFixture()
+	{
+		xercesc::XMLPlatformUtils::Terminate();
+	}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(recording_renderer)
+
+BOOST_FIXTURE_TEST_CASE(uploads, Fixture)
+{
+	boost::shared_ptr<graphic::VertexArrayPNT> vertex_array = renderer->create_vertex_array<graphic::VERTEX_PNT>(3);
+	boost::shared_ptr<graphic::IndexArray16> index_array = renderer->create_index_array<graphic::INDEX_U16>(6);
+	graphic::TexturePtr texture = renderer->create_texture(8, 4, graphic::PixelFormat::DEFAULT_FORMAT);
+
+	BOOST_REQUIRE (vertex_array->get_count() == 3);
+	BOOST_REQUIRE (renderer->get_log().bytes_uploaded == 0);
+
+	vertex_array->lock(true)[2].position = math::vec<3>(1, 2, 3);
+	vertex_array->unlock();
+	BOOST_REQUIRE (renderer->get_log().bytes_uploaded == 3 * sizeof(graphic::VERTEX_PNT));
+	BOOST_REQUIRE (vertex_array->at(2)->position == math::vec<3>(1, 2, 3));
+
+	index_array->lock(true);
+	index_array->put(5, 2);
+	index_array->unlock();
+	BOOST_REQUIRE (renderer->get_log().bytes_uploaded == 3 * sizeof(graphic::VERTEX_PNT) + 6 * sizeof(graphic::INDEX_U16));
+	BOOST_REQUIRE (index_array->get(5) == 2);
+
+	texture->lock(true);
+	texture->unlock();
+	BOOST_REQUIRE (renderer->get_log().bytes_uploaded == 3 * sizeof(graphic::VERTEX_PNT) + 6 * sizeof(graphic::INDEX_U16) + 8 * 4 * 4);
+
+	renderer->reset_log();
+	BOOST_REQUIRE (renderer->get_log().bytes_uploaded == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(draw_calls, Fixture)
+{
+	boost::shared_ptr<graphic::VertexArrayPNT> vertex_array = renderer->create_vertex_array<graphic::VERTEX_PNT>(4);
+	boost::shared_ptr<graphic::IndexArray16> index_array = renderer->create_index_array<graphic::INDEX_U16>(6);
+
+	graphic::MaterialPtr materials[2] = { create_material(), create_material() };
+
+	graphic::SchedulerPtr scheduler(new graphic::Scheduler(renderer));
+
+	// scheduler sorts calls by material, so materials change once
+	scheduler->add(create_draw_call(*vertex_array, *index_array, materials[0], 2));
+	scheduler->add(create_draw_call(*vertex_array, *index_array, materials[1], 1));
+	scheduler->add(create_draw_call(*vertex_array, *index_array, materials[0], 1));
+
+	renderer->begin_frame();
+	scheduler->flush();
+	renderer->finish_frame();
+
+	graphic::RecordingRenderer::CommandLog const &log = renderer->get_log();
+	BOOST_REQUIRE (log.frames == 1);
+	BOOST_REQUIRE (log.draw_calls == 3);
+	BOOST_REQUIRE (log.triangles == 4);
+	BOOST_REQUIRE (log.vertex_buffer_changes == 1);
+	BOOST_REQUIRE (log.index_buffer_changes == 1);
+	BOOST_REQUIRE (log.material_changes == 2);
+	BOOST_REQUIRE (log.texture_changes == 2);
+	BOOST_REQUIRE (log.shader_changes == 1);
+	BOOST_REQUIRE (log.shader_parameter_sets == 9);
+
+	graphic::RecordingRenderer::commands_type const &commands = renderer->get_commands();
+	BOOST_REQUIRE (commands.size() == 3);
+	BOOST_REQUIRE ((commands[0].material == commands[1].material) != (commands[1].material == commands[2].material));
+	BOOST_REQUIRE (commands[0].vertex_buffer == vertex_array->get_vertex_buffer().get());
+	BOOST_REQUIRE (commands[0].shader != 0 && commands[0].shader == commands[2].shader);
+
+	// state stays bound between frames
+	scheduler->add(create_draw_call(*vertex_array, *index_array, materials[0], 2));
+
+	renderer->begin_frame();
+	scheduler->flush();
+	renderer->finish_frame();
+
+	BOOST_REQUIRE (log.frames == 2);
+	BOOST_REQUIRE (log.draw_calls == 4);
+	BOOST_REQUIRE (log.vertex_buffer_changes == 1);
+	BOOST_REQUIRE (log.material_changes == (commands[2].material == materials[0].get() ? 2u : 3u));
+}
+
+BOOST_FIXTURE_TEST_CASE(model, ColladaFixture)
+{
+	graphic::SchedulerPtr scheduler(new graphic::Scheduler(renderer));
+
+	graphic::ModelPtr model(new graphic::StaticModelPNT(renderer, scheduler));
+	model->load_from_collada(util::get_graphic_sources_path() + "/test_directions.xml");
+	model->set_animation_time(0);
+	model->set_always_visible(true);
+
+	math::matrix<4,4> world_matrix;
+	world_matrix.identity();
+
+	renderer->reset_log();
+	renderer->set_commands_recorded(false);
+
+	size_t const frames = 1000;
+
+	std::clock_t start = std::clock();
+	for (size_t i = 0; i < frames; ++i)
+	{
+		world_matrix.rotation(math::vec<3>(0, 0.01f * i, 0));
+		model->draw(camera, world_matrix);
+
+		renderer->begin_frame();
+		scheduler->flush();
+		renderer->finish_frame();
+	}
+	double const frame_time = double(std::clock() - start) / CLOCKS_PER_SEC / frames;
+
+	graphic::RecordingRenderer::CommandLog const &log = renderer->get_log();
+	BOOST_REQUIRE (log.frames == frames);
+	BOOST_REQUIRE (log.draw_calls > 0 && log.draw_calls % frames == 0);
+	BOOST_REQUIRE (log.triangles % frames == 0);
+	BOOST_REQUIRE (renderer->get_commands().empty());
+
+	BOOST_TEST_MESSAGE("static model: " << log.draw_calls / frames << " draw calls, " << log.triangles / frames
+		<< " triangles, " << log.material_changes << " material changes in " << frames << " frames, "
+		<< frame_time * 1000 << "ms per frame");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,177 @@
+
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include "animation.h"
+
+namespace
+{
+
+bool equal(math::matrix<4,4> const &a, math::matrix<4,4> const &b, math::scalar epsilon = 1e-3f)
+{
+	for (size_t i = 0; i < 4; ++i)
+		for (size_t j = 0; j < 4; ++j)
+			if (abs(a.ij[i][j] - b.ij[i][j]) > epsilon) return false;
+
+	return true;
+}
+
+// rotation around y axis and translation along x axis
+math::matrix<4,4> transform(math::scalar angle, math::scalar x)
+{
+	math::matrix<4,4> m;
+	m.rotation(math::vec<3>(0, 1, 0), angle);
+	m.ij[3][0] = x;
+	return m;
+}
+
+// uniform motion sampled with given count of keys in one second
+graphic::Sampler create_sampler(size_t keys)
+{
+	graphic::Sampler sampler;
+	for (size_t i = 0; i < keys; ++i)
+	{
+		math::scalar const t = math::scalar(i) / (keys - 1);
+		sampler.add_sample(t, transform(t * math::PI / 2, 2 * t));
+	}
+	return sampler;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(sampler)
+
+BOOST_AUTO_TEST_CASE(interpolation)
+{
+	graphic::Sampler sampler = create_sampler(2);
+
+	BOOST_REQUIRE (equal(sampler.get(-1), transform(0, 0)));
+	BOOST_REQUIRE (equal(sampler.get(0), transform(0, 0)));
+	BOOST_REQUIRE (equal(sampler.get(0.5f), transform(math::PI / 4, 1)));
+	BOOST_REQUIRE (equal(sampler.get(0.25f), transform(math::PI / 8, 0.5f)));
+	BOOST_REQUIRE (equal(sampler.get(1), transform(math::PI / 2, 2)));
+	BOOST_REQUIRE (equal(sampler.get(2), transform(math::PI / 2, 2)));
+
+	// scale is kept when samples are not rigid
+	math::matrix<4,4> scaled = transform(math::PI / 2, 2);
+	for (int j = 0; j < 3; ++j) scaled.ij[1][j] *= 3;
+
+	sampler.add_sample(2, scaled);
+	BOOST_REQUIRE (equal(sampler.get(2), scaled));
+	BOOST_REQUIRE (equal(sampler.get(0.5f), transform(math::PI / 4, 1)));
+	BOOST_REQUIRE (abs(sampler.get(1.5f).ij[1][1] - 2) < 1e-3f);
+}
+
+// reflection of mirrored joint is kept in scale, single key gives it back exactly
+BOOST_AUTO_TEST_CASE(mirrored)
+{
+	math::matrix<4,4> mirrored = transform(0.7f, 2);
+	for (int j = 0; j < 3; ++j) mirrored.ij[0][j] = -mirrored.ij[0][j];
+
+	math::matrix<4,4> flipped;
+	flipped.identity();
+	flipped.ij[2][2] = -2;
+
+	math::matrix<4,4> const keys[] = { mirrored, flipped, flipped * transform(0.7f, 2) };
+
+	for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+	{
+		graphic::Sampler sampler;
+		sampler.add_sample(0, keys[i]);
+		BOOST_REQUIRE (equal(sampler.get(0), keys[i], 1e-5f));
+
+		graphic::Sampler::value v;
+		v.assign(keys[i]);
+		BOOST_REQUIRE (equal(v.to_matrix(), keys[i], 1e-5f));
+	}
+
+	// mirrored keys are interpolated by rotation
+	graphic::Sampler sampler;
+	math::matrix<4,4> first = transform(0, 0), last = transform(math::PI / 2, 2), middle = transform(math::PI / 4, 1);
+	for (int j = 0; j < 3; ++j)
+	{
+		first.ij[1][j] = -first.ij[1][j];
+		last.ij[1][j] = -last.ij[1][j];
+		middle.ij[1][j] = -middle.ij[1][j];
+	}
+
+	sampler.add_sample(0, first);
+	sampler.add_sample(1, last);
+	BOOST_REQUIRE (equal(sampler.get(0.5f), middle));
+}
+
+BOOST_AUTO_TEST_CASE(cursor)
+{
+	graphic::Sampler sampler = create_sampler(31);
+
+	// forward and backward playback, key is skipped at last step
+	size_t cursor = 0;
+	math::scalar const times[] = { 0.01f, 0.02f, 0.05f, 0.08f, 0.5f, 0.51f, 0.3f, 0.99f, 0.1f };
+
+	for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); ++i)
+	{
+		BOOST_REQUIRE (equal(sampler.get(times[i], cursor), sampler.get(times[i])));
+		BOOST_REQUIRE (equal(sampler.get(times[i], cursor), transform(times[i] * math::PI / 2, 2 * times[i])));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(compression)
+{
+	graphic::Sampler sampler = create_sampler(101);
+	size_t const size = sampler.get_memory_size();
+
+	// uniform motion is reproduced by first and last keys
+	sampler.compress(1e-3f, 1e-3f, true);
+	BOOST_REQUIRE (sampler.get_keys_count() == 2);
+	BOOST_REQUIRE (sampler.is_quantized());
+	BOOST_REQUIRE (sampler.get_memory_size() * 10 < size);
+
+	for (size_t i = 0; i <= 100; ++i)
+	{
+		math::scalar const t = math::scalar(i) / 100;
+		BOOST_REQUIRE (equal(sampler.get(t), transform(t * math::PI / 2, 2 * t), 1e-2f));
+	}
+
+	BOOST_CHECK_THROW (sampler.add_sample(2, transform(0, 0)), std::logic_error);
+
+	// changes of direction are kept
+	graphic::Sampler steps;
+	for (size_t i = 0; i < 10; ++i) steps.add_sample(math::scalar(i), transform(0, math::scalar(i % 2)));
+
+	steps.compress(1e-3f, 1e-3f, false);
+	BOOST_REQUIRE (steps.get_keys_count() == 10);
+	BOOST_REQUIRE (!steps.is_quantized());
+}
+
+BOOST_AUTO_TEST_CASE(benchmark)
+{
+	graphic::Animation animation;
+	animation.samplers.assign(64, create_sampler(301));
+
+	for (size_t i = 0; i < animation.samplers.size(); ++i) animation.samplers[i].set_slot(i);
+
+	std::vector<math::matrix<4,4> > pose(animation.samplers.size());
+	size_t const frames = 1000;
+
+	std::clock_t start = std::clock();
+	for (size_t i = 0; i < frames; ++i)
+	{
+		graphic::Animation::cursor_type cursor;
+		animation.sample(math::scalar(i) / frames, &pose[0], cursor);
+	}
+	double const search_time = double(std::clock() - start) / CLOCKS_PER_SEC / frames;
+
+	graphic::Animation::cursor_type cursor;
+	start = std::clock();
+	for (size_t i = 0; i < frames; ++i) animation.sample(math::scalar(i) / frames, &pose[0], cursor);
+	double const cursor_time = double(std::clock() - start) / CLOCKS_PER_SEC / frames;
+
+	size_t const size = animation.get_memory_size();
+	animation.compress(1e-3f, 1e-3f, true);
+
+	BOOST_REQUIRE (equal(pose[0], animation.samplers[0].get(math::scalar(frames - 1) / frames), 1e-2f));
+
+	BOOST_TEST_MESSAGE("pose of " << animation.samplers.size() << " samplers: " << search_time * 1e6 << "us by search, "
+		<< cursor_time * 1e6 << "us by cursor; keys take " << size << " bytes, " << animation.get_memory_size() << " bytes compressed");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
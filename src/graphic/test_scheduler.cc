@@ -0,0 +1,456 @@
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/test/unit_test.hpp>
+#include <math/scalar.h>
+#include "material.h"
+#include "scheduler.h"
+#include "draw_call_bucket.h"
+#include "uber_draw_call.h"
+#include "recording_renderer.h"
+
+namespace
+{
+
+struct Fixture
+{
+	graphic::RecordingRendererPtr renderer;
+	graphic::SchedulerPtr scheduler;
+	graphic::CameraPtr camera;
+
+	boost::shared_ptr<graphic::VertexArrayPNT> vertices_pnt;
+	boost::shared_ptr<graphic::VertexArrayPT> vertices_pt;
+	boost::shared_ptr<graphic::IndexArray16> indices;
+	std::vector<graphic::MaterialPtr> materials;
+
+	std::vector<graphic::DrawCallPtr> draw_calls;
+
+	Fixture():
+		renderer(new graphic::RecordingRenderer()),
+		camera(new graphic::Camera())
+	{
+		renderer->postconstruct();
+		scheduler.reset(new graphic::Scheduler(renderer));
+
+		camera->set_perspective_projection(math::PI / 2, 4.0f / 3.0f, 1, 1000);
+		camera->set_eye_lookat_up(math::vec<3>(0, 0, 0), math::vec<3>(0, 0, 1), math::vec<3>(0, 1, 0));
+
+		vertices_pnt = renderer->create_vertex_array<graphic::VERTEX_PNT>(4);
+		vertices_pt = renderer->create_vertex_array<graphic::VERTEX_PT>(4);
+		indices = renderer->create_index_array<graphic::INDEX_U16>(6);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			materials.push_back(renderer->create_material());
+			materials.back()->set_diffuse_texture(renderer->create_texture(4, 4, graphic::PixelFormat::DEFAULT_FORMAT));
+		}
+	}
+
+	// index of call in draw_calls is passed as first index offset, so it could be found in recorded commands
+	graphic::DrawCallPtr add(bool pnt, graphic::MaterialPtr const &material, math::scalar distance, int priority = 0)
+	{
+		return add(pnt, material, math::vec<3>(0, 0, distance), priority, camera);
+	}
+
+	graphic::DrawCallPtr add(bool pnt, graphic::MaterialPtr const &material, math::vec<3> const &position, int priority,
+		graphic::CameraPtr const &camera)
+	{
+		graphic::UberDrawCallPtr draw_call = renderer->create_uber_draw_call();
+		draw_call->set_priority(priority);
+		draw_call->set_obb(math::aabb<3>(position - math::vec<3>(1, 1, 1), position + math::vec<3>(1, 1, 1)));
+		draw_call->set_vertex_buffer(pnt ? vertices_pnt->get_vertex_buffer() : vertices_pt->get_vertex_buffer());
+		draw_call->set_index_buffer(indices->get_index_buffer());
+		draw_call->set_material(material);
+		draw_call->set_vertices_count(4);
+		draw_call->set_first_index_offset(draw_calls.size());
+		draw_call->set_triangles_count(2);
+		draw_call->set_camera(camera);
+		draw_call->commit();
+
+		draw_calls.push_back(draw_call);
+		scheduler->add(draw_call);
+
+		return draw_call;
+	}
+
+	// calls drawing same geometry which differ only by world matrix, vertices_pnt unless other buffer is given
+	graphic::DrawCallPtr add_instance(graphic::MaterialPtr const &material, math::scalar distance,
+		size_t triangles_count = 2, graphic::VertexBufferPtr const &vertex_buffer = graphic::VertexBufferPtr())
+	{
+		math::matrix<4,4> world_matrix;
+		world_matrix.translation(0, 0, distance);
+
+		graphic::UberDrawCallPtr draw_call = renderer->create_uber_draw_call();
+		draw_call->set_obb(math::aabb<3>(math::vec<3>(-1, -1, distance - 1), math::vec<3>(1, 1, distance + 1)));
+		draw_call->set_vertex_buffer(vertex_buffer ? vertex_buffer : vertices_pnt->get_vertex_buffer());
+		draw_call->set_index_buffer(indices->get_index_buffer());
+		draw_call->set_material(material);
+		draw_call->set_vertices_count(4);
+		draw_call->set_triangles_count(triangles_count);
+		draw_call->set_world_matrix(world_matrix);
+		draw_call->set_camera(camera);
+		draw_call->commit();
+
+		draw_calls.push_back(draw_call);
+		scheduler->add(draw_call);
+
+		return draw_call;
+	}
+
+	// records calls to bucket as meshes do, index of call is passed as first index offset
+	void record(graphic::DrawCallBucket *bucket, size_t first, size_t count)
+	{
+		for (size_t i = first; i < first + count; ++i)
+		{
+			graphic::UberDrawCall *draw_call = bucket->create_uber_draw_call();
+			draw_call->set_obb(math::aabb<3>(math::vec<3>(-1, -1, 1 + i % 100), math::vec<3>(1, 1, 3 + i % 100)));
+			draw_call->set_vertex_buffer(i % 2 ? vertices_pnt->get_vertex_buffer() : vertices_pt->get_vertex_buffer());
+			draw_call->set_index_buffer(indices->get_index_buffer());
+			draw_call->set_material(materials[i % 3]);
+			draw_call->set_vertices_count(4);
+			draw_call->set_first_index_offset(i);
+			draw_call->set_triangles_count(2);
+			draw_call->set_camera(camera);
+			draw_call->commit();
+
+			bucket->add(draw_call);
+		}
+	}
+
+	void add_random(size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			add(math::random(0, 1) < 0.5f, materials[size_t(math::random(0, 2.99f))], math::random(2, 500),
+				math::random(0, 1) < 0.2f ? 1 : 0);
+		}
+	}
+
+	std::vector<size_t> executed_order() const
+	{
+		std::vector<size_t> order;
+		for (size_t i = 0; i < renderer->get_commands().size(); ++i)
+		{
+			order.push_back(renderer->get_commands()[i].first_index_offset);
+		}
+		return order;
+	}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(scheduler)
+
+BOOST_FIXTURE_TEST_CASE(sort_order, Fixture)
+{
+	// small batches are sorted by comparison, larger ones by radix sort
+	size_t const counts[] = { 10, 1000 };
+
+	for (size_t c = 0; c < 2; ++c)
+	{
+		draw_calls.clear();
+		add_random(counts[c]);
+
+		renderer->reset_log();
+		scheduler->flush();
+
+		std::vector<size_t> const order = executed_order();
+		BOOST_REQUIRE (order.size() == counts[c]);
+		BOOST_REQUIRE (scheduler->get_visible_calls_count() == counts[c]);
+
+		for (size_t i = 1; i < order.size(); ++i)
+		{
+			boost::uint64_t const previous = draw_calls[order[i - 1]]->get_sort_key(), key = draw_calls[order[i]]->get_sort_key();
+			BOOST_REQUIRE (previous <= key);
+
+			// calls with same key keep order they were added
+			if (previous == key) BOOST_REQUIRE (order[i - 1] < order[i]);
+		}
+
+		// two priorities, two shaders and three materials
+		BOOST_REQUIRE (scheduler->get_shader_changes_count() == renderer->get_log().shader_changes);
+		BOOST_REQUIRE (scheduler->get_material_changes_count() == renderer->get_log().material_changes);
+		BOOST_REQUIRE (scheduler->get_shader_changes_count() <= 4);
+		BOOST_REQUIRE (scheduler->get_material_changes_count() <= 12);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(priority_and_depth, Fixture)
+{
+	materials[2]->set_alpha_blend_enabled(true);
+
+	add(true, materials[0], 50);
+	add(true, materials[0], 10);
+	add(true, materials[0], 30);
+	add(true, materials[0], 100, -1);
+	add(true, materials[2], 10, 1);
+	add(true, materials[2], 50, 1);
+
+	scheduler->flush();
+
+	// opaque calls go front to back, alpha blended back to front
+	std::vector<size_t> const order = executed_order();
+	size_t const expected[] = { 3, 1, 2, 0, 5, 4 };
+	BOOST_REQUIRE (order == std::vector<size_t>(expected, expected + 6));
+}
+
+BOOST_FIXTURE_TEST_CASE(cull, Fixture)
+{
+	graphic::CameraPtr other_camera(new graphic::Camera());
+	other_camera->set_perspective_projection(math::PI / 4, 1, 1, 100);
+	other_camera->set_eye_lookat_up(math::vec<3>(0, 0, 0), math::vec<3>(1, 0, 0), math::vec<3>(0, 1, 0));
+
+	// enough calls to be culled in parallel
+	size_t const count = graphic::Scheduler::PARALLEL_CULL_MIN * 2 + 17;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		math::vec<3> const position(math::random(-300, 300), math::random(-300, 300), math::random(-300, 300));
+		graphic::DrawCallPtr draw_call = add(true, materials[i % 3], position, 0, i % 5 ? camera : other_camera);
+		if (i % 97 == 0) draw_call->set_always_visible(true);
+	}
+
+	std::vector<bool> expected(count);
+	size_t nvisible = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		expected[i] = draw_calls[i]->is_visible();
+		nvisible += expected[i];
+	}
+
+	scheduler->flush();
+
+	BOOST_REQUIRE (nvisible > 0 && nvisible < count);
+	BOOST_REQUIRE (scheduler->get_visible_calls_count() == nvisible);
+	BOOST_REQUIRE (scheduler->get_invisible_calls_count() == count - nvisible);
+
+	std::vector<size_t> const order = executed_order();
+	BOOST_REQUIRE (order.size() == nvisible);
+	for (size_t i = 0; i < order.size(); ++i) BOOST_REQUIRE (expected[order[i]]);
+
+	BOOST_REQUIRE (scheduler->get_cull_time() >= 0 && scheduler->get_sort_time() >= 0 && scheduler->get_execute_time() >= 0);
+
+	// nothing is left for next frame
+	renderer->reset_log();
+	scheduler->flush();
+	BOOST_REQUIRE (renderer->get_log().draw_calls == 0);
+	BOOST_REQUIRE (scheduler->get_visible_calls_count() == 0 && scheduler->get_invisible_calls_count() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(instancing, Fixture)
+{
+	// run of instances longer than one instanced call could draw, other material and other range break it
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		bool const supported = frame == 0;
+		renderer->set_instancing_supported(supported);
+		renderer->reset_log();
+
+		size_t const count = graphic::DrawCall::MAX_INSTANCES_COUNT + 100;
+		for (size_t i = 0; i < count; ++i) add_instance(materials[0], 2 + i * 0.1f);
+		for (size_t i = 0; i < 10; ++i) add_instance(materials[1], 2 + i);
+		add_instance(materials[1], 20, 1);
+
+		// skinned call is never instanced
+		std::vector<math::matrix<4,4> > joint_matrix_array(1);
+		joint_matrix_array[0].identity();
+		boost::static_pointer_cast<graphic::UberDrawCall>(add_instance(materials[2], 10))->set_joint_matrix_array(joint_matrix_array);
+		add_instance(materials[2], 11);
+
+		scheduler->flush();
+
+		graphic::RecordingRenderer::CommandLog const &log = renderer->get_log();
+		BOOST_REQUIRE (scheduler->get_visible_calls_count() == count + 13);
+		BOOST_REQUIRE (log.triangles == (count + 10) * 2 + 1 + 2 * 2);
+
+		if (supported)
+		{
+			BOOST_REQUIRE (scheduler->get_instanced_calls_count() == 3);
+			BOOST_REQUIRE (scheduler->get_instances_count() == count + 10);
+			BOOST_REQUIRE (log.instanced_draw_calls == 3 && log.instances == count + 10);
+			BOOST_REQUIRE (log.draw_calls == 3 + 3);
+			BOOST_REQUIRE (log.bytes_uploaded == (count + 10) * sizeof(math::matrix<4,4>));
+
+			graphic::RecordingRenderer::commands_type const &commands = renderer->get_commands();
+			BOOST_REQUIRE (commands[0].instances_count == graphic::DrawCall::MAX_INSTANCES_COUNT);
+			BOOST_REQUIRE (commands[1].instances_count == 100);
+		}
+		else
+		{
+			BOOST_REQUIRE (scheduler->get_instanced_calls_count() == 0 && scheduler->get_instances_count() == 0);
+			BOOST_REQUIRE (log.instanced_draw_calls == 0);
+			BOOST_REQUIRE (log.draw_calls == count + 13);
+		}
+
+		BOOST_REQUIRE (scheduler->get_material_changes_count() == log.material_changes);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(instancing_mixed_meshes, Fixture)
+{
+	renderer->set_instancing_supported(true);
+
+	// two meshes of same format and material are interleaved by distance, opaque calls are grouped by mesh first
+	boost::shared_ptr<graphic::VertexArrayPNT> other_vertices = renderer->create_vertex_array<graphic::VERTEX_PNT>(4);
+	for (size_t i = 0; i < 20; ++i)
+	{
+		add_instance(materials[0], 2 + i, 2, i % 2 ? other_vertices->get_vertex_buffer() : graphic::VertexBufferPtr());
+	}
+
+	// alpha blended calls stay back to front, so they are not grouped
+	materials[1]->set_alpha_blend_enabled(true);
+	for (size_t i = 0; i < 4; ++i)
+	{
+		add_instance(materials[1], 2 + i, 2, i % 2 ? other_vertices->get_vertex_buffer() : graphic::VertexBufferPtr());
+	}
+
+	scheduler->flush();
+
+	graphic::RecordingRenderer::CommandLog const &log = renderer->get_log();
+	BOOST_REQUIRE (scheduler->get_instanced_calls_count() == 2);
+	BOOST_REQUIRE (scheduler->get_instances_count() == 20);
+	BOOST_REQUIRE (log.draw_calls == 2 + 4);
+	BOOST_REQUIRE (scheduler->get_material_changes_count() == 2);
+
+	graphic::RecordingRenderer::commands_type const &commands = renderer->get_commands();
+	BOOST_REQUIRE (commands[0].instances_count == 10 && commands[1].instances_count == 10);
+}
+
+BOOST_FIXTURE_TEST_CASE(buckets, Fixture)
+{
+	size_t const threads_count = 4, count = 20000;
+
+	renderer->set_commands_recorded(false);
+	scheduler->set_instancing_enabled(false);
+	scheduler->set_buckets_count(threads_count);
+
+	double record_time[2] = { 0, 0 };
+
+	for (int frame = 0; frame < 4; ++frame)
+	{
+		bool const parallel = frame % 2 == 1;
+		renderer->reset_log();
+
+		boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+		if (parallel)
+		{
+			boost::thread_group threads;
+			for (size_t i = 1; i < threads_count; ++i)
+			{
+				threads.create_thread(boost::bind(&Fixture::record, this, &scheduler->get_bucket(i),
+					count / threads_count * i, count / threads_count));
+			}
+
+			record(&scheduler->get_bucket(0), 0, count / threads_count);
+			threads.join_all();
+		}
+		else
+		{
+			record(&scheduler->get_bucket(0), 0, count);
+		}
+		record_time[parallel] += (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-3;
+
+		// shared calls go to first bucket too
+		add(true, materials[0], 10);
+		BOOST_REQUIRE (scheduler->get_bucket(0).get_arena().get_allocated_size() > 0);
+
+		scheduler->flush();
+
+		BOOST_REQUIRE (scheduler->get_visible_calls_count() == count + 1);
+		BOOST_REQUIRE (renderer->get_log().draw_calls == count + 1);
+		BOOST_REQUIRE (renderer->get_log().triangles == (count + 1) * 2);
+
+		for (size_t i = 0; i < threads_count; ++i)
+		{
+			BOOST_REQUIRE (scheduler->get_bucket(i).get_draw_calls().empty());
+			BOOST_REQUIRE (scheduler->get_bucket(i).get_arena().get_allocated_size() == 0);
+		}
+	}
+
+	// calls are recorded in place of previous frame
+	size_t const reserved_size = scheduler->get_bucket(0).get_arena().get_reserved_size();
+	record(&scheduler->get_bucket(0), 0, count);
+	BOOST_REQUIRE (scheduler->get_bucket(0).get_arena().get_reserved_size() == reserved_size);
+
+	BOOST_REQUIRE_THROW (scheduler->set_buckets_count(0), std::logic_error);
+	scheduler->flush();
+	scheduler->set_buckets_count(1);
+
+	BOOST_TEST_MESSAGE("recording of " << count << " draw calls: " << record_time[0] / 2 << "ms on one thread, "
+		<< record_time[1] / 2 << "ms on " << threads_count << " threads");
+}
+
+// joint matrices of skinned calls are kept in arena of bucket as animated meshes do
+BOOST_FIXTURE_TEST_CASE(joint_matrices_in_arena, Fixture)
+{
+	size_t const count = 1000, joints_count = 32;
+	graphic::DrawCallBucket &bucket = scheduler->get_bucket(0);
+
+	size_t reserved_size = 0;
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		renderer->reset_log();
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			math::matrix<4,4> *joint_matrices = bucket.allocate_matrices(joints_count);
+			BOOST_REQUIRE (size_t(joint_matrices) % 16 == 0);
+			for (size_t j = 0; j < joints_count; ++j) joint_matrices[j].identity();
+
+			graphic::UberDrawCall *draw_call = bucket.create_uber_draw_call();
+			draw_call->set_obb(math::aabb<3>(math::vec<3>(-1, -1, 2), math::vec<3>(1, 1, 4)));
+			draw_call->set_vertex_buffer(vertices_pnt->get_vertex_buffer());
+			draw_call->set_index_buffer(indices->get_index_buffer());
+			draw_call->set_material(materials[0]);
+			draw_call->set_vertices_count(4);
+			draw_call->set_triangles_count(2);
+			draw_call->set_camera(camera);
+			draw_call->set_joint_matrices(joint_matrices, joints_count);
+			draw_call->commit();
+
+			BOOST_REQUIRE (!draw_call->is_instanceable());
+			bucket.add(draw_call);
+		}
+
+		BOOST_REQUIRE (bucket.get_arena().get_allocated_size() >= count * joints_count * sizeof(math::matrix<4,4>));
+		scheduler->flush();
+
+		BOOST_REQUIRE (renderer->get_log().draw_calls == count);
+		BOOST_REQUIRE (renderer->get_log().instanced_draw_calls == 0);
+
+		// matrices are placed in memory of previous frame
+		if (frame > 0) BOOST_REQUIRE (bucket.get_arena().get_reserved_size() == reserved_size);
+		reserved_size = bucket.get_arena().get_reserved_size();
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(flush_benchmark, Fixture)
+{
+	size_t const count = 20000;
+	int const frames = 20;
+
+	renderer->set_commands_recorded(false);
+
+	double cull_time = 0, sort_time = 0, execute_time = 0;
+	for (int i = 0; i < frames; ++i)
+	{
+		draw_calls.clear();
+		add_random(count);
+
+		scheduler->flush();
+		cull_time += scheduler->get_cull_time();
+		sort_time += scheduler->get_sort_time();
+		execute_time += scheduler->get_execute_time();
+	}
+
+	BOOST_REQUIRE (renderer->get_log().draw_calls == count * frames);
+
+	BOOST_TEST_MESSAGE("flush of " << count << " draw calls: cull " << cull_time / frames * 1000 << "ms, sort "
+		<< sort_time / frames * 1000 << "ms, execute " << execute_time / frames * 1000 << "ms, "
+		<< scheduler->get_shader_changes_count() << " shader and " << scheduler->get_material_changes_count()
+		<< " material changes");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
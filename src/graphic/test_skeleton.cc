@@ -0,0 +1,180 @@
+
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include "joint.h"
+#include "skeleton.h"
+
+namespace
+{
+
+struct Fixture
+{
+	std::vector<graphic::JointPtr> joints;
+	std::vector<math::matrix<4,4> > matrices; // by joint indices
+
+	graphic::JointPtr add_joint(graphic::JointPtr const &parent)
+	{
+		graphic::JointPtr joint(new graphic::Joint(joints.size()));
+		joint->parent = parent;
+		if (parent) parent->childs.push_back(joint);
+
+		joints.push_back(joint);
+		return joint;
+	}
+
+	static math::matrix<4,4> transform(size_t i)
+	{
+		math::matrix<4,4> m;
+		m.rotation(math::vec<3>(0.1f * i, 0.2f, 0.3f * i));
+		m.ij[3][0] = math::scalar(i);
+		m.ij[3][1] = 1;
+		return m;
+	}
+
+	// children are added before parents, every joint has translate and rotate transforms
+	void create_chains(size_t chains, size_t length)
+	{
+		joints.clear();
+
+		for (size_t c = 0; c < chains; ++c)
+		{
+			graphic::JointPtr parent = add_joint(graphic::JointPtr());
+			for (size_t i = 1; i < length; ++i) parent = add_joint(parent);
+		}
+
+		std::reverse(joints.begin(), joints.end());
+		for (size_t i = 0; i < joints.size(); ++i)
+		{
+			joints[i]->index = i;
+			joints[i]->id = "joint";
+			joints[i]->transforms.push_back(graphic::Joint::transform("translate", transform(2 * i)));
+			joints[i]->transforms.push_back(graphic::Joint::transform("rotate", transform(2 * i + 1)));
+		}
+	}
+
+	// recursion from roots through children, as matrices were built before skeletons
+	void build_recursive(graphic::Joint &joint)
+	{
+		math::matrix<4,4> &matrix = matrices[joint.index];
+		matrix.identity();
+
+		for (std::vector<graphic::Joint::transform>::reverse_iterator it = joint.transforms.rbegin(); it != joint.transforms.rend(); it++)
+		{
+			matrix *= it->matrix;
+		}
+
+		if (graphic::JointPtr p = joint.parent.lock()) matrix *= matrices[p->index];
+
+		for (graphic::Joint::childs_type::iterator it = joint.childs.begin(); it != joint.childs.end(); it++)
+		{
+			if (graphic::JointPtr child = it->lock()) build_recursive(*child);
+		}
+	}
+
+	void build_recursive()
+	{
+		matrices.resize(joints.size());
+		for (size_t i = 0; i < joints.size(); ++i)
+		{
+			if (!joints[i]->parent.lock()) build_recursive(*joints[i]);
+		}
+	}
+};
+
+bool equal(math::matrix<4,4> const &a, math::matrix<4,4> const &b)
+{
+	for (size_t i = 0; i < 4; ++i)
+		for (size_t j = 0; j < 4; ++j)
+			if (abs(a.ij[i][j] - b.ij[i][j]) > 1e-3f) return false;
+
+	return true;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(skeleton)
+
+BOOST_FIXTURE_TEST_CASE(order, Fixture)
+{
+	create_chains(2, 3);
+
+	graphic::Skeleton skeleton;
+	skeleton.build(joints);
+
+	BOOST_REQUIRE (skeleton.get_joints_count() == 6);
+	BOOST_REQUIRE (skeleton.get_transforms_count() == 12);
+
+	std::vector<size_t> positions(6);
+	for (size_t k = 0; k < 6; ++k) positions[skeleton.get_joint(k)] = k;
+
+	for (size_t k = 0; k < 6; ++k)
+	{
+		graphic::JointPtr parent = joints[skeleton.get_joint(k)]->parent.lock();
+		if (!parent)
+		{
+			BOOST_REQUIRE (skeleton.get_parent(k) == graphic::Skeleton::NO_PARENT);
+			continue;
+		}
+
+		BOOST_REQUIRE (skeleton.get_parent(k) == parent->index);
+		BOOST_REQUIRE (positions[parent->index] < k);
+	}
+
+	size_t const slot = skeleton.get_transform_slot(3, "rotate");
+	BOOST_REQUIRE (slot != skeleton.get_transform_slot(3, "translate"));
+	BOOST_REQUIRE (equal(skeleton.get_bind_transforms()[slot], transform(7)));
+	BOOST_CHECK_THROW (skeleton.get_transform_slot(3, "scale"), std::logic_error);
+
+	// cycle
+	joints[5]->parent = joints[0];
+	joints[0]->parent = joints[5];
+	BOOST_CHECK_THROW (skeleton.build(joints), std::logic_error);
+	joints[0]->parent.reset();
+	joints[5]->parent.reset();
+}
+
+BOOST_FIXTURE_TEST_CASE(model_matrices, Fixture)
+{
+	create_chains(3, 5);
+
+	graphic::Skeleton skeleton;
+	skeleton.build(joints);
+
+	std::vector<math::matrix<4,4> > result(joints.size());
+	skeleton.build_model_matrices(&skeleton.get_bind_transforms()[0], &result[0]);
+
+	build_recursive();
+	for (size_t i = 0; i < joints.size(); ++i)
+	{
+		BOOST_REQUIRE (equal(result[i], matrices[i]));
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(benchmark, Fixture)
+{
+	create_chains(4, 16);
+
+	graphic::Skeleton skeleton;
+	skeleton.build(joints);
+
+	std::vector<math::matrix<4,4> > result(joints.size());
+	size_t const characters = 1000;
+
+	std::clock_t start = std::clock();
+	for (size_t i = 0; i < characters; ++i) build_recursive();
+	double const recursive_time = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+	start = std::clock();
+	for (size_t i = 0; i < characters; ++i) skeleton.build_model_matrices(&skeleton.get_bind_transforms()[0], &result[0]);
+	double const skeleton_time = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+	for (size_t i = 0; i < joints.size(); ++i)
+	{
+		BOOST_REQUIRE (equal(result[i], matrices[i]));
+	}
+
+	BOOST_TEST_MESSAGE(characters << " skeletons of " << joints.size() << " joints: " << recursive_time * 1000 << "ms by recursion, "
+		<< skeleton_time * 1000 << "ms by linear pass");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
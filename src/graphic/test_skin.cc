@@ -0,0 +1,250 @@
+
+#include <cstdlib>
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/test/unit_test.hpp>
+#include "skin.h"
+
+namespace
+{
+
+struct Fixture
+{
+	std::vector<math::matrix<4,4> > joint_matrices;
+	std::vector<graphic::Skin::vertex_type> vertices;
+	std::vector<graphic::Skin::JointWeights> weights;
+
+	Fixture():
+		joint_matrices(16)
+	{
+		for (size_t i = 0; i < joint_matrices.size(); ++i)
+		{
+			joint_matrices[i].rotation(math::vec<3>(0.1f * i, 0.2f * i, 0.3f * i));
+			joint_matrices[i].ij[3][0] = math::scalar(i);
+			joint_matrices[i].ij[3][1] = -math::scalar(i);
+			joint_matrices[i].ij[3][2] = 0.5f * i;
+		}
+	}
+
+	static math::scalar random(math::scalar lo, math::scalar hi)
+	{
+		return lo + (hi - lo) * std::rand() / RAND_MAX;
+	}
+
+	// vertex i has i % 9 influences
+	void create_mesh(size_t count)
+	{
+		vertices.resize(count);
+		weights.resize(count);
+
+		std::srand(1);
+		for (size_t i = 0; i < count; ++i)
+		{
+			graphic::Skin::vertex_type &v = vertices[i];
+			v.position = math::vec<3>(random(-1, 1), random(-1, 1), random(-1, 1));
+			v.tangent = math::vec<3>(1, 0, 0);
+			v.binormal = math::vec<3>(0, 0, 1);
+			v.normal = math::vec<3>(0, 1, 0);
+			v.texcoords = math::vec<2>(random(0, 1), random(0, 1));
+
+			graphic::Skin::JointWeights &w = weights[i];
+			std::fill(w.joints.i, w.joints.i + 8, 0u);
+			std::fill(w.weights.i, w.weights.i + 8, 0.0f);
+
+			size_t const influences = i % 9;
+			for (size_t j = 0; j < influences; ++j)
+			{
+				// zero weights are spread between used ones
+				w.joints.i[(j * 3) % 8] = std::rand() % joint_matrices.size();
+				w.weights.i[(j * 3) % 8] = 1.0f / influences;
+			}
+		}
+	}
+
+	static boost::posix_time::ptime now()
+	{
+		return boost::posix_time::microsec_clock::universal_time();
+	}
+
+	static math::vec<3> rotate(math::vec<3> const &v, math::matrix<4,4> const &m)
+	{
+		return math::vec<3>(v.x * m._11 + v.y * m._21 + v.z * m._31,
+			v.x * m._12 + v.y * m._22 + v.z * m._32,
+			v.x * m._13 + v.y * m._23 + v.z * m._33);
+	}
+
+	// sum of weighted positions, as MemoryMesh::transform_vertices computed it before skinning; with
+	// vectors tangents, binormals and normals are summed the same way and normalized, so result is
+	// what skin gives
+	void reference_transform(std::vector<graphic::Skin::vertex_type> &result, bool vectors = false) const
+	{
+		result = vertices;
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			math::vec<3> pos(0, 0, 0), tangent(0, 0, 0), binormal(0, 0, 0), normal(0, 0, 0);
+			bool influenced = false;
+
+			for (size_t j = 0; j < 8; j++)
+			{
+				math::scalar const weight = weights[i].weights.i[j];
+				if (weight > math::EPSILON)
+				{
+					math::matrix<4,4> const &m = joint_matrices.at(weights[i].joints.i[j]);
+					pos += (vertices[i].position * m) * weight;
+
+					if (vectors)
+					{
+						tangent += rotate(vertices[i].tangent, m) * weight;
+						binormal += rotate(vertices[i].binormal, m) * weight;
+						normal += rotate(vertices[i].normal, m) * weight;
+						influenced = true;
+					}
+				}
+			}
+
+			result[i].position = pos;
+
+			if (influenced)
+			{
+				result[i].tangent = normalize(tangent);
+				result[i].binormal = normalize(binormal);
+				result[i].normal = normalize(normal);
+			}
+		}
+	}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(skin)
+
+BOOST_FIXTURE_TEST_CASE(groups, Fixture)
+{
+	create_mesh(90);
+
+	graphic::Skin skin;
+	skin.build(&weights[0], weights.size());
+
+	BOOST_REQUIRE (skin.get_vertices_count() == 90);
+	BOOST_REQUIRE (skin.get_influences_count() == 10 * (0 + 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8));
+
+	for (size_t n = 0; n <= graphic::Skin::MAX_INFLUENCES; ++n)
+	{
+		BOOST_REQUIRE (skin.get_group_size(n) == 10);
+	}
+}
+
+BOOST_FIXTURE_TEST_CASE(transform, Fixture)
+{
+	create_mesh(1000);
+
+	graphic::Skin skin;
+	skin.build(&weights[0], weights.size());
+
+	std::vector<graphic::Skin::vertex_type> expected, result(vertices.size());
+	reference_transform(expected, true);
+	skin.transform(&vertices[0], &joint_matrices[0], joint_matrices.size(), &result[0]);
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		BOOST_REQUIRE ((result[i].position - expected[i].position).length_sq() < 1e-6f);
+		BOOST_REQUIRE ((result[i].tangent - expected[i].tangent).length_sq() < 1e-6f);
+		BOOST_REQUIRE ((result[i].binormal - expected[i].binormal).length_sq() < 1e-6f);
+		BOOST_REQUIRE ((result[i].normal - expected[i].normal).length_sq() < 1e-6f);
+		BOOST_REQUIRE (result[i].texcoords == vertices[i].texcoords);
+
+		if (i % 9 == 0)
+		{
+			BOOST_REQUIRE (result[i].normal == vertices[i].normal);
+			continue;
+		}
+
+		// joint matrices are rotations, so vectors stay unit and single influence keeps them orthogonal
+		BOOST_REQUIRE (abs(result[i].normal.length() - 1) < 1e-4f);
+		if (i % 9 == 1)
+		{
+			math::matrix<4,4> const &m = joint_matrices[weights[i].joints.i[0]];
+			BOOST_REQUIRE ((result[i].normal - math::vec<3>(m._21, m._22, m._23)).length_sq() < 1e-6f);
+			BOOST_REQUIRE (abs(math::dot_product(result[i].normal, result[i].tangent)) < 1e-4f);
+		}
+	}
+
+	joint_matrices.resize(1);
+	BOOST_CHECK_THROW (skin.transform(&vertices[0], &joint_matrices[0], joint_matrices.size(), &result[0]), std::out_of_range);
+}
+
+// all vertices follow one scaled joint, vectors are normalized after transform
+BOOST_FIXTURE_TEST_CASE(rigid, Fixture)
+{
+	create_mesh(1000);
+
+	for (size_t i = 0; i < weights.size(); ++i)
+	{
+		std::fill(weights[i].weights.i, weights[i].weights.i + 8, 0.0f);
+		weights[i].joints.i[2] = 3;
+		weights[i].weights.i[2] = 1;
+	}
+
+	math::matrix<4,4> scaling;
+	scaling.scaling(2, 2, 2);
+	joint_matrices[3] = scaling * joint_matrices[3];
+
+	graphic::Skin skin;
+	skin.build(&weights[0], weights.size());
+	BOOST_REQUIRE (skin.is_rigid());
+
+	std::vector<graphic::Skin::vertex_type> expected, result(vertices.size());
+	reference_transform(expected);
+	skin.transform(&vertices[0], &joint_matrices[0], joint_matrices.size(), &result[0]);
+
+	math::matrix<4,4> const &m = joint_matrices[3];
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		BOOST_REQUIRE ((result[i].position - expected[i].position).length_sq() < 1e-6f);
+		BOOST_REQUIRE ((result[i].normal - normalize(math::vec<3>(m._21, m._22, m._23))).length_sq() < 1e-6f);
+		BOOST_REQUIRE (abs(math::dot_product(result[i].normal, result[i].tangent)) < 1e-4f);
+		BOOST_REQUIRE (result[i].texcoords == vertices[i].texcoords);
+	}
+
+	weights[0].weights.i[2] = 0.5f;
+	skin.build(&weights[0], weights.size());
+	BOOST_REQUIRE (!skin.is_rigid());
+}
+
+BOOST_FIXTURE_TEST_CASE(benchmark, Fixture)
+{
+	create_mesh(1 << 16);
+
+	graphic::Skin skin;
+	skin.build(&weights[0], weights.size());
+
+	std::vector<graphic::Skin::vertex_type> expected, result(vertices.size());
+	size_t const frames = 20;
+
+	// reference sums vectors too, so both skin same outputs; wall time is measured, as skin uses threads
+	boost::posix_time::ptime start = now();
+	for (size_t i = 0; i < frames; ++i) reference_transform(expected, true);
+	double const reference_time = (now() - start).total_microseconds() * 1e-6 / frames;
+
+	start = now();
+	for (size_t i = 0; i < frames; ++i) skin.transform(&vertices[0], &joint_matrices[0], joint_matrices.size(), &result[0]);
+	double const skin_time = (now() - start).total_microseconds() * 1e-6 / frames;
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		BOOST_REQUIRE ((result[i].position - expected[i].position).length_sq() < 1e-6f);
+		BOOST_REQUIRE ((result[i].normal - expected[i].normal).length_sq() < 1e-6f);
+	}
+
+	// positions alone, as memory meshes were skinned before
+	start = now();
+	for (size_t i = 0; i < frames; ++i) reference_transform(expected);
+	double const positions_time = (now() - start).total_microseconds() * 1e-6 / frames;
+
+	BOOST_TEST_MESSAGE("skinning of " << vertices.size() << " vertices: " << reference_time * 1000
+		<< "ms by weighted sums, " << skin_time * 1000 << "ms by blended matrices (x" << reference_time / skin_time
+		<< "), " << positions_time * 1000 << "ms positions alone by weighted sum");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,13 +8,16 @@
 namespace graphic
 {
 
+unsigned Texture::next_sort_id_ = 1;
+
 Texture::Texture(std::string const &filename):
 	filename_(filename),
 	width_(-1),
 	height_(-1),
 	pixel_format_(-1),
 	dynamic_(false),
-	writeonly_(false) {
+	writeonly_(false),
+	sort_id_(next_sort_id_++) {
 }
 
 Texture::Texture(int width, int height, unsigned pixel_format,
@@ -23,7 +26,8 @@ Texture::Texture(int width, int height, unsigned pixel_format,
 	height_(height),
 	pixel_format_(pixel_format),
 	dynamic_(dynamic),
-	writeonly_(writeonly)
+	writeonly_(writeonly),
+	sort_id_(next_sort_id_++)
 {
 }
 
@@ -31,6 +31,9 @@ public:
 	int get_pixel_format() const { return pixel_format_; }
 	std::string const &get_filename() const { return filename_; }
 
+	// small number given to texture on creation, draw calls are sorted by it
+	unsigned get_sort_id() const { return sort_id_; }
+
 	static TexturePtr load_from_surface(RendererPtr const &renderer, SDL_Surface *surface);
 	static TexturePtr load_from_file(RendererPtr const &renderer, std::string const &filename);
 
@@ -45,6 +48,11 @@ protected:
 	bool dynamic_;
 	bool writeonly_;
 	std::string filename_;
+
+private:
+	unsigned const sort_id_;
+
+	static unsigned next_sort_id_;
 };
 
 }
@@ -1,5 +1,8 @@
 
 #include <luabind/luabind.hpp>
+#include "vertex_traits.h"
+#include "vertex_buffer.h"
+#include "material.h"
 #include "renderer.h"
 #include "uber_draw_call.h"
 
@@ -8,7 +11,9 @@ namespace graphic
 
 UberDrawCall::UberDrawCall(RendererPtr const &renderer):
 	DrawCall(renderer),
-	shader_(renderer->get_uber_shader())
+	shader_(renderer->get_uber_shader()),
+	joint_matrices_(0),
+	joint_matrices_count_(0)
 {
 }
 
@@ -19,11 +24,51 @@ UberDrawCall::~UberDrawCall()
 void UberDrawCall::swap_joint_matrix_array(std::vector<math::matrix<4,4> > &joint_matrix_array)
 {
 	joint_matrix_array_.swap(joint_matrix_array);
+	set_joint_matrices(joint_matrix_array_.empty() ? 0 : &joint_matrix_array_[0], joint_matrix_array_.size());
 }
 
 void UberDrawCall::set_joint_matrix_array(std::vector<math::matrix<4,4> > &joint_matrix_array)
 {
 	joint_matrix_array_ = joint_matrix_array;
+	set_joint_matrices(joint_matrix_array_.empty() ? 0 : &joint_matrix_array_[0], joint_matrix_array_.size());
+}
+
+void UberDrawCall::set_joint_matrices(math::matrix<4,4> const *matrices, size_t count)
+{
+	joint_matrices_ = matrices;
+	joint_matrices_count_ = count;
+}
+
+bool UberDrawCall::is_instanceable() const
+{
+	return joint_matrices_count_ == 0
+		&& !(vertex_buffer_->get_vertex_traits()->get_format() & GenericVertex::FORMAT_JOINT_INDICES);
+}
+
+unsigned UberDrawCall::get_shader_sort_id() const
+{
+	return shader_->get_instance(vertex_buffer_->get_vertex_traits()->get_format(), material_)->get_sort_id();
+}
+
+void UberDrawCall::set_material_parameters(UberShader::Instance const &shader_instance) const
+{
+	if (material_)
+	{
+		material_->select();
+
+		for (size_t i = 0; i < UberShader::DIFFUSE_TEXTURES_COUNT && i < material_->get_diffuse_textures_count(); ++i)
+		{
+			shader_instance.diffuse_textures[i]->set(material_->get_diffuse_texture(i));
+		}
+
+		if (material_->get_texture_blending_weights_texture())
+		{
+			shader_instance.texture_blending_weights_texture->set(material_->get_texture_blending_weights_texture());
+		}
+	}
+
+	if (shader_instance.normal_map_texture)
+		shader_instance.normal_map_texture->set(material_ ? material_->get_normal_map_texture() : TexturePtr());
 }
 
 namespace
@@ -14,11 +14,24 @@ public:
 	void swap_joint_matrix_array(std::vector<math::matrix<4,4> > &joint_matrix_array);
 	void set_joint_matrix_array(std::vector<math::matrix<4,4> > &joint_matrix_array);
 
+	// matrices are not copied and have to live until call is executed, see DrawCallBucket::allocate_matrices()
+	void set_joint_matrices(math::matrix<4,4> const *matrices, size_t count);
+
+	// calls without skeletal animation could be instanced
+	virtual bool is_instanceable() const;
+
 	static void bind(lua_State *L);
 
 protected:
 	UberShaderPtr const shader_;
 	std::vector<math::matrix<4,4> > joint_matrix_array_;
+	math::matrix<4,4> const *joint_matrices_; // joint_matrix_array_ or memory of caller
+	size_t joint_matrices_count_;
+
+	virtual unsigned get_shader_sort_id() const;
+
+	// selects material and sets its textures to shader
+	void set_material_parameters(UberShader::Instance const &shader_instance) const;
 };
 
 }
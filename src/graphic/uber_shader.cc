@@ -10,7 +10,8 @@
 namespace graphic
 {
 
-UberShader::Instance::Instance(RendererPtr const &renderer, unsigned flags)
+UberShader::Instance::Instance(RendererPtr const &renderer, unsigned flags, unsigned sort_id):
+	sort_id_(sort_id)
 {
 	shader_ = renderer->create_shader();
 
@@ -41,11 +42,17 @@ UberShader::Instance::Instance(RendererPtr const &renderer, unsigned flags)
 	if (flags & FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_TEXTURE)
 		shader_->add_preprocessor_macro("TEXUTRE_BLENDING_WEIGHTS_IN_TEXTURE");
 
+	if (flags & FLAG_INSTANCING_ENABLED)
+		shader_->add_preprocessor_macro("INSTANCING_ENABLED");
+
 	shader_->load_from_file(util::get_graphic_sources_path() + "uber_shader.fx");
 
 	world_view_projection_matrix = shader_->get_parameter("world_view_projection_matrix");
 	world_matrix = shader_->get_parameter("world_matrix");
 
+	if (flags & FLAG_INSTANCING_ENABLED)
+		view_projection_matrix = shader_->get_parameter("view_projection_matrix");
+
 	if (flags & FLAG_TEXTURE_BLENDING_ENABLED)
 	{
 		for (size_t i = 0; i < DIFFUSE_TEXTURES_COUNT; ++i)
@@ -82,25 +89,35 @@ UberShader::UberShader(RendererPtr const &renderer):
 	lighting_enabled_(false)
 {
 
-	build_instance(VERTEX_PT::FORMAT, 0);
-
-	for (int i = 0; i <= 1; ++i)
+	for (int j = 0; j <= 1; ++j)
 	{
-		unsigned lighting_enabled_flag = i ? FLAG_LIGHTING_ENABLED : 0;
+		unsigned instancing_enabled_flag = j ? FLAG_INSTANCING_ENABLED : 0;
+
+		build_instance(VERTEX_PT::FORMAT, instancing_enabled_flag);
+
+		for (int i = 0; i <= 1; ++i)
+		{
+			unsigned flags = instancing_enabled_flag | (i ? FLAG_LIGHTING_ENABLED : 0);
+
+			build_instance(VERTEX_PNT::FORMAT,
+				flags | FLAG_VERTEX_N_ENABLED);
 
-		build_instance(VERTEX_PNT::FORMAT,
-			lighting_enabled_flag | FLAG_VERTEX_N_ENABLED);
+			build_instance(VERTEX_PNT::FORMAT,
+				flags | FLAG_VERTEX_N_ENABLED | FLAG_TEXTURE_BLENDING_ENABLED
+				| FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_TEXTURE);
 
-		build_instance(VERTEX_PNT::FORMAT,
-			lighting_enabled_flag | FLAG_VERTEX_N_ENABLED | FLAG_TEXTURE_BLENDING_ENABLED
-			| FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_TEXTURE);
+			build_instance(VERTEX_PNTB::FORMAT,
+				flags | FLAG_VERTEX_N_ENABLED | FLAG_TEXTURE_BLENDING_ENABLED
+				| FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_VERTEX);
 
-		build_instance(VERTEX_PNTB::FORMAT,
-			lighting_enabled_flag | FLAG_VERTEX_N_ENABLED | FLAG_TEXTURE_BLENDING_ENABLED
-			| FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_VERTEX);
+			build_instance(VERTEX_PTBNT::FORMAT,
+				flags | FLAG_VERTEX_TB_ENABLED | FLAG_VERTEX_N_ENABLED | FLAG_NORMAL_MAP_ENABLED);
+		}
+	}
 
-		build_instance(VERTEX_PTBNT::FORMAT,
-			lighting_enabled_flag | FLAG_VERTEX_TB_ENABLED | FLAG_VERTEX_N_ENABLED | FLAG_NORMAL_MAP_ENABLED);
+	for (int i = 0; i <= 1; ++i)
+	{
+		unsigned lighting_enabled_flag = i ? FLAG_LIGHTING_ENABLED : 0;
 
 		build_instance(VERTEX_PNJWT::FORMAT,
 			lighting_enabled_flag | FLAG_VERTEX_N_ENABLED  | FLAG_VERTEX_JW_ENABLED | FLAG_SKELETAL_ANIMATION_ENABLED);
@@ -116,7 +133,7 @@ UberShader::~UberShader()
 }
 
 UberShader::InstancePtr const &UberShader::get_instance(GenericVertex::format_type format,
-	MaterialPtr const &material) const
+	MaterialPtr const &material, bool instanced) const
 {
 	InstanceKey key;
 	key.vertex_format = format;
@@ -124,6 +141,7 @@ UberShader::InstancePtr const &UberShader::get_instance(GenericVertex::format_ty
 	key.texture_blending_weights_in_vertex = ((format & GenericVertex::FORMAT_TEXTURE_BLEND_WEIGHTS) != 0);
 	key.texture_blending_weights_in_texture = !!material->get_texture_blending_weights_texture();
 	key.texture_blending_enabled = key.texture_blending_weights_in_vertex || key.texture_blending_weights_in_texture;
+	key.instancing_enabled = instanced;
 
 	instances_type::const_iterator it = instances_.find(key);
 	if (it == instances_.end()) throw std::logic_error("vertex format and material are not supported by uber shader");
@@ -140,9 +158,10 @@ void UberShader::build_instance(GenericVertex::format_type format, unsigned flag
 	key.texture_blending_enabled = !!(flags & FLAG_TEXTURE_BLENDING_ENABLED);
 	key.texture_blending_weights_in_vertex = !!(format & GenericVertex::FORMAT_TEXTURE_BLEND_WEIGHTS);
 	key.texture_blending_weights_in_texture = !!(flags & FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_TEXTURE);
+	key.instancing_enabled = !!(flags & FLAG_INSTANCING_ENABLED);
 
 	LOG_INFO("*** building uber shader: format = " << format << ", flags = " << flags);
-	instances_.insert(std::make_pair(key, InstancePtr(new Instance(renderer, flags))));
+	instances_.insert(std::make_pair(key, InstancePtr(new Instance(renderer, flags, instances_.size() + 1))));
 }
 
 }
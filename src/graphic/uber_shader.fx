@@ -2,6 +2,10 @@
 float4x4 world_view_projection_matrix : VIEWPROJECTION;
 float4x4 world_matrix : WORLD;
 
+#if defined(INSTANCING_ENABLED)
+float4x4 view_projection_matrix : VIEWPROJ;
+#endif
+
 uniform extern texture diffuse_texture_0;
 sampler DIFFUSE_TEXTURE_SAMPLER_0 = sampler_state { Texture = <diffuse_texture_0>; };
 
@@ -134,6 +138,14 @@ struct VS_INPUT
 #if defined(TEXUTRE_BLENDING_WEIGHTS_IN_VERTEX)
 	float4 texture_blend_weights: TEXCOORD1;
 #endif
+
+#if defined(INSTANCING_ENABLED)
+	// rows of world matrix from instance stream
+	float4 world_0 : TEXCOORD4;
+	float4 world_1 : TEXCOORD5;
+	float4 world_2 : TEXCOORD6;
+	float4 world_3 : TEXCOORD7;
+#endif
 };
 
 struct VS_OUTPUT
@@ -161,39 +173,47 @@ VS_OUTPUT VS(const VS_INPUT i)
 {
     VS_OUTPUT o;
 
+#if defined(INSTANCING_ENABLED)
+	const float4x4 world = float4x4(i.world_0, i.world_1, i.world_2, i.world_3);
+	const float4x4 world_view_projection = mul(world, view_projection_matrix);
+#else
+	const float4x4 world = world_matrix;
+	const float4x4 world_view_projection = world_view_projection_matrix;
+#endif
+
 #if defined(VERTEX_JW_ENABLED)
 	const int joints[8] = { i.joints1, i.joints2 };
 	const float weights[8] = { i.weights1, i.weights2 };
 
 	float3 position = ApplySkeletalAnimationToPosition(i.position, joints, weights);
 
-    o.position_h = mul(float4(position, 1.0f), world_view_projection_matrix);
+    o.position_h = mul(float4(position, 1.0f), world_view_projection);
 #else
-    o.position_h = mul(float4(i.position, 1.0f), world_view_projection_matrix);
+    o.position_h = mul(float4(i.position, 1.0f), world_view_projection);
 #endif
 
-	o.position = mul(float4(i.position, 1.0f), world_matrix);
+	o.position = mul(float4(i.position, 1.0f), world);
 
 #if defined(VERTEX_JW_ENABLED) && defined(VERTEX_TB_ENABLED)
 	float3 tangent = ApplySkeletalAnimationToVector(i.tangent, joints, weights);
 	float3 binormal = ApplySkeletalAnimationToVector(i.binormal, joints, weights);
 
-	o.tangent = normalize(mul(tangent, (float3x3) world_matrix));
-	o.binormal = normalize(mul(binormal, (float3x3) world_matrix));
+	o.tangent = normalize(mul(tangent, (float3x3) world));
+	o.binormal = normalize(mul(binormal, (float3x3) world));
 #endif
 
 #if defined(VERTEX_JW_ENABLED) && defined(VERTEX_N_ENABLED)
 	float3 normal = ApplySkeletalAnimationToVector(i.normal, joints, weights);
-	o.normal = normalize(mul(normal, (float3x3) world_matrix));
+	o.normal = normalize(mul(normal, (float3x3) world));
 #endif
 
 #if !defined(VERTEX_JW_ENABLED) && defined(VERTEX_TB_ENABLED)
-	o.tangent = normalize(mul(i.tangent, (float3x3) world_matrix));
-	o.binormal = normalize(mul(i.binormal, (float3x3) world_matrix));
+	o.tangent = normalize(mul(i.tangent, (float3x3) world));
+	o.binormal = normalize(mul(i.binormal, (float3x3) world));
 #endif
 
 #if !defined(VERTEX_JW_ENABLED) && defined(VERTEX_N_ENABLED)
-	o.normal = normalize(mul(i.normal, (float3x3) world_matrix));
+	o.normal = normalize(mul(i.normal, (float3x3) world));
 #endif
 
     o.texcoords  = i.texcoords;
@@ -248,8 +268,13 @@ technique
 {
     pass p0
     {
+#if defined(INSTANCING_ENABLED)
+        VertexShader = compile vs_3_0 VS();
+		PixelShader = compile ps_3_0 PS();
+#else
         VertexShader = compile vs_2_0 VS();
 		PixelShader = compile ps_2_0 PS();
+#endif
     }
 }
 
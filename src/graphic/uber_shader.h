@@ -19,6 +19,7 @@ public:
 	static unsigned const FLAG_TEXTURE_BLENDING_ENABLED = 64;
 	static unsigned const FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_VERTEX = 128;
 	static unsigned const FLAG_TEXUTRE_BLENDING_WEIGHTS_IN_TEXTURE = 256;
+	static unsigned const FLAG_INSTANCING_ENABLED = 512;
 
 	static size_t const DIFFUSE_TEXTURES_COUNT = 4;
 
@@ -43,6 +44,7 @@ public:
 		// from uber_shader.fx
 		Shader::ParameterPtr world_view_projection_matrix;
 		Shader::ParameterPtr world_matrix;
+		Shader::ParameterPtr view_projection_matrix;
 		Shader::ParameterPtr diffuse_textures[DIFFUSE_TEXTURES_COUNT];
 		Shader::ParameterPtr texture_blending_weights_texture;
 
@@ -55,13 +57,17 @@ public:
 		// from skeletal_animation.fx
 		Shader::ParameterPtr joint_matrix_array;
 
-		Instance(RendererPtr const &renderer, unsigned flags);
+		Instance(RendererPtr const &renderer, unsigned flags, unsigned sort_id);
 		~Instance();
 
 		ShaderPtr const &get_shader() const { return shader_; }
 
+		// draw calls using same instance get same shader bits in sort key
+		unsigned get_sort_id() const { return sort_id_; }
+
 	private:
 		ShaderPtr shader_;
+		unsigned sort_id_;
 	};
 
 	typedef boost::shared_ptr<Instance> InstancePtr;
@@ -69,7 +75,9 @@ public:
 	UberShader(RendererPtr const &renderer);
 	virtual ~UberShader();
 
-	virtual InstancePtr const &get_instance(GenericVertex::format_type format, MaterialPtr const &material) const;
+	// instanced variant takes world matrices from second vertex stream, it exists for formats without joints
+	virtual InstancePtr const &get_instance(GenericVertex::format_type format, MaterialPtr const &material,
+		bool instanced = false) const;
 	void set_lighting_enabled(bool flag) { lighting_enabled_ = true; }
 
 private:
@@ -79,6 +87,7 @@ private:
 		bool texture_blending_enabled;
 		bool texture_blending_weights_in_vertex;
 		bool texture_blending_weights_in_texture;
+		bool instancing_enabled;
 
 		struct Hash
 		{
@@ -89,6 +98,7 @@ private:
 				hash = (hash << 1) | (size_t) ik.texture_blending_enabled;
 				hash = (hash << 1) | (size_t) ik.texture_blending_weights_in_vertex;
 				hash = (hash << 1) | (size_t) ik.texture_blending_weights_in_texture;
+				hash = (hash << 1) | (size_t) ik.instancing_enabled;
 				return hash;
 			}
 		};
@@ -101,7 +111,8 @@ private:
 					&& left.lighting_enabled == right.lighting_enabled
 					&& left.texture_blending_enabled == right.texture_blending_enabled
 					&& left.texture_blending_weights_in_vertex == right.texture_blending_weights_in_vertex
-					&& left.texture_blending_weights_in_texture == right.texture_blending_weights_in_texture;
+					&& left.texture_blending_weights_in_texture == right.texture_blending_weights_in_texture
+					&& left.instancing_enabled == right.instancing_enabled;
 			}
 		};
 	};
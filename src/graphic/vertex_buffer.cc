@@ -6,6 +6,13 @@
 namespace graphic
 {
 
+unsigned VertexBuffer::next_sort_id_ = 1;
+
+VertexBuffer::VertexBuffer():
+	sort_id_(next_sort_id_++)
+{
+}
+
 VertexBuffer::~VertexBuffer()
 {
 }
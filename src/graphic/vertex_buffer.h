@@ -8,6 +8,7 @@ namespace graphic
 {
 
 class D3D9VertexBuffer;
+class VertexTraits;
 
 class VertexBuffer: public boost::noncopyable {
 public:
@@ -25,7 +26,20 @@ public:
 	virtual void *end() = 0;
 	virtual void const *end() const = 0;
 
+	virtual VertexTraits const *get_vertex_traits() const = 0;
+
+	// small number given to buffer on creation, opaque draw calls of same material are sorted by it
+	unsigned get_sort_id() const { return sort_id_; }
+
 	static void bind(lua_State *L);
+
+protected:
+	VertexBuffer();
+
+private:
+	unsigned const sort_id_;
+
+	static unsigned next_sort_id_;
 };
 
 }
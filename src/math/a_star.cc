@@ -35,7 +35,7 @@ std::vector<a_star::point> a_star::build_path(bool allow_best_heuristic_point) c
 			scalar best_cost = -1;
 			point best_point;
 
-			for (boost::unordered_map<point, point_record, point_hash>::const_iterator it = point_records_.begin();
+			for (boost::unordered_map<point, point_record, cell_hash>::const_iterator it = point_records_.begin();
 				 it != point_records_.end(); ++it)
 			{
 				if (it->second.heuristic_cost < 0) continue;
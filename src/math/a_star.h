@@ -6,6 +6,7 @@
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 #include "vec.h"
+#include "grid.h"
 
 namespace math
 {
@@ -35,7 +36,6 @@ private:
 		scalar total_cost;
 	};
 
-	struct point_hash { size_t operator ()(point const &p) const { return size_t(p.x) * 1011 + size_t(p.y); } };
 	struct point_equal { bool operator ()(point const &p1, point const &p2) const { return p1 == p2; } };
 
 	struct weighted_point_less {
@@ -47,10 +47,10 @@ private:
 		}
 	};
 
-	boost::unordered_set<point, point_hash, point_equal> closed_points_;
-	boost::unordered_set<point, point_hash, point_equal> open_points_;
+	boost::unordered_set<point, cell_hash, point_equal> closed_points_;
+	boost::unordered_set<point, cell_hash, point_equal> open_points_;
 	std::multiset< std::pair<scalar, point>, weighted_point_less> weighted_open_points_;
-	boost::unordered_map<point, point_record, point_hash, point_equal> point_records_;
+	boost::unordered_map<point, point_record, cell_hash, point_equal> point_records_;
 
 	void add_open_point(point const &p, scalar w);
 	point pop_cheapest_open_point();
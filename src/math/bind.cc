@@ -12,6 +12,7 @@
 #include "sphere.h"
 #include "capsule.h"
 #include "heightfield.h"
+#include "tiled_heightfield.h"
 #include "bind.h"
 
 namespace math
@@ -32,6 +33,7 @@ void bind(lua_State *L)
 	bind_sphere(L);
 	bind_capsule(L);
 	bind_heightfield(L);
+	bind_tiled_heightfield(L);
 }
 
 }
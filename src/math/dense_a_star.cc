@@ -0,0 +1,435 @@
+
+#include <algorithm>
+#include "grid.h"
+#include "dense_a_star.h"
+
+namespace math
+{
+
+namespace
+{
+scalar chebyshev_distance(dense_a_star::point const &p1, dense_a_star::point const &p2)
+{
+	return scalar(std::max(abs(p1.x - p2.x), abs(p1.y - p2.y)));
+}
+}
+
+dense_a_star::dense_a_star(int width, int height):
+	width_(0),
+	height_(0),
+	mode_(NEIGHBOURS),
+	finished_(true),
+	failed_(false),
+	expanded_points_(0),
+	generation_(0)
+{
+	resize(width, height);
+}
+
+dense_a_star::~dense_a_star()
+{
+}
+
+void dense_a_star::resize(int width, int height)
+{
+	if (width == width_ && height == height_) return;
+
+	width_ = width;
+	height_ = height;
+	generation_ = 0;
+
+	point_records_.clear();
+	point_records_.resize(size_t(width) * size_t(height));
+	walkable_.clear();
+	walkable_cached_.clear();
+}
+
+void dense_a_star::calculate_path(point const &from, point const &to, scorer_t const &scorer, search_mode mode)
+{
+	start_path(from, to, scorer, mode);
+	continue_path(size_t(-1));
+}
+
+void dense_a_star::start_path(point const &from, point const &to, scorer_t const &scorer, search_mode mode)
+{
+	start_ = from;
+	goal_ = to;
+	scorer_ = scorer;
+	mode_ = mode;
+	finished_ = false;
+	failed_ = false;
+	expanded_points_ = 0;
+
+	if (mode_ == JUMP_POINTS && walkable_.empty()) walkable_.resize(point_records_.size(), UNKNOWN);
+
+	for (std::vector<boost::uint32_t>::const_iterator it = walkable_cached_.begin(); it != walkable_cached_.end(); ++it)
+	{
+		walkable_[*it] = UNKNOWN;
+	}
+	walkable_cached_.clear();
+
+	best_heuristic_index_ = NONE;
+	heap_.clear();
+
+	if (++generation_ == 0)
+	{
+		for (std::vector<point_record>::iterator it = point_records_.begin(); it != point_records_.end(); ++it)
+		{
+			it->generation = 0;
+		}
+
+		generation_ = 1;
+	}
+
+	start();
+}
+
+bool dense_a_star::continue_path(size_t max_expansions)
+{
+	if (!finished_) run(max_expansions);
+	return finished_;
+}
+
+std::vector<dense_a_star::point> dense_a_star::build_path(bool allow_best_heuristic_point) const
+{
+	std::vector<point> result;
+
+	if (failed_ && (!allow_best_heuristic_point || best_heuristic_index_ == NONE)) return result;
+
+	boost::uint32_t current = failed_ ? best_heuristic_index_ : index_of(goal_);
+	boost::uint32_t const start = index_of(start_);
+
+	result.push_back(point_of(current));
+
+	while (current != start)
+	{
+		int const *d = GRID_DIRECTIONS[point_records_[current].came_from];
+		boost::uint32_t const delta = d[0] * height_ + d[1];
+		scalar cost = point_records_[current].best_cost;
+
+		// jump points are connected by straight or diagonal lines of walkable points, parent is
+		// first point on line which has been reached with matching cost
+		do
+		{
+			current -= delta;
+			cost -= 1;
+			result.push_back(point_of(current));
+		}
+		while (mode_ == JUMP_POINTS && (state_of(current) == UNVISITED || point_records_[current].best_cost != cost));
+	}
+
+	std::reverse(result.begin(), result.end());
+
+	return result;
+}
+
+dense_a_star::point_state dense_a_star::state_of(boost::uint32_t index) const
+{
+	point_record const &r = point_records_[index];
+	return r.generation == generation_ ? point_state(r.state) : UNVISITED;
+}
+
+dense_a_star::point_record &dense_a_star::touch_record(boost::uint32_t index)
+{
+	point_record &r = point_records_[index];
+
+	if (r.generation != generation_)
+	{
+		r.generation = generation_;
+		r.state = UNVISITED;
+	}
+
+	return r;
+}
+
+bool dense_a_star::is_walkable(point const &p)
+{
+	if (!is_inside(p)) return false;
+
+	boost::uint32_t const index = index_of(p);
+	boost::uint8_t &w = walkable_[index];
+
+	if (w == UNKNOWN)
+	{
+		w = scorer_(p) >= 0 ? WALKABLE : BLOCKED;
+		walkable_cached_.push_back(index);
+	}
+
+	return w == WALKABLE;
+}
+
+void dense_a_star::heap_push(boost::uint32_t index, scalar total_cost)
+{
+	heap_entry e;
+	e.total_cost = total_cost;
+	e.index = index;
+
+	heap_.push_back(e);
+	heap_sift_up(heap_.size() - 1);
+}
+
+boost::uint32_t dense_a_star::heap_pop()
+{
+	boost::uint32_t index = heap_.front().index;
+
+	heap_.front() = heap_.back();
+	heap_.pop_back();
+
+	if (!heap_.empty()) heap_sift_down(0);
+
+	return index;
+}
+
+void dense_a_star::heap_decrease(boost::uint32_t index, scalar total_cost)
+{
+	size_t position = point_records_[index].heap_position;
+	heap_[position].total_cost = total_cost;
+	heap_sift_up(position);
+}
+
+void dense_a_star::heap_sift_up(size_t position)
+{
+	heap_entry e = heap_[position];
+
+	while (position > 0)
+	{
+		size_t parent = (position - 1) / 4;
+		if (!(e < heap_[parent])) break;
+
+		heap_[position] = heap_[parent];
+		point_records_[heap_[position].index].heap_position = boost::uint32_t(position);
+		position = parent;
+	}
+
+	heap_[position] = e;
+	point_records_[e.index].heap_position = boost::uint32_t(position);
+}
+
+void dense_a_star::heap_sift_down(size_t position)
+{
+	heap_entry e = heap_[position];
+	size_t const n = heap_.size();
+
+	while (true)
+	{
+		size_t first = position * 4 + 1;
+		if (first >= n) break;
+
+		size_t best = first;
+		for (size_t c = first + 1, nc = std::min(first + 4, n); c < nc; ++c)
+		{
+			if (heap_[c] < heap_[best]) best = c;
+		}
+
+		if (!(heap_[best] < e)) break;
+
+		heap_[position] = heap_[best];
+		point_records_[heap_[position].index].heap_position = boost::uint32_t(position);
+		position = best;
+	}
+
+	heap_[position] = e;
+	point_records_[e.index].heap_position = boost::uint32_t(position);
+}
+
+void dense_a_star::start()
+{
+	if (!is_inside(start_)) return;
+
+	if (mode_ == JUMP_POINTS && !is_walkable(start_)) return;
+
+	boost::uint32_t index = index_of(start_);
+	point_record &pr = touch_record(index);
+	pr.best_cost = 0;
+	pr.heuristic_cost = mode_ == JUMP_POINTS ? chebyshev_distance(start_, goal_) : scorer_(start_);
+
+	if (pr.heuristic_cost < 0) return;
+
+	best_heuristic_index_ = index;
+	pr.state = OPEN;
+	heap_push(index, pr.heuristic_cost);
+}
+
+void dense_a_star::run(size_t max_expansions)
+{
+	bool const goal_inside = is_inside(goal_);
+	boost::uint32_t const goal = goal_inside ? index_of(goal_) : NONE;
+
+	// jump point search may find goal through jump point which is not cheapest one, so
+	// it waits for goal to be closed
+	point_state const goal_reached_state = mode_ == JUMP_POINTS ? CLOSED : OPEN;
+
+	for (size_t i = 0; ; ++i)
+	{
+		if (goal_inside && state_of(goal) == goal_reached_state)
+		{
+			finished_ = true;
+			return;
+		}
+
+		if (heap_.empty())
+		{
+			finished_ = failed_ = true;
+			return;
+		}
+
+		if (i == max_expansions) return;
+
+		process_next_point();
+	}
+}
+
+void dense_a_star::process_next_point()
+{
+	boost::uint32_t index = heap_pop();
+	point_records_[index].state = CLOSED;
+	++expanded_points_;
+
+	point p = point_of(index);
+
+	if (mode_ == NEIGHBOURS)
+	{
+		for (int d = 0; d < 8; ++d)
+		{
+			point n(p.x + GRID_DIRECTIONS[d][0], p.y + GRID_DIRECTIONS[d][1]);
+			if (is_inside(n)) process_point_neighbour(index, n, d);
+		}
+
+		return;
+	}
+
+	if (p == start_)
+	{
+		for (int d = 0; d < 8; ++d) process_jump(index, p, GRID_DIRECTIONS[d][0], GRID_DIRECTIONS[d][1]);
+		return;
+	}
+
+	// prune neighbours which could be reached from parent at least as cheap not passing through p,
+	// forced neighbours are ones that became reachable only through p because of obstacles; they
+	// are listed with offset of cell which has to be blocked, natural ones have zero offset
+	struct successor { int dx, dy, blocked_dx, blocked_dy; };
+
+	int const dx = GRID_DIRECTIONS[point_records_[index].came_from][0];
+	int const dy = GRID_DIRECTIONS[point_records_[index].came_from][1];
+
+	successor const diagonal[] = { { dx, 0, 0, 0 }, { 0, dy, 0, 0 }, { dx, dy, 0, 0 }, { -dx, dy, -dx, 0 }, { dx, -dy, 0, -dy } };
+	successor const horizontal[] = { { dx, 0, 0, 0 }, { dx, 1, 0, 1 }, { dx, -1, 0, -1 } };
+	successor const vertical[] = { { 0, dy, 0, 0 }, { 1, dy, 1, 0 }, { -1, dy, -1, 0 } };
+
+	successor const *successors = dx != 0 && dy != 0 ? diagonal : dx != 0 ? horizontal : vertical;
+	size_t const count = dx != 0 && dy != 0 ? sizeof(diagonal) / sizeof(diagonal[0]) : sizeof(horizontal) / sizeof(horizontal[0]);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		successor const &s = successors[i];
+		bool const natural = s.blocked_dx == 0 && s.blocked_dy == 0;
+
+		if (natural || !is_walkable(point(p.x + s.blocked_dx, p.y + s.blocked_dy))) process_jump(index, p, s.dx, s.dy);
+	}
+}
+
+void dense_a_star::process_jump(boost::uint32_t p, point const &from, int dx, int dy)
+{
+	point j;
+	if (jump(from, dx, dy, j)) process_jump_point(p, j, grid_direction_index(dx, dy));
+}
+
+void dense_a_star::process_point_neighbour(boost::uint32_t p, point const &n, int direction)
+{
+	boost::uint32_t index = index_of(n);
+	point_record &nr = touch_record(index);
+
+	if (nr.state == CLOSED) return;
+
+	scalar tentative_best_cost = point_records_[p].best_cost + 1;
+
+	if (nr.state != OPEN)
+	{
+		nr.came_from = boost::uint8_t(direction);
+		nr.best_cost = tentative_best_cost;
+		nr.heuristic_cost = scorer_(n);
+
+		if (nr.heuristic_cost < 0)
+		{
+			nr.state = CLOSED;
+			return;
+		}
+
+		if (nr.heuristic_cost < point_records_[best_heuristic_index_].heuristic_cost) best_heuristic_index_ = index;
+
+		nr.state = OPEN;
+		heap_push(index, nr.best_cost + nr.heuristic_cost);
+	}
+	else if (nr.best_cost > tentative_best_cost)
+	{
+		nr.came_from = boost::uint8_t(direction);
+		nr.best_cost = tentative_best_cost;
+		heap_decrease(index, nr.best_cost + nr.heuristic_cost);
+	}
+}
+
+void dense_a_star::process_jump_point(boost::uint32_t p, point const &n, int direction)
+{
+	boost::uint32_t index = index_of(n);
+	point_record &nr = touch_record(index);
+
+	if (nr.state == CLOSED) return;
+
+	scalar tentative_best_cost = point_records_[p].best_cost + chebyshev_distance(point_of(p), n);
+
+	if (nr.state != OPEN)
+	{
+		nr.came_from = boost::uint8_t(direction);
+		nr.best_cost = tentative_best_cost;
+		nr.heuristic_cost = chebyshev_distance(n, goal_);
+
+		if (nr.heuristic_cost < point_records_[best_heuristic_index_].heuristic_cost) best_heuristic_index_ = index;
+
+		nr.state = OPEN;
+		heap_push(index, nr.best_cost + nr.heuristic_cost);
+	}
+	else if (nr.best_cost > tentative_best_cost)
+	{
+		nr.came_from = boost::uint8_t(direction);
+		nr.best_cost = tentative_best_cost;
+		heap_decrease(index, nr.best_cost + nr.heuristic_cost);
+	}
+}
+
+bool dense_a_star::jump(point const &p, int dx, int dy, point &result)
+{
+	point n = p;
+
+	while (true)
+	{
+		n.x += dx;
+		n.y += dy;
+
+		if (!is_walkable(n)) return false;
+
+		result = n;
+
+		if (n == goal_) return true;
+
+		if (dx != 0 && dy != 0)
+		{
+			if (!is_walkable(point(n.x - dx, n.y)) && is_walkable(point(n.x - dx, n.y + dy))) return true;
+			if (!is_walkable(point(n.x, n.y - dy)) && is_walkable(point(n.x + dx, n.y - dy))) return true;
+
+			point dummy;
+			if (jump(n, dx, 0, dummy) || jump(n, 0, dy, dummy)) return true;
+		}
+		else if (dx != 0)
+		{
+			if (!is_walkable(point(n.x, n.y + 1)) && is_walkable(point(n.x + dx, n.y + 1))) return true;
+			if (!is_walkable(point(n.x, n.y - 1)) && is_walkable(point(n.x + dx, n.y - 1))) return true;
+		}
+		else
+		{
+			if (!is_walkable(point(n.x + 1, n.y)) && is_walkable(point(n.x + 1, n.y + dy))) return true;
+			if (!is_walkable(point(n.x - 1, n.y)) && is_walkable(point(n.x - 1, n.y + dy))) return true;
+		}
+	}
+}
+
+}
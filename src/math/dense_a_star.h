@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "a_star.h"
+
+namespace math
+{
+
+// A* over bounded grid [0, width) x [0, height) producing same paths as a_star, but keeping
+// point records in flat array indexed by cell and open points in 4-ary indexed heap with
+// decrease-key. Arrays are reused between searches, so one object should be kept per thread.
+//
+// In JUMP_POINTS mode jump point search is used instead of expanding every neighbour. Scorer
+// is then only used to tell walkable points (score >= 0) from blocked ones, heuristic is
+// max(|dx|, |dy|) and search stops when goal is closed, so returned path has minimal number
+// of steps. Points between jump points are filled in by build_path(), best heuristic point is
+// chosen among jump points only.
+//
+// Search could also be run in steps: start_path() prepares it and every continue_path() call
+// expands at most given number of points, so long searches could be spread over several ticks.
+class dense_a_star {
+public:
+	typedef a_star::point point;
+	typedef a_star::scorer_t scorer_t;
+
+	enum search_mode { NEIGHBOURS, JUMP_POINTS };
+
+	dense_a_star(int width = 0, int height = 0);
+	~dense_a_star();
+
+	void resize(int width, int height);
+	int width() const { return width_; }
+	int height() const { return height_; }
+
+	void calculate_path(point const &from, point const &to, scorer_t const &scorer, search_mode mode = NEIGHBOURS);
+	void start_path(point const &from, point const &to, scorer_t const &scorer, search_mode mode = NEIGHBOURS);
+	// returns true when search is finished
+	bool continue_path(size_t max_expansions);
+	bool is_finished() const { return finished_; }
+	bool have_failed() const { return failed_; }
+	std::vector<point> build_path(bool allow_best_heuristic_point = false) const;
+	size_t expanded_points() const { return expanded_points_; }
+
+private:
+	enum point_state { UNVISITED, OPEN, CLOSED };
+	static boost::uint32_t const NONE = 0xffffffff;
+
+	struct point_record
+	{
+		scalar best_cost;
+		scalar heuristic_cost;
+		boost::uint32_t heap_position;
+		boost::uint16_t generation;
+		boost::uint8_t state;
+		boost::uint8_t came_from;
+	};
+
+	struct heap_entry
+	{
+		scalar total_cost;
+		boost::uint32_t index;
+
+		// cells are stored column-major, so comparing indices gives same tie-breaking
+		// as lexicographical_less on points in a_star
+		bool operator <(heap_entry const &rhs) const
+		{
+			return total_cost < rhs.total_cost || (total_cost == rhs.total_cost && index < rhs.index);
+		}
+	};
+
+	int width_, height_;
+	point start_, goal_;
+	scorer_t scorer_;
+	search_mode mode_;
+	bool finished_;
+	bool failed_;
+	size_t expanded_points_;
+	boost::uint16_t generation_;
+	boost::uint32_t best_heuristic_index_;
+	std::vector<point_record> point_records_;
+	std::vector<heap_entry> heap_;
+
+	enum walkable_state { UNKNOWN, WALKABLE, BLOCKED };
+
+	// scorer results cached in JUMP_POINTS mode, one byte per cell kept apart from point records
+	// since jumps scan many more points than they open; cached cells are listed, so next search
+	// resets only them
+	std::vector<boost::uint8_t> walkable_;
+	std::vector<boost::uint32_t> walkable_cached_;
+
+	bool is_inside(point const &p) const { return p.x >= 0 && p.y >= 0 && p.x < width_ && p.y < height_; }
+	boost::uint32_t index_of(point const &p) const { return boost::uint32_t(p.x * height_ + p.y); }
+	point point_of(boost::uint32_t index) const { return point(int(index) / height_, int(index) % height_); }
+	point_state state_of(boost::uint32_t index) const;
+	point_record &touch_record(boost::uint32_t index);
+	bool is_walkable(point const &p);
+
+	void heap_push(boost::uint32_t index, scalar total_cost);
+	boost::uint32_t heap_pop();
+	void heap_decrease(boost::uint32_t index, scalar total_cost);
+	void heap_sift_up(size_t position);
+	void heap_sift_down(size_t position);
+
+	void start();
+	void run(size_t max_expansions);
+	void process_next_point();
+	void process_point_neighbour(boost::uint32_t p, point const &n, int direction);
+	void process_jump(boost::uint32_t p, point const &from, int dx, int dy);
+	void process_jump_point(boost::uint32_t p, point const &n, int direction);
+	bool jump(point const &p, int dx, int dy, point &result);
+};
+
+}
@@ -1,13 +1,165 @@
 
+#include <algorithm>
 #include <luabind/luabind.hpp>
 #include <luabind/iterator_policy.hpp>
 #include "aabb.h"
 #include "obb.h"
+#include "simd.h"
 #include "frustum.h"
 
 namespace math
 {
 
+namespace
+{
+
+// distance from plane to farthest vertex of box, negative when whole box is behind plane
+template<class T>
+T max_distance(plane<T> const &p, typename frustum<T>::aabb_arrays const &b, size_t i)
+{
+	return p.A * b.cx[i] + p.B * b.cy[i] + p.C * b.cz[i] + p.D
+		+ abs(p.A) * b.ex[i] + abs(p.B) * b.ey[i] + abs(p.C) * b.ez[i];
+}
+
+template<class T>
+T max_distance(plane<T> const &p, typename frustum<T>::obb_arrays const &b, size_t i)
+{
+	return p.A * b.cx[i] + p.B * b.cy[i] + p.C * b.cz[i] + p.D
+		+ abs(p.A * b.tx[i] + p.B * b.ty[i] + p.C * b.tz[i])
+		+ abs(p.A * b.nx[i] + p.B * b.ny[i] + p.C * b.nz[i])
+		+ abs(p.A * b.bx[i] + p.B * b.by[i] + p.C * b.bz[i]);
+}
+
+// tests up to four boxes starting from first, returns mask of visible ones
+template<class T, class Boxes>
+unsigned test_group(boost::array<plane<T>, frustum<T>::PLANES_COUNT> const &planes, Boxes const &bounds, size_t first, size_t n,
+	boost::uint8_t *cached_plane)
+{
+	unsigned visible = (1u << n) - 1;
+	size_t const start = cached_plane ? *cached_plane : 0;
+
+	for (size_t k = 0; k < planes.size() && visible != 0; ++k)
+	{
+		size_t const index = (start + k) % planes.size();
+
+		for (size_t j = 0; j < n; ++j)
+		{
+			if (max_distance(planes[index], bounds, first + j) < -EPSILON) visible &= ~(1u << j);
+		}
+
+		if (visible == 0 && cached_plane) *cached_plane = boost::uint8_t(index);
+	}
+
+	return visible;
+}
+
+#ifdef MATH_SSE
+
+__m128 abs_ps(__m128 x)
+{
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+}
+
+__m128 dot_ps(__m128 a, __m128 b, __m128 c, __m128 x, __m128 y, __m128 z)
+{
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)), _mm_mul_ps(c, z));
+}
+
+struct aabb_lanes
+{
+	__m128 cx, cy, cz, ex, ey, ez;
+
+	aabb_lanes(frustum<scalar>::aabb_arrays const &b, size_t i)
+		: cx(_mm_loadu_ps(b.cx + i)), cy(_mm_loadu_ps(b.cy + i)), cz(_mm_loadu_ps(b.cz + i)),
+		ex(_mm_loadu_ps(b.ex + i)), ey(_mm_loadu_ps(b.ey + i)), ez(_mm_loadu_ps(b.ez + i))
+	{
+	}
+
+	__m128 max_distance(__m128 a, __m128 b, __m128 c, __m128 d) const
+	{
+		__m128 const r = dot_ps(abs_ps(a), abs_ps(b), abs_ps(c), ex, ey, ez);
+		return _mm_add_ps(_mm_add_ps(dot_ps(a, b, c, cx, cy, cz), d), r);
+	}
+};
+
+struct obb_lanes
+{
+	__m128 cx, cy, cz, tx, ty, tz, nx, ny, nz, bx, by, bz;
+
+	obb_lanes(frustum<scalar>::obb_arrays const &b, size_t i)
+		: cx(_mm_loadu_ps(b.cx + i)), cy(_mm_loadu_ps(b.cy + i)), cz(_mm_loadu_ps(b.cz + i)),
+		tx(_mm_loadu_ps(b.tx + i)), ty(_mm_loadu_ps(b.ty + i)), tz(_mm_loadu_ps(b.tz + i)),
+		nx(_mm_loadu_ps(b.nx + i)), ny(_mm_loadu_ps(b.ny + i)), nz(_mm_loadu_ps(b.nz + i)),
+		bx(_mm_loadu_ps(b.bx + i)), by(_mm_loadu_ps(b.by + i)), bz(_mm_loadu_ps(b.bz + i))
+	{
+	}
+
+	__m128 max_distance(__m128 a, __m128 b, __m128 c, __m128 d) const
+	{
+		__m128 r = abs_ps(dot_ps(a, b, c, tx, ty, tz));
+		r = _mm_add_ps(r, abs_ps(dot_ps(a, b, c, nx, ny, nz)));
+		r = _mm_add_ps(r, abs_ps(dot_ps(a, b, c, bx, by, bz)));
+		return _mm_add_ps(_mm_add_ps(dot_ps(a, b, c, cx, cy, cz), d), r);
+	}
+};
+
+template<class Lanes>
+unsigned test_lanes(boost::array<plane<scalar>, frustum<scalar>::PLANES_COUNT> const &planes, Lanes const &lanes,
+	boost::uint8_t *cached_plane)
+{
+	__m128 const min_distance = _mm_set1_ps(-EPSILON);
+	size_t const start = cached_plane ? *cached_plane : 0;
+	int culled = 0;
+
+	for (size_t k = 0; k < planes.size(); ++k)
+	{
+		size_t const index = (start + k) % planes.size();
+		plane<scalar> const &p = planes[index];
+
+		__m128 const distance = lanes.max_distance(_mm_set1_ps(p.A), _mm_set1_ps(p.B), _mm_set1_ps(p.C), _mm_set1_ps(p.D));
+		culled |= _mm_movemask_ps(_mm_cmplt_ps(distance, min_distance));
+
+		if (culled == 0xf)
+		{
+			if (cached_plane) *cached_plane = boost::uint8_t(index);
+			return 0;
+		}
+	}
+
+	return ~culled & 0xf;
+}
+
+unsigned test_group(boost::array<plane<scalar>, frustum<scalar>::PLANES_COUNT> const &planes, frustum<scalar>::aabb_arrays const &bounds,
+	size_t first, size_t n, boost::uint8_t *cached_plane)
+{
+	if (n < 4) return test_group<scalar>(planes, bounds, first, n, cached_plane);
+	return test_lanes(planes, aabb_lanes(bounds, first), cached_plane);
+}
+
+unsigned test_group(boost::array<plane<scalar>, frustum<scalar>::PLANES_COUNT> const &planes, frustum<scalar>::obb_arrays const &bounds,
+	size_t first, size_t n, boost::uint8_t *cached_plane)
+{
+	if (n < 4) return test_group<scalar>(planes, bounds, first, n, cached_plane);
+	return test_lanes(planes, obb_lanes(bounds, first), cached_plane);
+}
+
+#endif
+
+template<class T, class Boxes>
+void test_boxes(boost::array<plane<T>, frustum<T>::PLANES_COUNT> const &planes, Boxes const &bounds, size_t count,
+	boost::uint32_t *visible, boost::uint8_t *plane_cache)
+{
+	std::fill(visible, visible + (count + 31) / 32, 0);
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		unsigned const mask = test_group(planes, bounds, i, std::min(count - i, size_t(4)), plane_cache ? &plane_cache[i / 4] : 0);
+		visible[i / 32] |= boost::uint32_t(mask) << (i % 32);
+	}
+}
+
+}
+
 template<class T>
 frustum<T>::frustum()
 {
@@ -100,6 +252,18 @@ bool frustum<T>::test_intersection(obb<3,T> const &bounds) const
 	return true;
 }
 
+template<class T>
+void frustum<T>::test_intersection(aabb_arrays const &bounds, size_t count, boost::uint32_t *visible, boost::uint8_t *plane_cache) const
+{
+	test_boxes(planes, bounds, count, visible, plane_cache);
+}
+
+template<class T>
+void frustum<T>::test_intersection(obb_arrays const &bounds, size_t count, boost::uint32_t *visible, boost::uint8_t *plane_cache) const
+{
+	test_boxes(planes, bounds, count, visible, plane_cache);
+}
+
 template class frustum<>;
 
 void bind_frustum(lua_State *L) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <boost/array.hpp>
+#include <boost/cstdint.hpp>
 #include <luabind/lua_include.hpp>
 #include "vec.h"
 #include "plane.h"
@@ -30,6 +31,22 @@ public:
 		PLANE_FAR,
 	};
 
+	// boxes kept as structure of arrays, c are centres and e are halves of sides along world axes
+	struct aabb_arrays
+	{
+		scalar_t const *cx, *cy, *cz;
+		scalar_t const *ex, *ey, *ez;
+	};
+
+	// boxes kept as structure of arrays, c are centres and t, n, b are halves of box sides
+	struct obb_arrays
+	{
+		scalar_t const *cx, *cy, *cz;
+		scalar_t const *tx, *ty, *tz;
+		scalar_t const *nx, *ny, *nz;
+		scalar_t const *bx, *by, *bz;
+	};
+
 	boost::array<plane_t, PLANES_COUNT> planes;
 
 	frustum();
@@ -41,6 +58,15 @@ public:
 	bool contains(math::vec<3> const &point) const;
 	bool test_intersection(aabb<3,T> const &bounds) const;
 	bool test_intersection(obb<3,T> const &bounds) const;
+
+	// Tests count boxes at once, bit i % 32 of visible[i / 32] is set when box i intersects
+	// frustum, visible should have room for (count + 31) / 32 words. Boxes are tested by four
+	// in sse registers. When plane_cache with (count + 3) / 4 entries is given, planes of every
+	// four boxes are tested starting from one which culled them last time, so boxes which stay
+	// culled between frames are usually rejected by first plane tested. It should be zeroed
+	// before first call.
+	void test_intersection(aabb_arrays const &bounds, size_t count, boost::uint32_t *visible, boost::uint8_t *plane_cache = 0) const;
+	void test_intersection(obb_arrays const &bounds, size_t count, boost::uint32_t *visible, boost::uint8_t *plane_cache = 0) const;
 };
 
 void bind_frustum(lua_State *L);
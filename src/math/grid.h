@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+#include "vec.h"
+
+namespace math
+{
+
+// offsets of eight neighbours of grid cell, same order as in a_star::process_next_point
+int const GRID_DIRECTIONS[8][2] = {
+	{ -1, -1 }, { -1,  0 }, { -1,  1 },
+	{  0, -1 },             {  0,  1 },
+	{  1, -1 }, {  1,  0 }, {  1,  1 }
+};
+
+// index of offset in GRID_DIRECTIONS
+inline int grid_direction_index(int dx, int dy)
+{
+	int const index = (dx + 1) * 3 + dy + 1;
+	return index > 4 ? index - 1 : index;
+}
+
+// both coordinates are mixed into all bits of result, so cells of nearby rows and columns fall to
+// different buckets
+struct cell_hash {
+	std::size_t operator ()(vec<2, int> const &cell) const {
+		boost::uint64_t h = (boost::uint64_t(boost::uint32_t(cell.x)) << 32) | boost::uint32_t(cell.y);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return std::size_t(h);
+	}
+};
+
+}
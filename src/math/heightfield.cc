@@ -1,26 +1,198 @@
 
 #include <stdexcept>
 #include <utility>
+#include <limits>
+#include <string>
 #include <boost/cstdint.hpp>
 #include <boost/bind.hpp>
-#include <boost/unordered_set.hpp>
 #include <luabind/luabind.hpp>
 #include <luabind/iterator_policy.hpp>
-#include "a_star.h"
-#include "bresenham_supercover.h"
+#include "dense_a_star.h"
+#include "heightfield_sampling.h"
+#include "transform.h"
+#include "parallel.h"
 #include "heightfield.h"
 
 namespace math
 {
 
+namespace
+{
+scalar const TRACE_EPSILON = 1e-4f;
+
+template<class T>
+T lowest_value()
+{
+	return std::numeric_limits<T>::is_integer ? std::numeric_limits<T>::min() : -std::numeric_limits<T>::max();
+}
+
+// rays traced by one thread, larger batches are split
+size_t const TRACE_PARALLEL_MIN_RAYS = 1024;
+
+// spreads lower 16 bits to even bits
+boost::uint32_t interleave_bits(boost::uint32_t x)
+{
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+#ifdef MATH_SSE
+// contact time of packet lane without contact, local rays end at 1
+scalar const NO_CONTACT_TIME = 2;
+
+// clip_slab() for four rays, inv_d is 1 / d
+void clip_slab(__m128 p, __m128 d, __m128 inv_d, scalar lo, scalar hi, __m128 &t0, __m128 &t1)
+{
+	__m128 const lo4 = _mm_set1_ps(lo), hi4 = _mm_set1_ps(hi);
+	__m128 const ta = _mm_mul_ps(_mm_sub_ps(lo4, p), inv_d);
+	__m128 const tb = _mm_mul_ps(_mm_sub_ps(hi4, p), inv_d);
+
+	// rays parallel to slab are either inside of it for whole time or never
+	__m128 const parallel = _mm_cmpeq_ps(d, _mm_setzero_ps());
+	__m128 const inside = _mm_and_ps(_mm_cmpge_ps(p, lo4), _mm_cmple_ps(p, hi4));
+
+	t0 = select(parallel, select(inside, t0, _mm_set1_ps(MAX_SCALAR)), _mm_max_ps(t0, _mm_min_ps(ta, tb)));
+	t1 = select(parallel, select(inside, t1, _mm_set1_ps(-MAX_SCALAR)), _mm_min_ps(t1, _mm_max_ps(ta, tb)));
+}
+
+// Moller-Trumbore test of four rays against triangle a, a + e1, a + e2, returns contact times
+// in [0, 1] or NO_CONTACT_TIME
+__m128 intersect_triangle(__m128 ox, __m128 oy, __m128 oz, __m128 dx, __m128 dy, __m128 dz,
+	vec<3> const &a, vec<3> const &e1, vec<3> const &e2)
+{
+	__m128 const e1x = _mm_set1_ps(e1.x), e1y = _mm_set1_ps(e1.y), e1z = _mm_set1_ps(e1.z);
+	__m128 const e2x = _mm_set1_ps(e2.x), e2y = _mm_set1_ps(e2.y), e2z = _mm_set1_ps(e2.z);
+
+	__m128 const px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 const py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 const pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+	__m128 const det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 const inv_det = _mm_div_ps(_mm_set1_ps(1), det);
+
+	__m128 const sx = _mm_sub_ps(ox, _mm_set1_ps(a.x));
+	__m128 const sy = _mm_sub_ps(oy, _mm_set1_ps(a.y));
+	__m128 const sz = _mm_sub_ps(oz, _mm_set1_ps(a.z));
+
+	__m128 const u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv_det);
+
+	__m128 const qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	__m128 const qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	__m128 const qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+	__m128 const v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv_det);
+	__m128 const t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det);
+
+	__m128 const zero = _mm_set1_ps(-EPSILON), one = _mm_set1_ps(1 + EPSILON);
+	__m128 hit = _mm_cmpgt_ps(_mm_mul_ps(det, det), _mm_set1_ps(EPSILON * EPSILON));
+	hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+	hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+	hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(t, _mm_setzero_ps()), _mm_cmple_ps(t, _mm_set1_ps(1))));
+
+	return select(hit, t, _mm_set1_ps(NO_CONTACT_TIME));
+}
+
+// local x and z of four positions, same operations order as in mul(vec<3>, vec<3>, matrix<4,4>)
+void transform_xz(matrix<4,4> const &m, vec<3> const *p, __m128 &x, __m128 &z)
+{
+	__m128 const px = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+	__m128 const py = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+	__m128 const pz = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+
+	x = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.ij[0][0]), px), _mm_mul_ps(_mm_set1_ps(m.ij[1][0]), py)),
+		_mm_mul_ps(_mm_set1_ps(m.ij[2][0]), pz)), _mm_set1_ps(m.ij[3][0]));
+	z = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(m.ij[0][2]), px), _mm_mul_ps(_mm_set1_ps(m.ij[1][2]), py)),
+		_mm_mul_ps(_mm_set1_ps(m.ij[2][2]), pz)), _mm_set1_ps(m.ij[3][2]));
+}
+
+// heights at corners of four cells, lanes of cells outside of heightfield get zeros
+template<class T>
+void load_corners(T const *heights, size_t ncols, __m128i cols, __m128i rows, __m128i inside,
+	__m128 &v1, __m128 &v2, __m128 &v3, __m128 &v4)
+{
+	int col[4], row[4], mask[4];
+	_mm_storeu_si128((__m128i *) col, cols);
+	_mm_storeu_si128((__m128i *) row, rows);
+	_mm_storeu_si128((__m128i *) mask, inside);
+
+	scalar c1[4], c2[4], c3[4], c4[4];
+
+	for (int j = 0; j < 4; ++j)
+	{
+		if (!mask[j])
+		{
+			c1[j] = c2[j] = c3[j] = c4[j] = 0;
+			continue;
+		}
+
+		T const *h = heights + row[j] * ncols + col[j];
+		c1[j] = scalar(h[0]);
+		c2[j] = scalar(h[1]);
+		c3[j] = scalar(h[ncols]);
+		c4[j] = scalar(h[ncols + 1]);
+	}
+
+	v1 = _mm_loadu_ps(c1);
+	v2 = _mm_loadu_ps(c2);
+	v3 = _mm_loadu_ps(c3);
+	v4 = _mm_loadu_ps(c4);
+}
+#endif
+
+// lua passes positions as string of packed x, y, z floats and gets results packed the same way
+template<class T>
+luabind::object lua_y_under_many(heightfield<T> const &hf, lua_State *L, std::string const &positions, scalar default_value)
+{
+	size_t const count = positions.size() / sizeof(vec<3>);
+	std::vector<vec<3> > buffer(count);
+	std::vector<scalar> results(count);
+
+	if (count != 0)
+	{
+		std::copy(positions.data(), positions.data() + count * sizeof(vec<3>), (char *) &buffer[0]);
+		hf.y_under_many(&buffer[0], &results[0], count, default_value);
+	}
+
+	lua_pushlstring(L, count != 0 ? (char const *) &results[0] : "", count * sizeof(scalar));
+	luabind::object result(luabind::from_stack(L, -1));
+	lua_pop(L, 1);
+	return result;
+}
+
+template<class T>
+luabind::object lua_max_y_in_cell_many(heightfield<T> const &hf, lua_State *L, std::string const &positions, scalar default_value)
+{
+	size_t const count = positions.size() / sizeof(vec<3>);
+	std::vector<vec<3> > buffer(count);
+	std::vector<scalar> results(count);
+
+	if (count != 0)
+	{
+		std::copy(positions.data(), positions.data() + count * sizeof(vec<3>), (char *) &buffer[0]);
+		hf.max_y_in_cell_many(&buffer[0], &results[0], count, default_value);
+	}
+
+	lua_pushlstring(L, count != 0 ? (char const *) &results[0] : "", count * sizeof(scalar));
+	luabind::object result(luabind::from_stack(L, -1));
+	lua_pop(L, 1);
+	return result;
+}
+}
+
 template<class T>
 heightfield<T>::heightfield(matrix<4,4> const &tf, size_t nrows, size_t ncols):
     nrows_(nrows),
-    ncols_(ncols)
+    ncols_(ncols),
+	version_(0)
 {
 	set_local_to_world(tf);
 
 	heights_.resize(nrows * ncols);
+	reset_versions();
+	build_pyramid();
 
 	local_aabb_.lo.set(0, -1, 0);
 	local_aabb_.hi.set(math::scalar(ncols_ - 1), 1, math::scalar(nrows_ - 1));
@@ -32,54 +204,355 @@ heightfield<T>::~heightfield()
 }
 
 template<class T>
-scalar heightfield<T>::y_under(vec<3> const &position, scalar default_value)
+scalar heightfield<T>::y_under(vec<3> const &position, scalar default_value) const
+{
+	return heightfield_y_under(*this, position * world_to_local_, default_value);
+}
+
+template<class T>
+scalar heightfield<T>::max_y_in_cell(int col, int row, scalar default_value) const
+{
+	return heightfield_max_y_in_cell(*this, col, row, default_value);
+}
+
+template<class T>
+scalar heightfield<T>::max_y_in_cell(vec<3> const &position, scalar default_value) const
 {
 	vec<3> local_position = position * world_to_local_;
 
 	int col = (int) local_position.x;
 	int row = (int) local_position.z;
 
-	if (col < 0 || row < 0 || col >= (int) ncols_ - 1 || row >= (int) nrows_ - 1) return default_value;
+	return max_y_in_cell(col, row, default_value);
+}
 
-	scalar v1 = local_y_at(col + 0, row + 0);
-	scalar v2 = local_y_at(col + 1, row + 0);
-	scalar v3 = local_y_at(col + 0, row + 1);
-	scalar v4 = local_y_at(col + 1, row + 1);
+template<class T>
+void heightfield<T>::y_under_many(vec<3> const *positions, scalar *results, size_t count, scalar default_value) const
+{
+	if (ncols_ < 2 || nrows_ < 2)
+	{
+		std::fill(results, results + count, default_value);
+		return;
+	}
+
+	size_t i = 0;
+
+#ifdef MATH_SSE
+	__m128 const one = _mm_set1_ps(1);
+	__m128 const default_values = _mm_set1_ps(default_value);
 
-	scalar k1 = local_position.x - col;
-	scalar k2 = local_position.z - col;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x, z;
+		transform_xz(world_to_local_, positions + i, x, z);
+
+		// truncated as in y_under()
+		__m128i const cols = _mm_cvttps_epi32(x);
+		__m128i const rows = _mm_cvttps_epi32(z);
+		__m128i const inside = _mm_and_si128(in_range(cols, 0, (int) ncols_ - 1), in_range(rows, 0, (int) nrows_ - 1));
+
+		__m128 v1, v2, v3, v4;
+		load_corners(&heights_[0], ncols_, cols, rows, inside, v1, v2, v3, v4);
 
-	scalar v12 = v1 * (1 - k1) + v2 * k1;
-	scalar v34 = v3 * (1 - k1) + v4 * k1;
+		__m128 const k1 = _mm_sub_ps(x, _mm_cvtepi32_ps(cols));
+		__m128 const k2 = _mm_sub_ps(z, _mm_cvtepi32_ps(rows));
+		__m128 const l1 = _mm_sub_ps(one, k1);
+
+		__m128 const v12 = _mm_add_ps(_mm_mul_ps(v1, l1), _mm_mul_ps(v2, k1));
+		__m128 const v34 = _mm_add_ps(_mm_mul_ps(v3, l1), _mm_mul_ps(v4, k1));
+		__m128 const y = _mm_add_ps(_mm_mul_ps(v12, _mm_sub_ps(one, k2)), _mm_mul_ps(v34, k2));
+
+		_mm_storeu_ps(results + i, select(_mm_castsi128_ps(inside), y, default_values));
+	}
+#endif
 
-	return v12 * (1 - k2) + v34 * k2;
+	for (; i < count; ++i) results[i] = y_under(positions[i], default_value);
 }
 
 template<class T>
-scalar heightfield<T>::max_y_in_cell(int col, int row, scalar default_value) const
+void heightfield<T>::max_y_in_cell_many(vec<3> const *positions, scalar *results, size_t count, scalar default_value) const
+{
+	if (ncols_ < 2 || nrows_ < 2)
+	{
+		std::fill(results, results + count, default_value);
+		return;
+	}
+
+	size_t i = 0;
+
+#ifdef MATH_SSE
+	__m128 const default_values = _mm_set1_ps(default_value);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x, z;
+		transform_xz(world_to_local_, positions + i, x, z);
+
+		__m128i const cols = _mm_cvttps_epi32(x);
+		__m128i const rows = _mm_cvttps_epi32(z);
+		__m128i const inside = _mm_and_si128(in_range(cols, 0, (int) ncols_ - 1), in_range(rows, 0, (int) nrows_ - 1));
+
+		__m128 v1, v2, v3, v4;
+		load_corners(&heights_[0], ncols_, cols, rows, inside, v1, v2, v3, v4);
+
+		__m128 const y = _mm_max_ps(_mm_max_ps(v1, v2), _mm_max_ps(v3, v4));
+
+		_mm_storeu_ps(results + i, select(_mm_castsi128_ps(inside), y, default_values));
+	}
+#endif
+
+	for (; i < count; ++i) results[i] = max_y_in_cell(positions[i], default_value);
+}
+
+template<class T>
+scalar heightfield<T>::min_y_in_region(int col0, int row0, int col1, int row1, scalar default_value) const
+{
+	height_range range;
+	range.min = std::numeric_limits<value_t>::max();
+	range.max = lowest_value<value_t>();
+
+	if (ncols_ >= 2 && nrows_ >= 2)
+	{
+		region_range((int) pyramid_.size(), 0, 0, col0, row0, col1, row1, range);
+	}
+
+	return range.is_dirty() ? default_value : scalar(range.min);
+}
+
+template<class T>
+scalar heightfield<T>::max_y_in_region(int col0, int row0, int col1, int row1, scalar default_value) const
+{
+	height_range range;
+	range.min = std::numeric_limits<value_t>::max();
+	range.max = lowest_value<value_t>();
+
+	if (ncols_ >= 2 && nrows_ >= 2)
+	{
+		region_range((int) pyramid_.size(), 0, 0, col0, row0, col1, row1, range);
+	}
+
+	return range.is_dirty() ? default_value : scalar(range.max);
+}
+
+template<class T>
+void heightfield<T>::set_local_y_at(int col, int row, value_t value)
+{
+	local_y_at(col, row) = value;
+	touch(col, row, col, row);
+	update_pyramid_cells(col - 1, row - 1, col, row);
+}
+
+template<class T>
+void heightfield<T>::update_pyramid()
+{
+	if (!pyramid_.empty()) refresh_pyramid_node((int) pyramid_.size(), 0, 0);
+}
+
+template<class T>
+typename heightfield<T>::height_range heightfield<T>::node_range(int level, int col, int row) const
+{
+	if (level > 0) return pyramid_[level - 1][row * level_ncols(level) + col];
+
+	height_range range;
+	range.min = range.max = local_y_at(col, row);
+	range.min = std::min(range.min, std::min(local_y_at(col + 1, row), std::min(local_y_at(col, row + 1), local_y_at(col + 1, row + 1))));
+	range.max = std::max(range.max, std::max(local_y_at(col + 1, row), std::max(local_y_at(col, row + 1), local_y_at(col + 1, row + 1))));
+	return range;
+}
+
+template<class T>
+typename heightfield<T>::height_range heightfield<T>::combine_children(int level, int col, int row) const
+{
+	int const child_ncols = level_ncols(level - 1), child_nrows = level_nrows(level - 1);
+
+	height_range range;
+	range.min = std::numeric_limits<value_t>::max();
+	range.max = lowest_value<value_t>();
+
+	for (int i = 0; i < 4; ++i)
+	{
+		int const child_col = col * 2 + (i & 1), child_row = row * 2 + (i >> 1);
+		if (child_col >= child_ncols || child_row >= child_nrows) continue;
+
+		height_range const child = node_range(level - 1, child_col, child_row);
+
+		if (child.is_dirty())
+		{
+			range.min = std::numeric_limits<value_t>::max();
+			range.max = value_t(0);
+			break;
+		}
+
+		range.min = std::min(range.min, child.min);
+		range.max = std::max(range.max, child.max);
+	}
+
+	return range;
+}
+
+template<class T>
+void heightfield<T>::build_pyramid()
+{
+	pyramid_.clear();
+
+	if (ncols_ < 2 || nrows_ < 2) return;
+
+	for (int level = 1; level_ncols(level - 1) > 1 || level_nrows(level - 1) > 1; ++level)
+	{
+		int const ncols = level_ncols(level), nrows = level_nrows(level);
+
+		pyramid_.push_back(std::vector<height_range>(ncols * nrows));
+
+		for (int row = 0; row < nrows; ++row)
+		{
+			for (int col = 0; col < ncols; ++col)
+			{
+				pyramid_.back()[row * ncols + col] = combine_children(level, col, row);
+			}
+		}
+	}
+}
+
+template<class T>
+void heightfield<T>::refresh_pyramid_node(int level, int col, int row)
+{
+	height_range &range = pyramid_[level - 1][row * level_ncols(level) + col];
+	if (!range.is_dirty()) return;
+
+	if (level > 1)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			int const child_col = col * 2 + (i & 1), child_row = row * 2 + (i >> 1);
+			if (child_col >= level_ncols(level - 1) || child_row >= level_nrows(level - 1)) continue;
+
+			refresh_pyramid_node(level - 1, child_col, child_row);
+		}
+	}
+
+	range = combine_children(level, col, row);
+}
+
+template<class T>
+void heightfield<T>::mark_pyramid_dirty(int col0, int row0, int col1, int row1)
+{
+	col0 = std::max(col0, 0);
+	row0 = std::max(row0, 0);
+
+	for (int level = 1; level <= (int) pyramid_.size(); ++level)
+	{
+		int const ncols = level_ncols(level);
+		std::vector<height_range> &ranges = pyramid_[level - 1];
+
+		for (int row = row0 >> level, nrow = std::min(row1 >> level, level_nrows(level) - 1); row <= nrow; ++row)
+		{
+			for (int col = col0 >> level, ncol = std::min(col1 >> level, ncols - 1); col <= ncol; ++col)
+			{
+				ranges[row * ncols + col].min = std::numeric_limits<value_t>::max();
+				ranges[row * ncols + col].max = value_t(0);
+			}
+		}
+	}
+}
+
+template<class T>
+void heightfield<T>::update_pyramid_cells(int col0, int row0, int col1, int row1)
+{
+	col0 = std::max(col0, 0);
+	row0 = std::max(row0, 0);
+
+	// nodes are recomputed level by level, so ones having other dirty children stay dirty
+	for (int level = 1; level <= (int) pyramid_.size(); ++level)
+	{
+		int const ncols = level_ncols(level);
+
+		for (int row = row0 >> level, nrow = std::min(row1 >> level, level_nrows(level) - 1); row <= nrow; ++row)
+		{
+			for (int col = col0 >> level, ncol = std::min(col1 >> level, ncols - 1); col <= ncol; ++col)
+			{
+				pyramid_[level - 1][row * ncols + col] = combine_children(level, col, row);
+			}
+		}
+	}
+}
+
+template<class T>
+void heightfield<T>::region_range(int level, int col, int row, int col0, int row0, int col1, int row1, height_range &range) const
 {
-	if (col < 0 || row < 0 || col >= (int) ncols_ - 1 || row >= (int) nrows_ - 1)
+	int const first_col = col << level, last_col = ((col + 1) << level) - 1;
+	int const first_row = row << level, last_row = ((row + 1) << level) - 1;
+
+	if (last_col < col0 || last_row < row0 || first_col > col1 || first_row > row1) return;
+
+	height_range const node = node_range(level, col, row);
+	bool const inside = first_col >= col0 && first_row >= row0 && last_col <= col1 && last_row <= row1;
+
+	if (level == 0 || (inside && !node.is_dirty()))
 	{
-		return default_value;
+		range.min = std::min(range.min, node.min);
+		range.max = std::max(range.max, node.max);
+		return;
 	}
 
-	scalar result = (scalar) local_y_at(col + 0, row + 0);
-	result = std::max(result, (scalar) local_y_at(col + 0, row + 1));
-	result = std::max(result, (scalar) local_y_at(col + 1, row + 0));
-	result = std::max(result, (scalar) local_y_at(col + 1, row + 1));
+	for (int i = 0; i < 4; ++i)
+	{
+		int const child_col = col * 2 + (i & 1), child_row = row * 2 + (i >> 1);
+		if (child_col >= level_ncols(level - 1) || child_row >= level_nrows(level - 1)) continue;
+
+		region_range(level - 1, child_col, child_row, col0, row0, col1, row1, range);
+	}
+}
+
+template<class T>
+boost::uint32_t heightfield<T>::get_region_version(int col0, int row0, int col1, int row1) const
+{
+	int const bc0 = std::max(col0, 0) / VERSION_BLOCK_SIZE;
+	int const br0 = std::max(row0, 0) / VERSION_BLOCK_SIZE;
+	int const bc1 = std::min(std::max(col1, 0) / VERSION_BLOCK_SIZE, (int) version_block_ncols_ - 1);
+	int const br1 = std::min(std::max(row1, 0) / VERSION_BLOCK_SIZE, (int) version_block_nrows_ - 1);
+
+	boost::uint32_t result = 0;
+
+	for (int br = br0; br <= br1; ++br)
+	{
+		for (int bc = bc0; bc <= bc1; ++bc)
+		{
+			result = std::max(result, block_versions_[br * version_block_ncols_ + bc]);
+		}
+	}
 
 	return result;
 }
 
 template<class T>
-scalar heightfield<T>::max_y_in_cell(vec<3> const &position, scalar default_value) const
+void heightfield<T>::touch(int col0, int row0, int col1, int row1)
 {
-	vec<3> local_position = position * world_to_local_;
+	int const bc0 = std::max(col0, 0) / VERSION_BLOCK_SIZE;
+	int const br0 = std::max(row0, 0) / VERSION_BLOCK_SIZE;
+	int const bc1 = std::min(std::max(col1, 0) / VERSION_BLOCK_SIZE, (int) version_block_ncols_ - 1);
+	int const br1 = std::min(std::max(row1, 0) / VERSION_BLOCK_SIZE, (int) version_block_nrows_ - 1);
 
-	int col = (int) local_position.x;
-	int row = (int) local_position.z;
+	++version_;
 
-	return max_y_in_cell(col, row, default_value);
+	for (int br = br0; br <= br1; ++br)
+	{
+		for (int bc = bc0; bc <= bc1; ++bc)
+		{
+			block_versions_[br * version_block_ncols_ + bc] = version_;
+		}
+	}
+
+	// cells depend on vertices at their own and next column and row
+	mark_pyramid_dirty(col0 - 1, row0 - 1, col1, row1);
+}
+
+template<class T>
+void heightfield<T>::reset_versions()
+{
+	version_block_ncols_ = (ncols_ + VERSION_BLOCK_SIZE - 1) / VERSION_BLOCK_SIZE;
+	version_block_nrows_ = (nrows_ + VERSION_BLOCK_SIZE - 1) / VERSION_BLOCK_SIZE;
+
+	block_versions_.assign(version_block_ncols_ * version_block_nrows_, ++version_);
 }
 
 template<class T>
@@ -113,79 +586,344 @@ contact_info<3> heightfield<T>::trace(ray<3> const &r, scalar max_distance) cons
 	contact_info<3> result;
 	result.happened = false;
 
-	scalar local_ray_t0, local_ray_t1;
+	// part of ray inside of bounding box, ray could start inside of it
+	scalar local_ray_t0 = 0, local_ray_t1 = 1;
+
+	if (!clip_slab(local_ray.r0.x, local_ray.a.x, local_aabb_.lo.x, local_aabb_.hi.x, local_ray_t0, local_ray_t1)) return result;
+	if (!clip_slab(local_ray.r0.y, local_ray.a.y, local_aabb_.lo.y, local_aabb_.hi.y, local_ray_t0, local_ray_t1)) return result;
+	if (!clip_slab(local_ray.r0.z, local_ray.a.z, local_aabb_.lo.z, local_aabb_.hi.z, local_ray_t0, local_ray_t1)) return result;
+
+	if (ncols_ >= 2 && nrows_ >= 2)
+	{
+		trace_node((int) pyramid_.size(), 0, 0, local_ray, local_ray_t0, local_ray_t1, result);
+	}
+
+	result.position = result.position * local_to_world_;
+
+	return result;
+}
+
+template<class T>
+bool heightfield<T>::trace_node(int level, int col, int row, ray<3> const &local_ray, scalar t0, scalar t1,
+	contact_info<3> &result) const
+{
+	int const size = 1 << level;
+
+	// cells of node, slightly extended so rays along borders are not lost
+	if (!clip_slab(local_ray.r0.x, local_ray.a.x, scalar(col * size) - TRACE_EPSILON,
+		scalar(std::min((col + 1) * size, (int) ncols_ - 1)) + TRACE_EPSILON, t0, t1)) return false;
+	if (!clip_slab(local_ray.r0.z, local_ray.a.z, scalar(row * size) - TRACE_EPSILON,
+		scalar(std::min((row + 1) * size, (int) nrows_ - 1)) + TRACE_EPSILON, t0, t1)) return false;
+
+	height_range const range = node_range(level, col, row);
+
+	if (!range.is_dirty())
+	{
+		scalar const y0 = local_ray.r0.y + local_ray.a.y * t0;
+		scalar const y1 = local_ray.r0.y + local_ray.a.y * t1;
+
+		if (std::min(y0, y1) > scalar(range.max) + TRACE_EPSILON) return false;
+		if (std::max(y0, y1) < scalar(range.min) - TRACE_EPSILON) return false;
+	}
+
+	if (level == 0) return trace_cell(col, row, local_ray, result);
+
+	// children are visited in order ray enters them, so ones behind found contact are skipped
+	int children[4][2];
+	scalar children_t0[4];
+	int nchildren = 0;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		int const child_col = col * 2 + (i & 1), child_row = row * 2 + (i >> 1);
+		if (child_col >= level_ncols(level - 1) || child_row >= level_nrows(level - 1)) continue;
 
-	if (!local_aabb_.trace(local_ray, &local_ray_t0, &local_ray_t1)) return result;
+		int const child_size = size / 2;
+		scalar child_t0 = t0, child_t1 = t1;
 
-	vec<3> local_p0_adjusted = local_ray.apply(local_ray_t0);
-	vec<3> local_p1_adjusted = local_ray.apply(local_ray_t1);
+		if (!clip_slab(local_ray.r0.x, local_ray.a.x, scalar(child_col * child_size) - TRACE_EPSILON,
+			scalar(std::min((child_col + 1) * child_size, (int) ncols_ - 1)) + TRACE_EPSILON, child_t0, child_t1)) continue;
+		if (!clip_slab(local_ray.r0.z, local_ray.a.z, scalar(child_row * child_size) - TRACE_EPSILON,
+			scalar(std::min((child_row + 1) * child_size, (int) nrows_ - 1)) + TRACE_EPSILON, child_t0, child_t1)) continue;
 
-	bresenham_supercover<> cells_iterator(cell_t(int (local_p0_adjusted.x), int(local_p0_adjusted.z)),
-		cell_t(int(local_p1_adjusted.x), int(local_p1_adjusted.z)));
+		int j = nchildren++;
+
+		for (; j > 0 && children_t0[j - 1] > child_t0; --j)
+		{
+			children[j][0] = children[j - 1][0];
+			children[j][1] = children[j - 1][1];
+			children_t0[j] = children_t0[j - 1];
+		}
 
-	while (true)
+		children[j][0] = child_col;
+		children[j][1] = child_row;
+		children_t0[j] = child_t0;
+	}
+
+	bool happened = false;
+
+	for (int i = 0; i < nchildren; ++i)
 	{
-		cell_t cell;
-		bool flag;
+		if (result.happened && children_t0[i] > result.time + TRACE_EPSILON) break;
 
-		boost::tie(cell, flag) = cells_iterator.get();
-		if (flag) break;
+		happened |= trace_node(level - 1, children[i][0], children[i][1], local_ray, t0, t1, result);
+	}
 
-		if (cell.x == ncols_ - 1) --cell.x;
-		if (cell.y == nrows_ - 1) --cell.y;
+	return happened;
+}
 
-		vec<3> v1 = local_vertex_at(cell.x + 0, cell.y + 0);
-		vec<3> v2 = local_vertex_at(cell.x + 0, cell.y + 1);
-		vec<3> v3 = local_vertex_at(cell.x + 1, cell.y + 1);
-		vec<3> v4 = local_vertex_at(cell.x + 1, cell.y + 0);
+template<class T>
+bool heightfield<T>::trace_cell(int col, int row, ray<3> const &local_ray, contact_info<3> &result) const
+{
+	return heightfield_trace_cell(*this, col, row, local_ray, result);
+}
 
-		triangle<3> t1(v1, v2, v3);
-		triangle<3> t2(v1, v3, v4);
+#ifdef MATH_SSE
+template<class T>
+struct heightfield<T>::ray_packet
+{
+	// local rays of four lanes
+	__m128 ox, oy, oz, dx, dy, dz, inv_dx, inv_dz;
+	// closest contacts, NO_CONTACT_TIME while lane has none
+	__m128 time, nx, ny, nz;
+};
+#endif
 
-		bool trace_h1, trace_h2;
-        scalar trace_t1, trace_t2;
-		vec<3> trace_p1, trace_p2;
+template<class T>
+void heightfield<T>::trace_many(ray<3> const *rays, contact_info<3> *results, size_t count, scalar max_distance) const
+{
+	// rays are ordered by z-order curve over cells they start in, so rays of one packet
+	// mostly visit same pyramid nodes
+	std::vector<std::pair<boost::uint32_t, boost::uint32_t> > keys(count);
+	std::vector<vec<3> > origins(count);
+	if (count != 0) transform_points(world_to_local_, &rays[0].r0, sizeof(ray<3>), &origins[0], sizeof(vec<3>), count);
 
-		trace_h1 = t1.trace(local_ray, trace_t1, trace_p1);
-		trace_h2 = t2.trace(local_ray, trace_t2, trace_p2);
+	for (size_t i = 0; i < count; ++i)
+	{
+		vec<3> const &p = origins[i];
+		boost::uint32_t const col = boost::uint32_t(std::min(std::max(p.x, scalar(0)), scalar(0xffff)));
+		boost::uint32_t const row = boost::uint32_t(std::min(std::max(p.z, scalar(0)), scalar(0xffff)));
 
-		if (trace_h1 || trace_h2)
-        {
-            contact_info<3> ci;
+		keys[i] = std::make_pair(interleave_bits(col) | (interleave_bits(row) << 1), boost::uint32_t(i));
+	}
 
-            ci.happened = true;
-            ci.penetrated = false;
+	std::sort(keys.begin(), keys.end());
 
-            if (trace_h1 && ((trace_h2 && trace_t1 < trace_t2) || trace_h2 == false))
-            {
-                ci.position = trace_p1;
-                ci.normal = t1.get_normal();
-                ci.time = trace_t1;
-            }
-            else
-            {
-                ci.position = trace_p2;
-                ci.normal = t2.get_normal();
-                ci.time = trace_t2;
-            }
+	std::vector<boost::uint32_t> indices(count);
+	for (size_t i = 0; i < count; ++i) indices[i] = keys[i].second;
 
-			if (result.worse_than(ci))
+	// ranges are multiple of packet size
+	if (count != 0)
+	{
+		parallel_for(count, TRACE_PARALLEL_MIN_RAYS, 4,
+			boost::bind(&heightfield::trace_sorted, this, rays, results, &indices[0], max_distance, _1, _2));
+	}
+}
+
+template<class T>
+void heightfield<T>::trace_sorted(ray<3> const *rays, contact_info<3> *results, boost::uint32_t const *indices,
+	scalar max_distance, size_t first, size_t count) const
+{
+	indices += first;
+
+#ifndef MATH_SSE
+	for (size_t i = 0; i < count; ++i) results[indices[i]] = trace(rays[indices[i]], max_distance);
+#else
+	if (ncols_ < 2 || nrows_ < 2)
+	{
+		for (size_t i = 0; i < count; ++i) results[indices[i]] = trace(rays[indices[i]], max_distance);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		size_t const n = std::min(count - i, size_t(4));
+
+		vec<3> p0[4], d[4];
+		scalar t0[4], t1[4];
+
+		for (size_t j = 0; j < 4; ++j)
+		{
+			t0[j] = 1;
+			t1[j] = 0;
+			p0[j] = d[j] = vec<3>(0, 0, 0);
+
+			if (j >= n) continue;
+
+			ray<3> const &r = rays[indices[i + j]];
+			p0[j] = r.r0 * world_to_local_;
+			d[j] = (r.r0 + normalize(r.a) * max_distance) * world_to_local_ - p0[j];
+
+			// part of ray inside of bounding box, lanes missing it stay empty
+			scalar lane_t0 = 0, lane_t1 = 1;
+
+			if (!clip_slab(p0[j].x, d[j].x, local_aabb_.lo.x, local_aabb_.hi.x, lane_t0, lane_t1)) continue;
+			if (!clip_slab(p0[j].y, d[j].y, local_aabb_.lo.y, local_aabb_.hi.y, lane_t0, lane_t1)) continue;
+			if (!clip_slab(p0[j].z, d[j].z, local_aabb_.lo.z, local_aabb_.hi.z, lane_t0, lane_t1)) continue;
+
+			t0[j] = lane_t0;
+			t1[j] = lane_t1;
+		}
+
+		ray_packet packet;
+		packet.ox = _mm_setr_ps(p0[0].x, p0[1].x, p0[2].x, p0[3].x);
+		packet.oy = _mm_setr_ps(p0[0].y, p0[1].y, p0[2].y, p0[3].y);
+		packet.oz = _mm_setr_ps(p0[0].z, p0[1].z, p0[2].z, p0[3].z);
+		packet.dx = _mm_setr_ps(d[0].x, d[1].x, d[2].x, d[3].x);
+		packet.dy = _mm_setr_ps(d[0].y, d[1].y, d[2].y, d[3].y);
+		packet.dz = _mm_setr_ps(d[0].z, d[1].z, d[2].z, d[3].z);
+		packet.inv_dx = _mm_div_ps(_mm_set1_ps(1), packet.dx);
+		packet.inv_dz = _mm_div_ps(_mm_set1_ps(1), packet.dz);
+		packet.time = _mm_set1_ps(NO_CONTACT_TIME);
+		packet.nx = packet.ny = packet.nz = _mm_setzero_ps();
+
+		trace_packet_node((int) pyramid_.size(), 0, 0, packet, _mm_loadu_ps(t0), _mm_loadu_ps(t1));
+
+		scalar time[4], nx[4], ny[4], nz[4];
+		_mm_storeu_ps(time, packet.time);
+		_mm_storeu_ps(nx, packet.nx);
+		_mm_storeu_ps(ny, packet.ny);
+		_mm_storeu_ps(nz, packet.nz);
+
+		for (size_t j = 0; j < n; ++j)
+		{
+			contact_info<3> &result = results[indices[i + j]];
+			result.happened = time[j] < NO_CONTACT_TIME;
+
+			if (result.happened)
 			{
-				result = ci;
+				result.penetrated = false;
+				result.penetration_depth = 0;
+				result.time = time[j];
+				result.position = (p0[j] + d[j] * time[j]) * local_to_world_;
+				result.normal.set(nx[j], ny[j], nz[j]);
 			}
-        }
-    }
+		}
+	}
+#endif
+}
 
-	result.position = result.position * local_to_world_;
+#ifdef MATH_SSE
 
-	return result;
+template<class T>
+void heightfield<T>::trace_packet_node(int level, int col, int row, ray_packet &packet, __m128 t0, __m128 t1) const
+{
+	__m128 const epsilon = _mm_set1_ps(TRACE_EPSILON);
+
+	// lanes which reach node before their contacts
+	__m128 active = _mm_and_ps(_mm_cmple_ps(t0, t1), _mm_cmple_ps(t0, _mm_add_ps(packet.time, epsilon)));
+
+	height_range const range = node_range(level, col, row);
+
+	if (!range.is_dirty())
+	{
+		__m128 const y0 = _mm_add_ps(packet.oy, _mm_mul_ps(packet.dy, t0));
+		__m128 const y1 = _mm_add_ps(packet.oy, _mm_mul_ps(packet.dy, t1));
+
+		active = _mm_and_ps(active, _mm_cmple_ps(_mm_min_ps(y0, y1), _mm_set1_ps(scalar(range.max) + TRACE_EPSILON)));
+		active = _mm_and_ps(active, _mm_cmpge_ps(_mm_max_ps(y0, y1), _mm_set1_ps(scalar(range.min) - TRACE_EPSILON)));
+	}
+
+	if (_mm_movemask_ps(active) == 0) return;
+
+	if (level == 0)
+	{
+		trace_packet_cell(col, row, packet, active);
+		return;
+	}
+
+	__m128 const empty = _mm_set1_ps(MAX_SCALAR);
+	t0 = select(active, t0, empty);
+
+	// children are visited in order packet enters them
+	int children[4][2];
+	__m128 children_t0[4], children_t1[4];
+	scalar children_order[4];
+	int nchildren = 0;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		int const child_col = col * 2 + (i & 1), child_row = row * 2 + (i >> 1);
+		if (child_col >= level_ncols(level - 1) || child_row >= level_nrows(level - 1)) continue;
+
+		int const child_size = 1 << (level - 1);
+		__m128 child_t0 = t0, child_t1 = t1;
+
+		clip_slab(packet.ox, packet.dx, packet.inv_dx, scalar(child_col * child_size) - TRACE_EPSILON,
+			scalar(std::min((child_col + 1) * child_size, (int) ncols_ - 1)) + TRACE_EPSILON, child_t0, child_t1);
+		clip_slab(packet.oz, packet.dz, packet.inv_dz, scalar(child_row * child_size) - TRACE_EPSILON,
+			scalar(std::min((child_row + 1) * child_size, (int) nrows_ - 1)) + TRACE_EPSILON, child_t0, child_t1);
+
+		__m128 const entered = _mm_cmple_ps(child_t0, child_t1);
+		if (_mm_movemask_ps(entered) == 0) continue;
+
+		scalar lanes_t0[4];
+		_mm_storeu_ps(lanes_t0, select(entered, child_t0, empty));
+		scalar const order = std::min(std::min(lanes_t0[0], lanes_t0[1]), std::min(lanes_t0[2], lanes_t0[3]));
+
+		int j = nchildren++;
+
+		for (; j > 0 && children_order[j - 1] > order; --j)
+		{
+			children[j][0] = children[j - 1][0];
+			children[j][1] = children[j - 1][1];
+			children_t0[j] = children_t0[j - 1];
+			children_t1[j] = children_t1[j - 1];
+			children_order[j] = children_order[j - 1];
+		}
+
+		children[j][0] = child_col;
+		children[j][1] = child_row;
+		children_t0[j] = child_t0;
+		children_t1[j] = child_t1;
+		children_order[j] = order;
+	}
+
+	for (int i = 0; i < nchildren; ++i)
+	{
+		trace_packet_node(level - 1, children[i][0], children[i][1], packet, children_t0[i], children_t1[i]);
+	}
+}
+
+template<class T>
+void heightfield<T>::trace_packet_cell(int col, int row, ray_packet &packet, __m128 active) const
+{
+	vec<3> const v[4] = {
+		local_vertex_at(col + 0, row + 0),
+		local_vertex_at(col + 0, row + 1),
+		local_vertex_at(col + 1, row + 1),
+		local_vertex_at(col + 1, row + 0)
+	};
+
+	// same triangles as in trace_cell()
+	int const triangles[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+
+	for (int i = 0; i < 2; ++i)
+	{
+		vec<3> const &a = v[triangles[i][0]], &b = v[triangles[i][1]], &c = v[triangles[i][2]];
+		vec<3> const e1 = b - a, e2 = c - a;
+
+		__m128 const time = intersect_triangle(packet.ox, packet.oy, packet.oz, packet.dx, packet.dy, packet.dz, a, e1, e2);
+		__m128 const hit = _mm_and_ps(active, _mm_cmplt_ps(time, packet.time));
+		if (_mm_movemask_ps(hit) == 0) continue;
+
+		vec<3> const normal = triangle<3>(a, b, c).get_normal();
+
+		packet.time = select(hit, time, packet.time);
+		packet.nx = select(hit, _mm_set1_ps(normal.x), packet.nx);
+		packet.ny = select(hit, _mm_set1_ps(normal.y), packet.ny);
+		packet.nz = select(hit, _mm_set1_ps(normal.z), packet.nz);
+	}
 }
 
+#endif
+
 template<class T>
 void heightfield<T>::load_from_raw_buffer(value_t const *heights)
 {
     heights_.assign(heights, heights + nsamples());
 
+	reset_versions();
 	post_load();
 }
 
@@ -203,85 +941,102 @@ void heightfield<T>::resize(size_t ncols, size_t nrows)
 		}
 	}
 
+	// blocks inside both old and new bounds keep their versions, ones along old border
+	// and new ones are touched
+	size_t const block_ncols = (ncols + VERSION_BLOCK_SIZE - 1) / VERSION_BLOCK_SIZE;
+	size_t const block_nrows = (nrows + VERSION_BLOCK_SIZE - 1) / VERSION_BLOCK_SIZE;
+	std::vector<boost::uint32_t> block_versions(block_ncols * block_nrows, 0);
+
+	for (size_t i = 0, ni = std::min(block_nrows, version_block_nrows_); i < ni; ++i)
+	{
+		for (size_t j = 0, nj = std::min(block_ncols, version_block_ncols_); j < nj; ++j)
+		{
+			block_versions[i * block_ncols + j] = block_versions_[i * version_block_ncols_ + j];
+		}
+	}
+
+	int const kept_ncols = (int) std::min(ncols, ncols_);
+	int const kept_nrows = (int) std::min(nrows, nrows_);
+
 	heights_.swap(heights);
 	ncols_ = ncols;
 	nrows_ = nrows;
+	version_block_ncols_ = block_ncols;
+	version_block_nrows_ = block_nrows;
+	block_versions_.swap(block_versions);
+
+	// pyramid is rebuilt by post_load()
+	pyramid_.clear();
+
+	{
+		boost::mutex::scoped_lock lock(pathfinders_mutex_);
+		free_pathfinders_.clear();
+	}
+
+	touch(kept_ncols - 1, 0, (int) ncols - 1, (int) nrows - 1);
+	touch(0, kept_nrows - 1, (int) ncols - 1, (int) nrows - 1);
 
 	post_load();
 }
 
-namespace
+template<class T> std::vector<typename heightfield<T>::cell_t>
+heightfield<T>::build_path(vec<3> const &from, vec<3> const &to, value_t min_value, bool allow_best_heuristic_point,
+	std::vector<cell_t> const &obstacles) const
 {
-template<class T>
-class scorer_closure {
-public:
-	typedef typename heightfield<T>::cell_t cell_t;
+	return build_path(from, to, min_value, allow_best_heuristic_point, obstacles, PATH_A_STAR);
+}
 
-	scorer_closure(heightfield<T> const *hf, scalar min_value, cell_t goal, std::vector<cell_t> const &obstacles):
-		hf_(hf),
-		min_value_(min_value),
-		goal_(goal)
-	{
-		obstacles_.insert(obstacles.begin(), obstacles.end());
-	}
+template<class T> std::vector<typename heightfield<T>::cell_t>
+heightfield<T>::build_path(vec<3> const &from, vec<3> const &to, value_t min_value, bool allow_best_heuristic_point,
+	std::vector<cell_t> const &obstacles, path_mode mode) const
+{
+	cell_t start = world_position_to_cell(from);
+	cell_t goal = world_position_to_cell(to);
 
-	scalar get_score(cell_t const &cell) const
-	{
-		if (cell.x < 0) return -1;
-		if (cell.y < 0) return -1;
-		if (cell.x >= (int) hf_->nrows()) return -1;
-		if (cell.y >= (int) hf_->ncols()) return -1;
+	boost::shared_ptr<dense_a_star> pathfinder = acquire_pathfinder();
 
-		typename obstacles_t::const_iterator it = obstacles_.find(cell);
-		if (it != obstacles_.end()) return -1;
+	heightfield_scorer<heightfield<T> > scorer(this, min_value, goal, obstacles);
+	pathfinder->calculate_path(start, goal, boost::bind(&heightfield_scorer<heightfield<T> >::get_score, &scorer, _1),
+		mode == PATH_JUMP_POINTS ? dense_a_star::JUMP_POINTS : dense_a_star::NEIGHBOURS);
 
-		scalar delta = (scalar) (cell - goal_).length_sq();
+	std::vector<cell_t> path = pathfinder->build_path(allow_best_heuristic_point);
+	release_pathfinder(pathfinder);
 
-		if (hf_->max_y_in_cell(cell.x, cell.y) < min_value_)
-		{
-			return delta;
-		}
-		else
-		{
-			return -1;
-		}
-	}
+	return path;
+}
 
-private:
-	struct cell_hash {
-		std::size_t operator ()(cell_t const &cell) const {
-			return (cell.x * 1011) ^ cell.y;
-		}
-	};
+template<class T>
+boost::shared_ptr<dense_a_star> heightfield<T>::acquire_pathfinder() const
+{
+	boost::shared_ptr<dense_a_star> pathfinder;
 
-	struct cell_eq {
-		std::size_t operator ()(cell_t const &lhs, cell_t const &rhs) const {
-			return lhs == rhs;
+	{
+		boost::mutex::scoped_lock lock(pathfinders_mutex_);
+
+		if (!free_pathfinders_.empty())
+		{
+			pathfinder = free_pathfinders_.back();
+			free_pathfinders_.pop_back();
 		}
-	};
+	}
 
-	typedef boost::unordered_set<cell_t, cell_hash, cell_eq> obstacles_t;
+	if (!pathfinder) pathfinder.reset(new dense_a_star());
+	pathfinder->resize((int) ncols_, (int) nrows_);
 
-	heightfield<T> const *hf_;
-	scalar min_value_;
-	cell_t goal_;
-	obstacles_t obstacles_;
-};
+	return pathfinder;
 }
 
-template<class T> std::vector<typename heightfield<T>::cell_t>
-heightfield<T>::build_path(vec<3> const &from, vec<3> const &to, value_t min_value, bool allow_best_heuristic_point,
-	std::vector<cell_t> const &obstacles) const
+template<class T>
+void heightfield<T>::release_pathfinder(boost::shared_ptr<dense_a_star> const &pathfinder) const
 {
-	cell_t start = world_position_to_cell(from);
-	cell_t goal = world_position_to_cell(to);
-
-	scorer_closure<T> scorer(this, min_value, goal, obstacles);
-	a_star pathfinder(start, goal, boost::bind(&scorer_closure<T>::get_score, &scorer, _1));
-
-	pathfinder.calculate_path();
+	boost::mutex::scoped_lock lock(pathfinders_mutex_);
+	free_pathfinders_.push_back(pathfinder);
+}
 
-	return pathfinder.build_path(allow_best_heuristic_point);
+template<class T>
+scalar heightfield<T>::path_score(cell_t const &cell, value_t min_value, cell_t const &goal) const
+{
+	return heightfield_path_score(*this, cell, min_value, goal);
 }
 
 template<class T>
@@ -304,6 +1059,8 @@ void heightfield<T>::post_load()
 
 	local_aabb_.hi.x = scalar(ncols_ - 1);
 	local_aabb_.hi.z = scalar(nrows_ - 1);
+
+	build_pyramid();
 }
 
 template<class T>
@@ -317,15 +1074,29 @@ void heightfield<T>::bind(lua_State *L, char const *name)
 		.def(constructor<matrix<4,4> const &, size_t, size_t>())
 		.def("y_under", &heightfield::y_under)
 		.def("max_y_in_cell", (scalar (heightfield::*)(vec<3> const &, scalar) const) &heightfield::max_y_in_cell)
+		.def("y_under_many", &lua_y_under_many<T>)
+		.def("max_y_in_cell_many", &lua_max_y_in_cell_many<T>)
+		.def("min_y_in_region", &heightfield::min_y_in_region)
+		.def("max_y_in_region", &heightfield::max_y_in_region)
+		.def("set_local_y_at", &heightfield::set_local_y_at)
+		.def("update_pyramid", &heightfield::update_pyramid)
 		.def("ncols", &heightfield::ncols)
 		.def("nrows", &heightfield::nrows)
 		.def("set_local_to_world", &heightfield::set_local_to_world)
 		.def("get_local_aabb", &heightfield::get_local_aabb)
 		.def("world_position_to_cell", &heightfield::world_position_to_cell)
 		.def("cell_to_world_position", &heightfield::cell_to_world_position)
-		.def("build_path", &heightfield::build_path)
+		.def("build_path", (std::vector<cell_t> (heightfield::*)(vec<3> const &, vec<3> const &, value_t, bool,
+			std::vector<cell_t> const &) const) &heightfield::build_path)
+		.def("build_path", (std::vector<cell_t> (heightfield::*)(vec<3> const &, vec<3> const &, value_t, bool,
+			std::vector<cell_t> const &, path_mode) const) &heightfield::build_path)
 		.def("trace", &heightfield::trace)
 		.def("resize", &heightfield::resize)
+		.enum_("path_mode")
+		[
+			value("PATH_A_STAR", PATH_A_STAR),
+			value("PATH_JUMP_POINTS", PATH_JUMP_POINTS)
+		]
 	];
 }
 
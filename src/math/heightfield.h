@@ -2,32 +2,56 @@
 
 #include <vector>
 #include <luabind/lua_include.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include "vec.h"
 #include "aabb.h"
 #include "line.h"
 #include "matrix.h"
 #include "collision.h"
+#include "simd.h"
 
 namespace math
 {
 
+class dense_a_star;
+
 template<class T = scalar>
 class heightfield {
 public:
     typedef T value_t;
 	typedef vec<2, int> cell_t;
 
+	// PATH_A_STAR follows a_star, PATH_JUMP_POINTS returns path with minimal number of steps
+	// expanding only jump points, see dense_a_star
+	enum path_mode { PATH_A_STAR, PATH_JUMP_POINTS };
+
+	// heights are split into VERSION_BLOCK_SIZE x VERSION_BLOCK_SIZE blocks of vertices, set_local_y_at(),
+	// touch(), load or resize stamps touched blocks with incremented version, so structures built
+	// over heightfield could find out which regions have to be rebuilt
+	static int const VERSION_BLOCK_SIZE = 16;
+
     heightfield(matrix<4,4> const &tf, size_t ncols, size_t nrows);
     ~heightfield();
 
 	value_t local_y_at(int col, int row) const { return heights_.at(row * ncols_ + col); }
+	// writes through reference are not seen by structures built over heightfield until touch()
 	value_t &local_y_at(int col, int row) { return heights_.at(row * ncols_ + col); }
+	// unlike writing through local_y_at() stamps version and keeps min/max pyramid up to date
+	void set_local_y_at(int col, int row, value_t value);
 	vec<3> local_vertex_at(int col, int row) const { return vec<3>(scalar(col), local_y_at(col, row), scalar(row)); }
 
-	scalar y_under(vec<3> const &position, scalar default_value = 0);
+	scalar y_under(vec<3> const &position, scalar default_value = 0) const;
 	scalar max_y_in_cell(int col, int row, scalar default_value = 0) const;
 	scalar max_y_in_cell(vec<3> const &position, scalar default_value = 0) const;
+	// same as y_under() and max_y_in_cell() for count positions, positions are transformed and
+	// heights are blended four at a time
+	void y_under_many(vec<3> const *positions, scalar *results, size_t count, scalar default_value = 0) const;
+	void max_y_in_cell_many(vec<3> const *positions, scalar *results, size_t count, scalar default_value = 0) const;
+	// heights over cells [col0, col1] x [row0, row1]
+	scalar min_y_in_region(int col0, int row0, int col1, int row1, scalar default_value = 0) const;
+	scalar max_y_in_region(int col0, int row0, int col1, int row1, scalar default_value = 0) const;
 
 	size_t ncols() const { return ncols_; }
 	size_t nrows() const { return nrows_; }
@@ -35,28 +59,70 @@ public:
     matrix<4,4> const &get_world_to_local() const { return world_to_local_; }
 	aabb<3> const &get_local_aabb() const { return local_aabb_; }
 
+	boost::uint32_t get_version() const { return version_; }
+	// maximal version of blocks containing vertices [col0, col1] x [row0, row1]
+	boost::uint32_t get_region_version(int col0, int row0, int col1, int row1) const;
+	void touch(int col0, int row0, int col1, int row1);
+
+	// min/max pyramid is used by trace() to skip blocks of cells ray passes above or below and
+	// by region queries, parts touched since last update are not used until update_pyramid()
+	void update_pyramid();
+
 	void set_local_to_world(math::matrix<4, 4> const &tf);
 	cell_t world_position_to_cell(vec<3> const &position) const;
 	vec<3> cell_to_world_position(cell_t const &cell) const;
     contact_info<3> trace(ray<3> const &r, scalar max_distance = 1000.0f) const;
+	// same as trace() for count rays, rays starting close to each other are traced four at a time
+	// through min/max pyramid and large batches are split between threads
+	void trace_many(ray<3> const *rays, contact_info<3> *results, size_t count, scalar max_distance = 1000.0f) const;
     void load_from_raw_buffer(value_t const *heights);
 	void resize(size_t ncols, size_t nrows);
 	std::vector<cell_t> build_path(vec<3> const &from, vec<3> const &to, value_t min_value = 0, bool allow_best_heuristic_point = false,
 		std::vector<cell_t> const &obstacles = std::vector<cell_t>()) const;
+	std::vector<cell_t> build_path(vec<3> const &from, vec<3> const &to, value_t min_value, bool allow_best_heuristic_point,
+		std::vector<cell_t> const &obstacles, path_mode mode) const;
+	// score build_path gives to cell, negative for cells path could not go through
+	scalar path_score(cell_t const &cell, value_t min_value, cell_t const &goal) const;
+	// search arrays are as large as heightfield, so they are kept by heightfield and reused by
+	// later searches, searches running at same time take different ones; searches run over several
+	// calls could borrow them too, they are freed with heightfield or on resize()
+	boost::shared_ptr<dense_a_star> acquire_pathfinder() const;
+	void release_pathfinder(boost::shared_ptr<dense_a_star> const &pathfinder) const;
 
 	template<class Archive>
 	void serialize(Archive &archive, unsigned const /*file_version*/)
 	{
 		archive & local_to_world_ & world_to_local_ & ncols_ & nrows_ & heights_ & local_aabb_;
+		if (Archive::is_loading::value)
+		{
+			reset_versions();
+			post_load();
+		}
 	}
 
 	static void bind(lua_State *L, char const *name);
 
 private:
+	struct height_range
+	{
+		value_t min, max;
+
+		// ranges of nodes changed since last pyramid update have min > max
+		bool is_dirty() const { return min > max; }
+	};
+
     matrix<4,4> local_to_world_, world_to_local_;
     size_t ncols_, nrows_;
     std::vector<value_t> heights_;
 	aabb<3> local_aabb_;
+	boost::uint32_t version_;
+	size_t version_block_ncols_, version_block_nrows_;
+	std::vector<boost::uint32_t> block_versions_;
+	// pyramid_[i] keeps ranges of heights over blocks of 2^(i+1) x 2^(i+1) cells, ranges of single
+	// cells are computed from heights
+	std::vector<std::vector<height_range> > pyramid_;
+	mutable boost::mutex pathfinders_mutex_;
+	mutable std::vector<boost::shared_ptr<dense_a_star> > free_pathfinders_;
 
     size_t nsamples()
     {
@@ -64,6 +130,27 @@ private:
     }
 
 	void post_load();
+	void reset_versions();
+
+	int level_ncols(int level) const { return (((int) ncols_ - 2) >> level) + 1; }
+	int level_nrows(int level) const { return (((int) nrows_ - 2) >> level) + 1; }
+	height_range node_range(int level, int col, int row) const;
+	height_range combine_children(int level, int col, int row) const;
+	void build_pyramid();
+	void refresh_pyramid_node(int level, int col, int row);
+	void mark_pyramid_dirty(int col0, int row0, int col1, int row1);
+	void update_pyramid_cells(int col0, int row0, int col1, int row1);
+	void region_range(int level, int col, int row, int col0, int row0, int col1, int row1, height_range &range) const;
+	bool trace_node(int level, int col, int row, ray<3> const &local_ray, scalar t0, scalar t1, contact_info<3> &result) const;
+	bool trace_cell(int col, int row, ray<3> const &local_ray, contact_info<3> &result) const;
+	// traces count rays of indices starting from first one
+	void trace_sorted(ray<3> const *rays, contact_info<3> *results, boost::uint32_t const *indices,
+		scalar max_distance, size_t first, size_t count) const;
+#ifdef MATH_SSE
+	struct ray_packet;
+	void trace_packet_node(int level, int col, int row, ray_packet &packet, __m128 t0, __m128 t1) const;
+	void trace_packet_cell(int col, int row, ray_packet &packet, __m128 active) const;
+#endif
 };
 
 void bind_heightfield(lua_State *L);
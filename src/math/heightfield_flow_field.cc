@@ -0,0 +1,270 @@
+
+#include <algorithm>
+#include "heightfield_flow_field.h"
+
+namespace math
+{
+
+namespace
+{
+boost::uint32_t const NOT_REACHED = 0xffffffff;
+}
+
+template<class T>
+boost::uint8_t const heightfield_flow_field<T>::GOAL;
+
+template<class T>
+boost::uint8_t const heightfield_flow_field<T>::UNREACHABLE;
+
+template<class T>
+heightfield_flow_field<T>::heightfield_flow_field(heightfield<T> const &hf, cell_t const &goal, value_t min_value,
+	std::vector<cell_t> const &obstacles, heightfield_flow_field_sweep *sweep):
+	hf_(hf),
+	goal_(goal),
+	min_value_(min_value),
+	sweep_(sweep),
+	built_(false),
+	built_version_(0),
+	ncols_(0),
+	nrows_(0),
+	col0_(0),
+	row0_(0),
+	col1_(-1),
+	row1_(-1)
+{
+	obstacles_.insert(obstacles.begin(), obstacles.end());
+	build();
+}
+
+template<class T>
+heightfield_flow_field<T>::~heightfield_flow_field()
+{
+}
+
+template<class T>
+bool heightfield_flow_field<T>::update()
+{
+	if (is_valid()) return false;
+
+	build();
+	return true;
+}
+
+template<class T>
+bool heightfield_flow_field<T>::is_valid() const
+{
+	if (!built_ || ncols_ != (int) hf_.ncols() || nrows_ != (int) hf_.nrows()) return false;
+
+	// blocked cells around reached ones could become walkable, cells depend on one more vertex
+	return hf_.get_region_version(col0_ - 1, row0_ - 1, col1_ + 2, row1_ + 2) <= built_version_;
+}
+
+template<class T>
+void heightfield_flow_field<T>::invalidate(int col0, int row0, int col1, int row1)
+{
+	if (col1 < col0_ - 1 || row1 < row0_ - 1 || col0 > col1_ + 1 || row0 > row1_ + 1) return;
+
+	built_ = false;
+}
+
+template<class T>
+void heightfield_flow_field<T>::invalidate()
+{
+	built_ = false;
+}
+
+template<class T>
+bool heightfield_flow_field<T>::is_reachable(cell_t const &cell) const
+{
+	return is_inside(cell) && directions_[cell.y * ncols_ + cell.x] != UNREACHABLE;
+}
+
+template<class T>
+typename heightfield_flow_field<T>::cell_t heightfield_flow_field<T>::direction_at(cell_t const &cell) const
+{
+	if (!is_inside(cell)) return cell_t(0, 0);
+
+	boost::uint8_t d = directions_[cell.y * ncols_ + cell.x];
+	if (d >= GOAL) return cell_t(0, 0);
+
+	return cell_t(GRID_DIRECTIONS[d][0], GRID_DIRECTIONS[d][1]);
+}
+
+template<class T>
+vec<3> heightfield_flow_field<T>::direction_at(vec<3> const &position) const
+{
+	cell_t cell = hf_.world_position_to_cell(position);
+	cell_t step = direction_at(cell);
+
+	if (step.x == 0 && step.y == 0) return vec<3>(0, 0, 0);
+
+	return normalize(hf_.cell_to_world_position(cell + step) - hf_.cell_to_world_position(cell));
+}
+
+template<class T>
+std::vector<typename heightfield_flow_field<T>::cell_t> heightfield_flow_field<T>::build_path(cell_t const &from) const
+{
+	std::vector<cell_t> result;
+	if (!is_reachable(from)) return result;
+
+	for (cell_t cell = from; ; cell += direction_at(cell))
+	{
+		result.push_back(cell);
+		if (cell == goal_) break;
+	}
+
+	return result;
+}
+
+template<class T>
+bool heightfield_flow_field<T>::is_walkable(cell_t const &cell) const
+{
+	if (!obstacles_.empty() && obstacles_.find(cell) != obstacles_.end()) return false;
+
+	return hf_.path_score(cell, min_value_, goal_) >= 0;
+}
+
+template<class T>
+void heightfield_flow_field<T>::build()
+{
+	ncols_ = (int) hf_.ncols();
+	nrows_ = (int) hf_.nrows();
+	built_version_ = hf_.get_version();
+	built_ = true;
+
+	directions_.assign(size_t(ncols_) * size_t(nrows_), UNREACHABLE);
+
+	// blocked goal is watched too, so field is rebuilt when it becomes walkable
+	col0_ = col1_ = goal_.x;
+	row0_ = row1_ = goal_.y;
+
+	if (!is_walkable(goal_)) return;
+
+	// cache passes arrays it owns to all its fields, so they grow to heightfield size once and
+	// every later build or rebuild of its fields reuses them; standalone field sweeps in its own
+	heightfield_flow_field_sweep own_sweep;
+	heightfield_flow_field_sweep &sweep = sweep_ ? *sweep_ : own_sweep;
+
+	std::vector<boost::uint32_t> &distances = sweep.distances;
+	std::vector<boost::uint32_t> &queue = sweep.queue;
+
+	distances.assign(directions_.size(), NOT_REACHED);
+	queue.clear();
+
+	boost::uint32_t const goal = boost::uint32_t(goal_.y * ncols_ + goal_.x);
+	distances[goal] = 0;
+	queue.push_back(goal);
+
+	// all moves cost the same, so breadth first order is order of dijkstra search
+	for (size_t q = 0; q < queue.size(); ++q)
+	{
+		boost::uint32_t const index = queue[q];
+		cell_t const cell(int(index) % ncols_, int(index) / ncols_);
+
+		for (int d = 0; d < 8; ++d)
+		{
+			cell_t const n(cell.x + GRID_DIRECTIONS[d][0], cell.y + GRID_DIRECTIONS[d][1]);
+			if (!is_inside(n)) continue;
+
+			boost::uint32_t const n_index = boost::uint32_t(n.y * ncols_ + n.x);
+			if (distances[n_index] != NOT_REACHED || !is_walkable(n)) continue;
+
+			distances[n_index] = distances[index] + 1;
+			queue.push_back(n_index);
+
+			col0_ = std::min(col0_, n.x);
+			row0_ = std::min(row0_, n.y);
+			col1_ = std::max(col1_, n.x);
+			row1_ = std::max(row1_, n.y);
+		}
+	}
+
+	directions_[goal] = GOAL;
+
+	for (size_t q = 1; q < queue.size(); ++q)
+	{
+		boost::uint32_t const index = queue[q];
+		cell_t const cell(int(index) % ncols_, int(index) / ncols_);
+
+		int best_direction = -1;
+		int best_length_sq = 0;
+
+		for (int d = 0; d < 8; ++d)
+		{
+			cell_t const n(cell.x + GRID_DIRECTIONS[d][0], cell.y + GRID_DIRECTIONS[d][1]);
+			if (!is_inside(n) || distances[n.y * ncols_ + n.x] + 1 != distances[index]) continue;
+
+			int const length_sq = (n - goal_).length_sq();
+
+			if (best_direction < 0 || length_sq < best_length_sq)
+			{
+				best_direction = d;
+				best_length_sq = length_sq;
+			}
+		}
+
+		directions_[index] = boost::uint8_t(best_direction);
+	}
+}
+
+template<class T>
+heightfield_flow_field_cache<T>::heightfield_flow_field_cache(heightfield<T> const &hf, size_t max_fields):
+	hf_(hf),
+	max_fields_(max_fields)
+{
+}
+
+template<class T>
+heightfield_flow_field_cache<T>::~heightfield_flow_field_cache()
+{
+}
+
+template<class T>
+typename heightfield_flow_field_cache<T>::field_ptr heightfield_flow_field_cache<T>::get(cell_t const &goal, value_t min_value)
+{
+	for (typename std::list<mutable_field_ptr>::iterator it = fields_.begin(); it != fields_.end(); ++it)
+	{
+		if ((*it)->get_goal() == goal && (*it)->get_min_value() == min_value)
+		{
+			fields_.splice(fields_.begin(), fields_, it);
+			fields_.front()->update();
+			return fields_.front();
+		}
+	}
+
+	fields_.push_front(mutable_field_ptr(new heightfield_flow_field<T>(hf_, goal, min_value, std::vector<cell_t>(), &sweep_)));
+	if (fields_.size() > max_fields_) fields_.pop_back();
+
+	return fields_.front();
+}
+
+template<class T>
+typename heightfield_flow_field_cache<T>::field_ptr heightfield_flow_field_cache<T>::get(vec<3> const &goal, value_t min_value)
+{
+	return get(hf_.world_position_to_cell(goal), min_value);
+}
+
+template<class T>
+void heightfield_flow_field_cache<T>::invalidate(int col0, int row0, int col1, int row1)
+{
+	for (typename std::list<mutable_field_ptr>::iterator it = fields_.begin(); it != fields_.end(); ++it)
+	{
+		(*it)->invalidate(col0, row0, col1, row1);
+	}
+}
+
+template<class T>
+void heightfield_flow_field_cache<T>::clear()
+{
+	fields_.clear();
+}
+
+template class heightfield_flow_field<boost::uint8_t>;
+template class heightfield_flow_field<boost::uint16_t>;
+template class heightfield_flow_field<scalar>;
+
+template class heightfield_flow_field_cache<boost::uint8_t>;
+template class heightfield_flow_field_cache<boost::uint16_t>;
+template class heightfield_flow_field_cache<scalar>;
+
+}
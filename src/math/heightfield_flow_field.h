@@ -0,0 +1,113 @@
+#pragma once
+
+#include <list>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_set.hpp>
+#include "heightfield.h"
+#include "grid.h"
+
+namespace math
+{
+
+// Arrays of breadth first sweep, as large as heightfield. Kept between builds, so rebuilding
+// fields does not allocate them again.
+struct heightfield_flow_field_sweep {
+	std::vector<boost::uint32_t> distances;
+	std::vector<boost::uint32_t> queue;
+};
+
+// Directions towards single goal for every heightfield cell, so any number of agents going to
+// same place could follow it instead of searching for paths. Field is built with one breadth
+// first sweep from goal using same walkability rules and unit cost moves as build_path, so
+// following it gives paths with same number of steps as build_path would find. Among equally
+// short moves the one closest to goal is chosen. Only one byte per cell is kept, search arrays
+// are given by owner of field, fields of one cache share its arrays.
+//
+// Field remembers heightfield version it was built at and region it covers, update() rebuilds
+// it when heights in this region were changed, invalidate() could be used when something
+// else affecting walkability has changed.
+template<class T>
+class heightfield_flow_field: public boost::noncopyable {
+public:
+	typedef typename heightfield<T>::cell_t cell_t;
+	typedef typename heightfield<T>::value_t value_t;
+
+	// field without sweep arrays allocates its own for every build; given arrays have to outlive
+	// field or its last update()
+	heightfield_flow_field(heightfield<T> const &hf, cell_t const &goal, value_t min_value,
+		std::vector<cell_t> const &obstacles = std::vector<cell_t>(), heightfield_flow_field_sweep *sweep = 0);
+	~heightfield_flow_field();
+
+	cell_t const &get_goal() const { return goal_; }
+	value_t get_min_value() const { return min_value_; }
+
+	// returns true when field was rebuilt
+	bool update();
+	bool is_valid() const;
+	void invalidate(int col0, int row0, int col1, int row1);
+	void invalidate();
+
+	bool is_reachable(cell_t const &cell) const;
+	// step to next cell, zero for goal and cells goal could not be reached from
+	cell_t direction_at(cell_t const &cell) const;
+	// normalized direction in world space
+	vec<3> direction_at(vec<3> const &position) const;
+	std::vector<cell_t> build_path(cell_t const &from) const;
+
+private:
+	// values of directions_ which are not indices of neighbours
+	static boost::uint8_t const GOAL = 8;
+	static boost::uint8_t const UNREACHABLE = 0xff;
+
+	heightfield<T> const &hf_;
+	cell_t const goal_;
+	value_t const min_value_;
+	boost::unordered_set<cell_t, cell_hash> obstacles_;
+	heightfield_flow_field_sweep *sweep_;
+
+	bool built_;
+	boost::uint32_t built_version_;
+	int ncols_, nrows_;
+	// cells reached by sweep
+	int col0_, row0_, col1_, row1_;
+	std::vector<boost::uint8_t> directions_;
+
+	bool is_walkable(cell_t const &cell) const;
+	bool is_inside(cell_t const &cell) const { return cell.x >= 0 && cell.y >= 0 && cell.x < ncols_ && cell.y < nrows_; }
+	void build();
+};
+
+// Flow fields kept for most recently requested goals. Fields are updated when they are
+// requested, so those covering changed parts of heightfield are rebuilt lazily.
+template<class T>
+class heightfield_flow_field_cache: public boost::noncopyable {
+public:
+	typedef typename heightfield<T>::cell_t cell_t;
+	typedef typename heightfield<T>::value_t value_t;
+	typedef boost::shared_ptr<heightfield_flow_field<T> const> field_ptr;
+
+	heightfield_flow_field_cache(heightfield<T> const &hf, size_t max_fields);
+	~heightfield_flow_field_cache();
+
+	field_ptr get(cell_t const &goal, value_t min_value);
+	field_ptr get(vec<3> const &goal, value_t min_value);
+
+	void invalidate(int col0, int row0, int col1, int row1);
+	void clear();
+	size_t size() const { return fields_.size(); }
+
+private:
+	typedef boost::shared_ptr<heightfield_flow_field<T> > mutable_field_ptr;
+
+	heightfield<T> const &hf_;
+	size_t const max_fields_;
+	// most recently used first
+	std::list<mutable_field_ptr> fields_;
+	// fields are built and updated only by cache, one at a time
+	heightfield_flow_field_sweep sweep_;
+};
+
+}
@@ -0,0 +1,584 @@
+
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <boost/cstdint.hpp>
+#include "grid.h"
+#include "heightfield_path_graph.h"
+
+namespace math
+{
+
+namespace
+{
+// entrances shorter than this get single transition in the middle, longer ones get two at the ends
+int const LONG_ENTRANCE = 6;
+
+// cluster offsets of heightfield_path_graph::side_t, transitions to other four sides are kept by
+// neighbours on those sides
+int const SIDE_OFFSETS[4][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { -1, 1 } };
+
+// inflated heuristic keeps abstract search from expanding every node of wide band of equal cost
+// ones unit cost moves give, paths over graph are at most this many times longer than shortest
+scalar const HEURISTIC_WEIGHT = 1.2f;
+
+}
+
+template<class T>
+heightfield_path_graph<T>::heightfield_path_graph(heightfield<T> const &hf, value_t min_value, int cluster_size):
+	hf_(hf),
+	min_value_(min_value),
+	cluster_size_(cluster_size),
+	ncols_(0),
+	nrows_(0),
+	cluster_ncols_(0),
+	cluster_nrows_(0),
+	built_version_(0),
+	generation_(0)
+{
+	bfs_distances_.resize(cluster_size * cluster_size);
+	bfs_came_from_.resize(cluster_size * cluster_size);
+
+	update();
+}
+
+template<class T>
+heightfield_path_graph<T>::~heightfield_path_graph()
+{
+}
+
+template<class T>
+size_t heightfield_path_graph<T>::update()
+{
+	bool resized = resize_clusters();
+	if (!resized && hf_.get_version() == built_version_) return 0;
+
+	size_t const n = clusters_.size();
+	std::vector<char> changed(n), rebuild(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		changed[i] = rebuild[i] = is_cluster_changed(int(i));
+	}
+
+	std::vector<transition_t> transitions;
+
+	for (int i = 0; i < (int) n; ++i)
+	{
+		for (int side = 0; side < NSIDES; ++side)
+		{
+			std::vector<transition_t> &current = clusters_[i].transitions[side];
+			int const dx = SIDE_OFFSETS[side][0], dy = SIDE_OFFSETS[side][1];
+			int const neighbour = neighbour_index(i, dx, dy);
+
+			if (neighbour < 0)
+			{
+				if (!current.empty())
+				{
+					current.clear();
+					rebuild[i] = 1;
+				}
+
+				continue;
+			}
+
+			// diagonal transitions depend on cells of clusters sharing the corner too
+			if (!changed[i] && !changed[neighbour] && !changed[neighbour_index(i, dx, 0)] && !changed[neighbour_index(i, 0, dy)]) continue;
+
+			build_transitions(i, side_t(side), transitions);
+
+			if (transitions != current)
+			{
+				current.swap(transitions);
+				rebuild[i] = rebuild[neighbour] = 1;
+			}
+		}
+	}
+
+	size_t nrebuilt = 0;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!rebuild[i]) continue;
+
+		build_cluster(int(i));
+		++nrebuilt;
+	}
+
+	// ids of nodes follow order of clusters
+	if (nrebuilt > 0 || resized)
+	{
+		node_clusters_.clear();
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			clusters_[i].first_node = (int) node_clusters_.size();
+			node_clusters_.insert(node_clusters_.end(), clusters_[i].nodes.size(), int(i));
+		}
+	}
+
+	built_version_ = hf_.get_version();
+
+	return nrebuilt;
+}
+
+template<class T>
+std::vector<typename heightfield_path_graph<T>::cell_t>
+heightfield_path_graph<T>::build_path(vec<3> const &from, vec<3> const &to, bool refine)
+{
+	return build_path(hf_.world_position_to_cell(from), hf_.world_position_to_cell(to), refine);
+}
+
+template<class T>
+std::vector<typename heightfield_path_graph<T>::cell_t>
+heightfield_path_graph<T>::build_path(cell_t const &from, cell_t const &to, bool refine)
+{
+	update();
+
+	std::vector<cell_t> result;
+
+	if (!is_walkable(from) || !is_walkable(to)) return result;
+
+	if (from == to)
+	{
+		result.push_back(from);
+		return result;
+	}
+
+	int const start_cluster = cluster_index_of(from);
+	int const goal_cluster = cluster_index_of(to);
+	cluster const &sc = clusters_[start_cluster];
+	cluster const &gc = clusters_[goal_cluster];
+
+	search_cluster(start_cluster, from);
+
+	std::vector<scalar> start_distances(sc.nodes.size());
+	for (size_t i = 0; i < sc.nodes.size(); ++i) start_distances[i] = scalar(bfs_distance(start_cluster, sc.nodes[i]));
+
+	scalar const direct_distance = start_cluster == goal_cluster ? scalar(bfs_distance(start_cluster, to)) : -1;
+
+	search_cluster(goal_cluster, to);
+
+	std::vector<scalar> goal_distances(gc.nodes.size());
+	for (size_t i = 0; i < gc.nodes.size(); ++i) goal_distances[i] = scalar(bfs_distance(goal_cluster, gc.nodes[i]));
+
+	// A* over entrance nodes, start and goal get ids after nodes of all clusters and are connected
+	// to nodes of their clusters
+	int const start_id = (int) node_clusters_.size(), goal_id = start_id + 1;
+
+	records_.resize(node_clusters_.size() + 2);
+
+	if (++generation_ == 0)
+	{
+		for (size_t i = 0; i < records_.size(); ++i) records_[i].generation = 0;
+		generation_ = 1;
+	}
+
+	open_.clear();
+	std::vector<std::pair<int, scalar> > edges;
+
+	search_record &start_record = records_[start_id];
+	start_record.cost = 0;
+	start_record.came_from = start_id;
+	start_record.generation = generation_;
+	start_record.closed = false;
+	open_.push_back(open_entry(0, 0, start_id));
+
+	bool found = false;
+
+	while (!open_.empty())
+	{
+		int const id = open_.front().id;
+		std::pop_heap(open_.begin(), open_.end(), std::greater<open_entry>());
+		open_.pop_back();
+
+		search_record &r = records_[id];
+		if (r.closed) continue;
+		r.closed = true;
+
+		if (id == goal_id)
+		{
+			found = true;
+			break;
+		}
+
+		edges.clear();
+
+		if (id == start_id)
+		{
+			for (size_t i = 0; i < sc.nodes.size(); ++i)
+			{
+				if (start_distances[i] >= 0) edges.push_back(std::make_pair(sc.first_node + int(i), start_distances[i]));
+			}
+
+			if (direct_distance >= 0) edges.push_back(std::make_pair(goal_id, direct_distance));
+		}
+		else
+		{
+			int const ci = node_clusters_[id];
+			cluster const &c = clusters_[ci];
+			int const i = id - c.first_node;
+			size_t const nnodes = c.nodes.size();
+
+			for (size_t j = 0; j < nnodes; ++j)
+			{
+				scalar d = c.distances[i * nnodes + j];
+				if (int(j) != i && d >= 0) edges.push_back(std::make_pair(c.first_node + int(j), d));
+			}
+
+			for (size_t j = 0; j < c.partners[i].size(); ++j)
+			{
+				cluster const &pc = clusters_[cluster_index_of(c.partners[i][j])];
+				edges.push_back(std::make_pair(pc.first_node + find_node(pc, c.partners[i][j]), scalar(1)));
+			}
+
+			if (ci == goal_cluster && goal_distances[i] >= 0) edges.push_back(std::make_pair(goal_id, goal_distances[i]));
+		}
+
+		scalar const best_cost = r.cost;
+
+		for (size_t e = 0; e < edges.size(); ++e)
+		{
+			int const n = edges[e].first;
+			scalar const n_cost = best_cost + edges[e].second;
+			search_record &nr = records_[n];
+
+			if (nr.generation != generation_)
+			{
+				nr.generation = generation_;
+				nr.closed = false;
+			}
+			else if (nr.closed || nr.cost <= n_cost)
+			{
+				continue;
+			}
+
+			nr.cost = n_cost;
+			nr.came_from = id;
+
+			cell_t const nc = node_cell(n, from, to);
+			scalar const heuristic = scalar(std::max(abs(nc.x - to.x), abs(nc.y - to.y)));
+			open_.push_back(open_entry(n_cost + heuristic * HEURISTIC_WEIGHT, heuristic, n));
+			std::push_heap(open_.begin(), open_.end(), std::greater<open_entry>());
+		}
+	}
+
+	// every move between clusters has its transition, so start and goal are not connected at all
+	if (!found) return result;
+
+	std::vector<cell_t> waypoints;
+
+	for (int id = goal_id; ; id = records_[id].came_from)
+	{
+		waypoints.push_back(node_cell(id, from, to));
+		if (id == start_id) break;
+	}
+
+	std::reverse(waypoints.begin(), waypoints.end());
+
+	if (!refine) return waypoints;
+
+	result.push_back(from);
+
+	for (size_t i = 1; i < waypoints.size(); ++i)
+	{
+		int const ci = cluster_index_of(waypoints[i - 1]);
+
+		if (ci == cluster_index_of(waypoints[i]))
+		{
+			append_cluster_path(ci, waypoints[i - 1], waypoints[i], result);
+		}
+		else
+		{
+			result.push_back(waypoints[i]);
+		}
+	}
+
+	return result;
+}
+
+template<class T>
+typename heightfield_path_graph<T>::cell_t heightfield_path_graph<T>::node_cell(int id, cell_t const &from, cell_t const &to) const
+{
+	int const n = (int) node_clusters_.size();
+	if (id >= n) return id == n ? from : to;
+
+	cluster const &c = clusters_[node_clusters_[id]];
+	return c.nodes[id - c.first_node];
+}
+
+template<class T>
+bool heightfield_path_graph<T>::is_walkable(cell_t const &c) const
+{
+	return is_inside(c) && hf_.max_y_in_cell(c.x, c.y) < scalar(min_value_);
+}
+
+template<class T>
+bool heightfield_path_graph<T>::is_cluster_changed(int index) const
+{
+	if (!clusters_[index].built) return true;
+
+	// cells of cluster depend on one more column and row of vertices
+	cell_t const o = cluster_origin(index);
+	return hf_.get_region_version(o.x, o.y, o.x + cluster_size_, o.y + cluster_size_) > built_version_;
+}
+
+template<class T>
+int heightfield_path_graph<T>::neighbour_index(int index, int dx, int dy) const
+{
+	int const cx = index % cluster_ncols_ + dx, cy = index / cluster_ncols_ + dy;
+	if (cx < 0 || cy < 0 || cx >= cluster_ncols_ || cy >= cluster_nrows_) return -1;
+
+	return cy * cluster_ncols_ + cx;
+}
+
+template<class T>
+bool heightfield_path_graph<T>::is_diagonal_only(cell_t const &a, cell_t const &b) const
+{
+	return is_walkable(a) && is_walkable(b) && !is_walkable(cell_t(a.x, b.y)) && !is_walkable(cell_t(b.x, a.y));
+}
+
+template<class T>
+bool heightfield_path_graph<T>::resize_clusters()
+{
+	int const ncols = (int) hf_.ncols();
+	int const nrows = (int) hf_.nrows();
+
+	if (ncols == ncols_ && nrows == nrows_) return false;
+
+	int const cluster_ncols = (ncols + cluster_size_ - 1) / cluster_size_;
+	int const cluster_nrows = (nrows + cluster_size_ - 1) / cluster_size_;
+
+	std::vector<cluster> clusters(cluster_ncols * cluster_nrows);
+
+	for (int cy = 0, ny = std::min(cluster_nrows, cluster_nrows_); cy < ny; ++cy)
+	{
+		for (int cx = 0, nx = std::min(cluster_ncols, cluster_ncols_); cx < nx; ++cx)
+		{
+			std::swap(clusters[cy * cluster_ncols + cx], clusters_[cy * cluster_ncols_ + cx]);
+		}
+	}
+
+	clusters_.swap(clusters);
+	ncols_ = ncols;
+	nrows_ = nrows;
+	cluster_ncols_ = cluster_ncols;
+	cluster_nrows_ = cluster_nrows;
+
+	return true;
+}
+
+template<class T>
+void heightfield_path_graph<T>::build_transitions(int index, side_t side, std::vector<transition_t> &transitions) const
+{
+	transitions.clear();
+
+	cell_t const o = cluster_origin(index);
+
+	// corner cell of this cluster is diagonal neighbour of corner cell of other one
+	if (side == SOUTH_EAST || side == SOUTH_WEST)
+	{
+		cell_t const corner(side == SOUTH_EAST ? o.x + cluster_size_ - 1 : o.x, o.y + cluster_size_ - 1);
+		cell_t const partner(corner.x + SIDE_OFFSETS[side][0], corner.y + 1);
+
+		if (is_diagonal_only(corner, partner)) transitions.push_back(transition_t(corner, partner));
+		return;
+	}
+
+	bool const east = side == EAST;
+
+	// border cell of this cluster is at (fixed, i) or (i, fixed), partner is next one across border
+	int const fixed = east ? o.x + cluster_size_ - 1 : o.y + cluster_size_ - 1;
+	int const begin = east ? o.y : o.x;
+	int const end = std::min(begin + cluster_size_, east ? nrows_ : ncols_);
+
+	struct local
+	{
+		static transition_t make(bool east, int fixed, int i)
+		{
+			return east ? transition_t(cell_t(fixed, i), cell_t(fixed + 1, i)) : transition_t(cell_t(i, fixed), cell_t(i, fixed + 1));
+		}
+	};
+
+	int run_begin = -1;
+
+	for (int i = begin; i <= end; ++i)
+	{
+		bool open = false;
+
+		if (i < end)
+		{
+			transition_t t = local::make(east, fixed, i);
+			open = is_walkable(t.first) && is_walkable(t.second);
+		}
+
+		if (open && run_begin < 0) run_begin = i;
+		if (open || run_begin < 0) continue;
+
+		int const run_end = i - 1;
+
+		if (run_end - run_begin + 1 < LONG_ENTRANCE)
+		{
+			transitions.push_back(local::make(east, fixed, (run_begin + run_end) / 2));
+		}
+		else
+		{
+			transitions.push_back(local::make(east, fixed, run_begin));
+			transitions.push_back(local::make(east, fixed, run_end));
+		}
+
+		run_begin = -1;
+	}
+
+	// diagonal moves next to open straight transition are covered by its run
+	for (int i = begin; i + 1 < end; ++i)
+	{
+		transition_t const t0 = local::make(east, fixed, i), t1 = local::make(east, fixed, i + 1);
+
+		if (is_diagonal_only(t0.first, t1.second)) transitions.push_back(transition_t(t0.first, t1.second));
+		if (is_diagonal_only(t1.first, t0.second)) transitions.push_back(transition_t(t1.first, t0.second));
+	}
+}
+
+template<class T>
+void heightfield_path_graph<T>::build_cluster(int index)
+{
+	cluster &c = clusters_[index];
+
+	c.nodes.clear();
+	c.partners.clear();
+
+	struct local
+	{
+		static void add(heightfield_path_graph const *graph, cluster &c, cell_t const &node, cell_t const &partner)
+		{
+			int i = graph->find_node(c, node);
+
+			if (i < 0)
+			{
+				i = (int) c.nodes.size();
+				c.nodes.push_back(node);
+				c.partners.push_back(std::vector<cell_t>());
+			}
+
+			c.partners[i].push_back(partner);
+		}
+	};
+
+	for (int side = 0; side < NSIDES; ++side)
+	{
+		std::vector<transition_t> const &own = c.transitions[side];
+		for (size_t i = 0; i < own.size(); ++i) local::add(this, c, own[i].first, own[i].second);
+
+		int const opposite = neighbour_index(index, -SIDE_OFFSETS[side][0], -SIDE_OFFSETS[side][1]);
+		if (opposite < 0) continue;
+
+		std::vector<transition_t> const &other = clusters_[opposite].transitions[side];
+		for (size_t i = 0; i < other.size(); ++i) local::add(this, c, other[i].second, other[i].first);
+	}
+
+	size_t const n = c.nodes.size();
+	c.distances.assign(n * n, -1);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		search_cluster(index, c.nodes[i]);
+
+		for (size_t j = 0; j < n; ++j)
+		{
+			c.distances[i * n + j] = scalar(bfs_distance(index, c.nodes[j]));
+		}
+	}
+
+	c.built = true;
+}
+
+template<class T>
+void heightfield_path_graph<T>::search_cluster(int index, cell_t const &from, cell_t const *stop)
+{
+	cell_t const o = cluster_origin(index);
+	int const width = std::min(cluster_size_, ncols_ - o.x);
+	int const height = std::min(cluster_size_, nrows_ - o.y);
+
+	std::fill(bfs_distances_.begin(), bfs_distances_.end(), -1);
+	bfs_queue_.clear();
+
+	int const first = (from.y - o.y) * cluster_size_ + (from.x - o.x);
+	int const last = stop ? (stop->y - o.y) * cluster_size_ + (stop->x - o.x) : -1;
+	bfs_distances_[first] = 0;
+	bfs_queue_.push_back(first);
+
+	for (size_t q = 0; q < bfs_queue_.size(); ++q)
+	{
+		int const li = bfs_queue_[q];
+		int const x = li % cluster_size_, y = li / cluster_size_;
+
+		for (int d = 0; d < 8; ++d)
+		{
+			int const nx = x + GRID_DIRECTIONS[d][0], ny = y + GRID_DIRECTIONS[d][1];
+			if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+
+			int const ni = ny * cluster_size_ + nx;
+			if (bfs_distances_[ni] >= 0) continue;
+
+			// blocked cells are marked as visited so scorer is not called for them twice
+			if (!is_walkable(cell_t(o.x + nx, o.y + ny)))
+			{
+				bfs_distances_[ni] = -2;
+				continue;
+			}
+
+			bfs_distances_[ni] = bfs_distances_[li] + 1;
+			bfs_came_from_[ni] = boost::uint8_t(d);
+			bfs_queue_.push_back(ni);
+
+			if (ni == last) return;
+		}
+	}
+}
+
+template<class T>
+int heightfield_path_graph<T>::bfs_distance(int index, cell_t const &c) const
+{
+	cell_t const o = cluster_origin(index);
+	int const d = bfs_distances_[(c.y - o.y) * cluster_size_ + (c.x - o.x)];
+	return d >= 0 ? d : -1;
+}
+
+template<class T>
+void heightfield_path_graph<T>::append_cluster_path(int index, cell_t const &from, cell_t const &to, std::vector<cell_t> &path)
+{
+	search_cluster(index, from, &to);
+
+	size_t const first = path.size();
+	cell_t current = to;
+
+	while (current != from)
+	{
+		path.push_back(current);
+
+		cell_t const o = cluster_origin(index);
+		int const *d = GRID_DIRECTIONS[bfs_came_from_[(current.y - o.y) * cluster_size_ + (current.x - o.x)]];
+		current.x -= d[0];
+		current.y -= d[1];
+	}
+
+	std::reverse(path.begin() + first, path.end());
+}
+
+template<class T>
+int heightfield_path_graph<T>::find_node(cluster const &c, cell_t const &cell) const
+{
+	for (size_t i = 0; i < c.nodes.size(); ++i)
+	{
+		if (c.nodes[i] == cell) return int(i);
+	}
+
+	return -1;
+}
+
+template class heightfield_path_graph<boost::uint8_t>;
+template class heightfield_path_graph<boost::uint16_t>;
+template class heightfield_path_graph<scalar>;
+
+}
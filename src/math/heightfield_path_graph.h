@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include "heightfield.h"
+
+namespace math
+{
+
+// Hierarchical path finding (HPA*) over heightfield cells with max_y_in_cell() < min_value.
+//
+// Cells are partitioned into square clusters, walkable cells on both sides of cluster borders
+// become entrance nodes and distances between nodes of every cluster are precomputed. Long
+// paths are searched over this graph and then refined cluster by cluster. Graph is updated
+// lazily: heightfield region versions are compared with version graph was built at, so only
+// clusters touched by edits (and neighbours whose entrances changed) are rebuilt. Paths have
+// same 8-connected unit cost moves as heightfield::build_path but could be slightly longer than
+// optimal ones. Diagonal moves across borders or cluster corners which could not be replaced by
+// two straight moves become entrances too, so graph search fails only when there is no path at all.
+template<class T>
+class heightfield_path_graph: public boost::noncopyable {
+public:
+	typedef typename heightfield<T>::cell_t cell_t;
+	typedef typename heightfield<T>::value_t value_t;
+
+	heightfield_path_graph(heightfield<T> const &hf, value_t min_value, int cluster_size = 32);
+	~heightfield_path_graph();
+
+	// rebuilds clusters changed since last update, returns number of rebuilt clusters
+	size_t update();
+
+	// without refining only entrance nodes path goes through are returned, consecutive points
+	// of such path could be connected with heightfield::build_path when needed
+	std::vector<cell_t> build_path(vec<3> const &from, vec<3> const &to, bool refine = true);
+	std::vector<cell_t> build_path(cell_t const &from, cell_t const &to, bool refine = true);
+
+	int cluster_size() const { return cluster_size_; }
+	size_t nclusters() const { return clusters_.size(); }
+	size_t nnodes() const { return node_clusters_.size(); }
+
+private:
+	typedef std::pair<cell_t, cell_t> transition_t;
+
+	enum side_t { EAST, SOUTH, SOUTH_EAST, SOUTH_WEST, NSIDES };
+
+	struct search_record
+	{
+		scalar cost;
+		int came_from;
+		boost::uint32_t generation;
+		bool closed;
+	};
+
+	struct open_entry
+	{
+		scalar total_cost, heuristic_cost;
+		int id;
+
+		open_entry(scalar total_cost, scalar heuristic_cost, int id): total_cost(total_cost), heuristic_cost(heuristic_cost), id(id) {}
+
+		// unit cost moves give many equal total costs, nodes closer to goal are expanded first then
+		bool operator >(open_entry const &rhs) const
+		{
+			return total_cost > rhs.total_cost || (total_cost == rhs.total_cost && heuristic_cost > rhs.heuristic_cost);
+		}
+	};
+
+	struct cluster
+	{
+		bool built;
+		std::vector<cell_t> nodes;
+		// for every node transition cells in neighbour clusters
+		std::vector<std::vector<cell_t> > partners;
+		// nodes.size() x nodes.size(), negative for nodes not connected inside cluster
+		std::vector<scalar> distances;
+		// transitions to clusters on the right, below and diagonally below, indexed by side_t
+		std::vector<transition_t> transitions[NSIDES];
+
+		// id of first node, nodes of clusters are numbered in order of clusters
+		int first_node;
+
+		cluster(): built(false), first_node(0) {}
+	};
+
+	heightfield<T> const &hf_;
+	value_t const min_value_;
+	int const cluster_size_;
+
+	int ncols_, nrows_;
+	int cluster_ncols_, cluster_nrows_;
+	boost::uint32_t built_version_;
+	std::vector<cluster> clusters_;
+
+	// cluster of every node id
+	std::vector<int> node_clusters_;
+
+	// scratch memory of abstract search, records are valid when their generation is current one
+	std::vector<search_record> records_;
+	std::vector<open_entry> open_;
+	boost::uint32_t generation_;
+
+	// scratch memory of cluster breadth first search
+	std::vector<int> bfs_distances_;
+	std::vector<boost::uint8_t> bfs_came_from_;
+	std::vector<int> bfs_queue_;
+
+	bool is_walkable(cell_t const &c) const;
+	bool is_inside(cell_t const &c) const { return c.x >= 0 && c.y >= 0 && c.x < ncols_ && c.y < nrows_; }
+	int cluster_index_of(cell_t const &c) const { return (c.y / cluster_size_) * cluster_ncols_ + c.x / cluster_size_; }
+	cell_t cluster_origin(int index) const { return cell_t((index % cluster_ncols_) * cluster_size_, (index / cluster_ncols_) * cluster_size_); }
+	bool is_cluster_changed(int index) const;
+	// -1 when there is no cluster at offset
+	int neighbour_index(int index, int dx, int dy) const;
+	// diagonal move from a to b which could not be replaced by two straight moves
+	bool is_diagonal_only(cell_t const &a, cell_t const &b) const;
+
+	bool resize_clusters();
+	void build_transitions(int index, side_t side, std::vector<transition_t> &transitions) const;
+	void build_cluster(int index);
+
+	// breadth first search from cell, distances of cells not reached are negative, when stop is
+	// given search ends as soon as it is reached
+	void search_cluster(int index, cell_t const &from, cell_t const *stop = 0);
+	int bfs_distance(int index, cell_t const &c) const;
+	void append_cluster_path(int index, cell_t const &from, cell_t const &to, std::vector<cell_t> &path);
+
+	int find_node(cluster const &c, cell_t const &cell) const;
+	// start and goal have ids following ones of nodes
+	cell_t node_cell(int id, cell_t const &from, cell_t const &to) const;
+};
+
+}
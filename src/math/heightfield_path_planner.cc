@@ -0,0 +1,419 @@
+
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+#include "grid.h"
+#include "heightfield_path_planner.h"
+
+namespace math
+{
+
+namespace
+{
+scalar const INFINITE_COST = std::numeric_limits<scalar>::infinity();
+}
+
+template<class T>
+heightfield_path_planner<T>::heightfield_path_planner(heightfield<T> const &hf, value_t min_value):
+	hf_(hf),
+	min_value_(min_value),
+	ncols_(0),
+	nrows_(0),
+	key_modifier_(0),
+	seen_version_(0),
+	expanded_points_(0),
+	planned_(false),
+	page_cols_(0),
+	pages_used_(0)
+{
+}
+
+template<class T>
+heightfield_path_planner<T>::~heightfield_path_planner()
+{
+}
+
+template<class T>
+void heightfield_path_planner<T>::plan(cell_t const &start, cell_t const &goal)
+{
+	start_ = last_start_ = start;
+	goal_ = goal;
+	key_modifier_ = 0;
+	expanded_points_ = 0;
+	planned_ = true;
+
+	reset();
+}
+
+template<class T>
+void heightfield_path_planner<T>::plan(vec<3> const &start, vec<3> const &goal)
+{
+	plan(hf_.world_position_to_cell(start), hf_.world_position_to_cell(goal));
+}
+
+template<class T>
+void heightfield_path_planner<T>::add_obstacle(cell_t const &cell)
+{
+	if (!planned_ || !is_inside(cell)) return;
+
+	boost::uint8_t &cell_state = state(index_of(cell));
+	if (cell_state & OBSTACLE) return;
+
+	cell_state |= OBSTACLE;
+	update_around(cell);
+}
+
+template<class T>
+void heightfield_path_planner<T>::remove_obstacle(cell_t const &cell)
+{
+	if (!planned_ || !is_inside(cell)) return;
+
+	boost::uint8_t &cell_state = state(index_of(cell));
+	if (!(cell_state & OBSTACLE)) return;
+
+	cell_state &= ~OBSTACLE;
+	update_around(cell);
+}
+
+template<class T>
+void heightfield_path_planner<T>::move_start(cell_t const &start)
+{
+	// keys of queued cells were calculated with heuristic from previous start, instead of
+	// recalculating them all new keys are increased by distance start has moved
+	key_modifier_ += heuristic(last_start_, start);
+	last_start_ = start_ = start;
+}
+
+template<class T>
+std::vector<typename heightfield_path_planner<T>::cell_t> heightfield_path_planner<T>::build_path()
+{
+	std::vector<cell_t> result;
+	if (!planned_) return result;
+
+	check_heightfield();
+
+	if (!is_walkable(start_) || !is_walkable(goal_)) return result;
+
+	compute_shortest_path();
+
+	if (record(index_of(start_)).g == INFINITE_COST) return result;
+
+	cell_t cell = start_;
+	result.push_back(cell);
+
+	while (cell != goal_)
+	{
+		cell_t best;
+		scalar best_g = INFINITE_COST;
+
+		for (int d = 0; d < 8; ++d)
+		{
+			cell_t const n(cell.x + GRID_DIRECTIONS[d][0], cell.y + GRID_DIRECTIONS[d][1]);
+			if (!is_walkable(n)) continue;
+
+			scalar const g = record(index_of(n)).g;
+
+			if (g < best_g)
+			{
+				best = n;
+				best_g = g;
+			}
+		}
+
+		if (best_g == INFINITE_COST || result.size() > size_t(ncols_) * size_t(nrows_))
+		{
+			result.clear();
+			break;
+		}
+
+		cell = best;
+		result.push_back(cell);
+	}
+
+	return result;
+}
+
+template<class T>
+bool heightfield_path_planner<T>::is_walkable(cell_t const &c)
+{
+	if (!is_inside(c)) return false;
+
+	boost::uint8_t &cell_state = state(index_of(c));
+
+	if (!(cell_state & EVALUATED))
+	{
+		cell_state |= EVALUATED;
+		if (is_terrain_walkable(c)) cell_state |= WALKABLE;
+	}
+
+	return (cell_state & (WALKABLE | OBSTACLE)) == WALKABLE;
+}
+
+template<class T>
+bool heightfield_path_planner<T>::is_terrain_walkable(cell_t const &c) const
+{
+	return hf_.max_y_in_cell(c.x, c.y) < min_value_;
+}
+
+template<class T>
+scalar heightfield_path_planner<T>::heuristic(cell_t const &c1, cell_t const &c2) const
+{
+	return scalar(std::max(abs(c1.x - c2.x), abs(c1.y - c2.y)));
+}
+
+template<class T>
+typename heightfield_path_planner<T>::key_t heightfield_path_planner<T>::calculate_key(boost::uint32_t index)
+{
+	cell_record const &r = record(index);
+	scalar const g = std::min(r.g, r.rhs);
+
+	key_t key;
+	key.k1 = g + heuristic(start_, cell_of(index)) + key_modifier_;
+	key.k2 = g;
+	return key;
+}
+
+template<class T>
+typename heightfield_path_planner<T>::page &heightfield_path_planner<T>::page_of(boost::uint32_t index)
+{
+	int const col = int(index) % ncols_, row = int(index) / ncols_;
+	boost::uint32_t &position = page_index_[(row >> PAGE_SHIFT) * page_cols_ + (col >> PAGE_SHIFT)];
+
+	if (!position)
+	{
+		if (pages_used_ == pages_.size()) pages_.push_back(page());
+
+		cell_record r;
+		r.g = r.rhs = INFINITE_COST;
+		r.key.k1 = r.key.k2 = INFINITE_COST;
+
+		page &p = pages_[pages_used_++];
+		p.index = boost::uint32_t(&position - &page_index_[0]);
+		std::fill(p.records, p.records + PAGE_SIZE * PAGE_SIZE, r);
+		std::fill(p.state, p.state + PAGE_SIZE * PAGE_SIZE, 0);
+
+		position = boost::uint32_t(pages_used_);
+	}
+
+	return pages_[position - 1];
+}
+
+template<class T>
+typename heightfield_path_planner<T>::cell_record &heightfield_path_planner<T>::record(boost::uint32_t index)
+{
+	int const col = int(index) % ncols_, row = int(index) / ncols_;
+	return page_of(index).records[((row & (PAGE_SIZE - 1)) << PAGE_SHIFT) + (col & (PAGE_SIZE - 1))];
+}
+
+template<class T>
+boost::uint8_t &heightfield_path_planner<T>::state(boost::uint32_t index)
+{
+	int const col = int(index) % ncols_, row = int(index) / ncols_;
+	return page_of(index).state[((row & (PAGE_SIZE - 1)) << PAGE_SHIFT) + (col & (PAGE_SIZE - 1))];
+}
+
+template<class T>
+void heightfield_path_planner<T>::reset()
+{
+	if (ncols_ != (int) hf_.ncols() || nrows_ != (int) hf_.nrows())
+	{
+		ncols_ = (int) hf_.ncols();
+		nrows_ = (int) hf_.nrows();
+		page_cols_ = (ncols_ + PAGE_SIZE - 1) >> PAGE_SHIFT;
+		page_index_.assign(size_t(page_cols_) * size_t((nrows_ + PAGE_SIZE - 1) >> PAGE_SHIFT), 0);
+	}
+	else
+	{
+		// only pages touched by previous search are released, their storage is kept for new one
+		for (size_t i = 0; i < pages_used_; ++i) page_index_[pages_[i].index] = 0;
+	}
+
+	pages_used_ = 0;
+	seen_version_ = hf_.get_version();
+	open_ = std::priority_queue<heap_entry>();
+
+	if (!is_inside(goal_)) return;
+
+	boost::uint32_t const goal = index_of(goal_);
+	record(goal).rhs = 0;
+	update_vertex(goal);
+}
+
+template<class T>
+void heightfield_path_planner<T>::check_heightfield()
+{
+	if (ncols_ != (int) hf_.ncols() || nrows_ != (int) hf_.nrows())
+	{
+		std::vector<cell_t> obstacles;
+
+		for (size_t i = 0; i < pages_used_; ++i)
+		{
+			page const &p = pages_[i];
+			cell_t const origin((int(p.index) % page_cols_) << PAGE_SHIFT, (int(p.index) / page_cols_) << PAGE_SHIFT);
+
+			for (int j = 0; j < PAGE_SIZE * PAGE_SIZE; ++j)
+			{
+				if (p.state[j] & OBSTACLE) obstacles.push_back(origin + cell_t(j & (PAGE_SIZE - 1), j >> PAGE_SHIFT));
+			}
+		}
+
+		reset();
+
+		for (size_t i = 0; i < obstacles.size(); ++i)
+		{
+			if (is_inside(obstacles[i])) state(index_of(obstacles[i])) |= OBSTACLE;
+		}
+
+		return;
+	}
+
+	if (hf_.get_version() == seen_version_) return;
+
+	// pages added by updates below evaluate cells with current heights already
+	size_t const pages_count = pages_used_;
+
+	for (size_t i = 0; i < pages_count; ++i)
+	{
+		page &p = pages_[i];
+		int const col0 = (int(p.index) % page_cols_) << PAGE_SHIFT;
+		int const row0 = (int(p.index) / page_cols_) << PAGE_SHIFT;
+
+		// cells depend on vertices at their own and next column and row
+		if (hf_.get_region_version(col0, row0, col0 + PAGE_SIZE, row0 + PAGE_SIZE) <= seen_version_) continue;
+
+		for (int j = 0; j < PAGE_SIZE * PAGE_SIZE; ++j)
+		{
+			if (!(p.state[j] & EVALUATED)) continue;
+
+			cell_t const c(col0 + (j & (PAGE_SIZE - 1)), row0 + (j >> PAGE_SHIFT));
+			bool const walkable = is_terrain_walkable(c);
+			if (walkable == ((p.state[j] & WALKABLE) != 0)) continue;
+
+			p.state[j] ^= WALKABLE;
+			update_around(c);
+		}
+	}
+
+	seen_version_ = hf_.get_version();
+}
+
+template<class T>
+void heightfield_path_planner<T>::update_around(cell_t const &c)
+{
+	update_vertex(index_of(c));
+
+	for (int d = 0; d < 8; ++d)
+	{
+		cell_t const n(c.x + GRID_DIRECTIONS[d][0], c.y + GRID_DIRECTIONS[d][1]);
+		if (is_inside(n)) update_vertex(index_of(n));
+	}
+}
+
+template<class T>
+void heightfield_path_planner<T>::update_vertex(boost::uint32_t index)
+{
+	cell_record &r = record(index);
+	cell_t const c = cell_of(index);
+
+	if (c != goal_)
+	{
+		r.rhs = INFINITE_COST;
+
+		if (is_walkable(c))
+		{
+			for (int d = 0; d < 8; ++d)
+			{
+				cell_t const n(c.x + GRID_DIRECTIONS[d][0], c.y + GRID_DIRECTIONS[d][1]);
+				if (is_walkable(n)) r.rhs = std::min(r.rhs, record(index_of(n)).g + 1);
+			}
+		}
+	}
+
+	if (r.g != r.rhs)
+	{
+		heap_entry entry;
+		entry.key = r.key = calculate_key(index);
+		entry.index = index;
+		open_.push(entry);
+
+		state(index) |= OPEN;
+	}
+	else
+	{
+		state(index) &= ~OPEN;
+	}
+}
+
+template<class T>
+bool heightfield_path_planner<T>::top(heap_entry &entry)
+{
+	// cells are not removed from queue when their keys change, outdated entries are skipped here
+	while (!open_.empty())
+	{
+		heap_entry const &e = open_.top();
+
+		if ((state(e.index) & OPEN) && record(e.index).key == e.key)
+		{
+			entry = e;
+			return true;
+		}
+
+		open_.pop();
+	}
+
+	return false;
+}
+
+template<class T>
+void heightfield_path_planner<T>::compute_shortest_path()
+{
+	boost::uint32_t const start = index_of(start_);
+	heap_entry entry;
+
+	while (top(entry))
+	{
+		cell_record &start_record = record(start);
+		if (!(entry.key < calculate_key(start)) && start_record.rhs == start_record.g) break;
+
+		boost::uint32_t const index = entry.index;
+		cell_record &r = record(index);
+		key_t const new_key = calculate_key(index);
+
+		open_.pop();
+		++expanded_points_;
+
+		if (entry.key < new_key)
+		{
+			heap_entry updated;
+			updated.key = r.key = new_key;
+			updated.index = index;
+			open_.push(updated);
+			continue;
+		}
+
+		state(index) &= ~OPEN;
+		cell_t const c = cell_of(index);
+
+		if (r.g > r.rhs)
+		{
+			r.g = r.rhs;
+		}
+		else
+		{
+			r.g = INFINITE_COST;
+			update_vertex(index);
+		}
+
+		for (int d = 0; d < 8; ++d)
+		{
+			cell_t const n(c.x + GRID_DIRECTIONS[d][0], c.y + GRID_DIRECTIONS[d][1]);
+			if (is_inside(n)) update_vertex(index_of(n));
+		}
+	}
+}
+
+template class heightfield_path_planner<boost::uint8_t>;
+template class heightfield_path_planner<boost::uint16_t>;
+template class heightfield_path_planner<scalar>;
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <deque>
+#include <queue>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include "heightfield.h"
+
+namespace math
+{
+
+// Incremental path planner (D* Lite) for one agent over heightfield cells with max_y_in_cell()
+// < min_value. Search runs from goal towards start and is kept between calls, so when
+// obstacles are added or removed, heights are edited or agent moves along path only part of
+// search affected by these changes is repaired on next build_path(). Moves are 8-connected
+// with unit cost as in heightfield::build_path, so paths have minimal number of steps.
+//
+// Heights edits are found by heightfield region versions, obstacles are set with
+// add_obstacle() and remove_obstacle() and are kept until plan() is called again.
+//
+// Search state is kept in pages of PAGE_SIZE x PAGE_SIZE cells allocated when search first
+// touches them, so memory and plan() time depend on searched area, not on heightfield size.
+// Pages are reused by next plan() of same planner.
+template<class T>
+class heightfield_path_planner: public boost::noncopyable {
+public:
+	typedef typename heightfield<T>::cell_t cell_t;
+	typedef typename heightfield<T>::value_t value_t;
+
+	heightfield_path_planner(heightfield<T> const &hf, value_t min_value);
+	~heightfield_path_planner();
+
+	// starts new search, previous search state and obstacles are dropped
+	void plan(cell_t const &start, cell_t const &goal);
+	void plan(vec<3> const &start, vec<3> const &goal);
+
+	void add_obstacle(cell_t const &cell);
+	void remove_obstacle(cell_t const &cell);
+	// agent moved, usually to next cell of last path
+	void move_start(cell_t const &start);
+
+	// repairs search and returns path from start to goal, empty when goal could not be reached
+	std::vector<cell_t> build_path();
+
+	cell_t const &get_start() const { return start_; }
+	cell_t const &get_goal() const { return goal_; }
+	// points expanded by build_path() calls since plan()
+	size_t expanded_points() const { return expanded_points_; }
+
+private:
+	// page::state bits
+	enum { EVALUATED = 1, WALKABLE = 2, OBSTACLE = 4, OPEN = 8 };
+
+	static int const PAGE_SHIFT = 4;
+	static int const PAGE_SIZE = 1 << PAGE_SHIFT;
+
+	struct key_t
+	{
+		scalar k1, k2;
+
+		bool operator <(key_t const &rhs) const { return k1 < rhs.k1 || (k1 == rhs.k1 && k2 < rhs.k2); }
+		bool operator ==(key_t const &rhs) const { return k1 == rhs.k1 && k2 == rhs.k2; }
+	};
+
+	struct cell_record
+	{
+		scalar g, rhs;
+		key_t key;
+	};
+
+	struct page
+	{
+		boost::uint32_t index; // in page_index_
+		cell_record records[PAGE_SIZE * PAGE_SIZE];
+		boost::uint8_t state[PAGE_SIZE * PAGE_SIZE];
+	};
+
+	struct heap_entry
+	{
+		key_t key;
+		boost::uint32_t index;
+
+		bool operator <(heap_entry const &rhs) const { return rhs.key < key; }
+	};
+
+	heightfield<T> const &hf_;
+	value_t const min_value_;
+
+	int ncols_, nrows_;
+	cell_t start_, goal_, last_start_;
+	scalar key_modifier_;
+	boost::uint32_t seen_version_;
+	size_t expanded_points_;
+	bool planned_;
+
+	int page_cols_;
+	// one plus position in pages_ by page, zero for pages not touched yet
+	std::vector<boost::uint32_t> page_index_;
+	// deque keeps references to records valid when new pages are added
+	std::deque<page> pages_;
+	size_t pages_used_;
+	std::priority_queue<heap_entry> open_;
+
+	bool is_inside(cell_t const &c) const { return c.x >= 0 && c.y >= 0 && c.x < ncols_ && c.y < nrows_; }
+	boost::uint32_t index_of(cell_t const &c) const { return boost::uint32_t(c.y * ncols_ + c.x); }
+	cell_t cell_of(boost::uint32_t index) const { return cell_t(int(index) % ncols_, int(index) / ncols_); }
+
+	page &page_of(boost::uint32_t index);
+	cell_record &record(boost::uint32_t index);
+	boost::uint8_t &state(boost::uint32_t index);
+
+	bool is_walkable(cell_t const &c);
+	bool is_terrain_walkable(cell_t const &c) const;
+	scalar heuristic(cell_t const &c1, cell_t const &c2) const;
+	key_t calculate_key(boost::uint32_t index);
+
+	void reset();
+	void check_heightfield();
+	void update_around(cell_t const &c);
+	void update_vertex(boost::uint32_t index);
+	bool top(heap_entry &entry);
+	void compute_shortest_path();
+};
+
+}
@@ -0,0 +1,244 @@
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/unordered_set.hpp>
+#include "grid.h"
+#include "dense_a_star.h"
+#include "heightfield_path_service.h"
+
+namespace math
+{
+
+template<class T>
+struct heightfield_path_service<T>::worker
+{
+	heightfield<T> const *hf;
+	// borrowed from heightfield while request is searched, so service does not add search arrays of its own
+	boost::shared_ptr<dense_a_star> pathfinder;
+	boost::unordered_set<cell_t, cell_hash> obstacles;
+	request current;
+	bool busy;
+
+	worker(heightfield<T> const *hf):
+		hf(hf),
+		busy(false)
+	{
+	}
+
+	~worker()
+	{
+		if (pathfinder) hf->release_pathfinder(pathfinder);
+	}
+
+	scalar get_score(cell_t const &cell) const
+	{
+		if (!obstacles.empty() && obstacles.find(cell) != obstacles.end()) return -1;
+
+		return hf->path_score(cell, current.min_value, current.to);
+	}
+};
+
+template<class T>
+size_t const heightfield_path_service<T>::EXPANSIONS_SLICE;
+
+template<class T>
+heightfield_path_service<T>::heightfield_path_service(heightfield<T> const &hf, size_t nthreads):
+	hf_(hf),
+	next_id_(0),
+	budget_(0),
+	nbusy_(0),
+	nrunning_(0),
+	stopping_(false)
+{
+	if (nthreads == 0)
+	{
+		workers_.push_back(worker_ptr(new worker(&hf_)));
+		return;
+	}
+
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		workers_.push_back(worker_ptr(new worker(&hf_)));
+		threads_.create_thread(boost::bind(&heightfield_path_service<T>::run_worker, this, workers_.back()));
+	}
+}
+
+template<class T>
+heightfield_path_service<T>::~heightfield_path_service()
+{
+	{
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		stopping_ = true;
+		work_condition_.notify_all();
+	}
+
+	threads_.join_all();
+}
+
+template<class T>
+typename heightfield_path_service<T>::request_id_t
+heightfield_path_service<T>::submit(vec<3> const &from, vec<3> const &to, value_t min_value, bool allow_best_heuristic_point,
+	std::vector<cell_t> const &obstacles, path_mode mode)
+{
+	request r;
+	r.from = hf_.world_position_to_cell(from);
+	r.to = hf_.world_position_to_cell(to);
+	r.min_value = min_value;
+	r.allow_best_heuristic_point = allow_best_heuristic_point;
+	r.mode = mode;
+
+	boost::unique_lock<boost::mutex> lock(mutex_);
+
+	r.id = next_id_++;
+	requests_.push_back(r);
+	requests_.back().obstacles = obstacles;
+
+	return r.id;
+}
+
+template<class T>
+void heightfield_path_service<T>::tick(size_t max_expansions)
+{
+	boost::unique_lock<boost::mutex> lock(mutex_);
+
+	budget_ = max_expansions;
+
+	if (threads_.size() == 0)
+	{
+		while (have_work(*workers_[0])) run_slice(*workers_[0], lock);
+		return;
+	}
+
+	work_condition_.notify_all();
+}
+
+template<class T>
+void heightfield_path_service<T>::wait()
+{
+	boost::unique_lock<boost::mutex> lock(mutex_);
+
+	while (nrunning_ > 0 || (budget_ > 0 && (nbusy_ > 0 || !requests_.empty())))
+	{
+		idle_condition_.wait(lock);
+	}
+}
+
+template<class T>
+void heightfield_path_service<T>::set_result_callback(result_callback_t const &callback)
+{
+	boost::unique_lock<boost::mutex> lock(mutex_);
+	result_callback_ = callback;
+}
+
+template<class T>
+size_t heightfield_path_service<T>::collect_results(std::deque<result> &results)
+{
+	boost::unique_lock<boost::mutex> lock(mutex_);
+
+	results.clear();
+	results.swap(results_);
+
+	return results.size();
+}
+
+template<class T>
+size_t heightfield_path_service<T>::npending() const
+{
+	boost::unique_lock<boost::mutex> lock(mutex_);
+	return requests_.size() + nbusy_;
+}
+
+template<class T>
+bool heightfield_path_service<T>::have_work(worker const &w) const
+{
+	return budget_ > 0 && (w.busy || !requests_.empty());
+}
+
+template<class T>
+void heightfield_path_service<T>::run_worker(worker_ptr w)
+{
+	boost::unique_lock<boost::mutex> lock(mutex_);
+
+	while (true)
+	{
+		while (!stopping_ && !have_work(*w)) work_condition_.wait(lock);
+		if (stopping_) return;
+
+		run_slice(*w, lock);
+	}
+}
+
+template<class T>
+void heightfield_path_service<T>::run_slice(worker &w, boost::unique_lock<boost::mutex> &lock)
+{
+	bool const starting = !w.busy;
+
+	if (starting)
+	{
+		std::swap(w.current, requests_.front());
+		requests_.pop_front();
+		w.busy = true;
+		++nbusy_;
+	}
+
+	size_t const slice = std::min(budget_, EXPANSIONS_SLICE);
+	budget_ -= slice;
+	++nrunning_;
+
+	lock.unlock();
+
+	if (starting)
+	{
+		w.obstacles.clear();
+		w.obstacles.insert(w.current.obstacles.begin(), w.current.obstacles.end());
+
+		w.pathfinder = hf_.acquire_pathfinder();
+		w.pathfinder->start_path(w.current.from, w.current.to, boost::bind(&worker::get_score, &w, _1),
+			w.current.mode == heightfield<T>::PATH_JUMP_POINTS ? dense_a_star::JUMP_POINTS : dense_a_star::NEIGHBOURS);
+	}
+
+	size_t const expanded_points = w.pathfinder->expanded_points();
+	bool const finished = w.pathfinder->continue_path(slice);
+	size_t const used = w.pathfinder->expanded_points() - expanded_points;
+
+	result r;
+
+	if (finished)
+	{
+		r.id = w.current.id;
+		r.path = w.pathfinder->build_path(w.current.allow_best_heuristic_point);
+		r.expanded_points = w.pathfinder->expanded_points();
+
+		hf_.release_pathfinder(w.pathfinder);
+		w.pathfinder.reset();
+
+		if (result_callback_) result_callback_(r);
+	}
+
+	lock.lock();
+
+	--nrunning_;
+	budget_ += slice - used;
+
+	if (finished)
+	{
+		w.busy = false;
+		--nbusy_;
+
+		if (!result_callback_)
+		{
+			results_.push_back(result());
+			std::swap(results_.back(), r);
+		}
+	}
+
+	// unused part of slice could be taken by other workers
+	work_condition_.notify_all();
+	idle_condition_.notify_all();
+}
+
+template class heightfield_path_service<boost::uint8_t>;
+template class heightfield_path_service<boost::uint16_t>;
+template class heightfield_path_service<scalar>;
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "heightfield.h"
+
+namespace math
+{
+
+// Queue of heightfield::build_path requests solved by pool of worker threads. Every worker keeps
+// its own obstacles set and borrows search arrays from heightfield while it works on request, so
+// arrays are shared with build_path and nothing is allocated per request once they are warmed
+// up. Requests are only processed after tick(), which gives workers budget of node
+// expansions to share, searches not finished within budget are continued on next tick. Paths
+// are same as heightfield::build_path would return, they are delivered either through result
+// callback called from worker thread or collected with collect_results().
+//
+// Heightfield is read by workers, so it should be changed only when they are idle, that is
+// after wait(). Searches which are still in progress will see such changes.
+//
+// With nthreads == 0 requests are processed on caller thread inside of tick().
+template<class T>
+class heightfield_path_service: public boost::noncopyable {
+public:
+	typedef typename heightfield<T>::cell_t cell_t;
+	typedef typename heightfield<T>::value_t value_t;
+	typedef typename heightfield<T>::path_mode path_mode;
+	typedef boost::uint32_t request_id_t;
+
+	struct result
+	{
+		request_id_t id;
+		std::vector<cell_t> path;
+		size_t expanded_points;
+	};
+
+	typedef boost::function<void (result const &)> result_callback_t;
+
+	// searches are run in slices of at most this many expansions, so budget is shared between workers
+	static size_t const EXPANSIONS_SLICE = 1024;
+
+	heightfield_path_service(heightfield<T> const &hf, size_t nthreads);
+	~heightfield_path_service();
+
+	request_id_t submit(vec<3> const &from, vec<3> const &to, value_t min_value = 0, bool allow_best_heuristic_point = false,
+		std::vector<cell_t> const &obstacles = std::vector<cell_t>(), path_mode mode = heightfield<T>::PATH_A_STAR);
+
+	// sets budget of node expansions until next tick and wakes workers up
+	void tick(size_t max_expansions);
+	// blocks until budget is spent or there is nothing to do
+	void wait();
+
+	// should be set before first tick
+	void set_result_callback(result_callback_t const &callback);
+	size_t collect_results(std::deque<result> &results);
+
+	// requests which are queued or in progress
+	size_t npending() const;
+
+private:
+	struct request
+	{
+		request_id_t id;
+		cell_t from, to;
+		value_t min_value;
+		bool allow_best_heuristic_point;
+		std::vector<cell_t> obstacles;
+		path_mode mode;
+	};
+
+	struct worker;
+	typedef boost::shared_ptr<worker> worker_ptr;
+
+	heightfield<T> const &hf_;
+	request_id_t next_id_;
+	result_callback_t result_callback_;
+
+	mutable boost::mutex mutex_;
+	boost::condition_variable work_condition_, idle_condition_;
+	std::deque<request> requests_;
+	std::deque<result> results_;
+	size_t budget_;
+	size_t nbusy_, nrunning_;
+	bool stopping_;
+
+	std::vector<worker_ptr> workers_;
+	boost::thread_group threads_;
+
+	bool have_work(worker const &w) const;
+	void run_worker(worker_ptr w);
+	void run_slice(worker &w, boost::unique_lock<boost::mutex> &lock);
+};
+
+}
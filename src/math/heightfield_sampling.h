@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+#include "vec.h"
+#include "ray.h"
+#include "triangle.h"
+#include "contact_info.h"
+#include "grid.h"
+
+// Cell queries shared by heightfield and tiled_heightfield. Heightfield type gives heights
+// through local_y_at(col, row) and local_vertex_at(col, row), size through ncols() and nrows(),
+// and cells path could go through by path_score().
+
+namespace math
+{
+
+// clips [t0, t1] to part of ray where p + d * t is inside [lo, hi]
+inline bool clip_slab(scalar p, scalar d, scalar lo, scalar hi, scalar &t0, scalar &t1)
+{
+	if (d == 0) return p >= lo && p <= hi;
+
+	scalar ta = (lo - p) / d;
+	scalar tb = (hi - p) / d;
+	if (ta > tb) std::swap(ta, tb);
+
+	t0 = std::max(t0, ta);
+	t1 = std::min(t1, tb);
+
+	return t0 <= t1;
+}
+
+// bilinear height at local position
+template<class Heightfield>
+scalar heightfield_y_under(Heightfield const &hf, vec<3> const &local_position, scalar default_value)
+{
+	int col = (int) local_position.x;
+	int row = (int) local_position.z;
+
+	if (col < 0 || row < 0 || col >= (int) hf.ncols() - 1 || row >= (int) hf.nrows() - 1) return default_value;
+
+	scalar v1 = hf.local_y_at(col + 0, row + 0);
+	scalar v2 = hf.local_y_at(col + 1, row + 0);
+	scalar v3 = hf.local_y_at(col + 0, row + 1);
+	scalar v4 = hf.local_y_at(col + 1, row + 1);
+
+	scalar k1 = local_position.x - col;
+	scalar k2 = local_position.z - row;
+
+	scalar v12 = v1 * (1 - k1) + v2 * k1;
+	scalar v34 = v3 * (1 - k1) + v4 * k1;
+
+	return v12 * (1 - k2) + v34 * k2;
+}
+
+template<class Heightfield>
+scalar heightfield_max_y_in_cell(Heightfield const &hf, int col, int row, scalar default_value)
+{
+	if (col < 0 || row < 0 || col >= (int) hf.ncols() - 1 || row >= (int) hf.nrows() - 1)
+	{
+		return default_value;
+	}
+
+	scalar result = (scalar) hf.local_y_at(col + 0, row + 0);
+	result = std::max(result, (scalar) hf.local_y_at(col + 0, row + 1));
+	result = std::max(result, (scalar) hf.local_y_at(col + 1, row + 0));
+	result = std::max(result, (scalar) hf.local_y_at(col + 1, row + 1));
+
+	return result;
+}
+
+// traces two triangles of cell, result is replaced when contact is better than it
+template<class Heightfield>
+bool heightfield_trace_cell(Heightfield const &hf, int col, int row, ray<3> const &local_ray, contact_info<3> &result)
+{
+	vec<3> v1 = hf.local_vertex_at(col + 0, row + 0);
+	vec<3> v2 = hf.local_vertex_at(col + 0, row + 1);
+	vec<3> v3 = hf.local_vertex_at(col + 1, row + 1);
+	vec<3> v4 = hf.local_vertex_at(col + 1, row + 0);
+
+	triangle<3> t1(v1, v2, v3);
+	triangle<3> t2(v1, v3, v4);
+
+	bool trace_h1, trace_h2;
+	scalar trace_t1, trace_t2;
+	vec<3> trace_p1, trace_p2;
+
+	trace_h1 = t1.trace(local_ray, trace_t1, trace_p1);
+	trace_h2 = t2.trace(local_ray, trace_t2, trace_p2);
+
+	if (!trace_h1 && !trace_h2) return false;
+
+	contact_info<3> ci;
+
+	ci.happened = true;
+	ci.penetrated = false;
+	ci.penetration_depth = 0;
+
+	if (trace_h1 && ((trace_h2 && trace_t1 < trace_t2) || trace_h2 == false))
+	{
+		ci.position = trace_p1;
+		ci.normal = t1.get_normal();
+		ci.time = trace_t1;
+	}
+	else
+	{
+		ci.position = trace_p2;
+		ci.normal = t2.get_normal();
+		ci.time = trace_t2;
+	}
+
+	if (result.worse_than(ci))
+	{
+		result = ci;
+	}
+
+	return true;
+}
+
+template<class Heightfield>
+scalar heightfield_path_score(Heightfield const &hf, vec<2, int> const &cell, typename Heightfield::value_t min_value,
+	vec<2, int> const &goal)
+{
+	if (cell.x < 0) return -1;
+	if (cell.y < 0) return -1;
+	if (cell.x >= (int) hf.ncols()) return -1;
+	if (cell.y >= (int) hf.nrows()) return -1;
+
+	if (hf.max_y_in_cell(cell.x, cell.y) < min_value)
+	{
+		return (scalar) (cell - goal).length_sq();
+	}
+	else
+	{
+		return -1;
+	}
+}
+
+// scores of cells for build_path, obstacles could not be passed
+template<class Heightfield>
+class heightfield_scorer {
+public:
+	typedef typename Heightfield::cell_t cell_t;
+	typedef typename Heightfield::value_t value_t;
+
+	heightfield_scorer(Heightfield const *hf, value_t min_value, cell_t goal, std::vector<cell_t> const &obstacles):
+		hf_(hf),
+		min_value_(min_value),
+		goal_(goal)
+	{
+		obstacles_.insert(obstacles.begin(), obstacles.end());
+	}
+
+	scalar get_score(cell_t const &cell) const
+	{
+		if (!obstacles_.empty() && obstacles_.find(cell) != obstacles_.end()) return -1;
+
+		return hf_->path_score(cell, min_value_, goal_);
+	}
+
+private:
+	typedef boost::unordered_set<cell_t, cell_hash> obstacles_t;
+
+	Heightfield const *hf_;
+	value_t min_value_;
+	cell_t goal_;
+	obstacles_t obstacles_;
+};
+
+}
@@ -5,6 +5,7 @@
 #include <luabind/lua_include.hpp>
 #include "scalar.h"
 #include "vec.h"
+#include "simd.h"
 
 #if defined(minor)
 #undef minor
@@ -263,6 +264,36 @@ public:
 		return matrix_t(*this).inverse(*this);
 	}
 
+	// inverse() for matrices with last column (0, 0, 0, 1), which only rotate, scale and translate
+	// returns false if determinant is zero
+	bool inverse_affine(matrix_t &M) const {
+		scalar_t det =
+			ij[0][0] * (ij[1][1] * ij[2][2] - ij[2][1] * ij[1][2]) -
+			ij[0][1] * (ij[1][0] * ij[2][2] - ij[2][0] * ij[1][2]) +
+			ij[0][2] * (ij[1][0] * ij[2][1] - ij[2][0] * ij[1][1]);
+		if(det == 0) return false;
+
+		scalar_t k = 1 / det;
+
+		M.ij[0][0] = (ij[1][1] * ij[2][2] - ij[2][1] * ij[1][2]) * k;
+		M.ij[0][1] = (ij[2][1] * ij[0][2] - ij[0][1] * ij[2][2]) * k;
+		M.ij[0][2] = (ij[0][1] * ij[1][2] - ij[1][1] * ij[0][2]) * k;
+		M.ij[1][0] = (ij[2][0] * ij[1][2] - ij[1][0] * ij[2][2]) * k;
+		M.ij[1][1] = (ij[0][0] * ij[2][2] - ij[2][0] * ij[0][2]) * k;
+		M.ij[1][2] = (ij[1][0] * ij[0][2] - ij[0][0] * ij[1][2]) * k;
+		M.ij[2][0] = (ij[1][0] * ij[2][1] - ij[2][0] * ij[1][1]) * k;
+		M.ij[2][1] = (ij[2][0] * ij[0][1] - ij[0][0] * ij[2][1]) * k;
+		M.ij[2][2] = (ij[0][0] * ij[1][1] - ij[1][0] * ij[0][1]) * k;
+
+		for(int j = 0; j < 3; j++) {
+			M.ij[3][j] = -(ij[3][0] * M.ij[0][j] + ij[3][1] * M.ij[1][j] + ij[3][2] * M.ij[2][j]);
+		}
+
+		M.ij[0][3] = M.ij[1][3] = M.ij[2][3] = 0;
+		M.ij[3][3] = 1;
+		return true;
+	}
+
 	// записать в T транспонированную матрицу
 	void transpose(matrix_t &tp) const {
        	tp.ij[0][0] = ij[0][0];	tp.ij[0][1] = ij[1][0];	tp.ij[0][2] = ij[2][0]; tp.ij[0][3] = ij[3][0];
@@ -389,6 +420,42 @@ mul(matrix<M,K,T> &result,const matrix<M,N,T> &left,const matrix<N,K,T> &right)
 	}
 }
 
+#ifdef MATH_SSE
+
+// sse versions for scalar matrices, rows of result are sums of rows of right matrix scaled by
+// elements of left one, so results are same as of generic versions
+inline void
+mul(vec<4,scalar> &result,const vec<4,scalar> &v,const matrix<4,4,scalar> &m) {
+	assert(&result != &v);
+
+	__m128 r = _mm_mul_ps(_mm_set1_ps(v.x), _mm_loadu_ps(m.ij[0]));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.y), _mm_loadu_ps(m.ij[1])));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.z), _mm_loadu_ps(m.ij[2])));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.w), _mm_loadu_ps(m.ij[3])));
+	_mm_storeu_ps(&result.x, r);
+}
+
+inline void
+mul(matrix<4,4,scalar> &result,const matrix<4,4,scalar> &left,const matrix<4,4,scalar> &right) {
+	assert(&result != &left);
+	assert(&result != &right);
+
+	__m128 const r0 = _mm_loadu_ps(right.ij[0]);
+	__m128 const r1 = _mm_loadu_ps(right.ij[1]);
+	__m128 const r2 = _mm_loadu_ps(right.ij[2]);
+	__m128 const r3 = _mm_loadu_ps(right.ij[3]);
+
+	for(int i = 0; i < 4; i++) {
+		__m128 r = _mm_mul_ps(_mm_set1_ps(left.ij[i][0]), r0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(left.ij[i][1]), r1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(left.ij[i][2]), r2));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(left.ij[i][3]), r3));
+		_mm_storeu_ps(result.ij[i], r);
+	}
+}
+
+#endif
+
 template <int M, int N, class T> inline bool
 equal(matrix<M, N, T> const &lhs, matrix<M, N, T> const &rhs, T epsilon = EPSILON) {
 	for(size_t i = 0; i < M; i++) {
@@ -0,0 +1,169 @@
+
+#include <deque>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "parallel.h"
+
+namespace math
+{
+
+namespace
+{
+
+class thread_pool: public boost::noncopyable {
+public:
+	thread_pool():
+		stopped_(false)
+	{
+		size_t const nthreads = std::max(boost::thread::hardware_concurrency(), 1u) - 1;
+		for (size_t i = 0; i < nthreads; ++i) threads_.create_thread(boost::bind(&thread_pool::work, this));
+	}
+
+	~thread_pool()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			stopped_ = true;
+		}
+
+		work_available_.notify_all();
+		threads_.join_all();
+	}
+
+	size_t size() const { return threads_.size(); }
+
+	void run(size_t count, size_t chunk, parallel_body_t const &body)
+	{
+		batch b;
+		b.body = &body;
+		b.pending = 0;
+
+		size_t first = 0;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			for (; first + chunk < count; first += chunk)
+			{
+				job const j = { &b, first, chunk };
+				jobs_.push_back(j);
+				++b.pending;
+			}
+		}
+
+		work_available_.notify_all();
+
+		// queued ranges refer to batch on stack, so they are finished before exception leaves
+		try
+		{
+			body(first, count - first);
+		}
+		catch (...)
+		{
+			wait(b);
+			throw;
+		}
+
+		wait(b);
+	}
+
+private:
+	struct batch
+	{
+		parallel_body_t const *body;
+		size_t pending;
+		boost::condition_variable done;
+	};
+
+	struct job
+	{
+		batch *b;
+		size_t first, count;
+	};
+
+	boost::thread_group threads_;
+	boost::mutex mutex_;
+	boost::condition_variable work_available_;
+	std::deque<job> jobs_;
+	bool stopped_;
+
+	// lock is held before and after call
+	void execute(boost::mutex::scoped_lock &lock)
+	{
+		job const j = jobs_.front();
+		jobs_.pop_front();
+
+		lock.unlock();
+		(*j.b->body)(j.first, j.count);
+		lock.lock();
+
+		if (--j.b->pending == 0) j.b->done.notify_all();
+	}
+
+	void work()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+
+		while (!stopped_)
+		{
+			if (jobs_.empty()) work_available_.wait(lock);
+			else execute(lock);
+		}
+	}
+
+	// ranges of other batches are run too, so nested loops do not wait for busy threads
+	void wait(batch &b)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+
+		while (b.pending != 0)
+		{
+			if (jobs_.empty()) b.done.wait(lock);
+			else execute(lock);
+		}
+	}
+};
+
+thread_pool *pool = 0;
+boost::once_flag pool_once = BOOST_ONCE_INIT;
+
+void create_pool()
+{
+	static thread_pool instance;
+	pool = &instance;
+}
+
+thread_pool &get_pool()
+{
+	boost::call_once(&create_pool, pool_once);
+	return *pool;
+}
+
+}
+
+void parallel_for(size_t count, size_t min_count, size_t alignment, parallel_body_t const &body)
+{
+	if (count == 0) return;
+
+	size_t nranges = count >= min_count ? parallel_threads_count() : 1;
+	nranges = std::min(nranges, count / std::max(min_count / 2, size_t(1)));
+
+	if (nranges <= 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	size_t const chunk = ((count + nranges - 1) / nranges + alignment - 1) / alignment * alignment;
+	get_pool().run(count, chunk, body);
+}
+
+size_t parallel_threads_count()
+{
+	return get_pool().size() + 1;
+}
+
+}
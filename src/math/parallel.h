@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <boost/function.hpp>
+
+namespace math
+{
+
+// Loops over arrays split between threads of one pool, which is created on first use and kept
+// until exit, so batches do not create threads. Calling thread runs last range itself and runs
+// queued ranges while it waits, so body could call parallel_for again.
+
+// body is called with first element and count of elements of range
+typedef boost::function<void (size_t, size_t)> parallel_body_t;
+
+// [0, count) is split when it has at least min_count elements, ranges are multiples of alignment
+// elements except last one and have at least min_count / 2 elements; body should not throw on pool
+// threads
+void parallel_for(size_t count, size_t min_count, size_t alignment, parallel_body_t const &body);
+
+// pool threads and calling one
+size_t parallel_threads_count();
+
+}
@@ -56,12 +56,36 @@ public:
 		return q;
 	}
 
+	// largest component is found first and others are derived from it, so result is stable for any rotation
 	template<int N, int M, class X>
 	void set_unit(matrix<N, M, X> const &m) {
-		x = sign(m.ij[1][2] - m.ij[2][1]) * T(sqrt(1 + m.ij[0][0] - m.ij[1][1] - m.ij[2][2])) / 2;
-		y = sign(m.ij[2][0] - m.ij[0][2]) * T(sqrt(1 - m.ij[0][0] + m.ij[1][1] - m.ij[2][2])) / 2;
-		z = sign(m.ij[0][1] - m.ij[1][0]) * T(sqrt(1 - m.ij[0][0] - m.ij[1][1] + m.ij[2][2])) / 2;
-		w = T(sqrt(m.ij[0][0] + m.ij[1][1] + m.ij[2][2] + 1));
+		T const trace = T(m.ij[0][0] + m.ij[1][1] + m.ij[2][2]);
+
+		if (trace > 0) {
+			T const s = T(sqrt(trace + 1)) * 2;
+			w = s / 4;
+			x = T(m.ij[1][2] - m.ij[2][1]) / s;
+			y = T(m.ij[2][0] - m.ij[0][2]) / s;
+			z = T(m.ij[0][1] - m.ij[1][0]) / s;
+		} else if (m.ij[0][0] > m.ij[1][1] && m.ij[0][0] > m.ij[2][2]) {
+			T const s = T(sqrt(1 + m.ij[0][0] - m.ij[1][1] - m.ij[2][2])) * 2;
+			w = T(m.ij[1][2] - m.ij[2][1]) / s;
+			x = s / 4;
+			y = T(m.ij[0][1] + m.ij[1][0]) / s;
+			z = T(m.ij[2][0] + m.ij[0][2]) / s;
+		} else if (m.ij[1][1] > m.ij[2][2]) {
+			T const s = T(sqrt(1 + m.ij[1][1] - m.ij[0][0] - m.ij[2][2])) * 2;
+			w = T(m.ij[2][0] - m.ij[0][2]) / s;
+			x = T(m.ij[0][1] + m.ij[1][0]) / s;
+			y = s / 4;
+			z = T(m.ij[1][2] + m.ij[2][1]) / s;
+		} else {
+			T const s = T(sqrt(1 + m.ij[2][2] - m.ij[0][0] - m.ij[1][1])) * 2;
+			w = T(m.ij[0][1] - m.ij[1][0]) / s;
+			x = T(m.ij[2][0] + m.ij[0][2]) / s;
+			y = T(m.ij[1][2] + m.ij[2][1]) / s;
+			z = s / 4;
+		}
 	}
 };
 
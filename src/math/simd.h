@@ -0,0 +1,36 @@
+#pragma once
+
+// MATH_SSE is defined when SSE2 intrinsics could be used, code using them has to keep scalar
+// fallback for other targets
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// alignment of types kept in sse registers
+#if defined(_MSC_VER)
+#define MATH_ALIGNED(n) __declspec(align(n))
+#else
+#define MATH_ALIGNED(n) __attribute__((aligned(n)))
+#endif
+
+namespace math
+{
+
+#ifdef MATH_SSE
+
+// mask ? a : b, mask lanes are all ones or all zeros
+inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// lo <= x && x < hi for every lane
+inline __m128i in_range(__m128i x, int lo, int hi)
+{
+	return _mm_and_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(lo - 1)), _mm_cmplt_epi32(x, _mm_set1_epi32(hi)));
+}
+
+#endif
+
+}
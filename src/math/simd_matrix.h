@@ -0,0 +1,208 @@
+#pragma once
+
+#include "simd.h"
+#include "matrix.h"
+
+namespace math
+{
+
+// vec<4> kept at 16 byte boundary, so it is loaded to and stored from sse register in one
+// aligned move; see simd_matrix::transform()
+class MATH_ALIGNED(16) simd_vec4 {
+public:
+	simd_vec4() {
+	}
+
+	simd_vec4(scalar x, scalar y, scalar z, scalar w) {
+		i[0] = x;
+		i[1] = y;
+		i[2] = z;
+		i[3] = w;
+	}
+
+	explicit simd_vec4(vec<4> const &v) {
+		i[0] = v.x;
+		i[1] = v.y;
+		i[2] = v.z;
+		i[3] = v.w;
+	}
+
+	vec<4> to_vec() const {
+		return vec<4>(i[0], i[1], i[2], i[3]);
+	}
+
+	scalar i[4];
+};
+
+// matrix<4,4> of scalars kept in aligned rows, so multiplications, transposes, affine inverses
+// and transforms are done in sse registers. Meant for code which does many operations with
+// same matrices, like building joint transforms, values are converted from and to matrix<4,4>
+// with assign() and store(). Rows are loaded and stored with aligned moves, so instances have
+// to be 16 byte aligned: default heap allocations are on 64 bit targets, on 32 bit ones containers
+// need aligned allocator. Without sse operations of matrix<4,4> are used.
+class MATH_ALIGNED(16) simd_matrix {
+public:
+	simd_matrix() {
+	}
+
+	explicit simd_matrix(matrix<4,4> const &m) {
+		assign(m);
+	}
+
+	void assign(matrix<4,4> const &m) {
+		for(int i = 0; i < 4; i++) {
+			for(int j = 0; j < 4; j++) ij[i][j] = m.ij[i][j];
+		}
+	}
+
+	void store(matrix<4,4> &m) const {
+		for(int i = 0; i < 4; i++) {
+			for(int j = 0; j < 4; j++) m.ij[i][j] = ij[i][j];
+		}
+	}
+
+	matrix<4,4> to_matrix() const {
+		matrix<4,4> m;
+		store(m);
+		return m;
+	}
+
+	void identity() {
+		for(int i = 0; i < 4; i++) {
+			for(int j = 0; j < 4; j++) ij[i][j] = i == j ? scalar(1) : scalar(0);
+		}
+	}
+
+	// result could be same as left or right
+	friend void mul(simd_matrix &result, simd_matrix const &left, simd_matrix const &right) {
+#ifdef MATH_SSE
+		__m128 const r0 = _mm_load_ps(right.ij[0]);
+		__m128 const r1 = _mm_load_ps(right.ij[1]);
+		__m128 const r2 = _mm_load_ps(right.ij[2]);
+		__m128 const r3 = _mm_load_ps(right.ij[3]);
+
+		for(int i = 0; i < 4; i++) {
+			__m128 const l = _mm_load_ps(left.ij[i]);
+			__m128 r = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)), r0);
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)), r1));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)), r2));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), r3));
+			_mm_store_ps(result.ij[i], r);
+		}
+#else
+		result.assign(left.to_matrix() * right.to_matrix());
+#endif
+	}
+
+	simd_matrix &operator *=(simd_matrix const &m) {
+		mul(*this, *this, m);
+		return *this;
+	}
+
+	simd_matrix operator *(simd_matrix const &m) const {
+		simd_matrix result;
+		mul(result, *this, m);
+		return result;
+	}
+
+	// result could be same as this matrix
+	void transpose(simd_matrix &result) const {
+#ifdef MATH_SSE
+		__m128 r0 = _mm_load_ps(ij[0]), r1 = _mm_load_ps(ij[1]), r2 = _mm_load_ps(ij[2]), r3 = _mm_load_ps(ij[3]);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		_mm_store_ps(result.ij[0], r0);
+		_mm_store_ps(result.ij[1], r1);
+		_mm_store_ps(result.ij[2], r2);
+		_mm_store_ps(result.ij[3], r3);
+#else
+		matrix<4,4> m;
+		to_matrix().transpose(m);
+		result.assign(m);
+#endif
+	}
+
+	// see matrix<4,4>::inverse_affine(), result could be same as this matrix
+	bool inverse_affine(simd_matrix &result) const {
+#ifdef MATH_SSE
+		__m128 const r0 = _mm_load_ps(ij[0]), r1 = _mm_load_ps(ij[1]), r2 = _mm_load_ps(ij[2]), t = _mm_load_ps(ij[3]);
+
+		// columns of inverted 3x3 part are cross products of its rows
+		__m128 c0 = cross(r1, r2), c1 = cross(r2, r0), c2 = cross(r0, r1), c3 = _mm_setzero_ps();
+
+		__m128 det = _mm_mul_ps(r0, c0);
+		det = _mm_add_ss(_mm_add_ss(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 2, 2, 2)));
+		if (_mm_cvtss_f32(det) == 0) return false;
+
+		__m128 const k = _mm_div_ps(_mm_set1_ps(1), _mm_shuffle_ps(det, det, _MM_SHUFFLE(0, 0, 0, 0)));
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+		c0 = _mm_mul_ps(c0, k);
+		c1 = _mm_mul_ps(c1, k);
+		c2 = _mm_mul_ps(c2, k);
+
+		__m128 c4 = _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0)), c0);
+		c4 = _mm_add_ps(c4, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1)), c1));
+		c4 = _mm_add_ps(c4, _mm_mul_ps(_mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2)), c2));
+		c4 = _mm_sub_ps(_mm_setr_ps(0, 0, 0, 1), c4);
+
+		_mm_store_ps(result.ij[0], c0);
+		_mm_store_ps(result.ij[1], c1);
+		_mm_store_ps(result.ij[2], c2);
+		_mm_store_ps(result.ij[3], c4);
+		return true;
+#else
+		matrix<4,4> m;
+		if (!to_matrix().inverse_affine(m)) return false;
+		result.assign(m);
+		return true;
+#endif
+	}
+
+	// p * m for point with w = 1
+	vec<3> transform_point(vec<3> const &p) const {
+		vec<4> r = transform(vec<4>(p.x, p.y, p.z, 1));
+		return vec<3>(r.x, r.y, r.z);
+	}
+
+	// v * m for direction with w = 0
+	vec<3> transform_vector(vec<3> const &v) const {
+		vec<4> r = transform(vec<4>(v.x, v.y, v.z, 0));
+		return vec<3>(r.x, r.y, r.z);
+	}
+
+	vec<4> transform(vec<4> const &v) const {
+		simd_vec4 result;
+		transform(simd_vec4(v), result);
+		return result.to_vec();
+	}
+
+	// v * m, result could be same as v
+	void transform(simd_vec4 const &v, simd_vec4 &result) const {
+#ifdef MATH_SSE
+		__m128 const p = _mm_load_ps(v.i);
+		__m128 r = _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), _mm_load_ps(ij[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), _mm_load_ps(ij[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), _mm_load_ps(ij[2])));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)), _mm_load_ps(ij[3])));
+		_mm_store_ps(result.i, r);
+#else
+		vec<4> r;
+		mul(r, v.to_vec(), to_matrix());
+		result = simd_vec4(r);
+#endif
+	}
+
+	scalar ij[4][4];
+
+private:
+#ifdef MATH_SSE
+	static __m128 cross(__m128 a, __m128 b) {
+		__m128 const a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 const c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+#endif
+};
+
+}
@@ -1,6 +1,136 @@
 
 #include <boost/test/unit_test.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include "a_star.h"
+#include "dense_a_star.h"
+#include "grid.h"
+
+namespace
+{
+
+typedef math::a_star::point point;
+
+// square grid with random obstacles and several walls with single gap in each
+struct grid
+{
+	int size;
+	std::vector<char> blocked;
+	point goal;
+
+	grid(int size, int obstacles_percent, int nwalls, unsigned seed):
+		size(size),
+		blocked(size * size, 0),
+		goal(size - 1, size - 1)
+	{
+		for (int i = 0; i < size * size; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			blocked[i] = int((seed >> 16) % 100) < obstacles_percent;
+		}
+
+		for (int w = 1; w <= nwalls; ++w)
+		{
+			int x = size * w / (nwalls + 1);
+			int gap = (w % 2) ? size - 2 : 1;
+
+			for (int y = 0; y < size; ++y)
+			{
+				blocked[x * size + y] = (y != gap);
+			}
+		}
+
+		blocked[0] = 0;
+		blocked[(size - 1) * size + size - 1] = 0;
+	}
+
+	math::scalar score(point const &p) const
+	{
+		if (p.x < 0 || p.y < 0 || p.x >= size || p.y >= size) return -1;
+		if (blocked[p.x * size + p.y]) return -1;
+		return math::scalar((p - goal).length_sq());
+	}
+
+	// admissible heuristic for unit cost 8-connected moves
+	math::scalar optimal_score(point const &p) const
+	{
+		if (p.x < 0 || p.y < 0 || p.x >= size || p.y >= size) return -1;
+		if (blocked[p.x * size + p.y]) return -1;
+		return math::scalar(std::max(abs(p.x - goal.x), abs(p.y - goal.y)));
+	}
+};
+
+void check_jump_points(grid const &g, point const &start)
+{
+	math::dense_a_star optimal(g.size, g.size);
+	optimal.calculate_path(start, g.goal, boost::bind(&grid::optimal_score, &g, _1));
+
+	math::dense_a_star jps(g.size, g.size);
+	jps.calculate_path(start, g.goal, boost::bind(&grid::score, &g, _1), math::dense_a_star::JUMP_POINTS);
+
+	BOOST_REQUIRE (optimal.have_failed() == jps.have_failed());
+	if (jps.have_failed()) return;
+
+	std::vector<point> optimal_path = optimal.build_path();
+	std::vector<point> path = jps.build_path();
+
+	BOOST_REQUIRE (path.size() == optimal_path.size());
+	BOOST_REQUIRE (path.front() == start);
+	BOOST_REQUIRE (path.back() == g.goal);
+
+	for (size_t i = 1; i < path.size(); ++i)
+	{
+		BOOST_REQUIRE (g.score(path[i]) >= 0);
+		BOOST_REQUIRE (std::max(abs(path[i].x - path[i - 1].x), abs(path[i].y - path[i - 1].y)) == 1);
+	}
+}
+
+void compare_with_dense(grid const &g, point const &start, bool allow_best_heuristic_point = false)
+{
+	math::a_star sparse(start, g.goal, boost::bind(&grid::score, &g, _1));
+	sparse.calculate_path();
+
+	math::dense_a_star dense(g.size, g.size);
+	dense.calculate_path(start, g.goal, boost::bind(&grid::score, &g, _1));
+
+	BOOST_REQUIRE (sparse.have_failed() == dense.have_failed());
+
+	std::vector<point> sparse_path = sparse.build_path(allow_best_heuristic_point);
+	std::vector<point> dense_path = dense.build_path(allow_best_heuristic_point);
+
+	if (sparse.have_failed())
+	{
+		BOOST_REQUIRE (sparse_path.empty() == dense_path.empty());
+		if (!dense_path.empty()) BOOST_REQUIRE (dense_path.front() == start);
+		return;
+	}
+
+	BOOST_REQUIRE (sparse_path.size() == dense_path.size());
+	for (size_t i = 0; i < sparse_path.size(); ++i) BOOST_REQUIRE (sparse_path[i] == dense_path[i]);
+}
+
+double benchmark_sparse(grid const &g, size_t &path_size)
+{
+	boost::posix_time::ptime start_time(boost::posix_time::microsec_clock::local_time());
+
+	math::a_star pathfinder(point(0, 0), g.goal, boost::bind(&grid::score, &g, _1));
+	pathfinder.calculate_path();
+	path_size = pathfinder.build_path().size();
+
+	return double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000;
+}
+
+double benchmark_dense(math::dense_a_star &pathfinder, grid const &g, size_t &path_size)
+{
+	boost::posix_time::ptime start_time(boost::posix_time::microsec_clock::local_time());
+
+	pathfinder.calculate_path(point(0, 0), g.goal, boost::bind(&grid::score, &g, _1));
+	path_size = pathfinder.build_path().size();
+
+	return double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000;
+}
+
+}
 
 BOOST_AUTO_TEST_SUITE(a_star)
 
@@ -122,4 +252,163 @@ BOOST_AUTO_TEST_CASE(simple_path_4)
 	BOOST_REQUIRE(path[11] == point(10, 0));
 }
 
+BOOST_AUTO_TEST_CASE(dense_same_paths)
+{
+	for (unsigned seed = 1; seed <= 20; ++seed)
+	{
+		grid g(64, 25, 3, seed);
+		compare_with_dense(g, point(0, 0));
+		compare_with_dense(g, point(int(seed), 0));
+		compare_with_dense(g, point(0, int(seed)), true);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(dense_failed_path)
+{
+	grid g(32, 0, 0, 1);
+	for (int i = 0; i < 32; ++i) g.blocked[20 * 32 + i] = 1;
+
+	math::dense_a_star dense(32, 32);
+	dense.calculate_path(point(0, 0), g.goal, boost::bind(&grid::score, &g, _1));
+	BOOST_REQUIRE (dense.have_failed());
+	BOOST_REQUIRE (dense.build_path().empty());
+
+	std::vector<point> path = dense.build_path(true);
+	BOOST_REQUIRE (!path.empty());
+	BOOST_REQUIRE (path.front() == point(0, 0));
+	BOOST_REQUIRE (path.back().x == 19);
+
+	compare_with_dense(g, point(0, 0), true);
+}
+
+BOOST_AUTO_TEST_CASE(jump_points_optimal_paths)
+{
+	for (unsigned seed = 1; seed <= 50; ++seed)
+	{
+		grid g(64, seed % 40, seed % 4, seed);
+		check_jump_points(g, point(0, 0));
+		check_jump_points(g, point(int(seed), 0));
+		check_jump_points(g, point(0, int(seed)));
+		check_jump_points(g, point(int(seed), int(seed)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(jump_points_trivial_paths)
+{
+	grid g(8, 0, 0, 1);
+
+	math::dense_a_star jps(g.size, g.size);
+	jps.calculate_path(g.goal, g.goal, boost::bind(&grid::score, &g, _1), math::dense_a_star::JUMP_POINTS);
+	BOOST_REQUIRE (!jps.have_failed());
+	BOOST_REQUIRE (jps.build_path().size() == 1);
+
+	jps.calculate_path(point(0, 0), g.goal, boost::bind(&grid::score, &g, _1), math::dense_a_star::JUMP_POINTS);
+	BOOST_REQUIRE (!jps.have_failed());
+	BOOST_REQUIRE (jps.build_path().size() == 8);
+	BOOST_REQUIRE (jps.expanded_points() == 2);
+
+	for (int i = 0; i < 8; ++i) g.blocked[4 * 8 + i] = 1;
+
+	jps.calculate_path(point(0, 0), g.goal, boost::bind(&grid::score, &g, _1), math::dense_a_star::JUMP_POINTS);
+	BOOST_REQUIRE (jps.have_failed());
+	BOOST_REQUIRE (jps.build_path().empty());
+	BOOST_REQUIRE (jps.build_path(true).front() == point(0, 0));
+}
+
+BOOST_AUTO_TEST_CASE(jump_points_benchmark)
+{
+	// open terrain with sparse rectangular obstacles
+	grid g(1024, 0, 0, 1);
+
+	unsigned seed = 1;
+	for (int i = 0; i < 100; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		int x0 = int((seed >> 8) % 960), y0 = int((seed >> 18) % 960);
+		seed = seed * 1103515245 + 12345;
+		int w = 4 + int((seed >> 8) % 60), h = 4 + int((seed >> 18) % 60);
+
+		for (int x = x0; x < x0 + w; ++x)
+		{
+			for (int y = y0; y < y0 + h; ++y) g.blocked[x * g.size + y] = 1;
+		}
+	}
+
+	point const start(0, g.size / 3);
+	g.blocked[start.x * g.size + start.y] = 0;
+	g.blocked[g.goal.x * g.size + g.goal.y] = 0;
+
+	math::dense_a_star optimal(g.size, g.size);
+	boost::posix_time::ptime start_time(boost::posix_time::microsec_clock::local_time());
+	optimal.calculate_path(start, g.goal, boost::bind(&grid::optimal_score, &g, _1));
+	double optimal_ms = double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000;
+
+	math::dense_a_star jps(g.size, g.size);
+	start_time = boost::posix_time::microsec_clock::local_time();
+	jps.calculate_path(start, g.goal, boost::bind(&grid::score, &g, _1), math::dense_a_star::JUMP_POINTS);
+	double jps_ms = double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000;
+
+	BOOST_REQUIRE (optimal.build_path().size() == jps.build_path().size());
+	BOOST_REQUIRE (jps.expanded_points() * 10 < optimal.expanded_points());
+
+	BOOST_TEST_MESSAGE("1024x1024 with sparse obstacles: a_star " << optimal.expanded_points() << " points, " << optimal_ms
+		<< " ms, jump points " << jps.expanded_points() << " points, " << jps_ms << " ms");
+}
+
+// walls with gaps at alternating ends make search fill large part of grid instead of going straight
+// to goal, sparse a_star takes tens of seconds over largest grid, so it is compared over smaller ones
+BOOST_AUTO_TEST_CASE(dense_benchmark)
+{
+	static int const SIZES[] = { 512, 4096 };
+	static int const SPARSE_MAX_SIZE = 1024;
+
+	for (size_t i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i)
+	{
+		grid g(SIZES[i], 30, 3, 1);
+		math::dense_a_star pathfinder(g.size, g.size);
+
+		size_t first_path_size, dense_path_size;
+		double dense_first_ms = benchmark_dense(pathfinder, g, first_path_size);
+		double dense_ms = benchmark_dense(pathfinder, g, dense_path_size);
+
+		BOOST_REQUIRE (first_path_size == dense_path_size);
+		BOOST_REQUIRE (pathfinder.expanded_points() > size_t(g.size) * g.size / 16);
+
+		if (g.size > SPARSE_MAX_SIZE)
+		{
+			BOOST_TEST_MESSAGE("dense_a_star " << g.size << "x" << g.size << ": " << dense_first_ms << " ms first search, "
+				<< dense_ms << " ms reused, " << pathfinder.expanded_points() << " points");
+			continue;
+		}
+
+		size_t sparse_path_size;
+		double sparse_ms = benchmark_sparse(g, sparse_path_size);
+
+		BOOST_REQUIRE (sparse_path_size == dense_path_size);
+
+		BOOST_TEST_MESSAGE("a_star " << g.size << "x" << g.size << ": " << sparse_ms << " ms, dense_a_star: "
+			<< dense_first_ms << " ms first search, " << dense_ms << " ms reused, " << pathfinder.expanded_points() << " points");
+	}
+}
+
+// cells of square block fill buckets of power of two count evenly
+BOOST_AUTO_TEST_CASE(cell_hash_spread)
+{
+	size_t const nbuckets = 1024;
+	std::vector<size_t> counts(nbuckets, 0);
+
+	math::cell_hash hash;
+	for (int x = 0; x < 128; ++x)
+	{
+		for (int y = 0; y < 128; ++y) ++counts[hash(point(x, y)) % nbuckets];
+	}
+
+	BOOST_REQUIRE (*std::max_element(counts.begin(), counts.end()) < 3 * 128 * 128 / nbuckets);
+
+	for (int d = 0; d < 8; ++d)
+	{
+		BOOST_REQUIRE (math::grid_direction_index(math::GRID_DIRECTIONS[d][0], math::GRID_DIRECTIONS[d][1]) == d);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,4 +1,6 @@
 
+#include <ctime>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 #include "matrix.h"
 #include "obb.h"
@@ -204,4 +206,160 @@ BOOST_AUTO_TEST_CASE(from_matrix_and_intersection_with_obb_1)
 	BOOST_REQUIRE (fr.test_intersection(bound) == false);
 }
 
+namespace
+{
+
+// boxes with random centres and sides, kept both as obb<3> and as arrays
+struct random_boxes
+{
+	std::vector<math::obb<3> > obbs;
+	std::vector<math::scalar> c[3], t[3], n[3], b[3];
+
+	// clustered boxes go by four close to each other, like objects sorted by position
+	random_boxes(size_t count, bool axis_aligned, bool clustered = false): obbs(count)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			c[k].resize(count);
+			t[k].resize(count);
+			n[k].resize(count);
+			b[k].resize(count);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			math::vec<3> centre(math::random(-500, 500), math::random(-500, 500), math::random(-500, 500));
+			if (clustered && i % 4 != 0)
+			{
+				centre = math::vec<3>(c[0][i - 1], c[1][i - 1], c[2][i - 1]) +
+					math::vec<3>(math::random(-20, 20), math::random(-20, 20), math::random(-20, 20));
+			}
+
+			math::matrix<3,3> rotation;
+			if (axis_aligned) rotation.identity();
+			else rotation.rotation(math::vec<3>(math::random(0, math::PI), math::random(0, math::PI), math::random(0, math::PI)));
+
+			math::vec<3> const half_t = math::vec<3>(math::random(0.5f, 20), 0, 0) * rotation;
+			math::vec<3> const half_n = math::vec<3>(0, math::random(0.5f, 20), 0) * rotation;
+			math::vec<3> const half_b = math::vec<3>(0, 0, math::random(0.5f, 20)) * rotation;
+
+			obbs[i].origin = centre - half_t - half_n - half_b;
+			obbs[i].tangent = half_t * 2;
+			obbs[i].normal = half_n * 2;
+			obbs[i].binormal = half_b * 2;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				c[k][i] = centre.i[k];
+				t[k][i] = half_t.i[k];
+				n[k][i] = half_n.i[k];
+				b[k][i] = half_b.i[k];
+			}
+		}
+	}
+
+	math::frustum<>::obb_arrays get_obb_arrays() const
+	{
+		math::frustum<>::obb_arrays arrays = { &c[0][0], &c[1][0], &c[2][0], &t[0][0], &t[1][0], &t[2][0],
+			&n[0][0], &n[1][0], &n[2][0], &b[0][0], &b[1][0], &b[2][0] };
+		return arrays;
+	}
+
+	// only valid for axis aligned boxes
+	math::frustum<>::aabb_arrays get_aabb_arrays() const
+	{
+		math::frustum<>::aabb_arrays arrays = { &c[0][0], &c[1][0], &c[2][0], &t[0][0], &n[1][0], &b[2][0] };
+		return arrays;
+	}
+};
+
+math::frustum<> random_frustum()
+{
+	math::matrix<4,4> view, projection;
+	view.rotation(math::random(0, math::PI), math::random(0, math::PI), math::random(0, math::PI));
+	view.translate(math::random(-100, 100), math::random(-100, 100), math::random(-100, 100));
+	projection.perspective(math::PI / 3, 1.33f, 1, 400);
+	return math::frustum<>(view * projection);
+}
+
+// camera turning around vertical axis by small step every frame
+math::frustum<> turning_frustum(int frame)
+{
+	math::matrix<4,4> view, projection;
+	view.rotation(0.3f, 0.01f * frame, 0);
+	view.translate(10, -20, 30);
+	projection.perspective(math::PI / 3, 1.33f, 1, 400);
+	return math::frustum<>(view * projection);
+}
+
+bool is_visible(std::vector<boost::uint32_t> const &visible, size_t i)
+{
+	return (visible[i / 32] >> (i % 32)) & 1;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_intersection_arrays)
+{
+	for (int iteration = 0; iteration < 10; ++iteration)
+	{
+		math::frustum<> fr = random_frustum();
+
+		// count is not multiple of four
+		size_t const count = 1001;
+		random_boxes obbs(count, false), aabbs(count, true);
+		std::vector<boost::uint32_t> visible((count + 31) / 32);
+
+		fr.test_intersection(obbs.get_obb_arrays(), count, &visible[0]);
+		for (size_t i = 0; i < count; ++i) BOOST_REQUIRE (is_visible(visible, i) == fr.test_intersection(obbs.obbs[i]));
+
+		fr.test_intersection(aabbs.get_aabb_arrays(), count, &visible[0]);
+		for (size_t i = 0; i < count; ++i) BOOST_REQUIRE (is_visible(visible, i) == fr.test_intersection(aabbs.obbs[i]));
+
+		// cached planes change order in which planes are tested, not results
+		std::vector<boost::uint8_t> plane_cache((count + 3) / 4, 0);
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			fr.test_intersection(obbs.get_obb_arrays(), count, &visible[0], &plane_cache[0]);
+			for (size_t i = 0; i < count; ++i) BOOST_REQUIRE (is_visible(visible, i) == fr.test_intersection(obbs.obbs[i]));
+		}
+	}
+}
+
+// frames of turning camera over boxes clustered by four, plane cache is kept between frames
+BOOST_AUTO_TEST_CASE(test_intersection_arrays_benchmark)
+{
+	size_t const count = 50000;
+	random_boxes obbs(count, false, true);
+	std::vector<boost::uint32_t> visible((count + 31) / 32), cached_visible((count + 31) / 32);
+	std::vector<boost::uint8_t> plane_cache((count + 3) / 4, 0);
+
+	int const nframes = 100;
+	std::vector<math::frustum<> > frames;
+	for (int i = 0; i < nframes; ++i) frames.push_back(turning_frustum(i));
+
+	std::clock_t start = std::clock();
+	for (int i = 0; i < nframes; ++i) frames[i].test_intersection(obbs.get_obb_arrays(), count, &visible[0]);
+	double const arrays_time = double(std::clock() - start) / CLOCKS_PER_SEC / nframes;
+
+	start = std::clock();
+	for (int i = 0; i < nframes; ++i) frames[i].test_intersection(obbs.get_obb_arrays(), count, &cached_visible[0], &plane_cache[0]);
+	double const cached_time = double(std::clock() - start) / CLOCKS_PER_SEC / nframes;
+
+	BOOST_REQUIRE (visible == cached_visible);
+
+	math::frustum<> const &fr = frames.back();
+	size_t nvisible = 0;
+	start = std::clock();
+	for (size_t i = 0; i < count; ++i) nvisible += fr.test_intersection(obbs.obbs[i]);
+	double const single_time = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+	size_t nvisible_arrays = 0;
+	for (size_t i = 0; i < count; ++i) nvisible_arrays += is_visible(visible, i);
+	BOOST_REQUIRE (nvisible_arrays == nvisible);
+
+	BOOST_TEST_MESSAGE("culling " << count << " boxes (" << nvisible << " visible): " << single_time << "s one by one, "
+		<< arrays_time << "s in arrays, " << cached_time << "s with plane cache");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,11 +1,100 @@
 
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/vector.hpp>
+#include "triangle.h"
+#include "dense_a_star.h"
 #include "heightfield.h"
+#include "test_random.h"
+
+namespace
+{
+
+typedef math::heightfield<boost::uint8_t> heightfield_t;
+
+// traces every cell, heightfield is expected to have identity transform
+math::contact_info<3> trace_all_cells(heightfield_t const &hf, math::ray<3> const &r, math::scalar max_distance)
+{
+	math::ray<3> local_ray(r.r0, normalize(r.a) * max_distance);
+
+	math::contact_info<3> result;
+	result.happened = false;
+
+	for (int row = 0; row + 1 < (int) hf.nrows(); ++row)
+	{
+		for (int col = 0; col + 1 < (int) hf.ncols(); ++col)
+		{
+			math::vec<3> v1 = hf.local_vertex_at(col + 0, row + 0);
+			math::vec<3> v2 = hf.local_vertex_at(col + 0, row + 1);
+			math::vec<3> v3 = hf.local_vertex_at(col + 1, row + 1);
+			math::vec<3> v4 = hf.local_vertex_at(col + 1, row + 0);
+
+			math::triangle<3> triangles[2] = { math::triangle<3>(v1, v2, v3), math::triangle<3>(v1, v3, v4) };
+
+			for (int i = 0; i < 2; ++i)
+			{
+				math::contact_info<3> ci;
+				ci.happened = triangles[i].trace(local_ray, ci.time, ci.position);
+				ci.penetrated = false;
+
+				if (result.worse_than(ci)) result = ci;
+			}
+		}
+	}
+
+	return result;
+}
+
+void check_traces(heightfield_t const &hf, boost::uint32_t seed, size_t ntraces)
+{
+	for (size_t i = 0; i < ntraces; ++i)
+	{
+		math::vec<3> from(math::scalar(math::next_random(seed) % (hf.ncols() * 10)) / 10, 40 + math::scalar(math::next_random(seed) % 200) / 10,
+			math::scalar(math::next_random(seed) % (hf.nrows() * 10)) / 10);
+		math::vec<3> to(math::scalar(math::next_random(seed) % (hf.ncols() * 10)) / 10, math::scalar(math::next_random(seed) % 400) / 10,
+			math::scalar(math::next_random(seed) % (hf.nrows() * 10)) / 10);
+
+		math::ray<3> r(from, to - from);
+		math::scalar const max_distance = (to - from).length() * 2;
+
+		math::contact_info<3> expected = trace_all_cells(hf, r, max_distance);
+		math::contact_info<3> ci = hf.trace(r, max_distance);
+
+		BOOST_REQUIRE (ci.happened == expected.happened);
+		if (ci.happened) BOOST_REQUIRE ((ci.position - expected.position).length_sq() < 0.0001f);
+	}
+}
+
+void check_regions(heightfield_t const &hf, boost::uint32_t seed, size_t nregions)
+{
+	for (size_t i = 0; i < nregions; ++i)
+	{
+		int col0 = int(math::next_random(seed) % (hf.ncols() - 1)), col1 = int(math::next_random(seed) % (hf.ncols() - 1));
+		int row0 = int(math::next_random(seed) % (hf.nrows() - 1)), row1 = int(math::next_random(seed) % (hf.nrows() - 1));
+		if (col0 > col1) std::swap(col0, col1);
+		if (row0 > row1) std::swap(row0, row1);
+
+		math::scalar expected_min = 1000, expected_max = -1000;
+
+		for (int row = row0; row <= row1 + 1; ++row)
+		{
+			for (int col = col0; col <= col1 + 1; ++col)
+			{
+				expected_min = std::min(expected_min, math::scalar(hf.local_y_at(col, row)));
+				expected_max = std::max(expected_max, math::scalar(hf.local_y_at(col, row)));
+			}
+		}
+
+		BOOST_REQUIRE (hf.min_y_in_region(col0, row0, col1, row1) == expected_min);
+		BOOST_REQUIRE (hf.max_y_in_region(col0, row0, col1, row1) == expected_max);
+	}
+}
+
+}
 
 BOOST_AUTO_TEST_SUITE(test_triangle)
 
@@ -368,4 +457,203 @@ BOOST_AUTO_TEST_CASE(test_y_under)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(test_y_under_many)
+{
+	math::matrix<4,4> tf;
+	tf.scaling(2, 1, 0.5f);
+	tf.translate(-10, 3, 7);
+
+	heightfield_t hf(tf, 37, 53);
+	math::fill_random(hf, 4321);
+
+	// cell with col != row
+	math::vec<3> const inside = math::vec<3>(20.25f, 0, 10.75f) * hf.get_local_to_world();
+	math::scalar const expected = (hf.local_y_at(20, 10) * 0.75f + hf.local_y_at(21, 10) * 0.25f) * 0.25f +
+		(hf.local_y_at(20, 11) * 0.75f + hf.local_y_at(21, 11) * 0.25f) * 0.75f;
+	BOOST_REQUIRE (abs(hf.y_under(inside) - expected) < 1e-3f);
+
+	boost::uint32_t seed = 99;
+	std::vector<math::vec<3> > positions;
+
+	// some positions are outside of heightfield, count is not multiple of four
+	for (int i = 0; i < 1003; ++i)
+	{
+		math::vec<3> local(math::scalar(math::next_random(seed) % 700) / 10 - 5, 0, math::scalar(math::next_random(seed) % 450) / 10 - 5);
+		positions.push_back(local * hf.get_local_to_world());
+	}
+
+	std::vector<math::scalar> heights(positions.size()), maxima(positions.size());
+	hf.y_under_many(&positions[0], &heights[0], positions.size(), -1);
+	hf.max_y_in_cell_many(&positions[0], &maxima[0], positions.size(), -1);
+
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		BOOST_REQUIRE (abs(heights[i] - hf.y_under(positions[i], -1)) < 1e-4f);
+		BOOST_REQUIRE (maxima[i] == hf.max_y_in_cell(positions[i], -1));
+	}
+
+	heightfield_t empty(tf, 1, 1);
+	empty.y_under_many(&positions[0], &heights[0], positions.size(), -1);
+	BOOST_REQUIRE (std::count(heights.begin(), heights.end(), -1.0f) == (int) heights.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_build_path_jump_points)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	math::heightfield<boost::uint8_t> hf(tf, 16, 16);
+
+	std::vector<boost::uint8_t> heights(16 * 16, 0);
+	for (int col = 0; col < 12; ++col) heights[8 * 16 + col] = 5;
+
+	hf.load_from_raw_buffer(&heights[0]);
+
+	math::vec<3> from(0.5f, 0, 0.5f), to(14.5f, 0, 14.5f);
+
+	std::vector<math::heightfield<boost::uint8_t>::cell_t> a_star_path = hf.build_path(from, to, 1, false,
+		std::vector<math::heightfield<boost::uint8_t>::cell_t>(), math::heightfield<boost::uint8_t>::PATH_A_STAR);
+	std::vector<math::heightfield<boost::uint8_t>::cell_t> jps_path = hf.build_path(from, to, 1, false,
+		std::vector<math::heightfield<boost::uint8_t>::cell_t>(), math::heightfield<boost::uint8_t>::PATH_JUMP_POINTS);
+
+	BOOST_REQUIRE (!a_star_path.empty());
+	BOOST_REQUIRE (!jps_path.empty());
+	BOOST_REQUIRE (jps_path.size() <= a_star_path.size());
+	BOOST_REQUIRE (jps_path.front() == math::heightfield<boost::uint8_t>::cell_t(0, 0));
+	BOOST_REQUIRE (jps_path.back() == math::heightfield<boost::uint8_t>::cell_t(14, 14));
+
+	for (size_t i = 0; i < jps_path.size(); ++i)
+	{
+		BOOST_REQUIRE (hf.max_y_in_cell(jps_path[i].x, jps_path[i].y) < 1);
+		if (i > 0) BOOST_REQUIRE ((jps_path[i] - jps_path[i - 1]).length_sq() <= 2);
+	}
+}
+
+// every heightfield keeps search arrays of its own size, searches running at same time take different ones
+BOOST_AUTO_TEST_CASE(test_build_path_pathfinders)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t small(tf, 16, 16), large(tf, 64, 64);
+	math::vec<3> from(0.5f, 0, 0.5f), to(14.5f, 0, 14.5f);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		BOOST_REQUIRE (small.build_path(from, to, 1).size() == 15);
+		BOOST_REQUIRE (large.build_path(from, to, 1).size() == 15);
+	}
+
+	boost::shared_ptr<math::dense_a_star> first = large.acquire_pathfinder();
+	boost::shared_ptr<math::dense_a_star> second = large.acquire_pathfinder();
+	BOOST_REQUIRE (first != second);
+	BOOST_REQUIRE (first->width() == 64 && first->height() == 64);
+	BOOST_REQUIRE (second->width() == 64 && second->height() == 64);
+
+	large.release_pathfinder(second);
+	BOOST_REQUIRE (large.acquire_pathfinder() == second);
+
+	large.release_pathfinder(first);
+	large.resize(32, 32);
+	BOOST_REQUIRE (large.acquire_pathfinder() != first);
+	BOOST_REQUIRE (small.acquire_pathfinder()->width() == 16);
+}
+
+BOOST_AUTO_TEST_CASE(test_trace_pyramid)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 101, 77);
+	math::fill_random(hf, 1);
+
+	check_traces(hf, 2, 300);
+
+	// edits through reference are not in pyramid until update
+	for (int col = 10; col < 70; ++col) hf.local_y_at(col, 40) = 90;
+	hf.touch(10, 40, 69, 40);
+	check_traces(hf, 3, 300);
+
+	hf.update_pyramid();
+	check_traces(hf, 4, 300);
+
+	for (int row = 5; row < 90; ++row) hf.set_local_y_at(50, row, 0);
+	check_traces(hf, 5, 300);
+}
+
+BOOST_AUTO_TEST_CASE(test_trace_many)
+{
+	math::matrix<4,4> tf;
+	tf.scaling(1.5f, 1, 0.75f);
+	tf.translate(20, -5, 10);
+
+	heightfield_t hf(tf, 101, 77);
+	math::fill_random(hf, 8);
+
+	// enough rays to be split between threads, some start outside and some miss
+	boost::uint32_t seed = 9;
+	std::vector<math::ray<3> > rays;
+
+	for (int i = 0; i < 3001; ++i)
+	{
+		math::vec<3> from(math::scalar(math::next_random(seed) % 900) / 10 - 5, 40 + math::scalar(math::next_random(seed) % 200) / 10,
+			math::scalar(math::next_random(seed) % 1100) / 10 - 5);
+		math::vec<3> to(math::scalar(math::next_random(seed) % 800) / 10, math::scalar(math::next_random(seed) % 500) / 10,
+			math::scalar(math::next_random(seed) % 1000) / 10);
+
+		from = from * hf.get_local_to_world();
+		to = to * hf.get_local_to_world();
+		rays.push_back(math::ray<3>(from, to - from));
+	}
+
+	std::vector<math::contact_info<3> > results(rays.size());
+	hf.trace_many(&rays[0], &results[0], rays.size(), 60);
+
+	size_t nhappened = 0;
+
+	for (size_t i = 0; i < rays.size(); ++i)
+	{
+		math::contact_info<3> const expected = hf.trace(rays[i], 60);
+
+		BOOST_REQUIRE (results[i].happened == expected.happened);
+		if (!expected.happened) continue;
+
+		BOOST_REQUIRE ((results[i].position - expected.position).length_sq() < 1e-4f);
+		BOOST_REQUIRE ((results[i].normal - expected.normal).length_sq() < 1e-4f);
+		++nhappened;
+	}
+
+	BOOST_REQUIRE (nhappened > rays.size() / 2 && nhappened < rays.size());
+
+	hf.trace_many(&rays[0], &results[0], 7, 60);
+	for (size_t i = 0; i < 7; ++i) BOOST_REQUIRE (results[i].happened == hf.trace(rays[i], 60).happened);
+}
+
+BOOST_AUTO_TEST_CASE(test_region_min_max)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 130, 67);
+	math::fill_random(hf, 6);
+
+	check_regions(hf, 7, 200);
+
+	hf.set_local_y_at(30, 30, 255);
+	hf.set_local_y_at(31, 60, 0);
+	check_regions(hf, 8, 200);
+
+	hf.local_y_at(5, 100) = 200;
+	hf.local_y_at(60, 3) = 1;
+	hf.touch(5, 100, 5, 100);
+	hf.touch(60, 3, 60, 3);
+	check_regions(hf, 9, 200);
+
+	hf.update_pyramid();
+	check_regions(hf, 10, 200);
+
+	BOOST_REQUIRE (hf.max_y_in_region(0, 0, 65, 128) == 255);
+	BOOST_REQUIRE (hf.max_y_in_region(100, 200, 300, 300, -1) == -1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,173 @@
+
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include "heightfield_flow_field.h"
+#include "test_random.h"
+
+namespace
+{
+
+typedef math::heightfield<boost::uint8_t> heightfield_t;
+typedef heightfield_t::cell_t cell_t;
+typedef math::heightfield_flow_field<boost::uint8_t> flow_field_t;
+
+int const SIZE = 64;
+
+void check_paths(heightfield_t const &hf, flow_field_t const &field, std::vector<cell_t> const &obstacles)
+{
+	math::vec<3> const to = hf.cell_to_world_position(field.get_goal());
+
+	for (int x = 0; x < SIZE; x += 3)
+	{
+		for (int y = 0; y < SIZE; y += 5)
+		{
+			cell_t const from(x, y);
+
+			// field is built by breadth first sweep, so its paths have as many steps as PATH_JUMP_POINTS ones
+			std::vector<cell_t> expected = hf.build_path(hf.cell_to_world_position(from), to, 1, false, obstacles,
+				heightfield_t::PATH_JUMP_POINTS);
+			std::vector<cell_t> path = field.build_path(from);
+
+			BOOST_REQUIRE (path.size() == expected.size());
+			BOOST_REQUIRE (field.is_reachable(from) == !path.empty());
+			if (path.empty()) continue;
+
+			BOOST_REQUIRE (path.front() == from);
+			BOOST_REQUIRE (path.back() == field.get_goal());
+
+			for (size_t i = 0; i < path.size(); ++i)
+			{
+				BOOST_REQUIRE (hf.max_y_in_cell(path[i].x, path[i].y) < 1);
+				BOOST_REQUIRE (std::find(obstacles.begin(), obstacles.end(), path[i]) == obstacles.end());
+			}
+		}
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_heightfield_flow_field)
+
+BOOST_AUTO_TEST_CASE(test_paths)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 5, 777);
+
+	std::vector<cell_t> obstacles;
+	for (int y = 0; y < SIZE - 4; ++y) obstacles.push_back(cell_t(SIZE / 2, y));
+
+	cell_t goal(SIZE / 3, SIZE / 2);
+	while (hf.max_y_in_cell(goal.x, goal.y) >= 1) ++goal.x;
+
+	flow_field_t field(hf, goal, 1);
+	check_paths(hf, field, std::vector<cell_t>());
+
+	flow_field_t field_with_obstacles(hf, goal, 1, obstacles);
+	check_paths(hf, field_with_obstacles, obstacles);
+
+	BOOST_REQUIRE (field.direction_at(goal) == cell_t(0, 0));
+	BOOST_REQUIRE ((field.direction_at(hf.cell_to_world_position(goal)) - math::vec<3>(0, 0, 0)).length_sq() < 0.001f);
+}
+
+BOOST_AUTO_TEST_CASE(test_invalidation)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 0, 0);
+
+	// walls keep goal area away from rest of heightfield
+	for (int i = 0; i <= 20; ++i)
+	{
+		hf.set_local_y_at(20, i, 5);
+		hf.set_local_y_at(i, 20, 5);
+	}
+
+	flow_field_t field(hf, cell_t(5, 5), 1);
+	BOOST_REQUIRE (field.is_valid());
+	BOOST_REQUIRE (field.is_reachable(cell_t(18, 18)));
+	BOOST_REQUIRE (!field.is_reachable(cell_t(25, 25)));
+	BOOST_REQUIRE (field.direction_at(math::vec<3>(15.5f, 0, 5.5f)).x < -0.99f);
+
+	hf.set_local_y_at(60, 60, 5);
+	BOOST_REQUIRE (field.is_valid());
+	BOOST_REQUIRE (!field.update());
+
+	hf.set_local_y_at(20, 10, 0);
+	hf.set_local_y_at(20, 11, 0);
+	BOOST_REQUIRE (!field.is_valid());
+	BOOST_REQUIRE (field.update());
+	BOOST_REQUIRE (field.is_reachable(cell_t(25, 25)));
+
+	field.invalidate(50, 50, 52, 52);
+	BOOST_REQUIRE (!field.is_valid());
+	BOOST_REQUIRE (field.update());
+}
+
+// field of blocked goal far from origin watches goal and is rebuilt when it becomes walkable
+BOOST_AUTO_TEST_CASE(test_blocked_goal)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 0, 0);
+
+	cell_t const goal(40, 40);
+	hf.set_local_y_at(goal.x, goal.y, 5);
+
+	flow_field_t field(hf, goal, 1);
+	BOOST_REQUIRE (field.is_valid());
+	BOOST_REQUIRE (!field.is_reachable(cell_t(10, 10)));
+
+	field.invalidate(goal.x, goal.y, goal.x, goal.y);
+	BOOST_REQUIRE (!field.is_valid());
+	BOOST_REQUIRE (field.update());
+	BOOST_REQUIRE (!field.is_reachable(cell_t(10, 10)));
+
+	hf.set_local_y_at(goal.x, goal.y, 0);
+	BOOST_REQUIRE (!field.is_valid());
+	BOOST_REQUIRE (field.update());
+	BOOST_REQUIRE (field.is_reachable(cell_t(10, 10)));
+	BOOST_REQUIRE (field.build_path(cell_t(10, 10)).size() == 31);
+}
+
+BOOST_AUTO_TEST_CASE(test_cache)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 0, 0);
+
+	math::heightfield_flow_field_cache<boost::uint8_t> cache(hf, 2);
+
+	math::heightfield_flow_field_cache<boost::uint8_t>::field_ptr f1 = cache.get(cell_t(1, 1), 1);
+	math::heightfield_flow_field_cache<boost::uint8_t>::field_ptr f2 = cache.get(cell_t(2, 2), 1);
+	BOOST_REQUIRE (cache.get(cell_t(1, 1), 1) == f1);
+	BOOST_REQUIRE (cache.get(cell_t(1, 1), 2) != f1);
+	BOOST_REQUIRE (cache.size() == 2);
+
+	// least recently used field is dropped
+	BOOST_REQUIRE (cache.get(cell_t(2, 2), 1) != f2);
+	BOOST_REQUIRE (cache.get(cell_t(1, 1), 1) != f1);
+
+	f1 = cache.get(cell_t(1, 1), 1);
+	hf.set_local_y_at(10, 10, 5);
+	BOOST_REQUIRE (!f1->is_valid());
+	BOOST_REQUIRE (cache.get(cell_t(1, 1), 1) == f1);
+	BOOST_REQUIRE (f1->is_valid());
+	BOOST_REQUIRE (!f1->is_reachable(cell_t(9, 9)));
+
+	cache.invalidate(0, 0, 1, 1);
+	BOOST_REQUIRE (!f1->is_valid());
+	cache.clear();
+	BOOST_REQUIRE (cache.size() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
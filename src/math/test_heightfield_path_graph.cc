@@ -0,0 +1,270 @@
+
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "heightfield_path_graph.h"
+#include "test_random.h"
+
+namespace
+{
+
+typedef math::heightfield<boost::uint8_t> heightfield_t;
+typedef heightfield_t::cell_t cell_t;
+
+// only cells (x0 + k * dx, y0 + k) are walkable, so chain could only be followed diagonally
+void carve_chain(heightfield_t &hf, int x0, int y0, int dx, int length)
+{
+	std::vector<boost::uint8_t> heights(hf.ncols() * hf.nrows(), 5);
+
+	for (int k = 0; k < length; ++k)
+	{
+		int const x = x0 + k * dx, y = y0 + k;
+		heights[y * hf.ncols() + x] = heights[y * hf.ncols() + x + 1] = 0;
+		heights[(y + 1) * hf.ncols() + x] = heights[(y + 1) * hf.ncols() + x + 1] = 0;
+	}
+
+	hf.load_from_raw_buffer(&heights[0]);
+}
+
+void check_path(heightfield_t const &hf, std::vector<cell_t> const &path, cell_t const &from, cell_t const &to)
+{
+	BOOST_REQUIRE (!path.empty());
+	BOOST_REQUIRE (path.front() == from);
+	BOOST_REQUIRE (path.back() == to);
+
+	for (size_t i = 0; i < path.size(); ++i)
+	{
+		BOOST_REQUIRE (hf.max_y_in_cell(path[i].x, path[i].y) < 1);
+		if (i > 0) BOOST_REQUIRE ((path[i] - path[i - 1]).length_sq() <= 2);
+	}
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_heightfield_path_graph)
+
+BOOST_AUTO_TEST_CASE(test_paths)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 128, 128);
+	math::fill_obstacles(hf, 8, 12345);
+
+	math::heightfield_path_graph<boost::uint8_t> graph(hf, 1, 16);
+	BOOST_REQUIRE (graph.nclusters() == 64);
+	BOOST_REQUIRE (graph.nnodes() > 0);
+
+	cell_t const points[] = { cell_t(1, 2), cell_t(120, 117), cell_t(3, 110), cell_t(100, 6), cell_t(60, 70), cell_t(66, 75) };
+	size_t const npoints = sizeof(points) / sizeof(points[0]);
+
+	for (size_t i = 0; i < npoints; ++i)
+	{
+		for (size_t j = 0; j < npoints; ++j)
+		{
+			if (hf.max_y_in_cell(points[i].x, points[i].y) >= 1 || hf.max_y_in_cell(points[j].x, points[j].y) >= 1) continue;
+
+			std::vector<cell_t> optimal = hf.build_path(hf.cell_to_world_position(points[i]), hf.cell_to_world_position(points[j]), 1);
+			std::vector<cell_t> path = graph.build_path(points[i], points[j]);
+
+			if (optimal.empty())
+			{
+				BOOST_REQUIRE (path.empty());
+				continue;
+			}
+
+			check_path(hf, path, points[i], points[j]);
+			// heightfield::build_path minimizes euclidean length, graph counts steps, so only
+			// difference in number of steps is checked
+			BOOST_REQUIRE (path.size() * 4 <= optimal.size() * 5);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_local_update)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 128, 128);
+	math::fill_obstacles(hf, 0, 0);
+
+	math::heightfield_path_graph<boost::uint8_t> graph(hf, 1, 32);
+	BOOST_REQUIRE (graph.update() == 0);
+
+	// vertex inside of cluster (1, 1) blocks four cells around it, entrances stay same
+	hf.set_local_y_at(48, 48, 5);
+	BOOST_REQUIRE (graph.update() == 1);
+	BOOST_REQUIRE (graph.update() == 0);
+
+	// vertex on border between clusters (1, 1) and (2, 1) changes entrances of both
+	hf.set_local_y_at(64, 40, 5);
+	size_t nrebuilt = graph.update();
+	BOOST_REQUIRE (nrebuilt >= 2 && nrebuilt < graph.nclusters());
+
+	cell_t const from(40, 40), to(90, 50);
+	std::vector<cell_t> path = graph.build_path(from, to);
+	check_path(hf, path, from, to);
+	BOOST_REQUIRE (std::find(path.begin(), path.end(), cell_t(48, 48)) == path.end());
+
+	std::vector<cell_t> waypoints = graph.build_path(from, to, false);
+	BOOST_REQUIRE (waypoints.size() >= 2 && waypoints.size() < path.size());
+}
+
+BOOST_AUTO_TEST_CASE(test_resize)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 64, 64);
+	math::fill_obstacles(hf, 0, 0);
+
+	math::heightfield_path_graph<boost::uint8_t> graph(hf, 1, 32);
+	BOOST_REQUIRE (graph.nclusters() == 4);
+
+	hf.resize(100, 64);
+	BOOST_REQUIRE (graph.update() > 0);
+	BOOST_REQUIRE (graph.nclusters() == 8);
+
+	cell_t const from(2, 2), to(95, 60);
+	check_path(hf, graph.build_path(from, to), from, to);
+
+	hf.resize(40, 40);
+	graph.update();
+	BOOST_REQUIRE (graph.nclusters() == 4);
+	BOOST_REQUIRE (graph.build_path(from, to).empty());
+
+	cell_t const near_to(37, 37);
+	check_path(hf, graph.build_path(from, near_to), from, near_to);
+}
+
+// chains cross cluster corners and borders only by diagonal moves
+BOOST_AUTO_TEST_CASE(test_diagonal_entrances)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 65, 65);
+
+	struct chain { int x0, y0, dx, length; };
+	chain const chains[] = { { 0, 0, 1, 64 }, { 63, 0, -1, 64 }, { 0, 10, 1, 54 } };
+
+	for (size_t i = 0; i < sizeof(chains) / sizeof(chains[0]); ++i)
+	{
+		chain const &c = chains[i];
+		carve_chain(hf, c.x0, c.y0, c.dx, c.length);
+
+		math::heightfield_path_graph<boost::uint8_t> graph(hf, 1, 32);
+
+		cell_t const from(c.x0, c.y0), to(c.x0 + (c.length - 1) * c.dx, c.y0 + c.length - 1);
+		std::vector<cell_t> path = graph.build_path(from, to);
+
+		check_path(hf, path, from, to);
+		BOOST_REQUIRE (path.size() == size_t(c.length));
+		BOOST_REQUIRE (graph.build_path(to, from).size() == size_t(c.length));
+	}
+}
+
+// walls around goal span several clusters, so abstract search fails and no path is returned
+BOOST_AUTO_TEST_CASE(test_disconnected)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 128, 128);
+	math::fill_obstacles(hf, 0, 0);
+
+	for (int i = 20; i <= 100; ++i)
+	{
+		hf.set_local_y_at(20, i, 5);
+		hf.set_local_y_at(100, i, 5);
+		hf.set_local_y_at(i, 20, 5);
+		hf.set_local_y_at(i, 100, 5);
+	}
+
+	math::heightfield_path_graph<boost::uint8_t> graph(hf, 1, 32);
+	cell_t const from(2, 2), to(60, 60);
+
+	BOOST_REQUIRE (hf.build_path(hf.cell_to_world_position(from), hf.cell_to_world_position(to), 1).empty());
+	BOOST_REQUIRE (graph.build_path(from, to).empty());
+	BOOST_REQUIRE (graph.build_path(from, to, false).empty());
+	check_path(hf, graph.build_path(from, cell_t(120, 60)), from, cell_t(120, 60));
+}
+
+// long paths between left and right parts of heightfield, walls reaching almost to bottom make
+// heightfield::build_path expand large part of heightfield, graph search expands only entrance nodes
+BOOST_AUTO_TEST_CASE(test_benchmark)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	int const size = 1024, nwalls = 3;
+	size_t const nqueries = 16;
+
+	heightfield_t hf(tf, size, size);
+
+	std::vector<std::pair<cell_t, cell_t> > queries;
+	boost::uint32_t seed = 1;
+
+	for (int walls = 0; walls < 2; ++walls)
+	{
+		math::fill_obstacles(hf, 8, 4321);
+
+		for (int w = 1; walls && w <= nwalls; ++w)
+		{
+			for (int row = 0; row < size - 16; ++row) hf.set_local_y_at(size * w / (nwalls + 1), row, 5);
+		}
+
+		boost::posix_time::ptime start_time(boost::posix_time::microsec_clock::local_time());
+		math::heightfield_path_graph<boost::uint8_t> graph(hf, 1, 32);
+		double build_ms = double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000;
+
+		queries.clear();
+
+		while (queries.size() < nqueries)
+		{
+			cell_t cells[2];
+
+			for (int i = 0; i < 2; ++i)
+			{
+				boost::uint32_t const r = math::next_random(seed);
+				cells[i] = cell_t(int(r % (size / 8)), int((r >> 12) % (size / 8)));
+			}
+
+			// without walls from top left corner to bottom right one, with them to top right one
+			cells[1] = cell_t(size - 2 - cells[1].x, walls ? cells[1].y : size - 2 - cells[1].y);
+			if (hf.max_y_in_cell(cells[0].x, cells[0].y) < 1 && hf.max_y_in_cell(cells[1].x, cells[1].y) < 1) queries.push_back(std::make_pair(cells[0], cells[1]));
+		}
+
+		std::vector<std::vector<cell_t> > paths(nqueries), optimal_paths(nqueries);
+
+		start_time = boost::posix_time::microsec_clock::local_time();
+		for (size_t i = 0; i < nqueries; ++i) graph.build_path(queries[i].first, queries[i].second, false);
+		double waypoints_ms = double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000 / nqueries;
+
+		start_time = boost::posix_time::microsec_clock::local_time();
+		for (size_t i = 0; i < nqueries; ++i) paths[i] = graph.build_path(queries[i].first, queries[i].second);
+		double graph_ms = double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000 / nqueries;
+
+		start_time = boost::posix_time::microsec_clock::local_time();
+		for (size_t i = 0; i < nqueries; ++i)
+		{
+			optimal_paths[i] = hf.build_path(hf.cell_to_world_position(queries[i].first), hf.cell_to_world_position(queries[i].second), 1);
+		}
+		double optimal_ms = double((boost::posix_time::microsec_clock::local_time() - start_time).total_microseconds()) / 1000 / nqueries;
+
+		for (size_t i = 0; i < nqueries; ++i)
+		{
+			check_path(hf, paths[i], queries[i].first, queries[i].second);
+			BOOST_REQUIRE (paths[i].size() * 4 <= optimal_paths[i].size() * 5);
+		}
+
+		if (walls) BOOST_REQUIRE (graph_ms * 4 < optimal_ms);
+
+		BOOST_TEST_MESSAGE(size << "x" << size << (walls ? " with walls" : "") << ": graph built in " << build_ms << " ms, "
+			<< waypoints_ms << " ms per waypoints, " << graph_ms << " ms per refined path, heightfield::build_path "
+			<< optimal_ms << " ms per path");
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,199 @@
+
+#include <ctime>
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include "heightfield_path_planner.h"
+#include "test_random.h"
+
+namespace
+{
+
+typedef math::heightfield<boost::uint8_t> heightfield_t;
+typedef heightfield_t::cell_t cell_t;
+typedef math::heightfield_path_planner<boost::uint8_t> planner_t;
+
+int const SIZE = 96;
+
+// jump point search returns paths with minimal number of steps
+size_t optimal_length(heightfield_t const &hf, cell_t const &from, cell_t const &to, std::vector<cell_t> const &obstacles)
+{
+	return hf.build_path(hf.cell_to_world_position(from), hf.cell_to_world_position(to), 1, false, obstacles,
+		heightfield_t::PATH_JUMP_POINTS).size();
+}
+
+void check_path(heightfield_t const &hf, std::vector<cell_t> const &path, cell_t const &from, cell_t const &to,
+	std::vector<cell_t> const &obstacles)
+{
+	BOOST_REQUIRE (path.size() == optimal_length(hf, from, to, obstacles));
+	if (path.empty()) return;
+
+	BOOST_REQUIRE (path.front() == from);
+	BOOST_REQUIRE (path.back() == to);
+
+	for (size_t i = 0; i < path.size(); ++i)
+	{
+		BOOST_REQUIRE (hf.max_y_in_cell(path[i].x, path[i].y) < 1);
+		BOOST_REQUIRE (std::find(obstacles.begin(), obstacles.end(), path[i]) == obstacles.end());
+		if (i > 0) BOOST_REQUIRE ((path[i] - path[i - 1]).length_sq() <= 2);
+	}
+}
+
+cell_t walkable_cell(heightfield_t const &hf, cell_t c)
+{
+	while (hf.max_y_in_cell(c.x, c.y) >= 1) ++c.x;
+	return c;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_heightfield_path_planner)
+
+BOOST_AUTO_TEST_CASE(test_obstacles)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 4, 2468);
+
+	cell_t const from = walkable_cell(hf, cell_t(3, 4)), to = walkable_cell(hf, cell_t(80, 85));
+	std::vector<cell_t> obstacles;
+
+	planner_t planner(hf, 1);
+	planner.plan(from, to);
+
+	std::vector<cell_t> path = planner.build_path();
+	check_path(hf, path, from, to, obstacles);
+
+	size_t const initial_expanded_points = planner.expanded_points();
+
+	// obstacles appear on path one by one
+	for (int i = 0; i < 8; ++i)
+	{
+		cell_t const obstacle = path[path.size() / 2 + i - 4];
+
+		obstacles.push_back(obstacle);
+		planner.add_obstacle(obstacle);
+
+		size_t const expanded_points = planner.expanded_points();
+		path = planner.build_path();
+		check_path(hf, path, from, to, obstacles);
+
+		BOOST_REQUIRE (planner.expanded_points() - expanded_points < initial_expanded_points);
+	}
+
+	while (!obstacles.empty())
+	{
+		planner.remove_obstacle(obstacles.back());
+		obstacles.pop_back();
+
+		check_path(hf, planner.build_path(), from, to, obstacles);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_move_start)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 4, 2468);
+
+	cell_t const to = walkable_cell(hf, cell_t(90, 10));
+	planner_t planner(hf, 1);
+	planner.plan(walkable_cell(hf, cell_t(5, 80)), to);
+
+	std::vector<cell_t> path = planner.build_path();
+	std::vector<cell_t> obstacles;
+
+	// agent walks along path while obstacles keep appearing in front of it
+	for (int step = 0; planner.get_start() != to; ++step)
+	{
+		BOOST_REQUIRE (path.size() >= 2);
+		BOOST_REQUIRE (step < SIZE * SIZE);
+
+		planner.move_start(path[1]);
+
+		if (step % 5 == 0 && path.size() > 6)
+		{
+			obstacles.push_back(path[5]);
+			planner.add_obstacle(path[5]);
+		}
+
+		path = planner.build_path();
+		check_path(hf, path, planner.get_start(), to, obstacles);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_heightfield_edits)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, SIZE, SIZE);
+	math::fill_obstacles(hf, 0, 0);
+
+	cell_t const from(10, 40), to(80, 40);
+	std::vector<cell_t> const no_obstacles;
+
+	planner_t planner(hf, 1);
+	planner.plan(from, to);
+	check_path(hf, planner.build_path(), from, to, no_obstacles);
+
+	// wall across straight path with gap at the bottom
+	for (int row = 0; row < SIZE - 20; ++row) hf.set_local_y_at(50, row, 5);
+
+	std::vector<cell_t> path = planner.build_path();
+	check_path(hf, path, from, to, no_obstacles);
+	BOOST_REQUIRE (path.size() > 71);
+
+	for (int row = 0; row < SIZE - 20; ++row) hf.set_local_y_at(50, row, 0);
+	check_path(hf, planner.build_path(), from, to, no_obstacles);
+
+	hf.resize(SIZE / 2, SIZE);
+	BOOST_REQUIRE (planner.build_path().empty());
+
+	hf.resize(SIZE, SIZE);
+	check_path(hf, planner.build_path(), from, to, no_obstacles);
+}
+
+// short searches on large heightfield touch few pages, obstacles of previous plan are dropped
+BOOST_AUTO_TEST_CASE(test_replan)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	int const size = 2048;
+	heightfield_t hf(tf, size, size);
+	math::fill_obstacles(hf, 4, 2468);
+
+	std::vector<cell_t> obstacles;
+	planner_t planner(hf, 1);
+
+	int const plans = 200;
+	std::clock_t const start = std::clock();
+
+	for (int i = 0; i < plans; ++i)
+	{
+		cell_t const origin(37 * i % (size - 64), 91 * i % (size - 64));
+		cell_t const from = walkable_cell(hf, origin), to = walkable_cell(hf, origin + cell_t(40, 30));
+
+		planner.plan(from, to);
+		std::vector<cell_t> path = planner.build_path();
+		check_path(hf, path, from, to, obstacles);
+
+		if (path.size() < 3) continue;
+
+		// obstacle is used by this plan only
+		obstacles.push_back(path[path.size() / 2]);
+		planner.add_obstacle(obstacles.back());
+		check_path(hf, planner.build_path(), from, to, obstacles);
+		obstacles.clear();
+	}
+
+	double const plan_time = double(std::clock() - start) / CLOCKS_PER_SEC / plans;
+	BOOST_TEST_MESSAGE("short plan on " << size << "x" << size << " heightfield: " << plan_time * 1e3 << "ms");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
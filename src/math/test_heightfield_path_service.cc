@@ -0,0 +1,179 @@
+
+#include <map>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include "dense_a_star.h"
+#include "heightfield_path_service.h"
+#include "test_random.h"
+
+namespace
+{
+
+typedef math::heightfield<boost::uint8_t> heightfield_t;
+typedef heightfield_t::cell_t cell_t;
+typedef math::heightfield_path_service<boost::uint8_t> service_t;
+
+size_t const SIZE = 96;
+size_t const NREQUESTS = 64;
+
+math::matrix<4,4> identity()
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+	return tf;
+}
+
+struct fixture
+{
+	heightfield_t hf;
+	std::vector<math::vec<3> > from, to;
+	std::vector<std::vector<cell_t> > obstacles;
+
+	fixture():
+		hf(identity(), SIZE, SIZE)
+	{
+		boost::uint32_t seed = 4321;
+		math::fill_obstacles(hf, 15, seed);
+
+		for (size_t i = 0; i < NREQUESTS; ++i)
+		{
+			boost::uint32_t r = math::next_random(seed);
+			from.push_back(hf.cell_to_world_position(cell_t(int(r % SIZE), int((r >> 12) % SIZE))));
+			r = math::next_random(seed);
+			to.push_back(hf.cell_to_world_position(cell_t(int(r % SIZE), int((r >> 12) % SIZE))));
+
+			obstacles.push_back(std::vector<cell_t>());
+			for (int j = 0; j < int(i % 4) * 8; ++j) obstacles.back().push_back(cell_t(int(SIZE) / 2, j * 2));
+		}
+	}
+
+	std::vector<service_t::request_id_t> submit(service_t &service)
+	{
+		std::vector<service_t::request_id_t> ids;
+
+		for (size_t i = 0; i < NREQUESTS; ++i)
+		{
+			ids.push_back(service.submit(from[i], to[i], 1, i % 2 == 0, obstacles[i],
+				i % 3 == 0 ? heightfield_t::PATH_JUMP_POINTS : heightfield_t::PATH_A_STAR));
+		}
+
+		return ids;
+	}
+
+	void check_results(std::vector<service_t::request_id_t> const &ids, std::deque<service_t::result> const &results)
+	{
+		BOOST_REQUIRE (results.size() == NREQUESTS);
+
+		std::map<service_t::request_id_t, size_t> requests;
+		for (size_t i = 0; i < ids.size(); ++i) requests[ids[i]] = i;
+
+		for (std::deque<service_t::result>::const_iterator it = results.begin(); it != results.end(); ++it)
+		{
+			BOOST_REQUIRE (requests.count(it->id) == 1);
+			size_t i = requests[it->id];
+			requests.erase(it->id);
+
+			std::vector<cell_t> expected = hf.build_path(from[i], to[i], 1, i % 2 == 0, obstacles[i],
+				i % 3 == 0 ? heightfield_t::PATH_JUMP_POINTS : heightfield_t::PATH_A_STAR);
+
+			BOOST_REQUIRE (it->path == expected);
+		}
+	}
+};
+
+struct collector
+{
+	boost::mutex mutex;
+	std::deque<service_t::result> results;
+
+	void on_result(service_t::result const &r)
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		results.push_back(r);
+	}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_heightfield_path_service)
+
+BOOST_AUTO_TEST_CASE(test_same_paths)
+{
+	fixture f;
+
+	for (size_t nthreads = 0; nthreads <= 4; nthreads += 4)
+	{
+		service_t service(f.hf, nthreads);
+		std::vector<service_t::request_id_t> ids = f.submit(service);
+		BOOST_REQUIRE (service.npending() == NREQUESTS);
+
+		std::deque<service_t::result> results, tick_results;
+
+		for (size_t tick = 0; tick < 1000 && results.size() < NREQUESTS; ++tick)
+		{
+			service.tick(SIZE * SIZE);
+			service.wait();
+			service.collect_results(tick_results);
+			results.insert(results.end(), tick_results.begin(), tick_results.end());
+		}
+
+		BOOST_REQUIRE (service.npending() == 0);
+		f.check_results(ids, results);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_budget)
+{
+	fixture f;
+	service_t service(f.hf, 0);
+
+	service.submit(f.hf.cell_to_world_position(cell_t(0, 0)), f.hf.cell_to_world_position(cell_t(SIZE - 2, SIZE - 2)), 1);
+
+	std::deque<service_t::result> results;
+	size_t const budget = 16;
+	size_t nticks = 0;
+
+	service.collect_results(results);
+	BOOST_REQUIRE (results.empty());
+
+	while (results.empty() && nticks < SIZE * SIZE)
+	{
+		service.tick(budget);
+		service.collect_results(results);
+		++nticks;
+	}
+
+	BOOST_REQUIRE (results.size() == 1);
+	BOOST_REQUIRE (results[0].expanded_points > budget);
+	BOOST_REQUIRE (results[0].expanded_points <= nticks * budget);
+	BOOST_REQUIRE (results[0].expanded_points > (nticks - 1) * budget);
+	BOOST_REQUIRE (service.npending() == 0);
+
+	// search arrays went back to heightfield with finished search
+	BOOST_REQUIRE (f.hf.acquire_pathfinder()->expanded_points() == results[0].expanded_points);
+}
+
+BOOST_AUTO_TEST_CASE(test_result_callback)
+{
+	fixture f;
+	service_t service(f.hf, 3);
+	collector c;
+
+	service.set_result_callback(boost::bind(&collector::on_result, &c, _1));
+	std::vector<service_t::request_id_t> ids = f.submit(service);
+
+	for (size_t tick = 0; tick < 1000 && service.npending() > 0; ++tick)
+	{
+		service.tick(service_t::EXPANSIONS_SLICE * 4);
+		service.wait();
+	}
+
+	std::deque<service_t::result> results;
+	BOOST_REQUIRE (service.collect_results(results) == 0);
+	f.check_results(ids, c.results);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,10 +1,19 @@
 
+#include <ctime>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 #include "matrix.h"
+#include "simd_matrix.h"
+#include "test_random.h"
 
 namespace
 {
 
+double seconds_since(std::clock_t start)
+{
+	return double(std::clock() - start) / CLOCKS_PER_SEC;
+}
+
 template<int N> void
 test_axis_angle_i(math::vec<3> const &src, math::vec<3> const &axis, math::scalar angle, math::vec<3> const &res)
 {
@@ -161,4 +170,117 @@ BOOST_AUTO_TEST_CASE (test_matrix_inverse_4x4_4)
 	BOOST_REQUIRE(math::equal(R, U));
 }
 
+BOOST_AUTO_TEST_CASE (test_matrix_inverse_affine)
+{
+	for (int i = 0; i < 100; ++i)
+	{
+		math::matrix<4,4> M = math::random_affine(), I, J;
+
+		BOOST_REQUIRE(M.inverse_affine(I));
+		BOOST_REQUIRE(M.inverse(J));
+		BOOST_REQUIRE(math::equal(I, J, 1e-4f));
+	}
+
+	math::matrix<4,4> Z, I;
+	Z.scaling(1, 0, 1);
+	BOOST_REQUIRE(!Z.inverse_affine(I));
+}
+
+BOOST_AUTO_TEST_CASE (test_simd_matrix)
+{
+	for (int i = 0; i < 100; ++i)
+	{
+		math::matrix<4,4> A = math::random_affine(), B = math::random_affine(), R, T, I;
+		math::simd_matrix a(A), b(B), r;
+
+		// sse mul of matrix<4,4> gives exactly same results as generic one
+		math::mul<4,4,4>(R, A, B);
+		BOOST_REQUIRE(math::equal(A * B, R, 0.0f));
+
+		math::vec<4> v(math::random(-5, 5), math::random(-5, 5), math::random(-5, 5), 1), u;
+		math::mul<math::scalar>(u, v, A);
+		BOOST_REQUIRE((v * A - u).length_sq() == 0);
+
+		BOOST_REQUIRE(math::equal((a * b).to_matrix(), R, 1e-4f));
+
+		r = a;
+		r *= b;
+		BOOST_REQUIRE(math::equal(r.to_matrix(), R, 1e-4f));
+
+		a.transpose(r);
+		A.transpose(T);
+		BOOST_REQUIRE(math::equal(r.to_matrix(), T));
+
+		BOOST_REQUIRE(a.inverse_affine(r));
+		A.inverse(I);
+		BOOST_REQUIRE(math::equal(r.to_matrix(), I, 1e-4f));
+
+		math::vec<3> p(v.x, v.y, v.z);
+		BOOST_REQUIRE((a.transform_point(p) - p * A).length_sq() < 1e-6f);
+		BOOST_REQUIRE((a.transform(v) - v * A).length_sq() < 1e-6f);
+
+		math::vec<4> d = math::vec<4>(p.x, p.y, p.z, 0) * A;
+		BOOST_REQUIRE((a.transform_vector(p) - math::vec<3>(d.x, d.y, d.z)).length_sq() < 1e-6f);
+
+		math::simd_vec4 w(v);
+		a.transform(w, w);
+		BOOST_REQUIRE((w.to_vec() - v * A).length_sq() < 1e-6f);
+		BOOST_REQUIRE(size_t(&w) % 16 == 0 && size_t(&r) % 16 == 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE (test_matrix_multiply_benchmark)
+{
+	size_t const N = 256, ITERATIONS = 2000;
+
+	std::vector<math::matrix<4,4> > matrices(N);
+	std::vector<math::simd_matrix> simd_matrices(N);
+	for (size_t i = 0; i < N; ++i) simd_matrices[i].assign(matrices[i] = math::random_affine());
+
+	math::matrix<4,4> R, T;
+	math::simd_matrix r;
+	R.identity();
+	r.identity();
+
+	std::clock_t start = std::clock();
+	for (size_t k = 0; k < ITERATIONS; ++k)
+	{
+		for (size_t i = 0; i < N; ++i) math::mul<4,4,4>(T, matrices[i], matrices[(i + k) % N]), R.ij[0][0] += T.ij[3][3];
+	}
+	double const generic_time = seconds_since(start);
+
+	start = std::clock();
+	for (size_t k = 0; k < ITERATIONS; ++k)
+	{
+		for (size_t i = 0; i < N; ++i) math::mul(T, matrices[i], matrices[(i + k) % N]), R.ij[0][0] += T.ij[3][3];
+	}
+	double const sse_time = seconds_since(start);
+
+	start = std::clock();
+	for (size_t k = 0; k < ITERATIONS; ++k)
+	{
+		for (size_t i = 0; i < N; ++i) r = simd_matrices[i] * simd_matrices[(i + k) % N], R.ij[0][0] += r.ij[3][3];
+	}
+	double const simd_matrix_time = seconds_since(start);
+
+	start = std::clock();
+	for (size_t k = 0; k < ITERATIONS / 4; ++k)
+	{
+		for (size_t i = 0; i < N; ++i) matrices[i].inverse(T), R.ij[0][0] += T.ij[3][3];
+	}
+	double const inverse_time = seconds_since(start);
+
+	start = std::clock();
+	for (size_t k = 0; k < ITERATIONS / 4; ++k)
+	{
+		for (size_t i = 0; i < N; ++i) simd_matrices[i].inverse_affine(r), R.ij[0][0] += r.ij[3][3];
+	}
+	double const inverse_affine_time = seconds_since(start);
+
+	BOOST_TEST_MESSAGE("matrix<4,4> multiply: generic " << generic_time << "s, sse " << sse_time << "s, simd_matrix " <<
+		simd_matrix_time << "s; inverse " << inverse_time << "s, simd_matrix::inverse_affine " << inverse_affine_time << "s");
+
+	BOOST_REQUIRE(R.ij[0][0] == R.ij[0][0]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,123 @@
+
+#include <vector>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/test/unit_test.hpp>
+#include "parallel.h"
+
+namespace
+{
+
+struct counter
+{
+	typedef boost::shared_ptr<counter> ptr;
+
+	std::vector<int> visits;
+	std::vector<std::pair<size_t, size_t> > ranges;
+	boost::mutex mutex;
+
+	explicit counter(size_t count):
+		visits(count, 0)
+	{
+	}
+
+	void visit(size_t first, size_t count)
+	{
+		for (size_t i = first; i < first + count; ++i) ++visits[i];
+
+		boost::mutex::scoped_lock lock(mutex);
+		ranges.push_back(std::make_pair(first, count));
+	}
+
+	bool all_visited_once() const
+	{
+		for (size_t i = 0; i < visits.size(); ++i) if (visits[i] != 1) return false;
+		return true;
+	}
+};
+
+std::vector<counter::ptr> create_counters(size_t n, size_t count)
+{
+	std::vector<counter::ptr> result;
+	for (size_t i = 0; i < n; ++i) result.push_back(counter::ptr(new counter(count)));
+	return result;
+}
+
+void inner_loop(std::vector<counter::ptr> const *counters, size_t first, size_t count)
+{
+	for (size_t i = first; i < first + count; ++i)
+	{
+		counter &c = *(*counters)[i];
+		math::parallel_for(c.visits.size(), 16, 1, boost::bind(&counter::visit, &c, _1, _2));
+	}
+}
+
+void throw_at_end(size_t first, size_t count, size_t size)
+{
+	if (first + count == size) throw std::runtime_error("last range");
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_parallel)
+
+BOOST_AUTO_TEST_CASE(ranges)
+{
+	size_t const sizes[] = { 0, 1, 7, 100, 1001, 65536 + 3 };
+
+	for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+	{
+		counter c(sizes[k]);
+		math::parallel_for(sizes[k], 64, 4, boost::bind(&counter::visit, &c, _1, _2));
+
+		BOOST_REQUIRE (c.all_visited_once());
+		BOOST_REQUIRE (sizes[k] < 64 ? c.ranges.size() <= 1 : c.ranges.size() <= math::parallel_threads_count());
+
+		for (size_t i = 0; i < c.ranges.size(); ++i)
+		{
+			bool const last = c.ranges[i].first + c.ranges[i].second == sizes[k];
+			BOOST_REQUIRE (c.ranges[i].first % 4 == 0);
+			BOOST_REQUIRE (last || c.ranges[i].second % 4 == 0);
+			BOOST_REQUIRE (c.ranges.size() == 1 || c.ranges[i].second >= 32 || last);
+		}
+	}
+}
+
+// body running on pool thread starts loops of its own
+BOOST_AUTO_TEST_CASE(nested)
+{
+	std::vector<counter::ptr> const counters = create_counters(64, 1000);
+
+	math::parallel_for(counters.size(), 2, 1, boost::bind(&inner_loop, &counters, _1, _2));
+
+	for (size_t i = 0; i < counters.size(); ++i) BOOST_REQUIRE (counters[i]->all_visited_once());
+}
+
+// threads share pool, every loop waits for its own ranges
+BOOST_AUTO_TEST_CASE(concurrent)
+{
+	size_t const nthreads = 4, count = 1 << 16;
+	std::vector<counter::ptr> const counters = create_counters(nthreads, count);
+
+	boost::thread_group threads;
+	for (size_t i = 0; i < nthreads; ++i)
+	{
+		threads.create_thread(boost::bind(&math::parallel_for, count, 1024, 1,
+			math::parallel_body_t(boost::bind(&counter::visit, counters[i].get(), _1, _2))));
+	}
+	threads.join_all();
+
+	for (size_t i = 0; i < nthreads; ++i) BOOST_REQUIRE (counters[i]->all_visited_once());
+}
+
+// exception of calling thread leaves loop after pool threads are done with it
+BOOST_AUTO_TEST_CASE(exception)
+{
+	size_t const count = 4096;
+	BOOST_REQUIRE_THROW (math::parallel_for(count, 64, 1, boost::bind(&throw_at_end, _1, _2, count)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "matrix.h"
+
+namespace math
+{
+
+// scaling, rotation and translation, so affine inverse exists
+inline matrix<4,4> random_affine()
+{
+	matrix<4,4> M;
+	M.scaling(random(0.5f, 2), random(0.5f, 2), random(0.5f, 2));
+	M.rotate(random(0, PI), random(0, PI), random(0, PI));
+	M.translate(random(-10, 10), random(-10, 10), random(-10, 10));
+	return M;
+}
+
+// linear congruential generator, tests get same numbers on every platform
+inline boost::uint32_t next_random(boost::uint32_t &seed)
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+// flat heightfield with obstacles_percent of vertices raised to 5, cells around them are blocked
+// for paths with smaller min_value
+template<class Heightfield>
+void fill_obstacles(Heightfield &hf, int obstacles_percent, boost::uint32_t seed)
+{
+	std::vector<typename Heightfield::value_t> heights(hf.ncols() * hf.nrows(), 0);
+
+	for (size_t i = 0; i < heights.size(); ++i)
+	{
+		if (int((next_random(seed) >> 8) % 100) < obstacles_percent) heights[i] = 5;
+	}
+
+	hf.load_from_raw_buffer(&heights[0]);
+}
+
+// smooth hills with few spikes
+template<class Heightfield>
+void fill_random(Heightfield &hf, boost::uint32_t seed)
+{
+	typedef typename Heightfield::value_t value_t;
+	std::vector<value_t> heights(hf.ncols() * hf.nrows());
+
+	for (size_t row = 0; row < hf.nrows(); ++row)
+	{
+		for (size_t col = 0; col < hf.ncols(); ++col)
+		{
+			heights[row * hf.ncols() + col] = value_t(20 + 15 * std::sin(col * 0.1f) * std::cos(row * 0.13f));
+			if (next_random(seed) % 50 == 0) heights[row * hf.ncols() + col] = value_t(next_random(seed) % 60);
+		}
+	}
+
+	hf.load_from_raw_buffer(&heights[0]);
+}
+
+}
@@ -0,0 +1,169 @@
+
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include "tiled_heightfield.h"
+#include "test_random.h"
+
+namespace
+{
+
+typedef math::heightfield<boost::uint8_t> heightfield_t;
+typedef math::tiled_heightfield<boost::uint8_t> tiled_heightfield_t;
+
+struct temp_file
+{
+	std::string path;
+
+	temp_file(): path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()) {}
+	~temp_file() { boost::filesystem::remove(path); }
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_tiled_heightfield)
+
+BOOST_AUTO_TEST_CASE(test_heights)
+{
+	math::matrix<4,4> tf;
+	tf.translation(-50, 0, 30);
+
+	// 200 columns and 150 rows, so last tiles are partial
+	heightfield_t hf(tf, 150, 200);
+	math::fill_random(hf, 123);
+
+	temp_file file;
+	tiled_heightfield_t::write(file.path, hf);
+
+	tiled_heightfield_t thf(file.path, 4);
+	BOOST_REQUIRE (thf.nmapped_tiles() == 0);
+	BOOST_REQUIRE (thf.ncols() == hf.ncols() && thf.nrows() == hf.nrows());
+	BOOST_REQUIRE (thf.get_local_aabb().lo.y == hf.get_local_aabb().lo.y);
+	BOOST_REQUIRE (thf.get_local_aabb().hi.y == hf.get_local_aabb().hi.y);
+
+	for (int row = 0; row < (int) hf.nrows(); ++row)
+	{
+		for (int col = 0; col < (int) hf.ncols(); ++col)
+		{
+			BOOST_REQUIRE (thf.local_y_at(col, row) == hf.local_y_at(col, row));
+		}
+	}
+
+	BOOST_REQUIRE (thf.nmapped_tiles() == 4);
+	BOOST_CHECK_THROW (thf.local_y_at(200, 0), std::out_of_range);
+
+	boost::uint32_t seed = 5;
+
+	for (int i = 0; i < 1000; ++i)
+	{
+		math::vec<3> p(math::scalar(math::next_random(seed) % 2200) / 10 - 60, 0, math::scalar(math::next_random(seed) % 1600) / 10 + 25);
+
+		BOOST_REQUIRE (thf.y_under(p, -1) == hf.y_under(p, -1));
+		BOOST_REQUIRE (thf.max_y_in_cell(p, -1) == hf.max_y_in_cell(p, -1));
+	}
+
+	thf.set_max_tiles(2);
+	BOOST_REQUIRE (thf.nmapped_tiles() <= 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_trace)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 150, 200);
+	math::fill_random(hf, 321);
+
+	temp_file file;
+	tiled_heightfield_t::write(file.path, hf);
+	tiled_heightfield_t thf(file.path, 3);
+
+	boost::uint32_t seed = 17;
+
+	for (int i = 0; i < 500; ++i)
+	{
+		math::vec<3> from(math::scalar(math::next_random(seed) % 2000) / 10, 40 + math::scalar(math::next_random(seed) % 200) / 10,
+			math::scalar(math::next_random(seed) % 1500) / 10);
+		math::vec<3> to(math::scalar(math::next_random(seed) % 2000) / 10, math::scalar(math::next_random(seed) % 400) / 10,
+			math::scalar(math::next_random(seed) % 1500) / 10);
+
+		math::ray<3> r(from, to - from);
+		math::scalar const max_distance = (to - from).length() * 2;
+
+		math::contact_info<3> expected = hf.trace(r, max_distance);
+		math::contact_info<3> ci = thf.trace(r, max_distance);
+
+		BOOST_REQUIRE (ci.happened == expected.happened);
+		if (ci.happened) BOOST_REQUIRE ((ci.position - expected.position).length_sq() < 1e-4f);
+	}
+
+	// ray high above terrain does not map any tile
+	tiled_heightfield_t other(file.path, 3);
+	BOOST_REQUIRE (!other.trace(math::ray<3>(math::vec<3>(0, 100, 0), math::vec<3>(1, 0, 1))).happened);
+	BOOST_REQUIRE (other.nmapped_tiles() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_build_path)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	heightfield_t hf(tf, 100, 160);
+
+	std::vector<boost::uint8_t> heights(160 * 100, 0);
+	for (int row = 0; row < 90; ++row) heights[row * 160 + 80] = 5;
+	hf.load_from_raw_buffer(&heights[0]);
+
+	temp_file file;
+	tiled_heightfield_t::write(file.path, hf);
+	tiled_heightfield_t thf(file.path, 6);
+
+	std::vector<tiled_heightfield_t::cell_t> path = thf.build_path(math::vec<3>(10.5f, 0, 10.5f), math::vec<3>(150.5f, 0, 10.5f), 1);
+	BOOST_REQUIRE (!path.empty());
+	BOOST_REQUIRE (path.front() == tiled_heightfield_t::cell_t(10, 10));
+	BOOST_REQUIRE (path.back() == tiled_heightfield_t::cell_t(150, 10));
+
+	for (size_t i = 0; i < path.size(); ++i)
+	{
+		BOOST_REQUIRE (thf.max_y_in_cell(path[i].x, path[i].y) < 1);
+		if (i > 0) BOOST_REQUIRE ((path[i] - path[i - 1]).length_sq() <= 2);
+	}
+
+	BOOST_REQUIRE (thf.nmapped_tiles() <= 6);
+}
+
+BOOST_AUTO_TEST_CASE(test_edit)
+{
+	math::matrix<4,4> tf;
+	tf.identity();
+
+	temp_file file;
+	tiled_heightfield_t::create(file.path, tf, 130, 70);
+
+	{
+		tiled_heightfield_t thf(file.path, 2);
+		BOOST_REQUIRE (thf.local_y_at(129, 69) == 0);
+		BOOST_CHECK_THROW (thf.set_local_y_at(0, 0, 1), std::logic_error);
+	}
+
+	{
+		tiled_heightfield_t thf(file.path, 2, tiled_heightfield_t::READ_WRITE);
+
+		// vertex on tile border belongs to cells of four tiles
+		thf.set_local_y_at(64, 64, 50);
+		thf.set_local_y_at(100, 10, 30);
+
+		BOOST_REQUIRE (thf.max_y_in_cell(63, 63) == 50);
+		BOOST_REQUIRE (thf.max_y_in_cell(64, 64) == 50);
+		BOOST_REQUIRE (thf.trace(math::ray<3>(math::vec<3>(63.8f, 100, 63.8f), math::vec<3>(0.001f, -1, 0.001f))).happened);
+		BOOST_REQUIRE (thf.trace(math::ray<3>(math::vec<3>(0, 20, 10.2f), math::vec<3>(1, 0, 0))).happened);
+	}
+
+	tiled_heightfield_t thf(file.path, 2);
+	BOOST_REQUIRE (thf.local_y_at(64, 64) == 50);
+	BOOST_REQUIRE (thf.local_y_at(100, 10) == 30);
+	BOOST_REQUIRE (thf.get_local_aabb().hi.y >= 50);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,141 @@
+
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "transform.h"
+#include "test_random.h"
+
+namespace
+{
+
+math::vec<3> random_vec()
+{
+	return math::vec<3>(math::random(-100, 100), math::random(-100, 100), math::random(-100, 100));
+}
+
+math::vec<3> transform_vector(math::vec<3> const &v, math::matrix<4,4> const &M)
+{
+	math::vec<4> r = math::vec<4>(v.x, v.y, v.z, 0) * M;
+	return math::vec<3>(r.x, r.y, r.z);
+}
+
+struct vertex
+{
+	math::vec<3> position;
+	math::vec<3> normal;
+	math::vec<2> tex_coord;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_transform)
+
+BOOST_AUTO_TEST_CASE(test_transform_arrays)
+{
+	math::matrix<4,4> M = math::random_affine();
+
+	// odd count leaves elements after last group of four
+	size_t const count = 103;
+	std::vector<math::vec<3> > src(count), dst(count);
+	std::vector<math::vec<4> > src4(count), dst4(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		src[i] = random_vec();
+		src4[i] = math::vec<4>(src[i].x, src[i].y, src[i].z, math::random(-1, 1));
+	}
+
+	math::transform_points(M, &src[0], &dst[0], count);
+	for (size_t i = 0; i < count; ++i) BOOST_REQUIRE ((dst[i] - src[i] * M).length() < 1e-3f);
+
+	math::transform_vectors(M, &src[0], &dst[0], count);
+	for (size_t i = 0; i < count; ++i) BOOST_REQUIRE ((dst[i] - transform_vector(src[i], M)).length() < 1e-3f);
+
+	math::transform(M, &src4[0], &dst4[0], count);
+	for (size_t i = 0; i < count; ++i) BOOST_REQUIRE ((dst4[i] - src4[i] * M).length() < 1e-3f);
+
+	// in place
+	dst = src;
+	math::transform_points(M, &dst[0], &dst[0], count);
+	for (size_t i = 0; i < count; ++i) BOOST_REQUIRE ((dst[i] - src[i] * M).length() < 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(test_transform_strided)
+{
+	math::matrix<4,4> M = math::random_affine();
+
+	size_t const count = 57;
+	std::vector<vertex> vertices(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		vertices[i].position = random_vec();
+		vertices[i].normal = random_vec();
+		vertices[i].tex_coord = math::vec<2>(math::scalar(i), 0);
+	}
+
+	std::vector<vertex> result(vertices);
+	math::transform_points(M, &result[0].position, sizeof(vertex), &result[0].position, sizeof(vertex), count);
+	math::transform_vectors(M, &result[0].normal, sizeof(vertex), &result[0].normal, sizeof(vertex), count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		BOOST_REQUIRE ((result[i].position - vertices[i].position * M).length() < 1e-3f);
+		BOOST_REQUIRE ((result[i].normal - transform_vector(vertices[i].normal, M)).length() < 1e-3f);
+		BOOST_REQUIRE (result[i].tex_coord.x == math::scalar(i));
+	}
+
+	// positions could be gathered to packed array
+	std::vector<math::vec<3> > positions(count);
+	math::transform_points(M, &vertices[0].position, sizeof(vertex), &positions[0], sizeof(math::vec<3>), count);
+	for (size_t i = 0; i < count; ++i) BOOST_REQUIRE (positions[i] == result[i].position);
+}
+
+BOOST_AUTO_TEST_CASE(test_transform_soa)
+{
+	math::matrix<4,4> M = math::random_affine();
+
+	size_t const count = 38;
+	std::vector<math::scalar> x(count), y(count), z(count), rx(count), ry(count), rz(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		x[i] = math::random(-100, 100);
+		y[i] = math::random(-100, 100);
+		z[i] = math::random(-100, 100);
+	}
+
+	math::transform_points(M, &x[0], &y[0], &z[0], &rx[0], &ry[0], &rz[0], count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		math::vec<3> p = math::vec<3>(x[i], y[i], z[i]) * M;
+		BOOST_REQUIRE ((math::vec<3>(rx[i], ry[i], rz[i]) - p).length() < 1e-3f);
+	}
+
+	// in place
+	std::vector<math::scalar> x0(x), y0(y), z0(z);
+	math::transform_vectors(M, &x[0], &y[0], &z[0], &x[0], &y[0], &z[0], count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		math::vec<3> v = transform_vector(math::vec<3>(x0[i], y0[i], z0[i]), M);
+		BOOST_REQUIRE ((math::vec<3>(x[i], y[i], z[i]) - v).length() < 1e-3f);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_transform_parallel)
+{
+	math::matrix<4,4> M = math::random_affine();
+
+	// large arrays are split between threads
+	size_t const count = math::TRANSFORM_PARALLEL_MIN * 3 + 7;
+	std::vector<math::vec<3> > src(count), dst(count);
+	for (size_t i = 0; i < count; ++i) src[i] = random_vec();
+
+	for (size_t i = 0; i < count; ++i) dst[i] = src[i] * M;
+
+	std::vector<math::vec<3> > result(count);
+	math::transform_points(M, &src[0], &result[0], count);
+
+	for (size_t i = 0; i < count; ++i) BOOST_REQUIRE ((result[i] - dst[i]).length() < 1e-3f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,283 @@
+
+#include <vector>
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <util/archive.h>
+#include "triangle_bvh.h"
+
+namespace
+{
+
+math::vec<3> random_point(math::scalar size)
+{
+	return math::vec<3>(math::random(-size, size), math::random(-size, size), math::random(-size, size));
+}
+
+// small triangles scattered in cube
+std::vector<math::triangle<3> > random_triangles(size_t count)
+{
+	std::vector<math::triangle<3> > triangles(count);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		math::vec<3> const p = random_point(100);
+		triangles[i].construct(p, p + random_point(3), p + random_point(3));
+	}
+
+	return triangles;
+}
+
+math::ray<3> random_ray()
+{
+	math::vec<3> const from = random_point(120), to = random_point(120);
+	return math::ray<3>(from, to - from);
+}
+
+// closest hit found by testing all triangles
+bool trace_all(std::vector<math::triangle<3> > const &triangles, math::ray<3> const &r, math::scalar &time, size_t &index)
+{
+	bool found = false;
+
+	for (size_t i = 0; i < triangles.size(); ++i)
+	{
+		math::scalar t;
+		math::vec<3> v;
+		if (triangles[i].trace(r, t, v, 0, found ? time : 1))
+		{
+			time = t;
+			index = i;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+math::aabb<3> triangle_aabb(math::triangle<3> const &tri)
+{
+	math::aabb<3> bounds(tri.A);
+	bounds.extend(tri.B);
+	bounds.extend(tri.C);
+	return bounds;
+}
+
+struct vertex
+{
+	math::vec<3> position;
+	math::vec<2> tex_coord;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_triangle_bvh)
+
+BOOST_AUTO_TEST_CASE(test_trace)
+{
+	std::vector<math::triangle<3> > triangles = random_triangles(3000);
+
+	math::triangle_bvh bvh;
+	bvh.build(triangles);
+	BOOST_REQUIRE (bvh.get_ntriangles() == triangles.size());
+
+	for (int i = 0; i < 2000; ++i)
+	{
+		math::ray<3> const r = random_ray();
+
+		math::scalar time = 0;
+		size_t index = 0;
+		bool const expected = trace_all(triangles, r, time, index);
+
+		size_t bvh_index = size_t(-1);
+		math::contact_info<3> ci = bvh.trace(r, 1, &bvh_index);
+
+		BOOST_REQUIRE (ci.happened == expected);
+		BOOST_REQUIRE (bvh.test_intersection(r) == expected);
+
+		if (expected)
+		{
+			BOOST_REQUIRE (math::abs(ci.time - time) < 1e-4f);
+			BOOST_REQUIRE (bvh_index == index || math::abs(ci.time - time) < 1e-6f);
+			BOOST_REQUIRE ((ci.normal & r.a) <= 0);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_build_from_vertices)
+{
+	// grid of 20 x 20 quads with vertices in structures
+	int const size = 21;
+	std::vector<vertex> vertices(size * size);
+	std::vector<boost::uint16_t> indices;
+
+	for (int row = 0; row < size; ++row)
+	{
+		for (int col = 0; col < size; ++col)
+		{
+			vertices[row * size + col].position = math::vec<3>(math::scalar(col), math::scalar((col * row) % 3), math::scalar(row));
+		}
+	}
+
+	for (int row = 0; row + 1 < size; ++row)
+	{
+		for (int col = 0; col + 1 < size; ++col)
+		{
+			boost::uint16_t const i = boost::uint16_t(row * size + col);
+			boost::uint16_t const quad[6] = { i, boost::uint16_t(i + size), boost::uint16_t(i + 1),
+				boost::uint16_t(i + 1), boost::uint16_t(i + size), boost::uint16_t(i + size + 1) };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	math::triangle_bvh bvh;
+	bvh.build(&vertices[0].position, sizeof(vertex), &indices[0], indices.size());
+	BOOST_REQUIRE (bvh.get_ntriangles() == 800);
+
+	math::aabb<3> const bounds = bvh.get_aabb();
+	BOOST_REQUIRE (bounds.lo.x == 0 && bounds.hi.x == 20 && bounds.lo.z == 0 && bounds.hi.z == 20);
+
+	// every ray going down over grid hits it
+	for (int i = 0; i < 500; ++i)
+	{
+		math::ray<3> const r(math::vec<3>(math::random(0.01f, 19.99f), 10, math::random(0.01f, 19.99f)), math::vec<3>(0.01f, -20, 0.02f));
+
+		size_t index;
+		math::contact_info<3> ci = bvh.trace(r, 1, &index);
+		BOOST_REQUIRE (ci.happened);
+		BOOST_REQUIRE (index < 800);
+		BOOST_REQUIRE (ci.normal.y > 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_overlap)
+{
+	std::vector<math::triangle<3> > triangles = random_triangles(2000);
+
+	math::triangle_bvh bvh;
+	bvh.build(triangles);
+
+	for (int i = 0; i < 300; ++i)
+	{
+		math::vec<3> const centre = random_point(100);
+
+		math::aabb<3> query(centre - math::vec<3>(10, 5, 8), centre + math::vec<3>(10, 5, 8));
+		std::vector<size_t> found;
+		size_t const nfound = bvh.query_triangles(query, found);
+
+		BOOST_REQUIRE (nfound == found.size());
+		BOOST_REQUIRE (bvh.test_intersection(query) == (nfound != 0));
+
+		std::vector<bool> is_found(triangles.size(), false);
+		for (size_t j = 0; j < found.size(); ++j)
+		{
+			BOOST_REQUIRE (!is_found[found[j]]);
+			is_found[found[j]] = true;
+			BOOST_REQUIRE (triangle_aabb(triangles[found[j]]).test_intersection(query));
+		}
+
+		for (size_t j = 0; j < triangles.size(); ++j)
+		{
+			if (query.contains(triangles[j].A) || query.contains(triangles[j].B) || query.contains(triangles[j].C)) BOOST_REQUIRE (is_found[j]);
+		}
+
+		math::sphere<3> sphere(centre, 12);
+		found.clear();
+		bvh.query_triangles(sphere, found);
+		BOOST_REQUIRE (bvh.test_intersection(sphere) == !found.empty());
+
+		is_found.assign(triangles.size(), false);
+		for (size_t j = 0; j < found.size(); ++j)
+		{
+			is_found[found[j]] = true;
+			BOOST_REQUIRE (triangle_aabb(triangles[found[j]]).test_intersection(math::aabb<3>(centre - math::vec<3>(12, 12, 12),
+				centre + math::vec<3>(12, 12, 12))));
+		}
+
+		for (size_t j = 0; j < triangles.size(); ++j)
+		{
+			bool const inside = (triangles[j].A - centre).length() < 12 || (triangles[j].B - centre).length() < 12
+				|| (triangles[j].C - centre).length() < 12 || (triangles[j].cog() - centre).length() < 12;
+			if (inside) BOOST_REQUIRE (is_found[j]);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_archive)
+{
+	std::vector<math::triangle<3> > triangles = random_triangles(500);
+
+	math::triangle_bvh bvh;
+	bvh.build(triangles);
+
+	std::string const path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+	{
+		util::ArchiveWriter writer;
+		writer.create(path);
+		bvh.write(writer, "bvh");
+		writer.close();
+	}
+
+	math::triangle_bvh loaded;
+
+	{
+		util::ArchiveReader reader;
+		reader.open(path);
+		loaded.read(reader, "bvh");
+		reader.close();
+	}
+
+	boost::filesystem::remove(path);
+
+	BOOST_REQUIRE (loaded.get_nnodes() == bvh.get_nnodes());
+	BOOST_REQUIRE (loaded.get_ntriangles() == bvh.get_ntriangles());
+
+	for (int i = 0; i < 500; ++i)
+	{
+		math::ray<3> const r = random_ray();
+
+		size_t index = 0, loaded_index = 0;
+		math::contact_info<3> ci = bvh.trace(r, 1, &index), loaded_ci = loaded.trace(r, 1, &loaded_index);
+
+		BOOST_REQUIRE (ci.happened == loaded_ci.happened);
+		if (ci.happened) BOOST_REQUIRE (ci.time == loaded_ci.time && index == loaded_index);
+	}
+
+	std::vector<char> blob;
+	bvh.save(blob);
+	blob[0] = 'X';
+	BOOST_CHECK_THROW (loaded.load(&blob[0], blob.size()), std::runtime_error);
+	BOOST_CHECK_THROW (loaded.load(&blob[0], 3), std::runtime_error);
+
+	// header is magic and two counts, node is bounds, offset, count and axis
+	size_t const root = 4 + 2 * sizeof(boost::uint32_t), node_size = 6 * sizeof(math::scalar) + sizeof(boost::uint32_t) + 2 * sizeof(boost::uint16_t);
+	size_t const offset = 6 * sizeof(math::scalar), count = offset + sizeof(boost::uint32_t);
+	boost::uint32_t const invalid_offsets[] = { 0, 1, boost::uint32_t(bvh.get_nnodes()) };
+
+	for (size_t i = 0; i < 3; ++i)
+	{
+		bvh.save(blob);
+		std::memcpy(&blob[root + offset], &invalid_offsets[i], sizeof(boost::uint32_t));
+		BOOST_CHECK_THROW (loaded.load(&blob[0], blob.size()), std::runtime_error);
+	}
+
+	// first leaf starts past last triangle
+	bvh.save(blob);
+	for (size_t i = 1; i < bvh.get_nnodes(); ++i)
+	{
+		boost::uint16_t n = 0;
+		std::memcpy(&n, &blob[root + i * node_size + count], sizeof(boost::uint16_t));
+		if (n == 0) continue;
+
+		boost::uint32_t const past_end = boost::uint32_t(bvh.get_ntriangles());
+		std::memcpy(&blob[root + i * node_size + offset], &past_end, sizeof(boost::uint32_t));
+		break;
+	}
+	BOOST_CHECK_THROW (loaded.load(&blob[0], blob.size()), std::runtime_error);
+
+	// failed loads keep previous tree
+	BOOST_REQUIRE (loaded.get_nnodes() == bvh.get_nnodes());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,529 @@
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <luabind/luabind.hpp>
+#include <luabind/iterator_policy.hpp>
+#include "a_star.h"
+#include "heightfield_sampling.h"
+#include "tiled_heightfield.h"
+
+namespace math
+{
+
+namespace
+{
+char const MAGIC[4] = { 'H', 'F', 'T', '1' };
+
+// tiles start at page boundary, so mapping them does not need to map parts of neighbours
+size_t const DATA_ALIGNMENT = 4096;
+
+scalar const TRACE_EPSILON = 1e-4f;
+
+// visits cells of ncols x nrows grid over xz plane which part of ray between t0 and t1 crosses,
+// in order ray enters them
+class grid_walker {
+public:
+	grid_walker(ray<3> const &r, scalar t0, scalar t1, int cell_size, int ncols, int nrows):
+		ncols_(ncols),
+		nrows_(nrows),
+		t_(t0),
+		t1_(t1),
+		done_(ncols <= 0 || nrows <= 0)
+	{
+		vec<3> const p = r.r0 + r.a * t0;
+
+		col_ = std::min(std::max(int(std::floor(p.x / cell_size)), 0), ncols - 1);
+		row_ = std::min(std::max(int(std::floor(p.z / cell_size)), 0), nrows - 1);
+
+		init_axis(r.r0.x, r.a.x, col_, cell_size, step_col_, next_col_t_, delta_col_t_);
+		init_axis(r.r0.z, r.a.z, row_, cell_size, step_row_, next_row_t_, delta_row_t_);
+	}
+
+	bool next(int &col, int &row, scalar &t0, scalar &t1)
+	{
+		if (done_) return false;
+
+		col = col_;
+		row = row_;
+		t0 = t_;
+		t1 = std::min(std::min(next_col_t_, next_row_t_), t1_);
+
+		if (t1 >= t1_)
+		{
+			done_ = true;
+		}
+		else if (next_col_t_ < next_row_t_)
+		{
+			col_ += step_col_;
+			t_ = next_col_t_;
+			next_col_t_ += delta_col_t_;
+			done_ = col_ < 0 || col_ >= ncols_;
+		}
+		else
+		{
+			row_ += step_row_;
+			t_ = next_row_t_;
+			next_row_t_ += delta_row_t_;
+			done_ = row_ < 0 || row_ >= nrows_;
+		}
+
+		return true;
+	}
+
+private:
+	int ncols_, nrows_;
+	int col_, row_, step_col_, step_row_;
+	scalar t_, t1_, next_col_t_, next_row_t_, delta_col_t_, delta_row_t_;
+	bool done_;
+
+	static void init_axis(scalar p, scalar d, int cell, int cell_size, int &step, scalar &next_t, scalar &delta_t)
+	{
+		step = d > 0 ? 1 : -1;
+
+		if (d == 0)
+		{
+			next_t = delta_t = MAX_SCALAR;
+			return;
+		}
+
+		next_t = (scalar((d > 0 ? cell + 1 : cell) * cell_size) - p) / d;
+		delta_t = scalar(cell_size) / abs(d);
+	}
+};
+
+}
+
+template<class T>
+int const tiled_heightfield<T>::TILE_SIZE;
+
+template<class T>
+tiled_heightfield<T>::tiled_heightfield(std::string const &path, size_t max_tiles, open_mode mode):
+	mode_(mode == READ_WRITE ? boost::interprocess::read_write : boost::interprocess::read_only),
+	file_(path.c_str(), mode_),
+	tile_ranges_(0),
+	data_offset_(0),
+	ncols_(0),
+	nrows_(0),
+	tile_shift_(0),
+	ntile_cols_(0),
+	ntile_rows_(0),
+	max_tiles_(std::max(max_tiles, size_t(1))),
+	last_tile_(-1),
+	last_heights_(0)
+{
+	boost::uintmax_t const file_size = boost::filesystem::file_size(path);
+	if (file_size < sizeof(file_header)) throw std::runtime_error(path + " is not tiled heightfield");
+
+	file_header header;
+	{
+		boost::interprocess::mapped_region region(file_, boost::interprocess::read_only, 0, sizeof(file_header));
+		std::memcpy(&header, region.get_address(), sizeof(file_header));
+	}
+
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) throw std::runtime_error(path + " is not tiled heightfield");
+	if (header.value_size != sizeof(value_t)) throw std::runtime_error(path + " has heights of different type");
+
+	while ((1u << tile_shift_) < header.tile_size) ++tile_shift_;
+	if ((1u << tile_shift_) != header.tile_size) throw std::runtime_error(path + " has unsupported tile size");
+
+	ncols_ = header.ncols;
+	nrows_ = header.nrows;
+	ntile_cols_ = int((ncols_ + header.tile_size - 1) >> tile_shift_);
+	ntile_rows_ = int((nrows_ + header.tile_size - 1) >> tile_shift_);
+
+	size_t const ntiles = size_t(ntile_cols_) * size_t(ntile_rows_);
+	size_t const header_size = sizeof(file_header) + ntiles * sizeof(tile_range);
+	data_offset_ = (header_size + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+
+	if (file_size < data_offset_ + ntiles * (sizeof(value_t) << (2 * tile_shift_)))
+	{
+		throw std::runtime_error(path + " is truncated");
+	}
+
+	boost::interprocess::mapped_region(file_, mode_, 0, header_size).swap(header_region_);
+	tile_ranges_ = (tile_range *) ((char *) header_region_.get_address() + sizeof(file_header));
+
+	std::copy(header.local_to_world, header.local_to_world + 16, &local_to_world_.ij[0][0]);
+	local_to_world_.inverse(world_to_local_);
+
+	local_aabb_.null();
+
+	for (size_t i = 0; i < ntiles; ++i)
+	{
+		if (local_aabb_.lo.y > tile_ranges_[i].min) local_aabb_.lo.y = tile_ranges_[i].min;
+		if (local_aabb_.hi.y < tile_ranges_[i].max) local_aabb_.hi.y = tile_ranges_[i].max;
+	}
+
+	local_aabb_.lo.y -= 1;
+	local_aabb_.hi.y += 1;
+
+	local_aabb_.lo.x = 0;
+	local_aabb_.lo.z = 0;
+
+	local_aabb_.hi.x = scalar(ncols_ - 1);
+	local_aabb_.hi.z = scalar(nrows_ - 1);
+
+	tiles_.resize(ntiles);
+}
+
+template<class T>
+tiled_heightfield<T>::~tiled_heightfield()
+{
+}
+
+template<class T>
+void tiled_heightfield<T>::write(std::string const &path, heightfield<T> const &hf)
+{
+	write_file(path, hf.get_local_to_world(), hf.ncols(), hf.nrows(), &hf);
+}
+
+template<class T>
+void tiled_heightfield<T>::create(std::string const &path, matrix<4,4> const &tf, size_t ncols, size_t nrows)
+{
+	write_file(path, tf, ncols, nrows, 0);
+}
+
+template<class T>
+void tiled_heightfield<T>::write_file(std::string const &path, matrix<4,4> const &tf, size_t ncols, size_t nrows,
+	heightfield<T> const *hf)
+{
+	std::ofstream stream(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!stream) throw std::runtime_error("could not create " + path);
+
+	file_header header;
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.value_size = sizeof(value_t);
+	header.tile_size = TILE_SIZE;
+	header.ncols = boost::uint32_t(ncols);
+	header.nrows = boost::uint32_t(nrows);
+	std::copy(&tf.ij[0][0], &tf.ij[0][0] + 16, header.local_to_world);
+
+	int const ntile_cols = int((ncols + TILE_SIZE - 1) / TILE_SIZE);
+	int const ntile_rows = int((nrows + TILE_SIZE - 1) / TILE_SIZE);
+
+	// ranges of tiles cover their cells, so they include first vertices of next tiles
+	std::vector<tile_range> ranges;
+
+	for (int tile_row = 0; tile_row < ntile_rows; ++tile_row)
+	{
+		for (int tile_col = 0; tile_col < ntile_cols; ++tile_col)
+		{
+			tile_range range;
+			range.min = range.max = 0;
+
+			if (hf)
+			{
+				range.min = MAX_SCALAR;
+				range.max = -MAX_SCALAR;
+
+				int const col1 = std::min((tile_col + 1) * TILE_SIZE, (int) ncols - 1);
+				int const row1 = std::min((tile_row + 1) * TILE_SIZE, (int) nrows - 1);
+
+				for (int row = tile_row * TILE_SIZE; row <= row1; ++row)
+				{
+					for (int col = tile_col * TILE_SIZE; col <= col1; ++col)
+					{
+						range.min = std::min(range.min, scalar(hf->local_y_at(col, row)));
+						range.max = std::max(range.max, scalar(hf->local_y_at(col, row)));
+					}
+				}
+			}
+
+			ranges.push_back(range);
+		}
+	}
+
+	stream.write((char const *) &header, sizeof(header));
+	if (!ranges.empty()) stream.write((char const *) &ranges[0], ranges.size() * sizeof(tile_range));
+
+	size_t const header_size = sizeof(file_header) + ranges.size() * sizeof(tile_range);
+	std::vector<char> padding((header_size + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT - header_size, 0);
+	if (!padding.empty()) stream.write(&padding[0], padding.size());
+
+	std::vector<value_t> heights(TILE_SIZE * TILE_SIZE);
+
+	for (int tile_row = 0; tile_row < ntile_rows; ++tile_row)
+	{
+		for (int tile_col = 0; tile_col < ntile_cols; ++tile_col)
+		{
+			std::fill(heights.begin(), heights.end(), value_t(0));
+
+			for (int row = 0; hf && row < TILE_SIZE && tile_row * TILE_SIZE + row < (int) nrows; ++row)
+			{
+				for (int col = 0; col < TILE_SIZE && tile_col * TILE_SIZE + col < (int) ncols; ++col)
+				{
+					heights[row * TILE_SIZE + col] = hf->local_y_at(tile_col * TILE_SIZE + col, tile_row * TILE_SIZE + row);
+				}
+			}
+
+			stream.write((char const *) &heights[0], heights.size() * sizeof(value_t));
+		}
+	}
+
+	if (!stream) throw std::runtime_error("could not write " + path);
+}
+
+template<class T>
+typename tiled_heightfield<T>::value_t *tiled_heightfield<T>::tile_heights(int index) const
+{
+	if (index == last_tile_) return last_heights_;
+
+	tile &t = tiles_[index];
+
+	if (t.region)
+	{
+		mapped_tiles_.splice(mapped_tiles_.begin(), mapped_tiles_, t.lru_position);
+	}
+	else
+	{
+		while (mapped_tiles_.size() >= max_tiles_)
+		{
+			tiles_[mapped_tiles_.back()].region.reset();
+			mapped_tiles_.pop_back();
+		}
+
+		size_t const tile_size = sizeof(value_t) << (2 * tile_shift_);
+		t.region.reset(new boost::interprocess::mapped_region(file_, mode_, data_offset_ + index * tile_size, tile_size));
+
+		mapped_tiles_.push_front(index);
+		t.lru_position = mapped_tiles_.begin();
+	}
+
+	last_tile_ = index;
+	last_heights_ = (value_t *) t.region->get_address();
+
+	return last_heights_;
+}
+
+template<class T>
+typename tiled_heightfield<T>::value_t *tiled_heightfield<T>::vertex(int col, int row) const
+{
+	if (col < 0 || row < 0 || col >= (int) ncols_ || row >= (int) nrows_) throw std::out_of_range("vertex is outside of heightfield");
+
+	int const mask = (1 << tile_shift_) - 1;
+	value_t *heights = tile_heights((row >> tile_shift_) * ntile_cols_ + (col >> tile_shift_));
+
+	return heights + (((row & mask) << tile_shift_) | (col & mask));
+}
+
+template<class T>
+typename tiled_heightfield<T>::value_t tiled_heightfield<T>::local_y_at(int col, int row) const
+{
+	return *vertex(col, row);
+}
+
+template<class T>
+void tiled_heightfield<T>::set_local_y_at(int col, int row, value_t value)
+{
+	if (mode_ != boost::interprocess::read_write) throw std::logic_error("tiled heightfield is opened read only");
+
+	*vertex(col, row) = value;
+
+	// first vertices of tile are also covered by ranges of previous tiles
+	int const mask = (1 << tile_shift_) - 1;
+	int const tile_col1 = std::min(col >> tile_shift_, ntile_cols_ - 1), tile_col0 = (col & mask) == 0 ? std::max(tile_col1 - 1, 0) : tile_col1;
+	int const tile_row1 = std::min(row >> tile_shift_, ntile_rows_ - 1), tile_row0 = (row & mask) == 0 ? std::max(tile_row1 - 1, 0) : tile_row1;
+
+	for (int tile_row = tile_row0; tile_row <= tile_row1; ++tile_row)
+	{
+		for (int tile_col = tile_col0; tile_col <= tile_col1; ++tile_col)
+		{
+			tile_range &range = tile_ranges_[tile_row * ntile_cols_ + tile_col];
+			range.min = std::min(range.min, scalar(value));
+			range.max = std::max(range.max, scalar(value));
+		}
+	}
+
+	local_aabb_.lo.y = std::min(local_aabb_.lo.y, scalar(value) - 1);
+	local_aabb_.hi.y = std::max(local_aabb_.hi.y, scalar(value) + 1);
+}
+
+template<class T>
+scalar tiled_heightfield<T>::y_under(vec<3> const &position, scalar default_value) const
+{
+	return heightfield_y_under(*this, position * world_to_local_, default_value);
+}
+
+template<class T>
+scalar tiled_heightfield<T>::max_y_in_cell(int col, int row, scalar default_value) const
+{
+	return heightfield_max_y_in_cell(*this, col, row, default_value);
+}
+
+template<class T>
+scalar tiled_heightfield<T>::max_y_in_cell(vec<3> const &position, scalar default_value) const
+{
+	cell_t cell = world_position_to_cell(position);
+	return max_y_in_cell(cell.x, cell.y, default_value);
+}
+
+template<class T>
+void tiled_heightfield<T>::set_max_tiles(size_t max_tiles)
+{
+	max_tiles_ = std::max(max_tiles, size_t(1));
+
+	while (mapped_tiles_.size() > max_tiles_)
+	{
+		if (mapped_tiles_.back() == last_tile_) last_tile_ = -1;
+
+		tiles_[mapped_tiles_.back()].region.reset();
+		mapped_tiles_.pop_back();
+	}
+}
+
+template<class T> typename tiled_heightfield<T>::cell_t
+tiled_heightfield<T>::world_position_to_cell(vec<3> const &position) const
+{
+	vec<3> p = position * world_to_local_;
+	return cell_t(int(p.x), int(p.z));
+}
+
+template<class T>
+vec<3> tiled_heightfield<T>::cell_to_world_position(cell_t const &cell) const
+{
+	return vec<3>((scalar) cell.x + 0.5f, 0, (scalar) cell.y + 0.5f) * local_to_world_;
+}
+
+template<class T>
+contact_info<3> tiled_heightfield<T>::trace(ray<3> const &r, scalar max_distance) const
+{
+	vec<3> local_p0 = r.r0 * world_to_local_;
+	vec<3> local_p1 = (r.r0 + normalize(r.a) * max_distance) * world_to_local_;
+
+	ray<3> local_ray(local_p0, local_p1 - local_p0);
+
+	contact_info<3> result;
+	result.happened = false;
+
+	scalar t0 = 0, t1 = 1;
+
+	if (!clip_slab(local_ray.r0.x, local_ray.a.x, local_aabb_.lo.x, local_aabb_.hi.x, t0, t1)) return result;
+	if (!clip_slab(local_ray.r0.y, local_ray.a.y, local_aabb_.lo.y, local_aabb_.hi.y, t0, t1)) return result;
+	if (!clip_slab(local_ray.r0.z, local_ray.a.z, local_aabb_.lo.z, local_aabb_.hi.z, t0, t1)) return result;
+
+	if (ncols_ >= 2 && nrows_ >= 2)
+	{
+		// tiles of cells, cells of last vertex column and row do not exist
+		grid_walker tiles(local_ray, t0, t1, 1 << tile_shift_, (((int) ncols_ - 2) >> tile_shift_) + 1,
+			(((int) nrows_ - 2) >> tile_shift_) + 1);
+
+		int tile_col, tile_row;
+		scalar tile_t0, tile_t1;
+
+		while (tiles.next(tile_col, tile_row, tile_t0, tile_t1))
+		{
+			if (trace_tile(tile_col, tile_row, local_ray, tile_t0, tile_t1, result)) break;
+		}
+	}
+
+	result.position = result.position * local_to_world_;
+
+	return result;
+}
+
+template<class T>
+bool tiled_heightfield<T>::trace_tile(int tile_col, int tile_row, ray<3> const &local_ray, scalar t0, scalar t1,
+	contact_info<3> &result) const
+{
+	// tile is skipped without being mapped when ray passes above or below all of its heights
+	tile_range const &range = tile_ranges_[tile_row * ntile_cols_ + tile_col];
+
+	scalar const y0 = local_ray.r0.y + local_ray.a.y * t0;
+	scalar const y1 = local_ray.r0.y + local_ray.a.y * t1;
+
+	if (std::min(y0, y1) > range.max + TRACE_EPSILON) return false;
+	if (std::max(y0, y1) < range.min - TRACE_EPSILON) return false;
+
+	grid_walker cells(local_ray, t0, t1, 1, (int) ncols_ - 1, (int) nrows_ - 1);
+
+	int col, row;
+	scalar cell_t0, cell_t1;
+
+	while (cells.next(col, row, cell_t0, cell_t1))
+	{
+		if (trace_cell(col, row, local_ray, result)) return true;
+	}
+
+	return false;
+}
+
+template<class T>
+bool tiled_heightfield<T>::trace_cell(int col, int row, ray<3> const &local_ray, contact_info<3> &result) const
+{
+	return heightfield_trace_cell(*this, col, row, local_ray, result);
+}
+
+template<class T> std::vector<typename tiled_heightfield<T>::cell_t>
+tiled_heightfield<T>::build_path(vec<3> const &from, vec<3> const &to, value_t min_value, bool allow_best_heuristic_point,
+	std::vector<cell_t> const &obstacles) const
+{
+	cell_t start = world_position_to_cell(from);
+	cell_t goal = world_position_to_cell(to);
+
+	// unlike dense_a_star used by heightfield keeps records only for visited cells, so only
+	// tiles around path are mapped
+	heightfield_scorer<tiled_heightfield<T> > scorer(this, min_value, goal, obstacles);
+	a_star pathfinder(start, goal, boost::bind(&heightfield_scorer<tiled_heightfield<T> >::get_score, &scorer, _1));
+
+	pathfinder.calculate_path();
+
+	return pathfinder.build_path(allow_best_heuristic_point);
+}
+
+template<class T>
+scalar tiled_heightfield<T>::path_score(cell_t const &cell, value_t min_value, cell_t const &goal) const
+{
+	return heightfield_path_score(*this, cell, min_value, goal);
+}
+
+template<class T>
+void tiled_heightfield<T>::bind(lua_State *L, char const *name)
+{
+	using namespace luabind;
+
+	module(L, "math")
+	[
+		class_<tiled_heightfield>(name)
+		.def(constructor<std::string const &, size_t>())
+		.def(constructor<std::string const &, size_t, open_mode>())
+		.def("y_under", &tiled_heightfield::y_under)
+		.def("max_y_in_cell", (scalar (tiled_heightfield::*)(vec<3> const &, scalar) const) &tiled_heightfield::max_y_in_cell)
+		.def("set_local_y_at", &tiled_heightfield::set_local_y_at)
+		.def("ncols", &tiled_heightfield::ncols)
+		.def("nrows", &tiled_heightfield::nrows)
+		.def("get_local_aabb", &tiled_heightfield::get_local_aabb)
+		.def("get_max_tiles", &tiled_heightfield::get_max_tiles)
+		.def("set_max_tiles", &tiled_heightfield::set_max_tiles)
+		.def("nmapped_tiles", &tiled_heightfield::nmapped_tiles)
+		.def("world_position_to_cell", &tiled_heightfield::world_position_to_cell)
+		.def("cell_to_world_position", &tiled_heightfield::cell_to_world_position)
+		.def("build_path", &tiled_heightfield::build_path)
+		.def("trace", &tiled_heightfield::trace)
+		.scope
+		[
+			def("write", &tiled_heightfield::write),
+			def("create", &tiled_heightfield::create)
+		]
+		.enum_("open_mode")
+		[
+			value("READ_ONLY", READ_ONLY),
+			value("READ_WRITE", READ_WRITE)
+		]
+	];
+}
+
+template class tiled_heightfield<boost::uint8_t>;
+template class tiled_heightfield<boost::uint16_t>;
+template class tiled_heightfield<scalar>;
+
+void bind_tiled_heightfield(lua_State *L)
+{
+	tiled_heightfield<boost::uint8_t>::bind(L, "tiled_heightfield_u8");
+	tiled_heightfield<boost::uint16_t>::bind(L, "tiled_heightfield_u16");
+	tiled_heightfield<scalar>::bind(L, "tiled_heightfield_s");
+}
+
+}
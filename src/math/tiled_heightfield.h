@@ -0,0 +1,121 @@
+#pragma once
+
+#include <list>
+#include <string>
+#include <vector>
+#include <luabind/lua_include.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "heightfield.h"
+
+namespace math
+{
+
+// Heightfield kept in file and mapped to memory by tiles of TILE_SIZE x TILE_SIZE vertices, for
+// terrains which are too large to be loaded as heightfield. Opening maps only file header with
+// height ranges of tiles, tiles are mapped when heights in them are accessed and least recently
+// used ones are unmapped when more than max_tiles are mapped. Ranges let trace() skip tiles
+// without mapping them, build_path() uses a_star which only visits cells it expands.
+//
+// File is written by write() from heightfield or by create() filled with zeros and then edited
+// with set_local_y_at() when opened with READ_WRITE. Mapped tiles are shared by all accessors,
+// so instance should not be used from several threads at once.
+template<class T = scalar>
+class tiled_heightfield: public boost::noncopyable {
+public:
+	typedef T value_t;
+	typedef vec<2, int> cell_t;
+
+	enum open_mode { READ_ONLY, READ_WRITE };
+
+	static int const TILE_SIZE = 64;
+
+	tiled_heightfield(std::string const &path, size_t max_tiles, open_mode mode = READ_ONLY);
+	~tiled_heightfield();
+
+	static void write(std::string const &path, heightfield<T> const &hf);
+	static void create(std::string const &path, matrix<4,4> const &tf, size_t ncols, size_t nrows);
+
+	value_t local_y_at(int col, int row) const;
+	// only allowed when opened with READ_WRITE, heights are written to file through mapping
+	void set_local_y_at(int col, int row, value_t value);
+	vec<3> local_vertex_at(int col, int row) const { return vec<3>(scalar(col), local_y_at(col, row), scalar(row)); }
+
+	scalar y_under(vec<3> const &position, scalar default_value = 0) const;
+	scalar max_y_in_cell(int col, int row, scalar default_value = 0) const;
+	scalar max_y_in_cell(vec<3> const &position, scalar default_value = 0) const;
+
+	size_t ncols() const { return ncols_; }
+	size_t nrows() const { return nrows_; }
+	matrix<4,4> const &get_local_to_world() const { return local_to_world_; }
+	matrix<4,4> const &get_world_to_local() const { return world_to_local_; }
+	aabb<3> const &get_local_aabb() const { return local_aabb_; }
+
+	size_t get_max_tiles() const { return max_tiles_; }
+	void set_max_tiles(size_t max_tiles);
+	size_t nmapped_tiles() const { return mapped_tiles_.size(); }
+
+	cell_t world_position_to_cell(vec<3> const &position) const;
+	vec<3> cell_to_world_position(cell_t const &cell) const;
+	contact_info<3> trace(ray<3> const &r, scalar max_distance = 1000.0f) const;
+	std::vector<cell_t> build_path(vec<3> const &from, vec<3> const &to, value_t min_value = 0, bool allow_best_heuristic_point = false,
+		std::vector<cell_t> const &obstacles = std::vector<cell_t>()) const;
+	// score build_path gives to cell, negative for cells path could not go through
+	scalar path_score(cell_t const &cell, value_t min_value, cell_t const &goal) const;
+
+	static void bind(lua_State *L, char const *name);
+
+private:
+	struct file_header
+	{
+		char magic[4];
+		boost::uint32_t value_size;
+		boost::uint32_t tile_size;
+		boost::uint32_t ncols, nrows;
+		scalar local_to_world[16];
+	};
+
+	// heights over cells of tile, these include next column and row of vertices
+	struct tile_range
+	{
+		scalar min, max;
+	};
+
+	struct tile
+	{
+		boost::shared_ptr<boost::interprocess::mapped_region> region;
+		std::list<int>::iterator lru_position;
+	};
+
+	boost::interprocess::mode_t const mode_;
+	boost::interprocess::file_mapping file_;
+	boost::interprocess::mapped_region header_region_;
+	tile_range *tile_ranges_;
+	size_t data_offset_;
+
+	matrix<4,4> local_to_world_, world_to_local_;
+	size_t ncols_, nrows_;
+	int tile_shift_, ntile_cols_, ntile_rows_;
+	aabb<3> local_aabb_;
+
+	size_t max_tiles_;
+	mutable std::vector<tile> tiles_;
+	// indices of mapped tiles, most recently used first
+	mutable std::list<int> mapped_tiles_;
+	mutable int last_tile_;
+	mutable value_t *last_heights_;
+
+	static void write_file(std::string const &path, matrix<4,4> const &tf, size_t ncols, size_t nrows, heightfield<T> const *hf);
+
+	value_t *tile_heights(int index) const;
+	value_t *vertex(int col, int row) const;
+	bool trace_tile(int tile_col, int tile_row, ray<3> const &local_ray, scalar t0, scalar t1, contact_info<3> &result) const;
+	bool trace_cell(int col, int row, ray<3> const &local_ray, contact_info<3> &result) const;
+};
+
+void bind_tiled_heightfield(lua_State *L);
+
+}
@@ -0,0 +1,175 @@
+
+#include <boost/bind.hpp>
+#include "simd.h"
+#include "parallel.h"
+#include "transform.h"
+
+namespace math
+{
+
+namespace
+{
+
+// vec<3> elements which are stride bytes apart, w is 1 for points and 0 for directions
+struct strided_kernel
+{
+	matrix<4,4> const *m;
+	char const *src;
+	size_t src_stride;
+	char *dst;
+	size_t dst_stride;
+	scalar w;
+
+	void run(size_t first, size_t count) const
+	{
+		char const *s = src + first * src_stride;
+		char *d = dst + first * dst_stride;
+
+#ifdef MATH_SSE
+		__m128 const r0 = _mm_loadu_ps(m->ij[0]), r1 = _mm_loadu_ps(m->ij[1]), r2 = _mm_loadu_ps(m->ij[2]);
+		__m128 const r3 = _mm_mul_ps(_mm_loadu_ps(m->ij[3]), _mm_set1_ps(w));
+
+		for (size_t i = 0; i < count; ++i, s += src_stride, d += dst_stride)
+		{
+			vec<3> const *p = reinterpret_cast<vec<3> const *>(s);
+			vec<3> *r = reinterpret_cast<vec<3> *>(d);
+
+			__m128 v = _mm_mul_ps(_mm_set1_ps(p->x), r0);
+			v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(p->y), r1));
+			v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(p->z), r2));
+			v = _mm_add_ps(v, r3);
+
+			// three components are stored, so next element is not overwritten
+			_mm_storel_pi(reinterpret_cast<__m64 *>(&r->x), v);
+			_mm_store_ss(&r->z, _mm_movehl_ps(v, v));
+		}
+#else
+		for (size_t i = 0; i < count; ++i, s += src_stride, d += dst_stride)
+		{
+			vec<3> const p = *reinterpret_cast<vec<3> const *>(s);
+			vec<3> &r = *reinterpret_cast<vec<3> *>(d);
+
+			r.x = p.x * m->_11 + p.y * m->_21 + p.z * m->_31 + w * m->_41;
+			r.y = p.x * m->_12 + p.y * m->_22 + p.z * m->_32 + w * m->_42;
+			r.z = p.x * m->_13 + p.y * m->_23 + p.z * m->_33 + w * m->_43;
+		}
+#endif
+	}
+};
+
+struct vec4_kernel
+{
+	matrix<4,4> const *m;
+	vec<4> const *src;
+	vec<4> *dst;
+
+	void run(size_t first, size_t count) const
+	{
+		for (size_t i = first; i < first + count; ++i)
+		{
+			vec<4> const v = src[i];
+			mul(dst[i], v, *m);
+		}
+	}
+};
+
+// coordinates in separate arrays are transformed four elements at once
+struct soa_kernel
+{
+	matrix<4,4> const *m;
+	scalar const *x, *y, *z;
+	scalar *rx, *ry, *rz;
+	scalar w;
+
+	void run(size_t first, size_t count) const
+	{
+		size_t i = first, end = first + count;
+
+#ifdef MATH_SSE
+		__m128 const m11 = _mm_set1_ps(m->_11), m12 = _mm_set1_ps(m->_12), m13 = _mm_set1_ps(m->_13);
+		__m128 const m21 = _mm_set1_ps(m->_21), m22 = _mm_set1_ps(m->_22), m23 = _mm_set1_ps(m->_23);
+		__m128 const m31 = _mm_set1_ps(m->_31), m32 = _mm_set1_ps(m->_32), m33 = _mm_set1_ps(m->_33);
+		__m128 const m41 = _mm_set1_ps(w * m->_41), m42 = _mm_set1_ps(w * m->_42), m43 = _mm_set1_ps(w * m->_43);
+
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 const px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+
+			_mm_storeu_ps(rx + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m11), _mm_mul_ps(py, m21)), _mm_mul_ps(pz, m31)), m41));
+			_mm_storeu_ps(ry + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m12), _mm_mul_ps(py, m22)), _mm_mul_ps(pz, m32)), m42));
+			_mm_storeu_ps(rz + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, m13), _mm_mul_ps(py, m23)), _mm_mul_ps(pz, m33)), m43));
+		}
+#endif
+
+		for (; i < end; ++i)
+		{
+			scalar const px = x[i], py = y[i], pz = z[i];
+
+			rx[i] = px * m->_11 + py * m->_21 + pz * m->_31 + w * m->_41;
+			ry[i] = px * m->_12 + py * m->_22 + pz * m->_32 + w * m->_42;
+			rz[i] = px * m->_13 + py * m->_23 + pz * m->_33 + w * m->_43;
+		}
+	}
+};
+
+// ranges are multiple of four elements
+template<class Kernel>
+void run_kernel(Kernel const &kernel, size_t count)
+{
+	parallel_for(count, TRANSFORM_PARALLEL_MIN, 4, boost::bind(&Kernel::run, &kernel, _1, _2));
+}
+
+void transform_strided(matrix<4,4> const &m, void const *src, size_t src_stride, void *dst, size_t dst_stride, size_t count, scalar w)
+{
+	strided_kernel kernel = { &m, static_cast<char const *>(src), src_stride, static_cast<char *>(dst), dst_stride, w };
+	run_kernel(kernel, count);
+}
+
+void transform_soa(matrix<4,4> const &m, scalar const *x, scalar const *y, scalar const *z,
+	scalar *rx, scalar *ry, scalar *rz, size_t count, scalar w)
+{
+	soa_kernel kernel = { &m, x, y, z, rx, ry, rz, w };
+	run_kernel(kernel, count);
+}
+
+}
+
+void transform_points(matrix<4,4> const &m, vec<3> const *src, vec<3> *dst, size_t count)
+{
+	transform_strided(m, src, sizeof(vec<3>), dst, sizeof(vec<3>), count, 1);
+}
+
+void transform_vectors(matrix<4,4> const &m, vec<3> const *src, vec<3> *dst, size_t count)
+{
+	transform_strided(m, src, sizeof(vec<3>), dst, sizeof(vec<3>), count, 0);
+}
+
+void transform(matrix<4,4> const &m, vec<4> const *src, vec<4> *dst, size_t count)
+{
+	vec4_kernel kernel = { &m, src, dst };
+	run_kernel(kernel, count);
+}
+
+void transform_points(matrix<4,4> const &m, vec<3> const *src, size_t src_stride, vec<3> *dst, size_t dst_stride, size_t count)
+{
+	transform_strided(m, src, src_stride, dst, dst_stride, count, 1);
+}
+
+void transform_vectors(matrix<4,4> const &m, vec<3> const *src, size_t src_stride, vec<3> *dst, size_t dst_stride, size_t count)
+{
+	transform_strided(m, src, src_stride, dst, dst_stride, count, 0);
+}
+
+void transform_points(matrix<4,4> const &m, scalar const *x, scalar const *y, scalar const *z,
+	scalar *result_x, scalar *result_y, scalar *result_z, size_t count)
+{
+	transform_soa(m, x, y, z, result_x, result_y, result_z, count, 1);
+}
+
+void transform_vectors(matrix<4,4> const &m, scalar const *x, scalar const *y, scalar const *z,
+	scalar *result_x, scalar *result_y, scalar *result_z, size_t count)
+{
+	transform_soa(m, x, y, z, result_x, result_y, result_z, count, 0);
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "vec.h"
+#include "matrix.h"
+
+namespace math
+{
+
+// Transforms of arrays by one matrix, same as multiplying every element by it. Elements are
+// transformed in sse registers and arrays longer than TRANSFORM_PARALLEL_MIN elements are split
+// between threads of math/parallel.h pool. Results could be written over source arrays.
+
+size_t const TRANSFORM_PARALLEL_MIN = 1 << 16;
+
+// p * m for points with w = 1
+void transform_points(matrix<4,4> const &m, vec<3> const *src, vec<3> *dst, size_t count);
+// v * m for directions with w = 0
+void transform_vectors(matrix<4,4> const &m, vec<3> const *src, vec<3> *dst, size_t count);
+void transform(matrix<4,4> const &m, vec<4> const *src, vec<4> *dst, size_t count);
+
+// elements are stride bytes apart, like positions and normals in vertex structures
+void transform_points(matrix<4,4> const &m, vec<3> const *src, size_t src_stride, vec<3> *dst, size_t dst_stride, size_t count);
+void transform_vectors(matrix<4,4> const &m, vec<3> const *src, size_t src_stride, vec<3> *dst, size_t dst_stride, size_t count);
+
+// coordinates are kept in separate arrays
+void transform_points(matrix<4,4> const &m, scalar const *x, scalar const *y, scalar const *z,
+	scalar *result_x, scalar *result_y, scalar *result_z, size_t count);
+void transform_vectors(matrix<4,4> const &m, scalar const *x, scalar const *y, scalar const *z,
+	scalar *result_x, scalar *result_y, scalar *result_z, size_t count);
+
+}
@@ -0,0 +1,618 @@
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <boost/static_assert.hpp>
+#include <util/archive.h>
+#include "triangle_bvh.h"
+
+namespace math
+{
+
+namespace
+{
+
+size_t const NBINS = 16;
+// deeper nodes are split by median, so traversal stack of MAX_DEPTH entries is enough for any tree
+size_t const MAX_SAH_DEPTH = 64;
+size_t const MAX_DEPTH = 128;
+
+char const BLOB_MAGIC[4] = { 'B', 'V', 'H', '1' };
+
+struct blob_header
+{
+	char magic[4];
+	boost::uint32_t nnodes, ntriangles;
+};
+
+scalar surface_area(aabb<3> const &bounds)
+{
+	vec<3> const d = bounds.hi - bounds.lo;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+aabb<3> empty_aabb()
+{
+	scalar const m = std::numeric_limits<scalar>::max();
+	return aabb<3>(vec<3>(m, m, m), vec<3>(-m, -m, -m));
+}
+
+// moller-trumbore, both sides of triangle are hit
+bool intersect(triangle<3> const &tri, ray<3> const &r, scalar &t)
+{
+	vec<3> const e1 = tri.B - tri.A, e2 = tri.C - tri.A;
+	vec<3> const p = r.a ^ e2;
+
+	scalar const det = e1 & p;
+	if (det == 0) return false;
+
+	scalar const inv_det = 1 / det;
+	vec<3> const s = r.r0 - tri.A;
+
+	scalar const u = (s & p) * inv_det;
+	if (u < 0 || u > 1) return false;
+
+	vec<3> const q = s ^ e1;
+	scalar const v = (r.a & q) * inv_det;
+	if (v < 0 || u + v > 1) return false;
+
+	t = (e2 & q) * inv_det;
+	return true;
+}
+
+// separating axis test, Akenine-Moller "Fast 3D Triangle-Box Overlap Testing"
+bool overlaps(triangle<3> const &tri, aabb<3> const &bounds)
+{
+	vec<3> const c = (bounds.lo + bounds.hi) / 2, h = (bounds.hi - bounds.lo) / 2;
+	vec<3> const v[3] = { tri.A - c, tri.B - c, tri.C - c };
+
+	for (int k = 0; k < 3; ++k)
+	{
+		scalar const lo = std::min(std::min(v[0].i[k], v[1].i[k]), v[2].i[k]);
+		scalar const hi = std::max(std::max(v[0].i[k], v[1].i[k]), v[2].i[k]);
+		if (lo > h.i[k] || hi < -h.i[k]) return false;
+	}
+
+	vec<3> const e[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+
+	vec<3> const n = e[0] ^ e[1];
+	if (abs(n & v[0]) > h.x * abs(n.x) + h.y * abs(n.y) + h.z * abs(n.z)) return false;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			vec<3> unit(0, 0, 0);
+			unit.i[k] = 1;
+
+			vec<3> const axis = unit ^ e[j];
+			scalar const p0 = axis & v[0], p1 = axis & v[1], p2 = axis & v[2];
+			scalar const r = h.x * abs(axis.x) + h.y * abs(axis.y) + h.z * abs(axis.z);
+
+			if (std::min(std::min(p0, p1), p2) > r || std::max(std::max(p0, p1), p2) < -r) return false;
+		}
+	}
+
+	return true;
+}
+
+// closest point of triangle, Ericson "Real-Time Collision Detection" 5.1.5
+vec<3> closest_point(triangle<3> const &tri, vec<3> const &p)
+{
+	vec<3> const ab = tri.B - tri.A, ac = tri.C - tri.A, ap = p - tri.A;
+
+	scalar const d1 = ab & ap, d2 = ac & ap;
+	if (d1 <= 0 && d2 <= 0) return tri.A;
+
+	vec<3> const bp = p - tri.B;
+	scalar const d3 = ab & bp, d4 = ac & bp;
+	if (d3 >= 0 && d4 <= d3) return tri.B;
+
+	scalar const vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) return tri.A + ab * (d1 / (d1 - d3));
+
+	vec<3> const cp = p - tri.C;
+	scalar const d5 = ab & cp, d6 = ac & cp;
+	if (d6 >= 0 && d5 <= d6) return tri.C;
+
+	scalar const vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) return tri.A + ac * (d2 / (d2 - d6));
+
+	scalar const va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) return tri.B + (tri.C - tri.B) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	scalar const denom = 1 / (va + vb + vc);
+	return tri.A + ab * (vb * denom) + ac * (vc * denom);
+}
+
+bool overlaps(triangle<3> const &tri, sphere<3> const &bounds)
+{
+	return (closest_point(tri, bounds.centre) - bounds.centre).length_sq() <= bounds.radius * bounds.radius;
+}
+
+bool overlaps(scalar const *lo, scalar const *hi, aabb<3> const &bounds)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		if (lo[k] > bounds.hi.i[k] || hi[k] < bounds.lo.i[k]) return false;
+	}
+
+	return true;
+}
+
+bool overlaps(scalar const *lo, scalar const *hi, sphere<3> const &bounds)
+{
+	scalar distance_sq = 0;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		scalar const x = bounds.centre.i[k];
+		if (x < lo[k]) distance_sq += (lo[k] - x) * (lo[k] - x);
+		else if (x > hi[k]) distance_sq += (x - hi[k]) * (x - hi[k]);
+	}
+
+	return distance_sq <= bounds.radius * bounds.radius;
+}
+
+}
+
+struct triangle_bvh::build_ref
+{
+	aabb<3> bounds;
+	vec<3> centroid;
+	boost::uint32_t index;
+};
+
+namespace
+{
+
+// bin of centroid along axis of centroid bounds
+struct bin_of
+{
+	int axis;
+	scalar lo, k;
+
+	template<class Ref>
+	size_t operator()(Ref const &ref) const
+	{
+		return std::min(size_t((ref.centroid.i[axis] - lo) * k), NBINS - 1);
+	}
+};
+
+template<class Ref>
+struct is_left
+{
+	bin_of bin;
+	size_t split;
+
+	bool operator()(Ref const &ref) const { return bin(ref) < split; }
+};
+
+template<class Ref>
+struct centroid_less
+{
+	int axis;
+
+	bool operator()(Ref const &left, Ref const &right) const { return left.centroid.i[axis] < right.centroid.i[axis]; }
+};
+
+}
+
+triangle_bvh::triangle_bvh()
+{
+	BOOST_STATIC_ASSERT(sizeof(node) == 32);
+}
+
+void triangle_bvh::build(vec<3> const *vertices, size_t vertex_stride, boost::uint16_t const *indices, size_t nindices)
+{
+	std::vector<boost::uint32_t> indices32(indices, indices + nindices);
+	build(vertices, vertex_stride, indices32.empty() ? 0 : &indices32[0], nindices);
+}
+
+void triangle_bvh::build(vec<3> const *vertices, size_t vertex_stride, boost::uint32_t const *indices, size_t nindices)
+{
+	char const *base = reinterpret_cast<char const *>(vertices);
+	std::vector<triangle<3> > triangles(nindices / 3);
+
+	for (size_t i = 0; i < triangles.size(); ++i)
+	{
+		triangles[i].A = *reinterpret_cast<vec<3> const *>(base + indices[i * 3 + 0] * vertex_stride);
+		triangles[i].B = *reinterpret_cast<vec<3> const *>(base + indices[i * 3 + 1] * vertex_stride);
+		triangles[i].C = *reinterpret_cast<vec<3> const *>(base + indices[i * 3 + 2] * vertex_stride);
+	}
+
+	build(triangles);
+}
+
+void triangle_bvh::build(std::vector<triangle<3> > const &triangles)
+{
+	nodes_.clear();
+	triangles_.clear();
+	triangle_indices_.clear();
+
+	if (triangles.empty()) return;
+
+	std::vector<build_ref> refs(triangles.size());
+
+	for (size_t i = 0; i < triangles.size(); ++i)
+	{
+		refs[i].bounds = aabb<3>(triangles[i].A, triangles[i].A);
+		refs[i].bounds.extend(triangles[i].B);
+		refs[i].bounds.extend(triangles[i].C);
+		refs[i].centroid = (refs[i].bounds.lo + refs[i].bounds.hi) / 2;
+		refs[i].index = boost::uint32_t(i);
+	}
+
+	nodes_.reserve(triangles.size() * 2 / MAX_LEAF_TRIANGLES + 1);
+	triangles_.reserve(triangles.size());
+	triangle_indices_.reserve(triangles.size());
+
+	build_node(refs, 0, refs.size(), triangles, 0);
+}
+
+void triangle_bvh::build_node(std::vector<build_ref> &refs, size_t first, size_t count, std::vector<triangle<3> > const &triangles,
+	size_t depth)
+{
+	size_t const index = nodes_.size();
+	nodes_.push_back(node());
+
+	aabb<3> bounds = empty_aabb(), centroid_bounds = empty_aabb();
+	for (size_t i = first; i < first + count; ++i)
+	{
+		bounds.extend(refs[i].bounds);
+		centroid_bounds.extend(refs[i].centroid);
+	}
+
+	for (int k = 0; k < 3; ++k)
+	{
+		nodes_[index].lo[k] = bounds.lo.i[k];
+		nodes_[index].hi[k] = bounds.hi.i[k];
+	}
+
+	// cost of intersecting triangle is taken as 1 and cost of visiting node as 1
+	scalar best_cost = scalar(count);
+	bin_of best_bin = { -1, 0, 0 };
+	size_t best_split = 0;
+
+	scalar const parent_area = surface_area(bounds);
+
+	for (int axis = 0; axis < 3 && count > 2 && depth < MAX_SAH_DEPTH; ++axis)
+	{
+		scalar const extent = centroid_bounds.hi.i[axis] - centroid_bounds.lo.i[axis];
+		if (!(extent > 0)) continue;
+
+		bin_of const bin = { axis, centroid_bounds.lo.i[axis], NBINS / extent };
+
+		size_t bin_counts[NBINS] = { 0 };
+		aabb<3> bin_bounds[NBINS];
+		std::fill(bin_bounds, bin_bounds + NBINS, empty_aabb());
+
+		for (size_t i = first; i < first + count; ++i)
+		{
+			size_t const b = bin(refs[i]);
+			++bin_counts[b];
+			bin_bounds[b].extend(refs[i].bounds);
+		}
+
+		// areas and counts left of every split are swept from left, then right ones from right
+		scalar left_areas[NBINS];
+		size_t left_counts[NBINS];
+		aabb<3> sweep = empty_aabb();
+		size_t n = 0;
+
+		for (size_t b = 0; b + 1 < NBINS; ++b)
+		{
+			n += bin_counts[b];
+			if (bin_counts[b] != 0) sweep.extend(bin_bounds[b]);
+			left_counts[b + 1] = n;
+			left_areas[b + 1] = n != 0 ? surface_area(sweep) : 0;
+		}
+
+		sweep = empty_aabb();
+		n = 0;
+
+		for (size_t split = NBINS - 1; split > 0; --split)
+		{
+			n += bin_counts[split];
+			if (bin_counts[split] != 0) sweep.extend(bin_bounds[split]);
+			if (n == 0 || left_counts[split] == 0) continue;
+
+			scalar const cost = 1 + (left_areas[split] * left_counts[split] + surface_area(sweep) * n) / parent_area;
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_bin = bin;
+				best_split = split;
+			}
+		}
+	}
+
+	if (best_bin.axis < 0 && count <= MAX_LEAF_TRIANGLES)
+	{
+		nodes_[index].offset = boost::uint32_t(triangles_.size());
+		nodes_[index].count = boost::uint16_t(count);
+		nodes_[index].axis = 0;
+
+		for (size_t i = first; i < first + count; ++i)
+		{
+			triangles_.push_back(triangles[refs[i].index]);
+			triangle_indices_.push_back(refs[i].index);
+		}
+
+		return;
+	}
+
+	size_t nleft;
+
+	int axis = best_bin.axis;
+
+	if (axis >= 0)
+	{
+		is_left<build_ref> const predicate = { best_bin, best_split };
+		nleft = std::partition(refs.begin() + first, refs.begin() + first + count, predicate) - (refs.begin() + first);
+	}
+	else
+	{
+		// too many triangles for leaf and no split is better or tree is too deep, split by median
+		vec<3> const extent = centroid_bounds.hi - centroid_bounds.lo;
+		axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+		centroid_less<build_ref> const less = { axis };
+		nleft = count / 2;
+		std::nth_element(refs.begin() + first, refs.begin() + first + nleft, refs.begin() + first + count, less);
+	}
+
+	nodes_[index].count = 0;
+	nodes_[index].axis = boost::uint16_t(axis);
+
+	build_node(refs, first, nleft, triangles, depth + 1);
+	nodes_[index].offset = boost::uint32_t(nodes_.size());
+	build_node(refs, first + nleft, count - nleft, triangles, depth + 1);
+}
+
+aabb<3> triangle_bvh::get_aabb() const
+{
+	if (nodes_.empty()) return aabb<3>(vec<3>(0, 0, 0), vec<3>(0, 0, 0));
+	return aabb<3>(vec<3>(nodes_[0].lo[0], nodes_[0].lo[1], nodes_[0].lo[2]), vec<3>(nodes_[0].hi[0], nodes_[0].hi[1], nodes_[0].hi[2]));
+}
+
+bool triangle_bvh::trace_nodes(ray<3> const &r, scalar max_time, bool any_hit, scalar &time, size_t &index) const
+{
+	if (nodes_.empty()) return false;
+
+	scalar const inv_a[3] = { 1 / r.a.x, 1 / r.a.y, 1 / r.a.z };
+
+	boost::uint32_t stack[MAX_DEPTH];
+	size_t depth = 0;
+	stack[depth++] = 0;
+
+	bool found = false;
+	time = max_time;
+
+	while (depth != 0)
+	{
+		boost::uint32_t const current = stack[--depth];
+		node const &n = nodes_[current];
+
+		scalar t0 = 0, t1 = time;
+		for (int k = 0; k < 3 && t0 <= t1; ++k)
+		{
+			scalar near_t = (n.lo[k] - r.r0.i[k]) * inv_a[k], far_t = (n.hi[k] - r.r0.i[k]) * inv_a[k];
+			if (near_t > far_t) std::swap(near_t, far_t);
+
+			// nan when origin is on slab of ray parallel to it, ray stays in slab then
+			if (near_t > t0) t0 = near_t;
+			if (far_t < t1) t1 = far_t;
+		}
+
+		if (t0 > t1) continue;
+
+		if (n.count != 0)
+		{
+			for (size_t i = n.offset; i < n.offset + n.count; ++i)
+			{
+				scalar t;
+				if (intersect(triangles_[i], r, t) && t >= 0 && t <= time)
+				{
+					time = t;
+					index = i;
+					found = true;
+					if (any_hit) return true;
+				}
+			}
+
+			continue;
+		}
+
+		// nearer child is visited first, so farther one could be skipped by time found in it
+		boost::uint32_t near_child = current + 1, far_child = n.offset;
+		if (r.a.i[n.axis] < 0) std::swap(near_child, far_child);
+
+		if (depth + 2 > MAX_DEPTH) throw std::logic_error("triangle_bvh is too deep");
+		stack[depth++] = far_child;
+		stack[depth++] = near_child;
+	}
+
+	return found;
+}
+
+contact_info<3> triangle_bvh::trace(ray<3> const &r, scalar max_time, size_t *triangle_index) const
+{
+	contact_info<3> result;
+	result.happened = false;
+	result.penetrated = false;
+
+	scalar time;
+	size_t index;
+	if (!trace_nodes(r, max_time, false, time, index)) return result;
+
+	triangle<3> const &tri = triangles_[index];
+	vec<3> normal = (tri.B - tri.A) ^ (tri.C - tri.A);
+	if ((normal & r.a) > 0) normal = -normal;
+
+	result.happened = true;
+	result.time = time;
+	result.position = r.r0 + r.a * time;
+	result.normal = normalize(normal);
+
+	if (triangle_index) *triangle_index = triangle_indices_[index];
+	return result;
+}
+
+bool triangle_bvh::test_intersection(ray<3> const &r, scalar max_time) const
+{
+	scalar time;
+	size_t index;
+	return trace_nodes(r, max_time, true, time, index);
+}
+
+template<class Bounds>
+size_t triangle_bvh::overlap_nodes(Bounds const &bounds, std::vector<size_t> *result) const
+{
+	if (nodes_.empty()) return 0;
+
+	boost::uint32_t stack[MAX_DEPTH];
+	size_t depth = 0;
+	stack[depth++] = 0;
+
+	size_t found = 0;
+
+	while (depth != 0)
+	{
+		boost::uint32_t const current = stack[--depth];
+		node const &n = nodes_[current];
+
+		if (!overlaps(n.lo, n.hi, bounds)) continue;
+
+		if (n.count != 0)
+		{
+			for (size_t i = n.offset; i < n.offset + n.count; ++i)
+			{
+				if (!overlaps(triangles_[i], bounds)) continue;
+
+				++found;
+				if (!result) return found;
+				result->push_back(triangle_indices_[i]);
+			}
+
+			continue;
+		}
+
+		if (depth + 2 > MAX_DEPTH) throw std::logic_error("triangle_bvh is too deep");
+		stack[depth++] = n.offset;
+		stack[depth++] = current + 1;
+	}
+
+	return found;
+}
+
+bool triangle_bvh::test_intersection(aabb<3> const &bounds) const
+{
+	return overlap_nodes(bounds, 0) != 0;
+}
+
+bool triangle_bvh::test_intersection(sphere<3> const &bounds) const
+{
+	return overlap_nodes(bounds, 0) != 0;
+}
+
+size_t triangle_bvh::query_triangles(aabb<3> const &bounds, std::vector<size_t> &result) const
+{
+	return overlap_nodes(bounds, &result);
+}
+
+size_t triangle_bvh::query_triangles(sphere<3> const &bounds, std::vector<size_t> &result) const
+{
+	return overlap_nodes(bounds, &result);
+}
+
+void triangle_bvh::save(std::vector<char> &blob) const
+{
+	blob_header header;
+	std::copy(BLOB_MAGIC, BLOB_MAGIC + 4, header.magic);
+	header.nnodes = boost::uint32_t(nodes_.size());
+	header.ntriangles = boost::uint32_t(triangles_.size());
+
+	blob.resize(sizeof(blob_header) + nodes_.size() * sizeof(node)
+		+ triangles_.size() * (sizeof(triangle<3>) + sizeof(boost::uint32_t)));
+
+	char *cursor = &blob[0];
+	cursor = std::copy((char const *) &header, (char const *) (&header + 1), cursor);
+	if (!nodes_.empty())
+	{
+		cursor = std::copy((char const *) &nodes_[0], (char const *) (&nodes_[0] + nodes_.size()), cursor);
+		cursor = std::copy((char const *) &triangles_[0], (char const *) (&triangles_[0] + triangles_.size()), cursor);
+		cursor = std::copy((char const *) &triangle_indices_[0], (char const *) (&triangle_indices_[0] + triangle_indices_.size()), cursor);
+	}
+}
+
+void triangle_bvh::load(char const *blob, size_t size)
+{
+	blob_header header;
+	if (size < sizeof(blob_header)) throw std::runtime_error("triangle_bvh blob is too short");
+
+	std::copy(blob, blob + sizeof(blob_header), (char *) &header);
+	if (!std::equal(BLOB_MAGIC, BLOB_MAGIC + 4, header.magic)) throw std::runtime_error("invalid triangle_bvh blob");
+
+	size_t const expected_size = sizeof(blob_header) + header.nnodes * sizeof(node)
+		+ header.ntriangles * (sizeof(triangle<3>) + sizeof(boost::uint32_t));
+	if (size != expected_size) throw std::runtime_error("triangle_bvh blob has invalid size");
+
+	if (header.nnodes == 0 && header.ntriangles != 0) throw std::runtime_error("triangle_bvh blob has triangles without nodes");
+
+	std::vector<node> nodes(header.nnodes);
+	std::vector<triangle<3> > triangles(header.ntriangles);
+	std::vector<boost::uint32_t> triangle_indices(header.ntriangles);
+
+	char const *cursor = blob + sizeof(blob_header);
+	if (!nodes.empty())
+	{
+		std::copy(cursor, cursor + nodes.size() * sizeof(node), (char *) &nodes[0]);
+		cursor += nodes.size() * sizeof(node);
+	}
+	if (!triangles.empty())
+	{
+		std::copy(cursor, cursor + triangles.size() * sizeof(triangle<3>), (char *) &triangles[0]);
+		cursor += triangles.size() * sizeof(triangle<3>);
+		std::copy(cursor, cursor + triangle_indices.size() * sizeof(boost::uint32_t), (char *) &triangle_indices[0]);
+	}
+
+	// first child of inner node follows it and second one is further, so traversal only goes
+	// forward and stays inside of arrays
+	for (size_t i = 0; i < nodes.size(); ++i)
+	{
+		node const &n = nodes[i];
+
+		if (n.count != 0)
+		{
+			if (n.count > MAX_LEAF_TRIANGLES || n.offset > triangles.size() || n.count > triangles.size() - n.offset)
+			{
+				throw std::runtime_error("triangle_bvh blob has leaf with invalid triangles");
+			}
+		}
+		else if (i + 1 >= nodes.size() || n.offset <= i + 1 || n.offset >= nodes.size() || n.axis > 2)
+		{
+			throw std::runtime_error("triangle_bvh blob has inner node with invalid children");
+		}
+	}
+
+	nodes_.swap(nodes);
+	triangles_.swap(triangles);
+	triangle_indices_.swap(triangle_indices);
+}
+
+void triangle_bvh::write(util::ArchiveWriter &archive, std::string const &key) const
+{
+	std::vector<char> blob;
+	save(blob);
+	archive.write_data(key, &blob[0], blob.size());
+}
+
+void triangle_bvh::read(util::ArchiveReader &archive, std::string const &key)
+{
+	std::vector<char> blob;
+	archive.read_data(key, blob);
+	load(blob.empty() ? 0 : &blob[0], blob.size());
+}
+
+}
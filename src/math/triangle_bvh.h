@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "vec.h"
+#include "ray.h"
+#include "aabb.h"
+#include "sphere.h"
+#include "triangle.h"
+#include "contact_info.h"
+
+namespace util
+{
+class ArchiveReader;
+class ArchiveWriter;
+}
+
+namespace math
+{
+
+// Bounding volume hierarchy over triangle soup, for raycasts and collision queries against static
+// models. Tree is built by binned surface area heuristic, nodes take 32 bytes and are laid out
+// depth first, so first child of inner node follows it. Triangles are copied to tree in order of
+// leaves, queries report indices of triangles in arrays tree was built from. Built tree could be
+// saved to archive and loaded without building it again.
+class triangle_bvh {
+public:
+	static size_t const MAX_LEAF_TRIANGLES = 4;
+
+	triangle_bvh();
+
+	// each three indices make triangle, vertices are stride bytes apart like positions in vertex structures
+	void build(vec<3> const *vertices, size_t vertex_stride, boost::uint16_t const *indices, size_t nindices);
+	void build(vec<3> const *vertices, size_t vertex_stride, boost::uint32_t const *indices, size_t nindices);
+	void build(std::vector<triangle<3> > const &triangles);
+
+	size_t get_ntriangles() const { return triangles_.size(); }
+	size_t get_nnodes() const { return nodes_.size(); }
+	aabb<3> get_aabb() const;
+
+	// closest hit of r.r0 + r.a * t with t in [0, max_time], normal faces ray origin
+	contact_info<3> trace(ray<3> const &r, scalar max_time = 1, size_t *triangle_index = 0) const;
+	// any hit, faster than trace() as it stops on first triangle found
+	bool test_intersection(ray<3> const &r, scalar max_time = 1) const;
+
+	bool test_intersection(aabb<3> const &bounds) const;
+	bool test_intersection(sphere<3> const &bounds) const;
+	// appends indices of triangles overlapping bounds to result, returns number of them
+	size_t query_triangles(aabb<3> const &bounds, std::vector<size_t> &result) const;
+	size_t query_triangles(sphere<3> const &bounds, std::vector<size_t> &result) const;
+
+	void save(std::vector<char> &blob) const;
+	// throws std::runtime_error when blob is not a saved tree
+	void load(char const *blob, size_t size);
+
+	void write(util::ArchiveWriter &archive, std::string const &key) const;
+	void read(util::ArchiveReader &archive, std::string const &key);
+
+private:
+	struct node
+	{
+		scalar lo[3], hi[3];
+		// first triangle of leaf or index of second child of inner node
+		boost::uint32_t offset;
+		// zero for inner nodes
+		boost::uint16_t count;
+		// axis inner node is split along
+		boost::uint16_t axis;
+	};
+
+	struct build_ref;
+
+	std::vector<node> nodes_;
+	std::vector<triangle<3> > triangles_;
+	std::vector<boost::uint32_t> triangle_indices_;
+
+	void build_node(std::vector<build_ref> &refs, size_t first, size_t count, std::vector<triangle<3> > const &triangles, size_t depth);
+
+	bool trace_nodes(ray<3> const &r, scalar max_time, bool any_hit, scalar &time, size_t &index) const;
+	template<class Bounds> size_t overlap_nodes(Bounds const &bounds, std::vector<size_t> *result) const;
+};
+
+}
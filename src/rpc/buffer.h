@@ -110,7 +110,7 @@ public:
 
 	void consume(size_t size)
 	{
-		memcpy(data_, data_ + size, size_ - size);
+		memmove(data_, data_ + size, size_ - size);
 
 		read_ -= size;
 		write_ -= size;
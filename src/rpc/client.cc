@@ -2,6 +2,8 @@
 #include <deque>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread_time.hpp>
 #include "handler.h"
 #include "connection.h"
 #include "client_service.h"
@@ -17,8 +19,11 @@ class Client::Impl:
 	public boost::noncopyable
 {
 public:
-	Impl():
-		service_(this)
+	Impl(ReceiveCallback const &receive_callback):
+		service_(this),
+		is_connected_(false),
+		have_error_(false),
+		receive_callback_(receive_callback)
 	{
 	}
 
@@ -73,24 +78,59 @@ public:
 	}
 #endif
 
-	boost::tuple<boost::uint16_t, rpc::BufferPtr> receive()
+	Message receive()
 	{
 		boost::unique_lock<boost::mutex> lock(mutex_);
 
-		if (incoming_messages_.empty()) return boost::tuple<boost::uint16_t, rpc::BufferPtr>();
+		if (incoming_messages_.empty()) return Message();
 
-		boost::tuple<boost::uint16_t, rpc::BufferPtr> result = incoming_messages_.front();
+		Message result = incoming_messages_.front();
 		incoming_messages_.pop_front();
 		return result;
 	}
 
+	Message receive(boost::posix_time::time_duration const &timeout)
+	{
+		boost::system_time const deadline = boost::get_system_time() + timeout;
+
+		boost::unique_lock<boost::mutex> lock(mutex_);
+
+		while (incoming_messages_.empty() && !have_error_)
+		{
+			if (!incoming_messages_condition_.timed_wait(lock, deadline)) break;
+		}
+
+		if (incoming_messages_.empty()) return Message();
+
+		Message result = incoming_messages_.front();
+		incoming_messages_.pop_front();
+		return result;
+	}
+
+	size_t receive_all(std::deque<Message> &messages)
+	{
+		messages.clear();
+
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		messages.swap(incoming_messages_);
+		return messages.size();
+	}
+
+	void set_receive_callback(ReceiveCallback const &callback)
+	{
+		boost::unique_lock<boost::mutex> lock(mutex_);
+		receive_callback_ = callback;
+	}
+
 private:
 	mutable boost::mutex mutex_;
+	boost::condition_variable incoming_messages_condition_;
 	rpc::ClientService service_;
 	rpc::ConnectionPtr connection_;
 	bool is_connected_, have_error_;
 	std::string error_message_;
-	std::deque<boost::tuple<boost::uint16_t, rpc::BufferPtr> > incoming_messages_;
+	std::deque<Message> incoming_messages_;
+	ReceiveCallback receive_callback_;
 
     void on_connect(boost::shared_ptr<rpc::Connection> const &connection_ptr)
 	{
@@ -105,8 +145,23 @@ private:
 
 	void on_read(boost::shared_ptr<rpc::Connection> const &connection_ptr, boost::uint16_t id, rpc::Buffer &buf)
 	{
-		boost::unique_lock<boost::mutex> lock(mutex_);
-		incoming_messages_.push_back(boost::make_tuple(id, rpc::BufferPtr(new rpc::Buffer(buf))));
+		rpc::BufferPtr buffer_ptr(new rpc::Buffer(buf));
+		ReceiveCallback callback;
+
+		{
+			boost::unique_lock<boost::mutex> lock(mutex_);
+
+			if (receive_callback_.empty())
+			{
+				incoming_messages_.push_back(boost::make_tuple(id, buffer_ptr));
+				incoming_messages_condition_.notify_one();
+				return;
+			}
+
+			callback = receive_callback_;
+		}
+
+		callback(id, buffer_ptr);
 	}
 
 	void on_error(boost::shared_ptr<rpc::Connection> const &connection_ptr, boost::system::error_code const &error)
@@ -115,6 +170,7 @@ private:
 
 		have_error_ = true;
 		error_message_ = error.message();
+		incoming_messages_condition_.notify_all();
 
 		boost::system::error_code dummy_error_code;
 		LOG_ERROR("error on " << connection_ptr->socket().remote_endpoint(dummy_error_code) << ": " << error);
@@ -131,7 +187,7 @@ Client::~Client()
 
 void Client::connect(std::string const &host, std::string const &port)
 {
-	impl_.reset(new Impl());
+	impl_.reset(new Impl(receive_callback_));
 	impl_->connect(host, port);
 	impl_->start();
 }
@@ -165,9 +221,25 @@ void Client::send(boost::uint16_t id, google::protobuf::Message const &message)
 }
 #endif
 
-boost::tuple<boost::uint16_t, rpc::BufferPtr> Client::receive()
+Client::Message Client::receive()
 {
 	return impl_->receive();
 }
 
+Client::Message Client::receive(boost::posix_time::time_duration const &timeout)
+{
+	return impl_->receive(timeout);
+}
+
+size_t Client::receive_all(std::deque<Message> &messages)
+{
+	return impl_->receive_all(messages);
+}
+
+void Client::set_receive_callback(ReceiveCallback const &callback)
+{
+	receive_callback_ = callback;
+	if (impl_) impl_->set_receive_callback(callback);
+}
+
 }
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <deque>
+#include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #if defined(PROTOBUF_FOUND)
 #include <google/protobuf/message.h>
@@ -16,6 +19,9 @@ namespace rpc
 class Client: public boost::noncopyable
 {
 public:
+	typedef boost::tuple<boost::uint16_t, rpc::BufferPtr> Message;
+	typedef boost::function<void (boost::uint16_t, rpc::BufferPtr const &)> ReceiveCallback;
+
 	Client();
 	~Client();
 
@@ -30,11 +36,23 @@ public:
 	void send(boost::uint16_t id, google::protobuf::Message const &message);
 #endif
 
-	boost::tuple<boost::uint16_t, rpc::BufferPtr> receive();
+	// returns empty message immediately if nothing is queued
+	Message receive();
+
+	// blocks until message arrives, timeout expires or connection fails
+	Message receive(boost::posix_time::time_duration const &timeout);
+
+	// replaces contents of messages with everything queued so far, returns number of messages
+	size_t receive_all(std::deque<Message> &messages);
+
+	// when callback is set messages are not queued but passed to callback on client io thread,
+	// empty callback switches back to queueing
+	void set_receive_callback(ReceiveCallback const &callback);
 
 private:
 	class Impl;
 	boost::scoped_ptr<Impl> impl_;
+	ReceiveCallback receive_callback_;
 };
 
 }
@@ -101,34 +101,32 @@ void Connection::handle_read(BufferPtr const &buffer_ptr,
 
 	buffer_ptr->seek_write(bytes_transferred);
 
-	if (bytes_transferred == 0 ||
-		buffer_ptr->read_bytes_available() < sizeof(Header) ||
-		sizeof(Header) + reinterpret_cast<Header const *>(buffer_ptr->begin_ptr())->len > buffer_ptr->read_bytes_available())
+	// several messages could arrive in one read, dispatch all complete ones before reading again
+	while (buffer_ptr->read_bytes_available() >= sizeof(Header) &&
+		sizeof(Header) + reinterpret_cast<Header const *>(buffer_ptr->begin_ptr())->len <= buffer_ptr->read_bytes_available())
 	{
-		return read(buffer_ptr);
+		Header h;
+		buffer_ptr->read((char *) &h, sizeof(h));
+
+		size_t total_length = h.len + sizeof(Header);
+
+		size_t write_offset_saved = buffer_ptr->write_offset();
+		buffer_ptr->set_write(total_length);
+
+		try
+		{
+			handler_->on_read(shared_from_this(), h.id, *buffer_ptr);
+		}
+		catch(Handler::CloseConnectionException const &)
+		{
+			return;
+		}
+
+		buffer_ptr->set_read(total_length);
+		buffer_ptr->set_write(write_offset_saved);
+		buffer_ptr->consume(total_length);
 	}
 
-	Header h;
-	buffer_ptr->read((char *) &h, sizeof(h));
-
-	size_t total_length = h.len + sizeof(Header);
-
-	size_t write_offset_saved = buffer_ptr->write_offset();
-	buffer_ptr->set_write(total_length);
-
-	try
-	{
-		handler_->on_read(shared_from_this(), h.id, *buffer_ptr);
-	}
-	catch(Handler::CloseConnectionException const &)
-	{
-		return;
-	}
-
-	buffer_ptr->set_read(total_length);
-	buffer_ptr->set_write(write_offset_saved);
-	buffer_ptr->consume(total_length);
-
 	read(buffer_ptr);
 }
 
@@ -0,0 +1,172 @@
+
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#include <rpc/header.h>
+#include <rpc/client.h>
+
+namespace
+{
+
+char const HOST[] = "127.0.0.1";
+char const SERVICE[] = "17172";
+
+size_t const NMESSAGES = 16;
+
+struct Server
+{
+	boost::asio::io_service io_service;
+	boost::asio::ip::tcp::acceptor acceptor;
+	boost::asio::ip::tcp::socket socket;
+
+	Server():
+		acceptor(io_service),
+		socket(io_service)
+	{
+		boost::asio::ip::tcp::resolver resolver(io_service);
+		boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(boost::asio::ip::tcp::resolver::query(HOST, SERVICE));
+
+		acceptor.open(endpoint.protocol());
+		acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+		acceptor.bind(endpoint);
+		acceptor.listen();
+	}
+
+	void accept()
+	{
+		acceptor.accept(socket);
+	}
+
+	void send(boost::uint16_t id)
+	{
+		std::vector<char> message(sizeof(rpc::Header) + id);
+
+		rpc::Header *h = (rpc::Header *) &message[0];
+		h->id = id;
+		h->len = id;
+		for (size_t j = 0; j < id; j++) message[sizeof(rpc::Header) + j] = (char) j;
+
+		boost::asio::write(socket, boost::asio::buffer(message));
+	}
+};
+
+void check_message(boost::uint16_t id, rpc::BufferPtr const &buffer_ptr)
+{
+	BOOST_REQUIRE (buffer_ptr);
+	BOOST_REQUIRE (buffer_ptr->read_bytes_available() == id);
+
+	std::vector<char> message(id);
+	if (!message.empty()) buffer_ptr->read(&message[0], message.size());
+	for (size_t j = 0; j < message.size(); j++) BOOST_REQUIRE (message[j] == (char) j);
+}
+
+struct Collector
+{
+	boost::mutex mutex;
+	std::vector<boost::uint16_t> ids;
+
+	void on_message(boost::uint16_t id, rpc::BufferPtr const &buffer_ptr)
+	{
+		check_message(id, buffer_ptr);
+
+		boost::unique_lock<boost::mutex> lock(mutex);
+		ids.push_back(id);
+	}
+
+	size_t size()
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		return ids.size();
+	}
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(test_client)
+
+BOOST_AUTO_TEST_CASE(test_receive_timeout)
+{
+	Server server;
+	rpc::Client client;
+
+	client.connect(HOST, SERVICE);
+	server.accept();
+
+	rpc::Client::Message message = client.receive(boost::posix_time::milliseconds(10));
+	BOOST_REQUIRE (!message.get<1>());
+
+	for (boost::uint16_t id = 0; id < NMESSAGES; ++id)
+	{
+		server.send(id);
+
+		message = client.receive(boost::posix_time::seconds(10));
+		BOOST_REQUIRE (message.get<0>() == id);
+		check_message(id, message.get<1>());
+	}
+
+	client.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(test_receive_all)
+{
+	Server server;
+	rpc::Client client;
+
+	client.connect(HOST, SERVICE);
+	server.accept();
+
+	for (boost::uint16_t id = 0; id < NMESSAGES; ++id) server.send(id);
+
+	std::deque<rpc::Client::Message> messages;
+	std::vector<boost::uint16_t> ids;
+
+	while (ids.size() < NMESSAGES)
+	{
+		rpc::Client::Message message = client.receive(boost::posix_time::seconds(10));
+		BOOST_REQUIRE (message.get<1>());
+		ids.push_back(message.get<0>());
+
+		client.receive_all(messages);
+
+		for (std::deque<rpc::Client::Message>::const_iterator it = messages.begin(); it != messages.end(); ++it)
+		{
+			ids.push_back(it->get<0>());
+		}
+	}
+
+	for (boost::uint16_t id = 0; id < NMESSAGES; ++id) BOOST_REQUIRE (ids[id] == id);
+
+	BOOST_REQUIRE (client.receive_all(messages) == 0);
+	BOOST_REQUIRE (messages.empty());
+
+	client.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(test_receive_callback)
+{
+	Server server;
+	rpc::Client client;
+	Collector collector;
+
+	client.set_receive_callback(boost::bind(&Collector::on_message, &collector, _1, _2));
+	client.connect(HOST, SERVICE);
+	server.accept();
+
+	for (boost::uint16_t id = 0; id < NMESSAGES; ++id) server.send(id);
+
+	for (size_t i = 0; i < 1000 && collector.size() < NMESSAGES; ++i)
+	{
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+
+	BOOST_REQUIRE (collector.size() == NMESSAGES);
+	for (boost::uint16_t id = 0; id < NMESSAGES; ++id) BOOST_REQUIRE (collector.ids[id] == id);
+	BOOST_REQUIRE (!client.receive().get<1>());
+
+	client.disconnect();
+}
+
+BOOST_AUTO_TEST_SUITE_END()